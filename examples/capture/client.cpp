@@ -3,6 +3,7 @@
 #include <vector>
 #include <string>
 #include <fstream>
+#include <memory>
 
 #include <atomic>
 #include <thread>
@@ -23,6 +24,7 @@ using namespace scap;
 using payload_t =  srfc_connection::payload_t;
 using status_t = srfc_connection::status_t;
 using params_t = srfc_connection::params_t;
+using chunk_source_t = srfc_connection::chunk_source_t;
 
 std::string SCAP_DIR =  "scrshots/";
 static std::string local_display = "";
@@ -31,7 +33,7 @@ static status_t PRINT_callback(const params_t&,payload_t,payload_t*,std::size_t*
 static status_t RUN_SCAP_callback(const params_t&,payload_t,payload_t*,std::size_t*);
 static status_t STOP_SCAP_callback(const params_t&,payload_t,payload_t*,std::size_t*);
 static status_t LIST_SCAP_callback(const params_t&,payload_t,payload_t*,std::size_t*);
-static status_t GETFILE_SCAP_callback(const params_t&,payload_t,payload_t*,std::size_t*);
+static status_t GETFILE_SCAP_callback(const srfc_message_view&,chunk_source_t*);
 
 // flag to store the __scap_thread__ state (running / not started)
 // used to stop screen capturing 
@@ -74,7 +76,15 @@ void run_client(std::string address, std::string port, std::string display)
     connection.add_method("RUN_SCAP", RUN_SCAP_callback);
     connection.add_method("STOP_SCAP", STOP_SCAP_callback);
     connection.add_method("LIST_SCAP", LIST_SCAP_callback);
-    connection.add_method("GETFILE_SCAP", GETFILE_SCAP_callback);
+    // Files are streamed in chunks, so neither side holds the whole file in memory
+    connection.add_method("GETFILE_SCAP", srfc_connection::stream_callback_t(GETFILE_SCAP_callback));
+
+    // Screenshots (raw PPM) compress well. zstd is used if both sides are built with it,
+    // the built-in codec otherwise
+    connection.set_compression(payload_codec::zstd);
+
+    // Large screenshots and files are checked end to end
+    connection.set_checksum(frame_checksum::crc32c);
 
     // Invoke deferred conneciton
     // Since now, connection starts listening for the incoming requests and responces
@@ -217,33 +227,42 @@ static status_t LIST_SCAP_callback(
 }
 
 static status_t GETFILE_SCAP_callback(
-    const params_t& params,
-    payload_t pld, 
-    payload_t* rpld, 
-    std::size_t* rpld_sz)
+    const srfc_message_view& request,
+    chunk_source_t* source)
 {   
     std::cout << "GETFILE_SCAP srfc-request received" << std::endl;
 
     std::string filename;
     try{
         // throws if not found
-        filename = get_param(params, "NAME");
+        filename = std::string(request.getParam("NAME"));
     }
     catch(...) {
         return status_codes::invalid_arguments;
     }
 
-    // Read file:
-    std::ifstream ifs(SCAP_DIR + get_separator() + filename, std::ios::binary);
-    if(!ifs.is_open()) {
-        std::string what = "Error: cannot open file " + filename + ".";
-        set_payload_msg(rpld, what, rpld_sz); // Sets rpld and rpld_sz;
+    // Open file:
+    auto ifs = std::make_shared<std::ifstream>(SCAP_DIR + get_separator() + filename, std::ios::binary);
+    if(!ifs->is_open()) {
+        // the error message is sent as the only chunk:
+        auto what = std::make_shared<std::string>("Error: cannot open file " + filename + ".");
+        *source = [what](char* buf, std::size_t size) {
+            const auto n = what->copy(buf, size);
+            what->erase(0, n);
+            return n;
+        };
     
         return status_codes::execution_error; 
     }
 
-    std::vector<char> buffer(std::istreambuf_iterator<char>(ifs), {});
-    set_payload_data(rpld, rpld_sz, buffer.data(), buffer.size()); // Sets rpld and rpld_sz;
+    // The file is read chunk by chunk as the receiver consumes it:
+    *source = [ifs](char* buf, std::size_t size) {
+        ifs->read(buf, size);
+        if(ifs->bad()) {
+            throw std::runtime_error("GETFILE_SCAP_callback(): read error");
+        }
+        return static_cast<std::size_t>(ifs->gcount());
+    };
 
     return status_codes::ok;
 }
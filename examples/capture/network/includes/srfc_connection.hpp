@@ -4,28 +4,66 @@
 #include <string>
 #include <functional>
 #include <vector>  
+#include <array>
+#include <deque>
+#include <memory>
 #include <unordered_map>
 
+#include <chrono>
 #include <future>
 #include <mutex>
-#include <thread>
 #include <condition_variable>
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <optional>
 
+#include "srfc_frame.hpp"
+#include "srfc_codec.hpp"
+#include "srfc_handshake.hpp"
 #include "srfc_request.hpp"
 #include "srfc_response.hpp"
+#include "srfc_message_view.hpp"
+#include "srfc_frame_parser.hpp"
+#include "srfc_method_registry.hpp"
+#include "srfc_marshal.hpp"
+#include "srfc_receive_buffer.hpp"
+#include "srfc_timer_wheel.hpp"
+#include "srfc_reactor.hpp"
+#include "srfc_task.hpp"
 
 namespace net 
 {
 
+// Memory held by a connection (see srfc_connection::set_memory_budget()):
+struct srfc_memory_usage
+{
+    std::size_t inbound = 0;        // unread received bytes and the requests being handled
+    std::size_t outbound = 0;       // frames waiting to be written
+    std::size_t budget = 0;
+    bool reading_paused = false;    // the connection is over the budget (or the executor is full)
+};
+
 class srfc_connection 
 {
+    friend class srfc_listener;     // places the accepted connections on the loop of their shard
+
 public:
     using params_t = srfc_request::params_t;
     using payload_t = srfc_request::payload_t;
     using status_t = srfc_response::status_t;
     using serialized_t = srfc_request::serialized_t;
-    using callback_t = std::function<status_t(const params_t&, payload_t, payload_t*, std::size_t*)>;
+    using callback_t = srfc_method_table::callback_t;
+    using view_callback_t = srfc_method_table::view_callback_t;
+    using task_callback_t = srfc_method_table::task_callback_t;
+    using chunk_source_t = srfc_method_table::chunk_source_t;
+    using stream_callback_t = srfc_method_table::stream_callback_t;
+    using chunk_handler_t = std::function<void(const char*, std::size_t)>;
+    using completion_t = std::function<void(srfc_response)>;
     using id_t = srfc_request::id_t;
+
+    class request_awaiter;
+    class response_awaiter;
     
     // For WinAPI: Even though sizeof(SOCKET) is 8, it's safe to cast it to int, because
     // the value constitutes an index in per-process table of limited size and not a real pointer.
@@ -38,7 +76,7 @@ public:
 
     // Move operations:
     // Is ONLY VALID on deferred objects. 
-    // If *this still has an associated running thread (i.e. joinable() == true), throws throw std::logic_error
+    // If *this is still registered in the reactor, throws throw std::logic_error
     srfc_connection(srfc_connection&& other);
     srfc_connection& operator=(srfc_connection&& other);
 
@@ -49,16 +87,168 @@ public:
     ~srfc_connection();
 
     // Manipulating the method map:
-    void        add_method(std::string methodName, callback_t methodCallback);
-    bool        remove_method(std::string methodName);
-    callback_t  get_method(std::string methodName) const;
-    bool        has_method(std::string methodName) const;
+    // Methods added with view_callback_t receive the request as a view into the receive buffer.
+    // Methods added with task_callback_t are coroutines: the response they co_return
+    // (its request id is set by the connection) is sent when they finish. 
+    // Methods added with stream_callback_t stream the response payload in chunks (see send_streaming_request).
+    // reset() and the destructor wait for the running methods, so they must not be called from them.
+    // The get_*method() functions throw std::out_of_range if no method of the kind is found
+    void                add_method(std::string methodName, callback_t methodCallback);
+    void                add_method(std::string methodName, view_callback_t methodCallback);
+    void                add_method(std::string methodName, task_callback_t methodCallback);
+    void                add_method(std::string methodName, stream_callback_t methodCallback);
+    bool                remove_method(std::string methodName);
+    callback_t          get_method(std::string methodName) const;
+    view_callback_t     get_view_method(std::string methodName) const;
+    task_callback_t     get_task_method(std::string methodName) const;
+    stream_callback_t   get_stream_method(std::string methodName) const;
+    bool                has_method(std::string methodName) const;
+
+    // Typed methods (see srfc_marshal.hpp):
+    // add_method<R(Args...)>() adds the method taking the arguments from the request payload and returning
+    // the result in the response payload (as a view method). Requests whose payload doesn't match the signature
+    // get status_codes::bad_request. call<R(Args...)>() sends the arguments to the method of the peer;
+    // the future gets the result, or srfc_call_error if the method returns another status than status_codes::ok
+    template<typename Sig, typename Method>
+    void    add_method(std::string methodName, Method method);
+    template<typename Sig, typename... Args>
+    std::future<typename marshal_detail::signature<Sig>::result_t>  call(std::string methodName, const Args&... args);
+
+    // Handshake (see srfc_handshake.hpp):
+    // When the connection starts (on connect() or invoke_deferred(), and on accept), both sides announce
+    // the wire formats, codecs and checksums they accept, the largest frame they accept and their stream window.
+    // The method name __SRFC_HELLO__ is reserved for that. Until the capabilities of the peer are received,
+    // messages are sent in SRFCv1 without compression. After that:
+    //  - the selected wire format and codec are used if the peer accepts them;
+    //  - requests (and batches) larger than the max frame size of the peer aren't sent: their completion gets
+    //    status_codes::frame_too_large;
+    //  - streamed responses have at most the stream window of the peer in flight.
+    //  - requests name the method by the id the peer has announced for it (see srfc_method_table),
+    //    so the peer dispatches them by indexing its table. Methods added later are named as usual.
+    // The limits are announced on the next connection. wait_handshake() returns false if the peer hasn't answered
+    // in time or the connection was closed. get_peer_capabilities() returns nothing until the peer has answered
+    // (and legacy_capabilities() for the peers which don't handshake)
+    void        set_max_frame_size(std::size_t bytes) noexcept;     // at least min_max_frame_size
+    std::size_t get_max_frame_size() const noexcept;
+    void        set_stream_window(std::size_t bytes) noexcept;
+    std::size_t get_stream_window() const noexcept;
+    bool        wait_handshake(std::chrono::milliseconds timeout) const;
+    std::optional<srfc_capabilities> get_peer_capabilities() const;
+
+    // Selecting the wire format (codec) of the outgoing messages. SRFCv1 is used if the peer doesn't accept it.
+    // Incoming messages are accepted in any supported wire format:
+    void        set_wire_format(wire_format fmt) noexcept;
+    wire_format get_wire_format() const noexcept;
+
+    // Payload compression of the outgoing messages (see srfc_codec.hpp).
+    // The selected codec is used if the peer accepts it; otherwise the built-in lz77 is used if the peer
+    // accepts that, and payloads are sent as is to the older peers.
+    // Small and incompressible payloads are sent as is, and so are batches. Chunks are compressed one by one,
+    // and the stream credit counts the uncompressed bytes. Received payloads are decompressed before
+    // the handlers see them (requests on the shared srfc_executor, other frames on the I/O thread);
+    // a corrupted request, or one larger than the max frame size once decompressed, gets status_codes::bad_request;
+    // other such frames are dropped.
+    // Default: payload_codec::none
+    void            set_compression(payload_codec codec) noexcept;
+    payload_codec   get_compression() const noexcept;
 
-    // Sending requests and responses: 
+    // Checksum of the outgoing frames (see srfc_checksum.hpp). The checksum is sent if the peer accepts it,
+    // and received frames are verified whenever they carry one. A frame with the wrong checksum means
+    // the stream is corrupted, so the connection is shut down (pending requests get status_codes::connection_error).
+    // Default: frame_checksum::none
+    void            set_checksum(frame_checksum checksum) noexcept;
+    frame_checksum  get_checksum() const noexcept;
+
+    // Memory budget of the connection:
+    // Received frames larger than the max frame size (see set_max_frame_size()) close the connection as soon as
+    // their preamble/header is read. The budget caps the memory the peer makes the connection hold:
+    // the received requests being handled and the responses queued for it. Over the budget, the connection
+    // stops reading, so TCP pushes back on the peer, and resumes when the memory is released.
+    // Requests that would take the outbound queue over the budget aren't sent: their completion gets
+    // status_codes::memory_budget_exceeded. Compressed payloads are charged with their decompressed size
+    // before they're decompressed; a received request that doesn't fit gets status_codes::memory_budget_exceeded,
+    // and so does the pending request whose response (or chunk) doesn't fit.
+    // So a connection holds about the budget plus one max frame at most.
+    // Default: default_memory_budget (at least min_max_frame_size)
+    static constexpr std::size_t default_memory_budget = 256 * 1024 * 1024;
+    void                set_memory_budget(std::size_t bytes) noexcept;
+    std::size_t         get_memory_budget() const noexcept;
+    srfc_memory_usage   get_memory_usage() const noexcept;
+
+    // Sending requests and responses:
+    // Messages are queued and written to the socket by the I/O thread owning the connection.
+    // The future returned by send_request() becomes ready when the response is received
+    // (or with status_codes::connection_error if the connection is closed before that).
+    // If the timeout is given and no response is received in time, the future becomes ready
+    // with status_codes::response_timeout. Late responses are dropped.
+    // The future returned by send_response() becomes ready when the response is written.
+    //
+    // Frames are queued in the lane of their priority (see frame_priority): high-priority frames are written
+    // before the queued normal and bulk ones, and wait for one partially written frame at most.
+    // Responses inherit the priority of the request. Response payloads larger than stream_chunk_size
+    // are sent as chunks, so they can be interleaved with other frames; request payloads are sent whole.
     std::future<srfc_response>  send_request(const srfc_request& request);
+    std::future<srfc_response>  send_request(const srfc_request& request, std::chrono::milliseconds timeout);
     std::future<void>           send_response(const srfc_response& response);
 
+    // Continuation-style variants: the callback is invoked with the response (or the error response,
+    // as the future above) on the shared srfc_executor. See also when_all() and when_any()
+    void    send_request(const srfc_request& request, completion_t callback);
+    void    send_request(const srfc_request& request, std::chrono::milliseconds timeout, completion_t callback);
+
+    // Streamed responses:
+    // A stream method returns the status and sets the chunk source. The source is called on the shared
+    // srfc_executor to fill the next chunk (up to the given size) and returns 0 at the end of the data.
+    // Chunks are sent while the receiver grants credit, and the response with the status
+    // (and no payload) follows the last one. If the source throws, the status is status_codes::unhandled_exception.
+    //
+    // send_streaming_request() passes the chunks to onChunk in order, one at a time, on the shared srfc_executor.
+    // The credit for a chunk is granted when onChunk returns, so a slow receiver slows the sender down
+    // and at most stream_window bytes of a stream are buffered on either side (the queued chunks count
+    // in the memory budget). A chunk beyond the granted credit fails the request
+    // with status_codes::memory_budget_exceeded.
+    // The future becomes ready after the last onChunk call. If onChunk throws, the rest of the chunks
+    // is dropped and the response gets status_codes::unhandled_exception.
+    // Responses of other methods are returned as usual; send_request() collects the chunks into the payload
+    // (on the I/O thread, so a handler may wait for its future; handlers mustn't wait for the futures
+    // of send_streaming_request(), see srfc_executor)
+    std::future<srfc_response>  send_streaming_request(const srfc_request& request, chunk_handler_t onChunk);
+    std::future<srfc_response>  send_streaming_request(const srfc_request& request, std::chrono::milliseconds timeout, 
+                                                       chunk_handler_t onChunk);
+
+    // Batched requests:
+    // The requests are packed into one frame. The peer parses them together and calls their methods
+    // one after another on one srfc_executor task; the responses are returned in one frame
+    // (responses of coroutine and stream methods, and responses larger than stream_chunk_size, are sent on their own).
+    // The batch is written in the lane of its highest priority. Every request keeps its id, timeout and
+    // completion slot, so it can be cancelled on its own. The future becomes ready when all responses are received,
+    // in the order of the requests (with the error responses as in send_request()). Intended for many small calls
+    std::future<std::vector<srfc_response>>  send_batch(const std::vector<srfc_request>& requests);
+    std::future<std::vector<srfc_response>>  send_batch(const std::vector<srfc_request>& requests, 
+                                                        std::chrono::milliseconds timeout);
+
+    static constexpr std::size_t stream_chunk_size = 64 * 1024;         // maximum chunk payload
+    static constexpr std::size_t stream_window = 4 * stream_chunk_size; // credit granted up front
+
+    // Cancels the request sent over this connection. Its completion (future, callback or awaiter) gets
+    // status_codes::request_cancelled at once, and the chunks and the response received later are dropped.
+    // A request that is still queued isn't sent at all. Otherwise a cancel frame is sent to the peer, which
+    // skips the handler if it hasn't started yet, raises the cancellation token of the running one
+    // (srfc_message_view::getCancellationToken()), stops the chunk source of a stream method and drops
+    // the queued chunks and response. Requests that time out and streams whose onChunk throws are cancelled
+    // the same way. Returns false if the request isn't pending
+    bool    cancel(id_t requestId);
+
+    // co_await-able variants of the above. The request is sent when it is awaited.
+    // The awaiting coroutine is resumed on the shared srfc_executor with the response
+    // (or when the response is written); no thread waits for it
+    request_awaiter     async_send_request(srfc_request request);
+    request_awaiter     async_send_request(srfc_request request, std::chrono::milliseconds timeout);
+    response_awaiter    async_send_response(srfc_response response);
+
     // Manipulating the connection:
+    // Connected sockets are served by the shared srfc_reactor; received requests are handled
+    // on the shared srfc_executor. No threads are owned by the connection.
     void    connect(unsigned int port, std::string address, bool deferred = false);
     void    connect(socket_t socketFd, bool deferred = false);
     void    invoke_deferred();
@@ -67,46 +257,365 @@ public:
     void    reset();
 
 protected:
-    void            handle_request(srfc_request request); 
-    void            handle_response(srfc_response response);             
-    srfc_response   __send_request__(const srfc_request& request);
-    void            __send_response__(const srfc_response& response);
+    void            handle_request(const srfc_message_view& request); 
+    srfc_response   call_method(const srfc_message_view& request,       // of callback_t and view_callback_t methods
+                                const srfc_method_table::method* method);
+    void            handle_batch(std::vector<srfc_message_view>& requests, frame_priority priority);  // decompresses the payloads
+    srfc_task<>     handle_task_request(task_callback_t method, srfc_message_view request);
+    void            finish_handler();
+    void            handle_response(const srfc_message_view& response);             
+    void            handle_chunk(const srfc_message_view& chunk, std::size_t inflated);  // keeps the charge of the payload
+    void            handle_credit(const srfc_message_view& credit);
+    void            handle_cancel(const srfc_message_view& cancel);
+    void                __send_request__(const srfc_request& request);
+    std::future<void>   __send_response__(const srfc_response& response);
+    void                __send_response__(const srfc_response& response, std::function<void(std::exception_ptr)> written);
+    void                __send_stream_frame__(frame_type type, id_t requestId, payload_t payload, std::size_t size,
+                                              frame_priority priority,
+                                              std::optional<std::uint32_t> payloadCrc = std::nullopt);
+    void                __send_batch__(const std::vector<srfc_request>& requests);
+    void                __send_batch__(const std::vector<srfc_response>& responses, frame_priority priority);
 
 private:
+    // Message waiting in the outbound queue:
+    struct outbound_frame
+    {
+        serialized_t header;
+        std::size_t header_size = 0;
+        payload_t payload;
+        std::size_t payload_size = 0;
+        std::array<char, checksum_trailer_size> trailer{};
+        std::size_t trailer_size = 0;                       // 0 if the frame has no checksum
+        bool reply = true;                                  // sent in reply to the peer (not a request of this side)
+        std::function<void(std::exception_ptr)> written;    // empty if nobody waits for the write. nullptr on success
+        frame_priority priority = frame_priority::normal;   // selects the lane
+        frame_type type = frame_type::request;
+        id_t request_id = 0;
+    };
+
+    // The blocks of the frames taken by the send in flight (completions), and copies of their trailers:
+    struct send_hold
+    {
+        std::vector<std::shared_ptr<char>> blocks;
+        std::vector<std::array<char, checksum_trailer_size>> trailers;
+    };
+
+    // Reactor handlers (called on the I/O thread owning the socket).
+    // If the reactor completes the I/O, the data comes to on_received() and the gather-writes of on_writable()
+    // are submitted to the reactor and finished by on_sent(). Otherwise the handlers read and write the socket:
+    void            start_io();
+    void            on_io(std::uint32_t events);
+    void            on_readable(bool closed);   // closed: read even if reading is paused
+    void            on_writable();
+    void            on_received(const char* data, std::size_t size);
+    void            on_sent(std::ptrdiff_t sent);
+    void            on_written(std::size_t sent);   // removes the written frames
+    void            shutdown_from_io();     // shuts the connection down unless another thread is doing it
+    void            close_io();             // the body of shutdown(). Called with shutdown_mutex held
+
     // Platform-dependent methods:
-    void              __listener__();                                         // platform-dependent implementation
-    void              __connect__(unsigned int port, std::string address);    // platform-dependent implementation
-    void              __send__(const void *buf, std::size_t len);             // platform-dependent implementation   
-    std::vector<char> __receive__();                                          // platform-dependent implementation
-    void              __shutdown__();                                         // platform-dependent implementation
-    void              __close__();                                            // platform-dependent implementation
-
-    // Manipulating the response queue:
-    void            add_response(const srfc_response& response);
-    bool            received_response(id_t request_id) const;
-    srfc_response   read_response(id_t response_id);
+    // __read_some__ and __write_some__ return -1 if the operation would block
+    void              __connect__(unsigned int port, std::string address);        // platform-dependent implementation
+    void              __set_nonblocking__();                                      // platform-dependent implementation
+    std::ptrdiff_t    __read_some__(char* buf, std::size_t len);                  // platform-dependent implementation
+    std::ptrdiff_t    __write_some__(const const_buffer* bufs, std::size_t count);// platform-dependent implementation   
+    void              __shutdown__();                                             // platform-dependent implementation
+    void              __close__();                                                // platform-dependent implementation
+
+    // Passes every complete message in the buffer (and in the received batches) to the handlers:
+    void            dispatch_received();
+    void            dispatch_batch(const srfc_message_view& batch);
+
+    // Manipulating the outbound queue:
+    // remove_outbound() removes the queued frames matching the predicate, except the ones being written,
+    // and returns their number
+    void            enqueue(outbound_frame frame);
+    void            fail_outbound();
+    std::size_t     remove_outbound(const std::function<bool(const outbound_frame&)>& match);
+    static std::size_t size_of(const outbound_frame& frame) noexcept;
+
+    // Memory budget:
+    // over_budget() tells whether the peer makes the connection hold too much (the requests being handled
+    // and the replies queued). pause_reading() stops reading until resume_reading() finds it below the budget.
+    // release_handled() is called when the handlers of the received frames are done
+    // charge_inflated() charges the budget with the decompressed size of the received payload before it's
+    // decompressed, and returns false (charging nothing) if it doesn't fit. reject_inflated() fails that message
+    bool            over_budget() const noexcept;
+    void            pause_reading();
+    void            resume_reading();
+    void            release_handled(std::size_t bytes);
+    bool            charge_inflated(const srfc_message_view& message, std::size_t* pBytes);
+    void            reject_inflated(const srfc_message_view& message);
+
+    // Tasks are passed to the shared executor without blocking: the I/O threads mustn't wait for the workers,
+    // which may wait for the responses read by these threads. When the executor is full, submit_task() keeps
+    // the tasks and stops reading until submit_deferred() passes them on (once a worker takes a task)
+    void            submit_task(std::function<void()> task);
+    void            submit_deferred();
+
+    // Manipulating the table of pending requests:
+    // The slot is completed either through the future or by calling the completion (in place)
+    std::future<srfc_response>  add_pending(id_t requestId);
+    void                        add_pending(id_t requestId, completion_t completion);
+    bool                        drop_pending(id_t requestId);
+    std::future<std::vector<srfc_response>>  add_batch_pending(const std::vector<srfc_request>& requests);
+    void                        set_pending_deadline(id_t requestId, std::chrono::milliseconds timeout);
+    bool                        complete_pending(srfc_response response);
+    void                        fail_pending();
+    void                        withdraw_request(id_t requestId);   // the peer drops the request (see cancel())
+    bool                        abort_pending(id_t requestId, status_t status);    // withdraws and completes it
+
+    // Manipulating the table of received requests:
+    // finish_request() returns false if the request was cancelled, so its response isn't sent
+    void            register_request(srfc_message_view& request);
+    bool            finish_request(id_t requestId, const std::shared_ptr<std::atomic_bool>& cancelled);
+    void            cancel_requests();
+
+    // Handshake:
+    // send_hello() announces the capabilities, handle_hello() applies the ones of the peer and answers.
+    // finish_handshake() is called with the answer of the peer (or the error if the connection is closed).
+    // send_format(), send_codec() and send_checksum() select the wire format, the codec and the checksum
+    // of the outgoing messages. The frames of a feature are sent only if peer_accepts() it
+    void            send_hello();
+    void            handle_hello(const srfc_message_view& hello);
+    void            finish_handshake(status_t status);
+    std::uint32_t   peer_method_id(const std::string& methodName) const;   // no_method_id if not announced
+    wire_format     send_format() const noexcept;
+    payload_codec   send_codec() const noexcept;
+    frame_checksum  send_checksum() const noexcept;
+    bool            peer_accepts(srfc_feature feature) const noexcept;
+
+    // seal() computes the trailer of the frame serialized with the checksum. payloadCrc is the checksum
+    // of the payload computed as it was produced (packed into a batch or filled by a stream source);
+    // without it the payload is read once more (the shared payloads of the messages and the compressed ones)
+    static void     seal(outbound_frame& frame, frame_checksum checksum,
+                         std::optional<std::uint32_t> payloadCrc = std::nullopt);
+
+    // inflate() decompresses the received payload in place. Returns false if it's corrupted, larger than
+    // the max frame size once decompressed or can't be allocated (like a frame that can't be received):
+    bool            inflate(srfc_message_view& message) const;
+
+    // resolve_method() looks the method of the received request up by its id (or by its name) on the I/O thread,
+    // and the request keeps it until it's handled. find_method() returns it (nullptr if there is none):
+    void                                        resolve_method(srfc_message_view& request);
+    static const srfc_method_table::method*    find_method(const srfc_message_view& request) noexcept;
 
     // Fields:
 
-    std::unordered_map<std::string, callback_t> callback_map;
-    std::vector<srfc_response> response_queue; // change conatiner to std::set
+    srfc_method_registry methods;
+    srfc_method_registry::table_ptr io_methods;     // snapshot used by the I/O thread
+    std::uint64_t io_methods_version = 0;           // version of the snapshot (0 is never published)
+
+    struct inbound_stream;
+
+    // Completion slot of the request waiting for the response:
+    struct pending_call
+    {
+        std::promise<srfc_response> promise;
+        completion_t completion;                // called instead of the promise, if set
+        srfc_timer_wheel::timer_id timer = 0;   // deadline timer (0 if no timeout)
+        std::shared_ptr<inbound_stream> stream; // received chunks (created by the first chunk if not streaming)
+
+        void finish(srfc_response response);
+    };
+    void                        insert_pending(id_t requestId, pending_call slot);
+
+    // Receiving side of a streamed response. Chunks are handled one at a time by drain_stream(),
+    // and the slot is completed when all of them are handled:
+    struct inbound_stream
+    {
+        chunk_handler_t on_chunk;               // collects the chunks into the payload, if empty
+        std::vector<char> collected;
+        std::mutex mutex;
+        std::deque<std::pair<srfc_message_view, std::size_t>> chunks;  // received, not yet handled (and their charge)
+        std::size_t credit = 0;                 // bytes the sender may still send (starts with the announced window)
+        std::optional<pending_call> slot;       // set when the response is received
+        std::optional<srfc_response> response;
+        bool draining = false;                  // drain_stream() is scheduled (or running)
+        bool failed = false;                    // on_chunk has thrown
+        std::atomic_bool abandoned{false};      // the slot was completed without the chunks (timeout, etc.)
+    };
+
+    // Sending side of a streamed response (or of a large one, sent as the chunks of its payload):
+    struct outbound_stream
+    {
+        chunk_source_t source;
+        payload_t data;                         // of the large response (read instead of the source)
+        std::size_t data_size = 0;
+        std::size_t offset = 0;                 // of the next chunk of the data
+        std::optional<srfc_response> response;  // the large response without payload, sent after the chunks
+        std::function<void(std::exception_ptr)> written;    // of the large response, under stream_mutex
+        status_t status = status_codes::ok;
+        frame_priority priority = frame_priority::normal;
+        std::shared_ptr<std::atomic_bool> cancelled;    // of the request
+        std::size_t credit = stream_window;     // bytes the receiver accepts (starts with its stream window)
+        bool pumping = false;                   // a pump_stream() task is running
+        bool closed = false;                    // cancelled by the receiver or failed, under stream_mutex
+    };
+
+    // Manipulating the streams:
+    // schedule_drain() drains the stream on the executor, or in place if send_request() collects the chunks
+    void            schedule_drain(id_t requestId, std::shared_ptr<inbound_stream> stream);
+    void            drain_stream(id_t requestId, const std::shared_ptr<inbound_stream>& stream);
+    void            abandon_stream(id_t requestId, const std::shared_ptr<inbound_stream>& stream);
+    void            grant_credit(id_t requestId, std::size_t bytes);
+    void            start_stream(const srfc_message_view& request, status_t status, chunk_source_t source);
+    bool            stream_response(const srfc_response& response, std::function<void(std::exception_ptr)>& written);
+    void            pump_stream(id_t requestId, const std::shared_ptr<outbound_stream>& stream);
+    static std::function<void(std::exception_ptr)> close_stream(outbound_stream& stream);   // under stream_mutex
+    void            fail_streams();
+
+    std::unordered_map<id_t, pending_call> pending_requests; // completion slot per request id
+    std::unordered_map<id_t, std::shared_ptr<outbound_stream>> outbound_streams;   // under stream_mutex
+    std::unordered_map<id_t, std::shared_ptr<std::atomic_bool>> received_requests; // cancellation flag of the handled ones
     socket_t socket_fd = 0;
+    std::atomic<wire_format> wire_fmt{wire_format::srfc_v1};
+    std::atomic<payload_codec> compression{payload_codec::none};
+    std::atomic<frame_checksum> checksum{frame_checksum::none};
+    std::atomic<std::size_t> max_frame_size{default_max_frame_size};
+    std::atomic<std::size_t> receive_window{stream_window};
+    std::atomic<std::size_t> announced_window{stream_window};  // receive_window sent in the hello
+    std::atomic<std::size_t> memory_budget{default_memory_budget};
+
+    // Memory accounting (see set_memory_budget()):
+    std::atomic<std::size_t> buffered_bytes{0};     // unread bytes of the receive buffer (stored by the I/O thread)
+    std::atomic<std::size_t> handled_bytes{0};      // received requests (and batches) passed to the handlers
+    std::atomic<std::size_t> queued_bytes{0};       // frames in the outbound queue. Changed under outbound_mutex
+    std::atomic<std::size_t> queued_replies{0};     // the part of queued_bytes sent in reply to the peer
+    std::atomic_bool reading_paused{false};
+    std::deque<std::function<void()>> deferred_tasks;  // under deferred_mutex. The executor was full
+    std::mutex deferred_mutex;
+    std::atomic_bool executor_full{false};          // deferred_tasks isn't empty
 
-    std::atomic_bool connected{false};     // setted true ONLY in the connect() function, setted false ONLY in the shutdown()           
-    std::atomic_bool terminate_listener{false}; // setted ONLY in the destructor;
-    std::atomic_bool idleable{true};
+    // Capabilities of the peer. The atomics are used by the senders (legacy values until the hello of the peer):
+    using method_ids_t = std::unordered_map<std::string, std::uint32_t>;
+    std::optional<srfc_capabilities> peer_caps;     // under handshake_mutex
+    std::shared_ptr<const method_ids_t> peer_methods;   // under handshake_mutex. Ids announced by the peer
+    bool handshaken = false;                        // under handshake_mutex. The peer has answered
+    mutable std::mutex handshake_mutex;
+    mutable std::condition_variable handshake_cv;
+    std::atomic<std::uint8_t> peer_formats{0};
+    std::atomic<std::uint8_t> peer_codecs{0};
+    std::atomic<std::uint8_t> peer_checksums{0};
+    std::atomic<std::size_t> peer_max_frame{0};
+    std::atomic<std::size_t> peer_window{stream_window};
+    std::atomic<std::uint8_t> peer_features{0};
+
+    std::atomic_bool connected{false};     // setted true ONLY in the connect() function, setted false ONLY under shutdown_mutex         
+    std::atomic<srfc_reactor::token_t> io_token{0};     // registration in the reactor (0 if not registered)
+    std::size_t io_loop = srfc_reactor::any_loop;       // reactor loop to register in (set by srfc_listener)
     
-    mutable std::mutex queue_mutex;
-    mutable std::mutex listener_cv_mutex;
-    mutable std::mutex idleable_cv_mutex;    
-    mutable std::mutex response_cv_mutex;
-    mutable std::condition_variable listener_cv;
-    mutable std::condition_variable response_cv;
-    mutable std::condition_variable idleable_cv;   
-
-    std::thread listener;
+    mutable std::mutex pending_mutex;
+    mutable std::mutex outbound_mutex;
+    std::mutex stream_mutex;
+    std::mutex received_mutex;
+    std::mutex shutdown_mutex;              // held for the whole shutdown()
+    std::atomic<std::size_t> running_handlers{0};  // submitted or suspended request handlers. reset() waits for them
+
+    // Received data. Used only by the I/O thread:
+    // Refcounted receive ring. Messages are passed to handlers as views into it.
+    // Single-pass frame parser. Keeps the size of the partially received frame.
+    srfc_receive_buffer received_data{2048};  // 2KB (arbitrary-chosen size)
+    srfc_frame_parser parser;
+
+    // Outbound lanes, from the highest priority to the lowest. Frames of a lane are written in the order
+    // they were queued. A frame is contiguous on the wire, so the partially written one is finished first:
+    static constexpr std::size_t lane_count = 3;
+    std::array<std::deque<outbound_frame>, lane_count> outbound_lanes;
+    std::optional<outbound_frame> partial_frame;
+    std::size_t written_bytes = 0;      // of the partial frame
+    bool write_armed = false;           // writability is watched
+    bool io_completions = false;        // the reactor completes the I/O (see srfc_reactor::completes_io())
+    bool sending = false;               // completions: a gather-write is in flight
+    std::shared_ptr<send_hold> held;    // completions: reused once the reactor releases it
+    std::vector<const_buffer> write_bufs;
+    std::vector<std::size_t> write_lanes;   // lane of each frame of the gather-write
+    std::array<std::size_t, lane_count> writing{};  // frames at the front of each lane taken by the gather-write
+    static constexpr std::size_t max_coalesced_frames = 128;   // frames written with one gather-write
 }; // class srfc_connection
 
+// Awaitable returned by srfc_connection::async_send_request()
+class srfc_connection::request_awaiter
+{
+public:
+    request_awaiter(srfc_connection& connection, srfc_request request, std::optional<std::chrono::milliseconds> timeout);
+
+    // Registers the completion slot, sends the request and suspends the caller.
+    // Throws std::logic_error (in the awaiting coroutine) if not connected
+    bool            await_ready() const noexcept { return false; }
+    void            await_suspend(std::coroutine_handle<> awaiting);
+    srfc_response   await_resume() { return std::move(response); }
+
+private:
+    srfc_connection* connection;
+    srfc_request request;
+    std::optional<std::chrono::milliseconds> timeout;
+    srfc_response response{0};
+}; // class srfc_connection::request_awaiter
+
+// Awaitable returned by srfc_connection::async_send_response()
+class srfc_connection::response_awaiter
+{
+public:
+    response_awaiter(srfc_connection& connection, srfc_response response);
+
+    // The caller is resumed when the response is written.
+    // await_resume() rethrows the error if the connection was closed before that
+    bool            await_ready() const noexcept { return false; }
+    void            await_suspend(std::coroutine_handle<> awaiting);
+    void            await_resume();
+
+private:
+    srfc_connection* connection;
+    srfc_response response;
+    std::exception_ptr error;
+}; // class srfc_connection::response_awaiter
+
+//
+// Typed methods:
+//
+
+template<typename Sig, typename Method>
+void srfc_connection::add_method(std::string methodName, Method method)
+{
+    add_method(std::move(methodName), view_callback_t(marshal_detail::make_method<Sig>(std::move(method))));
+}
+
+template<typename Sig, typename... Args>
+std::future<typename marshal_detail::signature<Sig>::result_t> 
+srfc_connection::call(std::string methodName, const Args&... args)
+{
+    using sig = marshal_detail::signature<Sig>;
+    using result_t = typename sig::result_t;
+    static_assert(sizeof...(Args) == std::tuple_size_v<typename sig::args_t>, 
+                  "call(std::string methodName, const Args&... args): The arguments don't match the signature");
+
+    std::size_t size = 0;
+    auto pld = marshal_detail::pack_as<typename sig::args_t>(&size, std::index_sequence_for<Args...>(), args...);
+
+    auto request = srfc_request(methodName);
+    request.setPayload(std::move(pld), size);
+
+    auto promise = std::make_shared<std::promise<result_t>>();
+    auto res = promise->get_future();
+    send_request(request, [promise](srfc_response response) {
+        try {
+            if constexpr(std::is_void_v<result_t>) {
+                marshal_detail::take_result<result_t>(response);
+                promise->set_value();
+            }
+            else {
+                promise->set_value(marshal_detail::take_result<result_t>(response));
+            }
+        }
+        catch(...) {
+            promise->set_exception(std::current_exception());
+        }
+    });
+
+    return res;
+}
+
 } // namespace net 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,158 @@
+#ifndef SRFC_FRAME_HPP
+#define SRFC_FRAME_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace net
+{
+
+// Wire formats (codecs) of the SRFC messages:
+//  - SRFCv1: 32-byte zero-padded ASCII preamble followed by the null-terminated text lines;
+//  - SRFCv2: fixed-width packed little-endian binary header followed by the binary body.
+enum class wire_format : std::uint8_t
+{
+    srfc_v1 = 1,
+    srfc_v2 = 2
+};
+
+// Message types as they are written into the SRFCv2 header.
+// Chunks and credits are the stream frames of a streamed response (see srfc_connection):
+//  - chunk: next part of the response payload. Has no method, parameters and status;
+//  - credit: the receiver grants the sender more bytes of chunks. Has no payload.
+// Cancel frames withdraw a request (see srfc_connection::cancel). They have no payload.
+// Batch frames carry complete request or response frames back to back as the payload
+// (see srfc_connection::send_batch). Batches aren't nested.
+enum class frame_type : std::uint8_t
+{
+    request = 1,
+    response = 2,
+    chunk = 3,
+    credit = 4,
+    cancel = 5,
+    batch = 6
+};
+
+// Priority of the message. Every priority has its own outbound lane in srfc_connection;
+// the frames of the higher lanes are written first. Responses inherit the priority of their requests.
+// Stored in the bits 0-1 of the SRFCv2 header flags (0 is normal, so older senders are unaffected).
+// SRFCv1 requests carry it in the optional "PRIO: <n>" line between the payload size and the method,
+// which is omitted for normal priority. SRFCv1 responses are received with normal priority
+enum class frame_priority : std::uint8_t
+{
+    normal = 0,
+    high = 1,       // control calls
+    bulk = 2        // large transfers
+};
+
+constexpr std::uint16_t priority_flags_mask = 0x3;
+
+// Codec of the compressed payload (see srfc_codec.hpp). The payload size on the wire is the compressed one.
+// Stored in the bits 2-3 of the SRFCv2 header flags. SRFCv1 messages carry it in the optional "PC: <n>" line
+// right after the payload size, which is omitted for uncompressed payloads
+enum class payload_codec : std::uint8_t
+{
+    none = 0,
+    lz77 = 1,       // built-in
+    lz4 = 2,        // builds with SRFC_WITH_LZ4
+    zstd = 3        // builds with SRFC_WITH_ZSTD
+};
+
+constexpr std::uint16_t codec_flags_mask = 0xC;
+constexpr unsigned codec_flags_shift = 2;
+
+// Checksum of the frame (see srfc_checksum.hpp). A checksummed frame ends with the trailer holding the checksum
+// (u32, little-endian) of all the preceding bytes of the frame; the frame size includes the trailer.
+// Stored in the bits 4-5 of the SRFCv2 header flags. SRFCv1 messages carry it in the optional "CK: <n>" line
+// right after the request id, which is omitted for frames without the checksum
+enum class frame_checksum : std::uint8_t
+{
+    none = 0,
+    crc32c = 1
+};
+
+constexpr std::uint16_t checksum_flags_mask = 0x30;
+constexpr unsigned checksum_flags_shift = 4;
+constexpr std::size_t checksum_trailer_size = 4;
+
+// Method id of the request. The receiver announces the ids of its methods in the handshake (see srfc_connection),
+// so the requests can name the method with the id instead of the name.
+// SRFCv2 requests set the bit 6 of the header flags and carry the id in the status field (the method is empty).
+// SRFCv1 requests carry it in the "MI: <id>" line in place of the method line
+constexpr std::uint16_t method_id_flag = 0x40;
+constexpr std::uint32_t no_method_id = 0xFFFFFFFF;      // the request names the method
+
+// SRFCv2 message layout:
+//  | header (36 bytes) | method (method_length) | params (params_length) | payload (payload_length) | [checksum] |
+// Each parameter is encoded as:
+//  | name length (u16) | value length (u32) | name | value |
+// All integers are little-endian, the header has no padding.
+// Credit frames carry the granted amount of bytes in the status field.
+class srfc_v2_header
+{
+public:
+    static constexpr std::uint32_t magic_value = 0x32465253; // "SRF2"
+    static constexpr std::uint8_t version_value = 2;
+    static constexpr std::size_t size = 36;
+    static constexpr std::size_t param_prefix_size = 6;     // u16 + u32 lengths
+
+    // Serialization & deserialization:
+    // out should point to a block of memory of size at least srfc_v2_header::size
+    void encode(char* out) const noexcept;
+
+    // in should point to a block of memory of size at least srfc_v2_header::size
+    // returns false if magic or version don't match
+    bool decode(const char* in) noexcept;
+
+    // Size of the whole message described by the header (with the checksum trailer)
+    std::size_t frame_size() const noexcept;
+    frame_checksum checksum() const noexcept;
+
+    std::uint32_t magic = magic_value;
+    std::uint8_t version = version_value;
+    std::uint8_t type = 0;
+    std::uint16_t flags = 0;
+    std::uint64_t request_id = 0;
+    std::uint32_t status = 0;
+    std::uint16_t method_length = 0;
+    std::uint16_t param_count = 0;
+    std::uint32_t params_length = 0;
+    std::uint64_t payload_length = 0;
+}; // class srfc_v2_header
+
+// Contiguous part of a serialized message. Messages are sent as a list of parts
+// (header, payload), so the payload is never copied into the serialized message:
+struct const_buffer
+{
+    const char* data;
+    std::size_t size;
+};
+
+// Size of the SRFCv1 preamble:
+constexpr std::size_t srfc_v1_preamble_size = 32;
+
+// Returns the wire format of the serialized message
+// d should point to a block of memory of size at least 1
+wire_format detect_wire_format(const char* d) noexcept;
+
+// Returns the amount of bytes needed to determine the size of the message
+std::size_t frame_prefix_size(wire_format fmt) noexcept;
+
+// Serializes the header of the stream, cancel or batch frame (frame_type::chunk, credit, cancel or batch).
+// The chunk data (or the batched frames) of size payloadSize is sent after the header;
+// credit is ignored for other types. Batch frames have request id 0. codec is the codec of a compressed chunk.
+// The checksum trailer (if any) is sent after the payload.
+// SRFCv1 stream, cancel and batch frames are:
+//  | preamble | SRFCv1 | TYPE: CHK | RI: <id> | [CK: <checksum>] | PS: <size> | [PC: <codec>] | payload |
+//  | preamble | SRFCv1 | TYPE: CRD | RI: <id> | [CK: <checksum>] | PS: 0 | CREDIT: <bytes> |
+//  | preamble | SRFCv1 | TYPE: CNL | RI: <id> | [CK: <checksum>] | PS: 0 |
+//  | preamble | SRFCv1 | TYPE: BAT | RI: 0 | [CK: <checksum>] | PS: <size> | frames |
+std::shared_ptr<char> serialize_stream_header(frame_type type, std::uint64_t requestId, std::size_t payloadSize,
+                                              std::uint32_t credit, wire_format fmt, std::size_t* pSize,
+                                              payload_codec codec = payload_codec::none,
+                                              frame_checksum checksum = frame_checksum::none);
+
+} // namespace net
+
+#endif
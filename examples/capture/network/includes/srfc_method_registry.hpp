@@ -0,0 +1,62 @@
+#ifndef SRFC_METHOD_REGISTRY_HPP
+#define SRFC_METHOD_REGISTRY_HPP
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <string>
+
+#include "srfc_method_table.hpp"
+
+namespace net
+{
+
+// Method table that can be changed while the requests are dispatched (read-copy-update):
+// the readers take the immutable snapshot of the table, and the writers copy it, change the copy
+// and publish it in place of the old one. The snapshot stays valid for as long as a reader holds it.
+// The version changes with every published table, so the readers keep their snapshot until it does.
+//
+// A registry may follow another one (the connections accepted by srfc_listener follow its registry):
+// it publishes the tables of the followed registry until it's changed itself. Then it starts with a copy
+// of the last table of the followed one and stops following it.
+class srfc_method_registry
+{
+public:
+    using table_ptr = std::shared_ptr<const srfc_method_table>;
+    using method_id_t = srfc_method_table::method_id_t;
+
+    // Move operations aren't thread-safe. The moved-from registry is empty
+    srfc_method_registry();
+    srfc_method_registry(srfc_method_registry&& other) noexcept;
+    srfc_method_registry& operator=(srfc_method_registry&& other) noexcept;
+
+    // Writers (serialized, each publishes a new table):
+    method_id_t add(std::string name, srfc_method_table::callback_t callback);
+    method_id_t add(std::string name, srfc_method_table::view_callback_t callback);
+    method_id_t add(std::string name, srfc_method_table::task_callback_t callback);
+    method_id_t add(std::string name, srfc_method_table::stream_callback_t callback);
+    bool        remove(const std::string& name);
+    void        clear();    // forgets the ids too and stops following
+
+    // Not thread-safe with the readers, so it's called before the registry is used:
+    void        follow(std::shared_ptr<srfc_method_registry> registry);
+
+    // Readers:
+    table_ptr       snapshot() const;
+    std::uint64_t   version() const noexcept;
+
+private:
+    template<typename change_t>
+    auto update(change_t change);
+
+    mutable std::mutex mutex;                       // serializes the writers
+    table_ptr table;                                // under mutex
+    std::shared_ptr<srfc_method_registry> parent;   // under mutex. Kept after the registry stops following it
+    std::atomic<srfc_method_registry*> followed{nullptr};
+    std::atomic<std::uint64_t> own_version{0};
+}; // class srfc_method_registry
+
+} // namespace net
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef SRFC_RECEIVE_BUFFER_HPP
+#define SRFC_RECEIVE_BUFFER_HPP
+
+#include <memory>
+#include <cstddef>
+
+namespace net
+{
+
+// Growable refcounted receive ring. Data is read directly into the block and complete messages
+// are passed to the handlers as views into the same block (see srfc_message_view).
+// Consuming a message only advances the read cursor. When the write cursor reaches the end,
+// the ring wraps by moving the unread tail (a partial message) to the beginning of the block,
+// so every message stays contiguous. The block is never overwritten while it is shared:
+// in that case the unread tail is moved into a new block.
+// A block grown beyond max_ring_capacity for a large message is replaced with a block of the ring size
+// once the message is consumed and its views are released, so the connection doesn't keep the memory.
+//
+// The read size adapts to the traffic: it grows while reads fill the offered space 
+// and shrinks when they return much less.
+class srfc_receive_buffer
+{
+public:
+    using block_t = std::shared_ptr<char>;
+
+    // Make non-copyable:
+    srfc_receive_buffer(const srfc_receive_buffer& other) = delete;
+    srfc_receive_buffer& operator=(const srfc_receive_buffer& other) = delete;
+
+    // Parameterized constructor:
+    explicit srfc_receive_buffer(std::size_t initialCapacity = 2048);
+
+    static constexpr std::size_t max_read_size = 256 * 1024;
+    static constexpr std::size_t max_ring_capacity = 2 * max_read_size;
+
+    // Writing:
+    // Returns the pointer to the free space of size at least minFree
+    char*       prepare(std::size_t minFree);
+    std::size_t writable() const noexcept;
+    void        commit(std::size_t n) noexcept;
+
+    // Adaptive read size:
+    std::size_t read_size() const noexcept;
+    void        adapt(std::size_t offered, std::size_t received) noexcept;
+
+    // Reading:
+    const char* data() const noexcept;
+    std::size_t size() const noexcept;
+    block_t     block() const noexcept;
+    void        consume(std::size_t n) noexcept;
+    void        clear() noexcept;
+
+    std::size_t get_capacity() const noexcept;
+
+private:
+    bool        exclusive() const noexcept;     // the block is not shared with any view
+    std::size_t ring_capacity() const noexcept;
+    void        shrink() noexcept;
+
+    block_t buffer;
+    std::size_t capacity = 0;
+    std::size_t rpos = 0;   // first unread byte
+    std::size_t wpos = 0;   // first free byte
+    const std::size_t initial_capacity;
+
+    static constexpr std::size_t min_read_size = 1024;
+    std::size_t rsize = min_read_size;
+}; // class srfc_receive_buffer
+
+} // namespace net
+
+#endif
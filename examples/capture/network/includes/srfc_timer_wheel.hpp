@@ -0,0 +1,88 @@
+#ifndef SRFC_TIMER_WHEEL_HPP
+#define SRFC_TIMER_WHEEL_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <vector>
+#include <unordered_map>
+
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+
+namespace net
+{
+
+// Hashed timer wheel served by a single thread.
+// A timer is put into the slot of its expiration tick, so scheduling and cancelling are O(1)
+// and the thread only visits the slots of the elapsed ticks. Timers that expire after more than
+// one revolution stay in their slot until their tick comes.
+// The thread sleeps while the wheel is empty.
+//
+// Callbacks are executed on the wheel thread and should be short.
+class srfc_timer_wheel
+{
+public:
+    using clock_t = std::chrono::steady_clock;
+    using timer_id = std::uint64_t;
+    using callback_t = std::function<void()>;
+
+    // Make non-copyable & non-movable:
+    srfc_timer_wheel(const srfc_timer_wheel& other) = delete;
+    srfc_timer_wheel& operator=(const srfc_timer_wheel& other) = delete;
+
+    // Parameterized constructor & dtor:
+    explicit srfc_timer_wheel(std::chrono::milliseconds tick = std::chrono::milliseconds(10),
+                              std::size_t slots = 512);
+    ~srfc_timer_wheel();
+
+    // The wheel shared by all connections:
+    static srfc_timer_wheel& shared();
+
+    // Runs callback after the delay (rounded up to the tick). Returns the id of the timer (never 0)
+    timer_id schedule(std::chrono::milliseconds delay, callback_t callback);
+
+    // Returns false if the timer has already fired (or was not found).
+    // When cancel() returns, the callback of the timer is not running.
+    bool     cancel(timer_id id);
+
+    std::size_t size() const;
+
+private:
+    struct entry
+    {
+        timer_id id;
+        std::uint64_t due_tick;
+        callback_t callback;
+    };
+
+    using slot_t = std::list<entry>;
+
+    void            __worker__();
+    std::uint64_t   tick_of(clock_t::time_point tp) const;
+
+    // Fields:
+    const clock_t::duration tick_duration;
+    const clock_t::time_point start;
+
+    std::vector<slot_t> wheel;
+    std::unordered_map<timer_id, std::pair<std::size_t, slot_t::iterator>> index;  // id -> (slot, entry)
+    std::uint64_t processed_tick = 0;   // all ticks up to this one are processed
+    timer_id next_id = 1;
+
+    std::atomic_bool terminate{false};
+
+    mutable std::mutex wheel_mutex;
+    mutable std::mutex fire_mutex;      // held by the worker while it runs callbacks
+    std::condition_variable wheel_cv;
+
+    std::thread worker;
+}; // class srfc_timer_wheel
+
+} // namespace net
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef SRFC_WHEN_HPP
+#define SRFC_WHEN_HPP
+
+#include <vector>
+#include <utility>
+#include <optional>
+#include <functional>
+#include <future>
+#include <chrono>
+
+#include "srfc_connection.hpp"
+
+namespace net
+{
+
+// A request to be sent over the connection by when_all() / when_any()
+struct srfc_call
+{
+    srfc_connection* connection;
+    srfc_request request;
+    std::optional<std::chrono::milliseconds> timeout = std::nullopt;
+};
+
+// Combinators over many in-flight requests. They are built on the completion callbacks of
+// srfc_connection::send_request, so no thread waits for the responses.
+// A call that can't be sent (e.g. the connection is closed) completes with status_codes::connection_error.
+//
+// Usage:
+//      std::vector<srfc_call> calls;
+//      for(const auto& name : files) {
+//          calls.push_back({&connection, srfc_request("GETFILE_SCAP", name.data(), name.size())});
+//      }
+//      when_all(std::move(calls), [](std::vector<srfc_response> responses) { ... });
+
+// The callback receives the responses in the order of the calls. It's called on the shared srfc_executor
+// (or in place, if calls is empty)
+void when_all(std::vector<srfc_call> calls, std::function<void(std::vector<srfc_response>)> callback);
+std::future<std::vector<srfc_response>> when_all(std::vector<srfc_call> calls);
+
+// The callback receives the index and the response of the first completed call. It's called once,
+// on the shared srfc_executor; the later responses are discarded.
+// Throws std::invalid_argument if calls is empty
+void when_any(std::vector<srfc_call> calls, std::function<void(std::size_t, srfc_response)> callback);
+std::future<std::pair<std::size_t, srfc_response>> when_any(std::vector<srfc_call> calls);
+
+} // namespace net
+
+#endif
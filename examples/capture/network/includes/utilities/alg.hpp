@@ -4,6 +4,7 @@
 #include <cstring>
 #include <string>
 #include <type_traits>
+#include <stdexcept>
 
 
  // copies sz bytes from s to t and shifts t:
@@ -0,0 +1,36 @@
+#ifndef BYTE_ORDER_HPP
+#define BYTE_ORDER_HPP
+
+#include <cstddef>
+#include <type_traits>
+
+// Writes num into t in the little-endian byte order and shifts t
+// Number should be an unsigned integral type
+template <
+    typename UIntT,
+    typename = typename std::enable_if<std::is_unsigned<UIntT>::value, UIntT>::type
+    >
+inline void store_le_and_shift(char*& t, UIntT num)
+{
+    for(std::size_t i = 0; i < sizeof(UIntT); ++i) {
+        *(t++) = static_cast<char>((num >> (8 * i)) & 0xFF);
+    }
+}
+
+// Reads the little-endian number from p and shifts p
+// Number should be an unsigned integral type
+template <
+    typename UIntT,
+    typename = typename std::enable_if<std::is_unsigned<UIntT>::value, UIntT>::type
+    >
+inline UIntT load_le_and_shift(const char*& p)
+{
+    UIntT num = 0;
+    for(std::size_t i = 0; i < sizeof(UIntT); ++i) {
+        num |= static_cast<UIntT>(static_cast<unsigned char>(*(p++))) << (8 * i);
+    }
+
+    return num;
+}
+
+#endif
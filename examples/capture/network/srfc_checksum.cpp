@@ -0,0 +1,198 @@
+#include "includes/srfc_checksum.hpp"
+
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SRFC_CRC32C_SSE42
+#include <nmmintrin.h>
+#elif defined(_M_X64) && defined(_MSC_VER)
+#define SRFC_CRC32C_SSE42
+#include <intrin.h>
+#include <nmmintrin.h>
+#endif
+
+#include "includes/utilities/byte_order.hpp"
+
+namespace net
+{
+
+namespace
+{
+
+//
+// Slicing-by-8: table n holds the CRC of the byte followed by n zero bytes,
+// so 8 bytes are folded with 8 independent lookups
+//
+
+constexpr std::uint32_t crc32c_poly = 0x82F63B78;   // reflected Castagnoli polynomial
+
+struct crc_tables
+{
+    std::uint32_t t[8][256];
+};
+
+constexpr crc_tables make_tables()
+{
+    crc_tables res{};
+    for(std::uint32_t i = 0; i < 256; ++i) {
+        std::uint32_t crc = i;
+        for(int k = 0; k < 8; ++k) {
+            crc = (crc >> 1) ^ (crc32c_poly & (0u - (crc & 1u)));
+        }
+        res.t[0][i] = crc;
+    }
+    for(std::uint32_t i = 0; i < 256; ++i) {
+        for(int n = 1; n < 8; ++n) {
+            res.t[n][i] = (res.t[n - 1][i] >> 8) ^ res.t[0][res.t[n - 1][i] & 0xFF];
+        }
+    }
+    return res;
+}
+
+constexpr crc_tables tables = make_tables();
+
+std::uint32_t crc32c_tables(std::uint32_t crc, const char* p, std::size_t size) noexcept
+{
+    const auto& t = tables.t;
+
+    for(; size >= 8; size -= 8) {
+        const auto word = load_le_and_shift<std::uint64_t>(p) ^ crc;
+        crc = t[7][word & 0xFF] ^ t[6][(word >> 8) & 0xFF] ^ t[5][(word >> 16) & 0xFF] ^ t[4][(word >> 24) & 0xFF] ^
+              t[3][(word >> 32) & 0xFF] ^ t[2][(word >> 40) & 0xFF] ^ t[1][(word >> 48) & 0xFF] ^ t[0][word >> 56];
+    }
+    for(; size != 0; --size) {
+        crc = t[0][(crc ^ static_cast<unsigned char>(*(p++))) & 0xFF] ^ (crc >> 8);
+    }
+
+    return crc;
+}
+
+#if defined(SRFC_CRC32C_SSE42)
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((target("sse4.2")))
+#endif
+std::uint32_t crc32c_sse42(std::uint32_t crc, const char* p, std::size_t size) noexcept
+{
+    std::uint64_t crc64 = crc;
+    for(; size >= 8; size -= 8, p += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+
+    auto res = static_cast<std::uint32_t>(crc64);
+    for(; size != 0; --size) {
+        res = _mm_crc32_u8(res, static_cast<unsigned char>(*(p++)));
+    }
+
+    return res;
+}
+
+bool has_sse42() noexcept
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    return __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+#endif
+
+using crc_impl_t = std::uint32_t (*)(std::uint32_t, const char*, std::size_t);
+
+crc_impl_t select_impl() noexcept
+{
+#if defined(SRFC_CRC32C_SSE42)
+    if(has_sse42()) {
+        return crc32c_sse42;
+    }
+#endif
+    return crc32c_tables;
+}
+
+// piece copied and checksummed at once (fits into L1):
+constexpr std::size_t copy_block = 16 * 1024;
+
+//
+// Combining: appending n zero bytes to the data multiplies its CRC by x^(8n) modulo the polynomial.
+// x2n_table[k] holds x^(2^k), so x^(8n) is the product of the entries of the set bits of 8n
+//
+
+// a * b modulo the polynomial (bit 31 is x^0, as the CRC is reflected):
+constexpr std::uint32_t multiply_mod_poly(std::uint32_t a, std::uint32_t b) noexcept
+{
+    std::uint32_t m = 1u << 31;
+    std::uint32_t res = 0;
+    while(m != 0) {
+        if(a & m) {
+            res ^= b;
+        }
+        m >>= 1;
+        b = (b >> 1) ^ (crc32c_poly & (0u - (b & 1u)));
+    }
+    return res;
+}
+
+struct x2n_tables
+{
+    std::uint32_t t[64 + 3];    // up to x^(8 * 2^63)
+};
+
+constexpr x2n_tables make_x2n_tables()
+{
+    x2n_tables res{};
+    std::uint32_t p = 1u << 30;     // x^1
+    for(int k = 0; k < 64 + 3; ++k) {
+        res.t[k] = p;
+        p = multiply_mod_poly(p, p);
+    }
+    return res;
+}
+
+constexpr x2n_tables x2n_table = make_x2n_tables();
+
+// x^(8 * bytes) modulo the polynomial:
+std::uint32_t x8n_mod_poly(std::size_t bytes) noexcept
+{
+    std::uint32_t res = 1u << 31;   // x^0
+    for(int k = 3; bytes != 0; bytes >>= 1, ++k) {
+        if(bytes & 1u) {
+            res = multiply_mod_poly(x2n_table.t[k], res);
+        }
+    }
+    return res;
+}
+
+} // namespace
+
+std::uint8_t supported_checksums() noexcept
+{
+    return 1u << static_cast<unsigned>(frame_checksum::crc32c);
+}
+
+std::uint32_t crc32c(std::uint32_t crc, const char* data, std::size_t size) noexcept
+{
+    static const crc_impl_t impl = select_impl();
+    return ~impl(~crc, data, size);
+}
+
+std::uint32_t crc32c_combine(std::uint32_t crc1, std::uint32_t crc2, std::size_t size2) noexcept
+{
+    return multiply_mod_poly(x8n_mod_poly(size2), crc1) ^ crc2;
+}
+
+std::uint32_t copy_crc32c(std::uint32_t crc, char* dst, const char* src, std::size_t size) noexcept
+{
+    for(std::size_t offset = 0; offset < size; offset += copy_block) {
+        const auto n = size - offset < copy_block ? size - offset : copy_block;
+        std::memcpy(dst + offset, src + offset, n);
+        crc = crc32c(crc, dst + offset, n);
+    }
+    return crc;
+}
+
+} // namespace net
@@ -1,15 +1,134 @@
+#include "includes/srfc_connection.hpp"
+
 #include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <new>
 #include <stdexcept>
+#include <utility>
 
-#include "includes/srfc_connection.hpp"
-
+#include "includes/srfc_checksum.hpp"
+#include "includes/srfc_codec.hpp"
+#include "includes/srfc_executor.hpp"
+#include "includes/srfc_frame_parser.hpp"
+#include "includes/srfc_receive_buffer.hpp"
 #include "includes/utilities/alg.hpp"
+#include "includes/utilities/byte_order.hpp"
 #include "includes/utilities/net_utils.hpp"
 #include "includes/utilities/array_deleter.hpp"
 
 namespace net
 {
 
+// index of the outbound lane of the priority (the highest priority is written first)
+static std::size_t lane_of(frame_priority priority) noexcept
+{
+    switch(priority) {
+        case frame_priority::high:      return 0;
+        case frame_priority::normal:    return 1;
+        case frame_priority::bulk:      return 2;
+    }
+    return 1;
+}
+
+// Returns the copy of the message with the compressed payload, or nothing if the compression doesn't pay off
+// (or the payload is compressed already):
+template<typename message_t>
+static std::optional<message_t> compress_message(const message_t& message, payload_codec codec)
+{
+    std::size_t pldSize = 0;
+    const auto pld = message.getPayload(&pldSize);
+    if(codec == payload_codec::none || message.getPayloadCodec() != payload_codec::none || 
+       pldSize < min_compressed_payload) 
+    {
+        return std::nullopt;
+    }
+
+    std::size_t size = 0;
+    auto packed = compress_payload(codec, pld.get(), pldSize, &size);
+    if(!packed) {
+        return std::nullopt;
+    }
+
+    message_t res(message);
+    res.setPayload(std::move(packed), size);
+    res.setPayloadCodec(codec);
+    return res;
+}
+
+using method_ids_t = std::unordered_map<std::string, std::uint32_t>;
+
+// Returns the id the peer has announced for the method, or no_method_id:
+static std::uint32_t find_method_id(const method_ids_t* ids, const std::string& methodName)
+{
+    if(ids == nullptr) {
+        return no_method_id;
+    }
+    const auto it = ids->find(methodName);
+    return it != ids->end() ? it->second : no_method_id;
+}
+
+// Batched requests name the method by the id announced by the peer, responses have no method:
+static srfc_connection::serialized_t serialize_batched(const srfc_request& request, wire_format fmt, 
+                                                       const method_ids_t* ids, std::size_t* pSize)
+{
+    return request.serializeHeader(pSize, fmt, frame_checksum::none, find_method_id(ids, request.getMethod()));
+}
+
+static srfc_connection::serialized_t serialize_batched(const srfc_response& response, wire_format fmt, 
+                                                       const method_ids_t*, std::size_t* pSize)
+{
+    return response.serializeHeader(pSize, fmt);
+}
+
+// Serializes the messages (headers and payloads) back to back into the payload of a batch frame.
+// Batched messages are small, so their payloads are copied (and checksummed as they're copied, if pCrc is set):
+template<typename message_t>
+static srfc_connection::payload_t pack_batch(const std::vector<message_t>& messages, wire_format fmt, std::size_t* pSize,
+                                             std::uint32_t* pCrc, const method_ids_t* ids = nullptr)
+{
+    std::vector<std::pair<srfc_connection::serialized_t, std::size_t>> headers;
+    headers.reserve(messages.size());
+
+    std::size_t total = 0;
+    for(const auto& message : messages) {
+        std::size_t headerSize = 0, payloadSize = 0;
+        headers.emplace_back(serialize_batched(message, fmt, ids, &headerSize), headerSize);
+        message.getPayload(&payloadSize);
+        total += headerSize + payloadSize;
+    }
+
+    srfc_connection::payload_t res(new char[total], array_deleter<char>());
+    auto tmpptr = res.get();
+    std::uint32_t crc = 0;
+    for(std::size_t i = 0; i < messages.size(); ++i) {
+        std::size_t payloadSize = 0;
+        const auto payload = messages[i].getPayload(&payloadSize);
+        if(pCrc != nullptr) {
+            crc = copy_crc32c(crc, tmpptr, headers[i].first.get(), headers[i].second);
+            tmpptr += headers[i].second;
+            crc = copy_crc32c(crc, tmpptr, payload.get(), payloadSize);
+            tmpptr += payloadSize;
+        }
+        else {
+            copy_and_shift(tmpptr, headers[i].first.get(), headers[i].second);
+            copy_and_shift(tmpptr, payload.get(), payloadSize);
+        }
+    }
+
+    if(pCrc != nullptr) {
+        *pCrc = crc;
+    }
+    *pSize = total;
+    return res;
+}
+
+// true if the received request was cancelled (requests without the flag never are)
+static bool is_cancelled(const std::shared_ptr<std::atomic_bool>& cancelled) noexcept
+{
+    return cancelled && cancelled->load();
+}
+
 srfc_connection::srfc_connection(unsigned int port, std::string address, bool deferred)
 {
     connect(port, address, deferred);
@@ -27,425 +146,2631 @@ srfc_connection::srfc_connection(srfc_connection&& other)
 
 srfc_connection& srfc_connection::operator=(srfc_connection&& other)
 {
-    if(this->listener.joinable() == true) {
+    if(this->io_token.load() != 0) {
         throw std::logic_error("operator=(srfc_connection&& other): is not deferred");
     }
-    if(other.listener.joinable() == true) {
+    if(other.io_token.load() != 0) {
         throw std::logic_error("operator=(srfc_connection&& other): is not deferred");        
     }
 
-    callback_map = std::move(other.callback_map);
-    other.callback_map.clear();
+    methods = std::move(other.methods);
 
-    response_queue = std::move(other.response_queue);
-    other.response_queue.clear();
+    pending_requests = std::move(other.pending_requests);
+    other.pending_requests.clear();
 
     socket_fd = other.socket_fd;
     other.socket_fd = 0;
 
-    connected.store(other.connected.load());
-    other.connected.store(false);
+    io_loop = other.io_loop;
+    other.io_loop = srfc_reactor::any_loop;
+
+    wire_fmt.store(other.wire_fmt.load());
+    other.wire_fmt.store(wire_format::srfc_v1);
+
+    compression.store(other.compression.load());
+    other.compression.store(payload_codec::none);
+
+    checksum.store(other.checksum.load());
+    other.checksum.store(frame_checksum::none);
+
+    max_frame_size.store(other.max_frame_size.load());
+    other.max_frame_size.store(default_max_frame_size);
+
+    receive_window.store(other.receive_window.load());
+    other.receive_window.store(stream_window);
+
+    announced_window.store(other.announced_window.load());
+    other.announced_window.store(stream_window);
 
-    terminate_listener.store(other.terminate_listener.load());
-    other.terminate_listener.store(false);
+    memory_budget.store(other.memory_budget.load());
+    other.memory_budget.store(default_memory_budget);
 
-    idleable.store(other.idleable.load());
-    other.idleable.store(true);
+    connected.store(other.connected.load());
+    other.connected.store(false);
 
-    listener = std::move(other.listener);
+    std::lock_guard<std::mutex> lg(outbound_mutex);
+    std::lock_guard<std::mutex> olg(other.outbound_mutex);
+    outbound_lanes = std::move(other.outbound_lanes);
+    for(auto& lane : other.outbound_lanes) {
+        lane.clear();
+    }
 
     return *this;
 }
 
 void srfc_connection::add_method(std::string methodName, callback_t methodCallback)
 {
-    callback_map[methodName] = methodCallback;
+    methods.add(std::move(methodName), std::move(methodCallback));
 }
 
-bool srfc_connection::remove_method(std::string methodName)
+void srfc_connection::add_method(std::string methodName, view_callback_t methodCallback)
 {
-    // std::unordered_map::erase returns number of elements removed (0 or 1)
-    auto res = callback_map.erase(methodName);
-    return res == 1 ? true : false; 
+    methods.add(std::move(methodName), std::move(methodCallback));
 }
 
-srfc_connection::callback_t 
-srfc_connection::get_method(std::string methodName) const
+void srfc_connection::add_method(std::string methodName, task_callback_t methodCallback)
 {
-    // If no such element exists, an exception of type std::out_of_range is thrown
-    return callback_map.at(methodName);
+    methods.add(std::move(methodName), std::move(methodCallback));
 }
 
-bool srfc_connection::has_method(std::string methodName) const
+void srfc_connection::add_method(std::string methodName, stream_callback_t methodCallback)
 {
-    return callback_map.find(methodName) != callback_map.end();
+    methods.add(std::move(methodName), std::move(methodCallback));
 }
 
-std::future<srfc_response> 
-srfc_connection::send_request(const srfc_request& request)
+bool srfc_connection::remove_method(std::string methodName)
 {
-    if(connected.load() == false) {
-        throw std::logic_error("send_request(const srfc_request& request): not connected");
-    }
-    return std::async(&srfc_connection::__send_request__, this, std::ref(request));
+    return methods.remove(methodName);
 }
 
-std::future<void> 
-srfc_connection::send_response(const srfc_response& response) 
+srfc_connection::callback_t 
+srfc_connection::get_method(std::string methodName) const
 {
-    if(connected.load() == false) {
-        throw std::logic_error("send_response(const srfc_response& response): not connected");
-    }
-    return std::async(&srfc_connection::__send_response__, this, response);
+    return methods.snapshot()->at(methodName, method_kind::callback).callback;
 }
 
-void srfc_connection::connect(unsigned int port, std::string address, bool deferred)
+srfc_connection::view_callback_t 
+srfc_connection::get_view_method(std::string methodName) const
 {
-    if(connected.load() == true) {
-        throw std::logic_error("connect(unsigned int port, std::string address): is already connected"); 
-    }
-
-    __connect__(port, address); // platform-dependent implementation'
-                                // sets socket_t socket_fd
-                                // sets std::atomic_bool connected
-
-    if(!deferred) {
-        // listener has not been started yet:
-        if(listener.joinable() == false) {
-            listener = std::thread(&srfc_connection::__listener__, this);
-        }
-        // listener is idled:
-        else {
-            listener_cv.notify_one();
-        }
-    }
+    return methods.snapshot()->at(methodName, method_kind::view).view_callback;
 }
 
-void srfc_connection::connect(socket_t socketFd, bool deferred)
+srfc_connection::task_callback_t 
+srfc_connection::get_task_method(std::string methodName) const
 {
-    if(connected.load() == true) {
-        throw std::logic_error("connect(socket_t socketFd): is already connected"); 
-    }
-
-    this->socket_fd = socketFd;
-    connected.store(true);
-
-    if(!deferred) {
-        // listener has not been started yet:
-        if(listener.joinable() == false) {
-            listener = std::thread(&srfc_connection::__listener__, this);
-        }
-        // listener is idled:
-        else {
-            listener_cv.notify_one();
-        }
-    }
+    return methods.snapshot()->at(methodName, method_kind::task).task_callback;
 }
 
-void srfc_connection::invoke_deferred()
+srfc_connection::stream_callback_t 
+srfc_connection::get_stream_method(std::string methodName) const
 {
-    // listener has not been started yet:
-    if(listener.joinable() == false) {
-        listener = std::thread(&srfc_connection::__listener__, this);
-    }
-    // listener is idled:
-    else {
-        listener_cv.notify_one();
-    }
+    return methods.snapshot()->at(methodName, method_kind::stream).stream_callback;
 }
 
-bool srfc_connection::is_connected() const
+bool srfc_connection::has_method(std::string methodName) const
 {
-    return connected.load();
+    return methods.snapshot()->find(methodName) != nullptr;
 }
 
-// shutdown connection, close socket, idle receive_thread, clear the response_queue
-void srfc_connection::shutdown() 
+void srfc_connection::set_max_frame_size(std::size_t bytes) noexcept
 {
-    if(connected.load() == false) {
-        throw std::logic_error("shutdown(): is not connected");
-    }
+    max_frame_size.store(std::max(bytes, min_max_frame_size));
+}
 
-    connected.store(false);
-    listener_cv.notify_one();
+std::size_t srfc_connection::get_max_frame_size() const noexcept
+{
+    return max_frame_size.load();
+}
 
-    // awakes blocking operations
-    try{ 
-        // try to shutdown
-        // throws if connection was closed from another host
-        __shutdown__();
-    }
-    catch(...){}
+void srfc_connection::set_stream_window(std::size_t bytes) noexcept
+{
+    receive_window.store(std::max<std::size_t>(bytes, 1));
+}
 
-    __close__();
-    socket_fd = 0;
+std::size_t srfc_connection::get_stream_window() const noexcept
+{
+    return receive_window.load();
+}
 
-    if(listener.joinable()) {
-        // wait for listener to idle on listener_cv
-        std::unique_lock<std::mutex> ul(idleable_cv_mutex);
-        idleable_cv.wait(ul, [this]{return this->idleable.load();});
-    }
+bool srfc_connection::wait_handshake(std::chrono::milliseconds timeout) const
+{
+    std::unique_lock<std::mutex> lk(handshake_mutex);
+    handshake_cv.wait_for(lk, timeout, [this] { return handshaken; });
+    return peer_caps.has_value();
+}
 
-    response_cv.notify_all();
+std::optional<srfc_capabilities> srfc_connection::get_peer_capabilities() const
+{
+    std::lock_guard<std::mutex> lg(handshake_mutex);
+    return peer_caps;
+}
 
-    std::lock_guard<std::mutex> lg(queue_mutex);
-    response_queue.clear();
+void srfc_connection::set_wire_format(wire_format fmt) noexcept
+{
+    wire_fmt.store(fmt);
 }
 
-// if thread was not started?
-void srfc_connection::reset()
+wire_format srfc_connection::get_wire_format() const noexcept
 {
-    // connected can be false ONLY if the shutdown() was previously called OR connect() was not called yet
-    if(connected.load() == true) {
-        shutdown();
-    }
-    callback_map.clear();
+    return wire_fmt.load();
 }
 
-// if thread was not started?
-srfc_connection::~srfc_connection()
+void srfc_connection::set_compression(payload_codec codec) noexcept
 {
-    reset();
+    compression.store(codec);
+}
 
-    // Terminate the terminate_listener thread if it was started:
-    if(listener.joinable()) {
-        terminate_listener.store(true);
-        listener_cv.notify_one();
-        listener.join();
-    }
+payload_codec srfc_connection::get_compression() const noexcept
+{
+    return compression.load();
 }
 
-void srfc_connection::handle_request(srfc_request request)
+void srfc_connection::set_checksum(frame_checksum checksum) noexcept
 {
-    auto rid = request.getRequestId();
-    auto response = srfc_response(rid);
+    this->checksum.store(checksum);
+}
 
-    // No requested method found:
-    if(!has_method(request.getMethod())) {
-        response.setStatusCode(status_codes::unknown_method);
-    }
+frame_checksum srfc_connection::get_checksum() const noexcept
+{
+    return checksum.load();
+}
 
-    // Method found:
-    else {
-        payload_t respPld;
-        std::size_t respPldSz = 0;
-        
-        // Execute method: 
-        auto callback = get_method(request.getMethod());
-        status_t res;
-        try {
-            res = callback(
-                request.getParams(),
-                request.getPayload(),
-                &respPld,
-                &respPldSz
-            );
-        }
-        catch(...) {
-            res = status_codes::unhandled_exception;
-            respPldSz = 0;
-            respPld.reset();
-        }
+void srfc_connection::set_memory_budget(std::size_t bytes) noexcept
+{
+    memory_budget.store(std::max(bytes, min_max_frame_size));
+}
 
-        // Add results to response:
-        response.setStatusCode(res);
-        response.setPayload(respPld, respPldSz);
-    }
-    
-    // Send response:
-    send_response(response);
+std::size_t srfc_connection::get_memory_budget() const noexcept
+{
+    return memory_budget.load();
 }
 
-void srfc_connection::handle_response(srfc_response response)
+srfc_memory_usage srfc_connection::get_memory_usage() const noexcept
 {
-    add_response(response);
-    response_cv.notify_all(); // notify __send_request__ threads about the new response
+    srfc_memory_usage usage;
+    usage.inbound = buffered_bytes.load() + handled_bytes.load();
+    usage.outbound = queued_bytes.load();
+    usage.budget = memory_budget.load();
+    usage.reading_paused = reading_paused.load();
+    return usage;
 }
 
-srfc_response srfc_connection::__send_request__(const srfc_request& request)
+std::future<srfc_response> 
+srfc_connection::send_request(const srfc_request& request)
 {
-    auto requestId = request.getRequestId();
-    std::size_t srdSz = 0;
-    auto srd = request.serialize(&srdSz);
-    
-    // try to send
+    if(connected.load() == false) {
+        throw std::logic_error("send_request(const srfc_request& request): not connected");
+    }
+    // the slot is registered before sending, so the response can't outrun it:
+    auto res = add_pending(request.getRequestId());
     try {
-        __send__(static_cast<const void*>(srd.get()), srdSz);
+        __send_request__(request);
     }
-    catch(...){
-        return srfc_response(requestId, status_codes::connection_error);      
+    catch(...) {
+        drop_pending(request.getRequestId());
+        throw;
     }
 
-    // Wait for response:
-    std::unique_lock<std::mutex> ul(response_cv_mutex);
-    response_cv.wait(ul, [requestId, this] {  // change for wait_for?
-        return !connected.load() || this->received_response(requestId);
-    });
+    return res;
+}
 
-    if(!connected.load()) {
-        return srfc_response(requestId, status_codes::connection_error);
+std::future<srfc_response> 
+srfc_connection::send_request(const srfc_request& request, std::chrono::milliseconds timeout)
+{
+    if(connected.load() == false) {
+        throw std::logic_error("send_request(const srfc_request& request, std::chrono::milliseconds timeout): not connected");
     }
 
-    // Response received:
+    auto res = add_pending(request.getRequestId());
     try {
-        auto res = read_response(requestId);
-        return res;
+        set_pending_deadline(request.getRequestId(), timeout);
+        __send_request__(request);
     }
     catch(...) {
-        return srfc_response(requestId, status_codes::connection_error);    
+        drop_pending(request.getRequestId());
+        throw;
     }
-}
-
-void srfc_connection::__send_response__(const srfc_response& response)
-{
-    std::size_t srdSz = 0;
-    const auto srd = response.serialize(&srdSz);
-    __send__(static_cast<const void*>(srd.get()), srdSz);
-}
 
-void srfc_connection::add_response(const srfc_response& response)
-{
-    std::lock_guard<std::mutex> lg(queue_mutex);
-    response_queue.emplace_back(std::move(response));   
+    return res;
 }
 
-bool srfc_connection::received_response(id_t request_id) const
+void srfc_connection::send_request(const srfc_request& request, completion_t callback)
 {
-    std::lock_guard<std::mutex> lg(queue_mutex);
+    if(connected.load() == false) {
+        throw std::logic_error("send_request(const srfc_request& request, completion_t callback): not connected");
+    }
 
-    auto it = std::find_if(response_queue.begin(), response_queue.end(), [request_id](const auto& resp){
-        return resp.getRequestId() == request_id;
+    // the slot is completed on the I/O or the timer thread. The user code is moved to the executor:
+    add_pending(request.getRequestId(), [this, callback = std::move(callback)](srfc_response response) {
+        submit_task([callback, response = std::move(response)]{callback(response);});
     });
 
-    // no element found:
-    return it != response_queue.end();
+    try {
+        __send_request__(request);
+    }
+    catch(...) {
+        // the callback is called at most once: either it's invoked or the exception is thrown
+        if(drop_pending(request.getRequestId())) {
+            throw;
+        }
+    }
 }
 
-srfc_response srfc_connection::read_response(id_t response_id)
+void srfc_connection::send_request(const srfc_request& request, std::chrono::milliseconds timeout, completion_t callback)
 {
-    std::lock_guard<std::mutex> lg(queue_mutex);
+    if(connected.load() == false) {
+        throw std::logic_error("send_request(const srfc_request& request, std::chrono::milliseconds timeout, "
+                               "completion_t callback): not connected");
+    }
 
-    auto it = std::find_if(response_queue.begin(), response_queue.end(), [response_id](const auto& resp){
-        return resp.getRequestId() == response_id;
+    add_pending(request.getRequestId(), [this, callback = std::move(callback)](srfc_response response) {
+        submit_task([callback, response = std::move(response)]{callback(response);});
     });
 
-    // throw std::logic_error if nothing found:
-    if(it == response_queue.end()) {
-        throw std::logic_error("read_response(id_t response_id): no response with id = " + 
-                               std::to_string(response_id) + " found");
+    try {
+        set_pending_deadline(request.getRequestId(), timeout);
+        __send_request__(request);
+    }
+    catch(...) {
+        if(drop_pending(request.getRequestId())) {
+            throw;
+        }
+    }
+}
+
+std::future<srfc_response> 
+srfc_connection::send_streaming_request(const srfc_request& request, chunk_handler_t onChunk)
+{
+    if(connected.load() == false) {
+        throw std::logic_error("send_streaming_request(const srfc_request& request, chunk_handler_t onChunk): not connected");
     }
 
-    // copy found response:
-    const auto result = *it;
+    pending_call slot;
+    slot.stream = std::make_shared<inbound_stream>();
+    slot.stream->on_chunk = std::move(onChunk);
+    slot.stream->credit = announced_window.load();
+    auto res = slot.promise.get_future();
 
-    // remove this response from queue:
-    response_queue.erase(it);
+    insert_pending(request.getRequestId(), std::move(slot));
+    try {
+        __send_request__(request);
+    }
+    catch(...) {
+        drop_pending(request.getRequestId());
+        throw;
+    }
 
-    return result;
+    return res;
 }
 
-void srfc_connection::__listener__()
+std::future<srfc_response> 
+srfc_connection::send_streaming_request(const srfc_request& request, std::chrono::milliseconds timeout, 
+                                        chunk_handler_t onChunk)
 {
-    std::vector<char> receivedData;  
-    receivedData.reserve(2048); // reserve 2KB (arbitrary-chosen size);
-
-    // main listener loop:
-    while(true) {
-        // set idleable flag and notify. Shutdown() method now can continue execution:
-        idleable.store(true);
-        idleable_cv.notify_all();
-        
-        // get previous connection handle; used to clear receivedData after connection change
-        const auto prev_connection = this->socket_fd;
+    if(connected.load() == false) {
+        throw std::logic_error("send_streaming_request(const srfc_request& request, std::chrono::milliseconds timeout, "
+                               "chunk_handler_t onChunk): not connected");
+    }
 
-        // clear receivedData if disconnected:
-        if(!connected.load()) {
-            receivedData.clear();
-        }
+    pending_call slot;
+    slot.stream = std::make_shared<inbound_stream>();
+    slot.stream->on_chunk = std::move(onChunk);
+    slot.stream->credit = announced_window.load();
+    auto res = slot.promise.get_future();
 
-        // idle if not connected:
-        std::unique_lock<std::mutex> ul(listener_cv_mutex);
-        listener_cv.wait(ul, [this] {
-            return connected.load() || terminate_listener.load();
-        });
+    insert_pending(request.getRequestId(), std::move(slot));
+    try {
+        set_pending_deadline(request.getRequestId(), timeout);
+        __send_request__(request);
+    }
+    catch(...) {
+        drop_pending(request.getRequestId());
+        throw;
+    }
 
-        // finish thread if terminate_listener flag set:
-        if(terminate_listener.load()) {
-            return;
-        }
+    return res;
+}
 
-        // remove the idleable_cv flag. Shutdown() method should wait for the end of this iteration:
-        idleable.store(false);
+std::future<std::vector<srfc_response>> 
+srfc_connection::send_batch(const std::vector<srfc_request>& requests)
+{
+    if(connected.load() == false) {
+        throw std::logic_error("send_batch(const std::vector<srfc_request>& requests): not connected");
+    }
 
-        // clear the receivedData message if connection changed during idle:
-        if(prev_connection != this->socket_fd) {
-            receivedData.clear();
+    auto res = add_batch_pending(requests);
+    try {
+        if(!requests.empty()) {
+            __send_batch__(requests);
         }
-
-        // read data:
-        std::vector<char> res; // container for the reseived chunk
-        try{
-            res = __receive__();
-        }   
-        catch(...){
-            receivedData.clear();
-            continue;
+    }
+    catch(...) {
+        for(const auto& request : requests) {
+            drop_pending(request.getRequestId());
         }
+        throw;
+    }
 
-        // Connection was terminated:
-        if(res.empty()) {
-            receivedData.clear();
-            idleable.store(true);
-            this->shutdown();
-            continue;
-        }
+    return res;
+}
 
-        // copy received chunk into the whole message
-        receivedData.insert(receivedData.end(), res.begin(), res.end());
-        
-        // check whether message contains preamble. If not go to the next iteration
-        if(receivedData.size() < 32) { 
-            continue;
-        }
-        
-        // get desired message size:
-        std::size_t message_size = 0;
-        try{
-            message_size = get_size_from_preamble(receivedData.data());
+std::future<std::vector<srfc_response>> 
+srfc_connection::send_batch(const std::vector<srfc_request>& requests, std::chrono::milliseconds timeout)
+{
+    if(connected.load() == false) {
+        throw std::logic_error("send_batch(const std::vector<srfc_request>& requests, "
+                               "std::chrono::milliseconds timeout): not connected");
+    }
+
+    auto res = add_batch_pending(requests);
+    try {
+        for(const auto& request : requests) {
+            set_pending_deadline(request.getRequestId(), timeout);
         }
-        catch(...) {
-            // Invalid preamble
-            receivedData.clear();
-            continue;
+        if(!requests.empty()) {
+            __send_batch__(requests);
         }
-        
-        // go to a new iteration if entire message received:
-        if(receivedData.size() < message_size){
-            continue;
+    }
+    catch(...) {
+        for(const auto& request : requests) {
+            drop_pending(request.getRequestId());
         }
+        throw;
+    }
 
-        // if entire message reseived:
+    return res;
+}
 
-        // create serialized_t variable and move the received message with extraction:
-        serialized_t serl(new char[message_size], array_deleter<char>());
-        memcpy(serl.get(), receivedData.data(), message_size);
-        receivedData.erase(receivedData.begin(), receivedData.begin() + message_size);
+bool srfc_connection::cancel(id_t requestId)
+{
+    return abort_pending(requestId, status_codes::request_cancelled);
+}
 
-        // validate message and pass to handlers (each as a new detached thread):
-        if(is_valid_message(serl, message_size)){
-            // get message type:
-            const auto type = extract_type(serl, message_size);
+bool srfc_connection::abort_pending(id_t requestId, status_t status)
+{
+    pending_call slot;
+    {
+        std::lock_guard<std::mutex> lg(pending_mutex);
 
-            if(type == "REQ") {
-                srfc_request tmp(serl, message_size);
-                std::thread([this, tmp]{handle_request(std::move(tmp));}).detach();
-            }
-            else if(type == "RES") {
-                srfc_response tmp(serl, message_size);
-                std::thread([this, tmp]{handle_response(std::move(tmp));}).detach();
-            }
+        auto it = pending_requests.find(requestId);
+        if(it == pending_requests.end()) {
+            return false;
         }
+
+        slot = std::move(it->second);
+        pending_requests.erase(it);
+    }
+
+    if(slot.timer != 0) {
+        srfc_timer_wheel::shared().cancel(slot.timer);
+    }
+    withdraw_request(requestId);
+
+    slot.finish(srfc_response(requestId, status));
+    return true;
+}
+
+std::future<void> 
+srfc_connection::send_response(const srfc_response& response) 
+{
+    if(connected.load() == false) {
+        throw std::logic_error("send_response(const srfc_response& response): not connected");
+    }
+    return __send_response__(response);
+}
+
+srfc_connection::request_awaiter 
+srfc_connection::async_send_request(srfc_request request)
+{
+    return request_awaiter(*this, std::move(request), std::nullopt);
+}
+
+srfc_connection::request_awaiter 
+srfc_connection::async_send_request(srfc_request request, std::chrono::milliseconds timeout)
+{
+    return request_awaiter(*this, std::move(request), timeout);
+}
+
+srfc_connection::response_awaiter 
+srfc_connection::async_send_response(srfc_response response)
+{
+    return response_awaiter(*this, std::move(response));
+}
+
+void srfc_connection::connect(unsigned int port, std::string address, bool deferred)
+{
+    if(connected.load() == true) {
+        throw std::logic_error("connect(unsigned int port, std::string address): is already connected"); 
+    }
+
+    __connect__(port, address); // platform-dependent implementation'
+                                // sets socket_t socket_fd
+                                // sets std::atomic_bool connected
+    __set_nonblocking__();
+
+    if(!deferred) {
+        start_io();
+    }
+}
+
+void srfc_connection::connect(socket_t socketFd, bool deferred)
+{
+    if(connected.load() == true) {
+        throw std::logic_error("connect(socket_t socketFd): is already connected"); 
+    }
+
+    this->socket_fd = socketFd;
+    __set_nonblocking__();
+    connected.store(true);
+
+    if(!deferred) {
+        start_io();
+    }
+}
+
+void srfc_connection::invoke_deferred()
+{
+    if(connected.load() == false) {
+        throw std::logic_error("invoke_deferred(): is not connected");
+    }
+    start_io();
+}
+
+bool srfc_connection::is_connected() const
+{
+    return connected.load();
+}
+
+// unregister from the reactor, close socket, fail the queued messages and the pending requests
+void srfc_connection::shutdown() 
+{
+    std::lock_guard<std::mutex> sl(shutdown_mutex);
+    if(connected.exchange(false) == false) {
+        throw std::logic_error("shutdown(): is not connected");
+    }
+
+    close_io();
+}
+
+void srfc_connection::close_io()
+{
+    // wait for the I/O thread to leave the handlers (unless called from them):
+    const auto token = io_token.exchange(0);
+    if(token != 0) {
+        srfc_reactor::shared().remove(token);
+    }
+
+    try{ 
+        // try to shutdown
+        // throws if connection was closed from another host
+        __shutdown__();
+    }
+    catch(...){}
+
+    fail_outbound();
+    fail_streams();
+    cancel_requests();
+
+    __close__();
+    socket_fd = 0;
+
+    fail_pending();
+}
+
+void srfc_connection::reset()
+{
+    // connected can be false ONLY if the shutdown() was previously called OR connect() was not called yet
+    if(connected.load() == true) {
+        try {
+            shutdown();
+        }
+        catch(...) {}   // the I/O thread has shut the connection down concurrently
+    }
+    // wait for a concurrent shutdown() to finish:
+    std::lock_guard<std::mutex> sl(shutdown_mutex);
+
+    // and for the handlers of the received requests:
+    for(auto n = running_handlers.load(); n != 0; n = running_handlers.load()) {
+        running_handlers.wait(n);
+    }
+
+    methods.clear();
+    io_methods.reset();
+    io_methods_version = 0;
+}
+
+srfc_connection::~srfc_connection()
+{
+    reset();
+}
+
+void srfc_connection::start_io()
+{
+    if(io_token.load() != 0) {
+        return;
+    }
+
+    received_data.clear();
+    parser.reset();
+    parser.set_max_frame_size(max_frame_size.load());
+    buffered_bytes.store(0);
+    reading_paused.store(false);
+
+    // the peer learns the capabilities first (the hello is written as soon as the socket is registered).
+    // Until the hello of the peer is received, it's treated as a legacy peer:
+    {
+        std::lock_guard<std::mutex> lg(handshake_mutex);
+        peer_caps.reset();
+        peer_methods.reset();
+        handshaken = false;
+    }
+    const auto legacy = legacy_capabilities();
+    peer_formats.store(legacy.wire_formats);
+    peer_codecs.store(legacy.codecs);
+    peer_checksums.store(legacy.checksums);
+    peer_max_frame.store(legacy.max_frame_size);
+    peer_window.store(legacy.stream_window);
+    peer_features.store(legacy.features);
+    send_hello();
+
+    // the reactor receives and sends on its own if it can:
+    auto& reactor = srfc_reactor::shared();
+    io_completions = reactor.completes_io();
+    sending = false;
+
+    std::lock_guard<std::mutex> lg(outbound_mutex);
+    if(io_completions) {
+        io_token.store(reactor.add_stream(socket_fd, 
+            [this](std::uint32_t events) { on_io(events); },
+            [this](const char* data, std::size_t size) { on_received(data, size); },
+            [this](std::ptrdiff_t sent) { on_sent(sent); }, io_loop));
+    }
+    else {
+        io_token.store(reactor.add(socket_fd, [this](std::uint32_t events) {
+            on_io(events);
+        }, io_loop));
+    }
+
+    // messages queued while the connection was deferred:
+    written_bytes = 0;
+    partial_frame.reset();
+    writing.fill(0);
+    write_armed = std::any_of(outbound_lanes.begin(), outbound_lanes.end(), [](const auto& lane) {
+        return !lane.empty();
+    });
+    if(write_armed) {
+        srfc_reactor::shared().want_write(io_token.load(), true);
+    }
+}
+
+void srfc_connection::on_io(std::uint32_t events)
+{
+    try {
+        if(events & io_events::writable) {
+            on_writable();
+        }
+        if(events & (io_events::readable | io_events::closed)) {
+            on_readable((events & io_events::closed) != 0);
+        }
+    }
+    catch(...) {
+        // I/O error: the connection is broken
+        shutdown_from_io();
+    }
+}
+
+void srfc_connection::shutdown_from_io()
+{
+    // Another thread may be in shutdown(), waiting for this handler to return.
+    // Blocking on the mutex here would deadlock:
+    std::unique_lock<std::mutex> sl(shutdown_mutex, std::try_to_lock);
+    if(sl.owns_lock() && connected.exchange(false) == true) {
+        close_io();
+    }
+}
+
+void srfc_connection::on_readable(bool closed)
+{
+    // a few reads per readiness event, so other sockets of the loop are not starved:
+    constexpr int max_reads = 8;
+
+    for(int i = 0; i < max_reads && io_token.load() != 0; ++i) {
+        // the peer holds too much memory, or the handlers can't keep up.
+        // The hang-up is still read to close the connection:
+        if(!closed && (over_budget() || executor_full.load())) {
+            pause_reading();
+            return;
+        }
+
+        // Reserve space for the entire message (if its size is known) to read it directly into one block:
+        const auto needed = parser.needed();
+        const auto toRead = std::max(received_data.read_size(), 
+                                     needed > received_data.size() ? needed - received_data.size() : 0);
+
+        // read data directly into the receive buffer:
+        auto* dst = received_data.prepare(toRead);
+        const auto offered = received_data.writable();
+        const auto received = __read_some__(dst, offered);
+
+        // no more data:
+        if(received < 0) {
+            return;
+        }
+
+        // Connection was terminated:
+        if(received == 0) {
+            shutdown_from_io();
+            return;
+        }
+
+        received_data.commit(static_cast<std::size_t>(received));
+        received_data.adapt(offered, static_cast<std::size_t>(received));
+
+        // dispatch every complete message in the buffer before reading again:
+        dispatch_received();
+        buffered_bytes.store(received_data.size());
+
+        // the socket is drained:
+        if(static_cast<std::size_t>(received) < offered) {
+            return;
+        }
+    }
+}
+
+void srfc_connection::on_received(const char* data, std::size_t size)
+{
+    try {
+        // the end of the stream, or the receive failed:
+        if(size == 0) {
+            shutdown_from_io();
+            return;
+        }
+
+        // the data is copied out of the buffer of the reactor. Space for the entire message is reserved
+        // (if its size is known), as on_readable() does:
+        const auto needed = parser.needed();
+        auto* dst = received_data.prepare(std::max(size, needed > received_data.size() ? needed - received_data.size() : 0));
+        std::memcpy(dst, data, size);
+        received_data.commit(size);
+
+        dispatch_received();
+        buffered_bytes.store(received_data.size());
+
+        // the receive goes on until it's cancelled:
+        if(io_token.load() != 0 && (over_budget() || executor_full.load())) {
+            pause_reading();
+        }
+    }
+    catch(...) {
+        shutdown_from_io();
+    }
+}
+
+void srfc_connection::on_sent(std::ptrdiff_t sent)
+{
+    sending = false;
+    try {
+        if(sent < 0) {
+            throw std::runtime_error("on_sent(std::ptrdiff_t sent): The send failed");
+        }
+        on_written(static_cast<std::size_t>(sent));
+    }
+    catch(...) {
+        // I/O error: the connection is broken
+        shutdown_from_io();
+    }
+}
+
+void srfc_connection::on_writable()
+{
+    // completions: the frames of the send in flight are finished by on_sent() first
+    if(sending) {
+        return;
+    }
+
+    // completions: the reactor keeps the taken blocks alive until the send completes, even if the frames
+    // are failed meanwhile (the previous hold is reused once the reactor releases it):
+    send_hold* hold = nullptr;
+    if(io_completions) {
+        if(held == nullptr || held.use_count() != 1) {
+            held = std::make_shared<send_hold>();
+            held->trailers.reserve(max_coalesced_frames + 1);   // the copies don't move
+        }
+        held->blocks.clear();
+        held->trailers.clear();
+        hold = held.get();
+    }
+
+    // coalesce headers and payloads of the queued messages into one gather-write:
+    // the rest of the partially written frame, then the lanes from the highest priority to the lowest.
+    // The taken frames are removed from the lanes only by this thread (see writing), so the buffers stay valid:
+    write_bufs.clear();
+    write_lanes.clear();
+    {
+        std::lock_guard<std::mutex> lg(outbound_mutex);
+        writing.fill(0);
+
+        const auto add_frame = [this, hold](const outbound_frame& frame, std::size_t skip) {
+            const char* trailer = frame.trailer.data();
+            if(hold != nullptr) {
+                hold->blocks.push_back(frame.header);
+                hold->blocks.push_back(frame.payload);
+                if(frame.trailer_size != 0) {
+                    hold->trailers.push_back(frame.trailer);
+                    trailer = hold->trailers.back().data();
+                }
+            }
+
+            const const_buffer parts[] = {{frame.header.get(), frame.header_size}, 
+                                          {frame.payload.get(), frame.payload_size},
+                                          {trailer, frame.trailer_size}};
+            for(const auto& part : parts) {
+                // skip the already written part of the frame:
+                if(skip >= part.size) {
+                    skip -= part.size;
+                    continue;
+                }
+                write_bufs.push_back({part.data + skip, part.size - skip});
+                skip = 0;
+            }
+        };
+
+        if(partial_frame) {
+            add_frame(*partial_frame, written_bytes);
+        }
+        for(std::size_t lane = 0; lane < lane_count; ++lane) {
+            const auto& queue = outbound_lanes[lane];
+            for(std::size_t i = 0; i < queue.size() && write_lanes.size() < max_coalesced_frames; ++i) {
+                add_frame(queue[i], 0);
+                write_lanes.push_back(lane);
+                ++writing[lane];
+            }
+        }
+    }
+
+    // completions: the frames stay taken until on_sent()
+    if(io_completions && !write_bufs.empty()) {
+        if(srfc_reactor::shared().send(io_token.load(), write_bufs.data(), write_bufs.size(), held)) {
+            sending = true;
+            return;
+        }
+
+        // the connection is being shut down:
+        std::lock_guard<std::mutex> lg(outbound_mutex);
+        writing.fill(0);
+        return;
+    }
+
+    const auto sent = write_bufs.empty() ? 0 : __write_some__(write_bufs.data(), write_bufs.size());
+    if(sent < 0) {
+        // the send buffer is full. Wait for writability
+        std::lock_guard<std::mutex> lg(outbound_mutex);
+        writing.fill(0);
+        return;
+    }
+
+    on_written(static_cast<std::size_t>(sent));
+}
+
+void srfc_connection::on_written(std::size_t sent)
+{
+    // remove the written frames. Other threads only append frames to the lanes meanwhile
+    // (or remove the ones behind the taken), so the written ones are still at their fronts:
+    std::vector<outbound_frame> done;
+    {
+        std::lock_guard<std::mutex> lg(outbound_mutex);
+        writing.fill(0);
+
+        auto left = sent;
+        if(partial_frame) {
+            const auto rest = size_of(*partial_frame) - written_bytes;
+            if(left < rest) {
+                written_bytes += left;
+                left = 0;
+            }
+            else {
+                left -= rest;
+                written_bytes = 0;
+                done.push_back(std::move(*partial_frame));
+                partial_frame.reset();
+            }
+        }
+        for(const auto lane : write_lanes) {
+            if(left == 0) {
+                break;
+            }
+
+            auto& queue = outbound_lanes[lane];
+            auto frame = std::move(queue.front());
+            queue.pop_front();
+
+            // the frame must be finished before any other:
+            if(left < size_of(frame)) {
+                written_bytes = left;
+                partial_frame.emplace(std::move(frame));
+                break;
+            }
+            left -= size_of(frame);
+            done.push_back(std::move(frame));
+        }
+
+        for(const auto& frame : done) {
+            queued_bytes -= size_of(frame);
+            if(frame.reply) {
+                queued_replies -= size_of(frame);
+            }
+        }
+
+        // stop watching writability when everything is written:
+        const auto empty = !partial_frame && std::all_of(outbound_lanes.begin(), outbound_lanes.end(), 
+            [](const auto& queue) { return queue.empty(); });
+        if(empty && write_armed) {
+            write_armed = false;
+            srfc_reactor::shared().want_write(io_token.load(), false);
+        }
+    }
+
+    for(auto& frame : done) {
+        if(frame.written) {
+            frame.written(nullptr);
+        }
+    }
+
+    // the written replies may take the connection below its memory budget:
+    if(!done.empty()) {
+        resume_reading();
+    }
+}
+
+void srfc_connection::resolve_method(srfc_message_view& request)
+{
+    // the snapshot is taken again only when the methods have changed:
+    const auto version = methods.version();
+    if(version != io_methods_version) {
+        io_methods = methods.snapshot();
+        io_methods_version = version;
+    }
+
+    // the id announced in the handshake is the index of the method:
+    std::shared_ptr<const srfc_method_table::method> method;
+    if(request.getMethodId() != no_method_id) {
+        method = io_methods->entry(request.getMethodId());
+        if(method) {
+            request.method_name = method->name;     // owned by the method the request keeps
+        }
+    }
+    else {
+        method = io_methods->entry(std::string(request.getMethod()));
+    }
+    request.method = std::move(method);
+}
+
+const srfc_method_table::method* srfc_connection::find_method(const srfc_message_view& request) noexcept
+{
+    return static_cast<const srfc_method_table::method*>(request.method.get());
+}
+
+void srfc_connection::handle_request(const srfc_message_view& request)
+{
+    // the request was cancelled before its handler started:
+    if(is_cancelled(request.cancelled)) {
+        return;
+    }
+
+    auto rid = request.getRequestId();
+    auto response = srfc_response(rid);
+    response.setPriority(request.getPriority());
+
+    const auto* method = find_method(request);
+
+    // coroutine methods send the response when they finish:
+    if(method != nullptr && method->kind == method_kind::task) {
+        ++running_handlers;
+        handle_task_request(method->task_callback, request).detach();
+        return;
+    }
+
+    // stream methods send the chunks first and the response after them:
+    if(method != nullptr && method->kind == method_kind::stream) {
+        chunk_source_t source;
+        status_t res;
+        try {
+            res = method->stream_callback(request, &source);
+        }
+        catch(...) {
+            res = status_codes::unhandled_exception;
+            source = nullptr;
+        }
+
+        if(source) {
+            start_stream(request, res, std::move(source));
+            return;
+        }
+        response.setStatusCode(res);
+        if(finish_request(rid, request.cancelled)) {
+            send_response(response);
+        }
+        return;
+    }
+
+    // other methods return the response. Send it (unless the request was cancelled meanwhile):
+    response = call_method(request, method);
+    if(finish_request(rid, request.cancelled)) {
+        send_response(response);
+    }
+}
+
+srfc_response srfc_connection::call_method(const srfc_message_view& request, const srfc_method_table::method* method)
+{
+    auto response = srfc_response(request.getRequestId());
+    response.setPriority(request.getPriority());
+
+    // No requested method found:
+    if(method == nullptr || (method->kind != method_kind::callback && method->kind != method_kind::view)) {
+        response.setStatusCode(status_codes::unknown_method);
+    }
+
+    // Method found:
+    else {
+        payload_t respPld;
+        std::size_t respPldSz = 0;
+        
+        // Execute method: 
+        status_t res;
+        try {
+            // view methods get the request without any copy:
+            if(method->kind == method_kind::view) {
+                res = method->view_callback(request, &respPld, &respPldSz);
+            }
+            // other methods get the copied parameters and the payload shared with the view:
+            else {
+                const srfc_request req(request);
+                res = method->callback(
+                    req.getParams(),
+                    req.getPayload(),
+                    &respPld,
+                    &respPldSz
+                );
+            }
+        }
+        catch(...) {
+            res = status_codes::unhandled_exception;
+            respPldSz = 0;
+            respPld.reset();
+        }
+
+        // Add results to response:
+        response.setStatusCode(res);
+        response.setPayload(respPld, respPldSz);
+    }
+
+    return response;
+}
+
+void srfc_connection::handle_batch(std::vector<srfc_message_view>& requests, frame_priority priority)
+{
+    std::vector<srfc_response> responses;
+    responses.reserve(requests.size());
+
+    for(auto& request : requests) {
+        // the payloads are decompressed off the I/O thread. The corrupted ones get status_codes::bad_request:
+        if(!inflate(request)) {
+            if(finish_request(request.getRequestId(), request.cancelled)) {
+                responses.push_back(srfc_response(request.getRequestId(), status_codes::bad_request));
+            }
+            continue;
+        }
+
+        // coroutine and stream methods send their responses on their own:
+        const auto* method = find_method(request);
+        if(method != nullptr && (method->kind == method_kind::task || method->kind == method_kind::stream)) {
+            try {
+                handle_request(request);
+            }
+            catch(...) {}
+            continue;
+        }
+
+        if(is_cancelled(request.cancelled)) {
+            continue;
+        }
+        auto response = call_method(request, method);
+        if(finish_request(request.getRequestId(), request.cancelled)) {
+            responses.push_back(std::move(response));
+        }
+    }
+
+    if(!responses.empty()) {
+        __send_batch__(responses, priority);
+    }
+}
+
+srfc_task<> srfc_connection::handle_task_request(task_callback_t method, srfc_message_view request)
+{
+    const auto rid = request.getRequestId();
+    const auto priority = request.getPriority();
+    const auto cancelled = request.cancelled;
+
+    srfc_response response(rid, status_codes::unhandled_exception);
+    try {
+        response = co_await method(std::move(request));
+    }
+    catch(...) {
+        response = srfc_response(rid, status_codes::unhandled_exception);
+    }
+    response.setRequestId(rid);
+    response.setPriority(priority);
+
+    // the request may be cancelled (or the connection closed) while the method was suspended:
+    if(finish_request(rid, cancelled) && connected.load()) {
+        try {
+            send_response(response);
+        }
+        catch(...) {}
+    }
+    finish_handler();
+}
+
+void srfc_connection::finish_handler()
+{
+    if(running_handlers.fetch_sub(1) == 1) {
+        running_handlers.notify_all();
+    }
+}
+
+void srfc_connection::handle_response(const srfc_message_view& response)
+{
+    // responses nobody waits for are dropped:
+    complete_pending(srfc_response(response));
+}
+
+void srfc_connection::handle_chunk(const srfc_message_view& chunk, std::size_t inflated)
+{
+    const auto rid = chunk.getRequestId();
+
+    std::shared_ptr<inbound_stream> stream;
+    {
+        std::lock_guard<std::mutex> lg(pending_mutex);
+
+        auto it = pending_requests.find(rid);
+        if(it != pending_requests.end()) {
+            // send_request() collects the chunks into the payload:
+            if(!it->second.stream) {
+                it->second.stream = std::make_shared<inbound_stream>();
+                it->second.stream->credit = announced_window.load();
+            }
+            stream = it->second.stream;
+        }
+    }
+
+    // nobody waits for the chunk: the request was cancelled (or it timed out), so the sender stops
+    if(!stream) {
+        release_handled(inflated);
+        return;
+    }
+
+    // the sender has at most the granted credit in flight. The queued chunk holds the receive buffer
+    // (and the decompressed payload) until it's handled:
+    const auto size = chunk.getPayloadSize();
+    bool overrun = false;
+    {
+        std::lock_guard<std::mutex> lg(stream->mutex);
+        overrun = size > stream->credit;
+        if(!overrun) {
+            stream->credit -= size;
+            handled_bytes += chunk.getFrameSize();
+            stream->chunks.emplace_back(chunk, chunk.getFrameSize() + inflated);
+        }
+    }
+
+    if(overrun) {
+        release_handled(inflated);
+        abort_pending(rid, status_codes::memory_budget_exceeded);
+        return;
+    }
+    schedule_drain(rid, stream);
+}
+
+void srfc_connection::handle_credit(const srfc_message_view& credit)
+{
+    std::shared_ptr<outbound_stream> stream;
+    {
+        std::lock_guard<std::mutex> lg(stream_mutex);
+
+        auto it = outbound_streams.find(credit.getRequestId());
+        if(it == outbound_streams.end()) {
+            return;
+        }
+
+        // for credit frames the status code is the amount of granted bytes:
+        it->second->credit += credit.getStatusCode();
+        if(it->second->pumping) {
+            return;
+        }
+        it->second->pumping = true;
+        stream = it->second;
+    }
+
+    // the stream was waiting for the credit:
+    ++running_handlers;
+    submit_task([this, rid = credit.getRequestId(), stream] {
+        try {
+            pump_stream(rid, stream);
+        }
+        catch(...) {}
+        finish_handler();
+    });
+}
+
+void srfc_connection::handle_cancel(const srfc_message_view& cancel)
+{
+    const auto rid = cancel.getRequestId();
+
+    // the handler is skipped if it hasn't started yet, the running one sees the cancellation token:
+    {
+        std::lock_guard<std::mutex> lg(received_mutex);
+
+        auto it = received_requests.find(rid);
+        if(it != received_requests.end()) {
+            it->second->store(true);
+            received_requests.erase(it);
+        }
+    }
+
+    // the chunk source of the stream isn't called anymore:
+    std::function<void(std::exception_ptr)> written;
+    {
+        std::lock_guard<std::mutex> lg(stream_mutex);
+
+        auto it = outbound_streams.find(rid);
+        if(it != outbound_streams.end()) {
+            written = close_stream(*it->second);
+            outbound_streams.erase(it);
+        }
+    }
+    if(written) {
+        written(std::make_exception_ptr(std::runtime_error("handle_cancel(const srfc_message_view& cancel): request cancelled")));
+    }
+
+    // and the queued chunks and response (if the handler has finished) aren't sent:
+    remove_outbound([rid](const outbound_frame& frame) {
+        return frame.request_id == rid && (frame.type == frame_type::chunk || frame.type == frame_type::response);
+    });
+}
+
+void srfc_connection::__send_request__(const srfc_request& request)
+{
+    const auto packed = compress_message(request, send_codec());
+    const auto& message = packed ? *packed : request;
+    const auto ck = send_checksum();
+
+    // serialize header only. Payload is passed to the kernel as is:
+    outbound_frame frame;
+    // the hello is sent before the ids of the peer are known:
+    const auto id = message.getMethod() != hello_method ? peer_method_id(message.getMethod()) : no_method_id;
+    // peers without the priority feature would read the "PRIO" line as the method name,
+    // so they get the request as normal. The priority still orders the frame locally:
+    std::optional<srfc_request> plain;
+    if(message.getPriority() != frame_priority::normal && !peer_accepts(srfc_feature::priority)) {
+        plain.emplace(message);
+        plain->setPriority(frame_priority::normal);
+    }
+    frame.header = (plain ? *plain : message).serializeHeader(&frame.header_size, send_format(), ck, id);
+    frame.payload = message.getPayload(&frame.payload_size);
+    frame.priority = message.getPriority();
+    frame.type = frame_type::request;
+    frame.request_id = message.getRequestId();
+    frame.reply = false;
+
+    // the peer would drop the frame:
+    const auto trailer = ck != frame_checksum::none ? checksum_trailer_size : 0;
+    const auto size = frame.header_size + frame.payload_size + trailer;
+    if(size > peer_max_frame.load()) {
+        complete_pending(srfc_response(frame.request_id, status_codes::frame_too_large));
+        return;
+    }
+    if(queued_bytes.load() + size > memory_budget.load()) {
+        complete_pending(srfc_response(frame.request_id, status_codes::memory_budget_exceeded));
+        return;
+    }
+
+    seal(frame, ck);
+    enqueue(std::move(frame));
+}
+
+std::future<void> srfc_connection::__send_response__(const srfc_response& response)
+{
+    auto written = std::make_shared<std::promise<void>>();
+    auto res = written->get_future();
+
+    __send_response__(response, [written](std::exception_ptr error) {
+        if(error) {
+            written->set_exception(error);
+        }
+        else {
+            written->set_value();
+        }
+    });
+
+    return res;
+}
+
+void srfc_connection::__send_response__(const srfc_response& response, std::function<void(std::exception_ptr)> written)
+{
+    std::size_t pldSize = 0;
+    auto pld = response.getPayload(&pldSize);
+
+    // a large payload is sent as chunks (sharing the payload), so the frames of the higher lanes
+    // can be written between them. Peers without stream frames get it in one frame:
+    if(pldSize > stream_chunk_size && peer_accepts(srfc_feature::streams) && stream_response(response, written)) {
+        return;
+    }
+
+    const auto packed = compress_message(response, send_codec());
+    const auto& message = packed ? *packed : response;
+    const auto ck = send_checksum();
+
+    // serialize header only. Payload is passed to the kernel as is:
+    outbound_frame frame;
+    frame.header = message.serializeHeader(&frame.header_size, send_format(), ck);
+    frame.payload = message.getPayload(&frame.payload_size);
+    frame.written = std::move(written);
+    frame.priority = message.getPriority();
+    frame.type = frame_type::response;
+    frame.request_id = message.getRequestId();
+
+    seal(frame, ck);
+    enqueue(std::move(frame));
+}
+
+void srfc_connection::__send_stream_frame__(frame_type type, id_t requestId, payload_t payload, std::size_t size,
+                                            frame_priority priority, std::optional<std::uint32_t> payloadCrc)
+{
+    // chunks carry the data as the payload, credits carry the amount of bytes in the header.
+    // Cancels carry nothing but the request id:
+    const auto ck = send_checksum();
+
+    outbound_frame frame;
+    frame.priority = priority;
+    frame.type = type;
+    frame.request_id = requestId;
+    if(type == frame_type::chunk) {
+        auto codec = send_codec();
+        std::size_t packedSize = 0;
+        auto packed = codec != payload_codec::none ? compress_payload(codec, payload.get(), size, &packedSize) : nullptr;
+        // the checksum of the data doesn't cover the compressed chunk:
+        if(packed) {
+            payload = std::move(packed);
+            size = packedSize;
+            payloadCrc.reset();
+        }
+        else {
+            codec = payload_codec::none;
+        }
+
+        frame.header = serialize_stream_header(type, requestId, size, 0, send_format(), &frame.header_size, codec, ck);
+        frame.payload = std::move(payload);
+        frame.payload_size = size;
+    }
+    else {
+        frame.header = serialize_stream_header(type, requestId, 0, static_cast<std::uint32_t>(size), 
+                                               send_format(), &frame.header_size, payload_codec::none, ck);
+    }
+
+    seal(frame, ck, payloadCrc);
+    enqueue(std::move(frame));
+}
+
+void srfc_connection::__send_batch__(const std::vector<srfc_request>& requests)
+{
+    // peers without batch frames get the requests one by one:
+    if(!peer_accepts(srfc_feature::batch)) {
+        for(const auto& request : requests) {
+            __send_request__(request);
+        }
+        return;
+    }
+
+    const auto fmt = send_format();
+    const auto ck = send_checksum();
+
+    std::shared_ptr<const method_ids_t> ids;
+    {
+        std::lock_guard<std::mutex> lg(handshake_mutex);
+        ids = peer_methods;
+    }
+
+    // the nested messages are covered by the checksum of the batch:
+    outbound_frame frame;
+    std::uint32_t payloadCrc = 0;
+    frame.payload = pack_batch(requests, fmt, &frame.payload_size, ck != frame_checksum::none ? &payloadCrc : nullptr,
+                               ids.get());
+    frame.header = serialize_stream_header(frame_type::batch, 0, frame.payload_size, 0, fmt, &frame.header_size,
+                                           payload_codec::none, ck);
+    frame.type = frame_type::batch;
+    frame.reply = false;
+
+    // the batch doesn't fit into a frame of the peer (or into the memory budget),
+    // so the requests are sent (or rejected) one by one:
+    const auto trailer = ck != frame_checksum::none ? checksum_trailer_size : 0;
+    const auto size = frame.header_size + frame.payload_size + trailer;
+    if(size > peer_max_frame.load() || queued_bytes.load() + size > memory_budget.load()) {
+        for(const auto& request : requests) {
+            __send_request__(request);
+        }
+        return;
+    }
+
+    // the batch is as urgent as its most urgent request:
+    frame.priority = std::min_element(requests.begin(), requests.end(), [](const auto& a, const auto& b) {
+        return lane_of(a.getPriority()) < lane_of(b.getPriority());
+    })->getPriority();
+
+    seal(frame, ck, payloadCrc);
+    enqueue(std::move(frame));
+}
+
+void srfc_connection::__send_batch__(const std::vector<srfc_response>& responses, frame_priority priority)
+{
+    // large payloads are chunked, so they're sent on their own:
+    std::vector<srfc_response> batched;
+    for(const auto& response : responses) {
+        std::size_t pldSize = 0;
+        response.getPayload(&pldSize);
+        if(pldSize > stream_chunk_size) {
+            __send_response__(response, nullptr);
+        }
+        else {
+            batched.push_back(response);
+        }
+    }
+
+    if(batched.size() <= 1) {
+        if(!batched.empty()) {
+            __send_response__(batched.front(), nullptr);
+        }
+        return;
+    }
+
+    const auto fmt = send_format();
+    const auto ck = send_checksum();
+
+    outbound_frame frame;
+    std::uint32_t payloadCrc = 0;
+    frame.payload = pack_batch(batched, fmt, &frame.payload_size, ck != frame_checksum::none ? &payloadCrc : nullptr);
+    frame.header = serialize_stream_header(frame_type::batch, 0, frame.payload_size, 0, fmt, &frame.header_size,
+                                           payload_codec::none, ck);
+    frame.type = frame_type::batch;
+    frame.priority = priority;
+
+    // every response fits into a frame of the peer (see min_max_frame_size), the batch may not:
+    const auto trailer = ck != frame_checksum::none ? checksum_trailer_size : 0;
+    if(frame.header_size + frame.payload_size + trailer > peer_max_frame.load()) {
+        for(const auto& response : batched) {
+            __send_response__(response, nullptr);
+        }
+        return;
+    }
+
+    seal(frame, ck, payloadCrc);
+    enqueue(std::move(frame));
+}
+
+void srfc_connection::enqueue(outbound_frame frame)
+{
+    std::lock_guard<std::mutex> lg(outbound_mutex);
+
+    // the connection was closed after the caller checked it:
+    if(!connected.load()) {
+        if(frame.written) {
+            frame.written(std::make_exception_ptr(
+                std::runtime_error("enqueue(outbound_frame frame): not connected")));
+        }
+        return;
+    }
+
+    queued_bytes += size_of(frame);
+    if(frame.reply) {
+        queued_replies += size_of(frame);
+    }
+    outbound_lanes[lane_of(frame.priority)].push_back(std::move(frame));
+
+    // the I/O thread writes the lanes when the socket becomes writable:
+    const auto token = io_token.load();
+    if(!write_armed && token != 0) {
+        write_armed = true;
+        srfc_reactor::shared().want_write(token, true);
+    }
+}
+
+void srfc_connection::fail_outbound()
+{
+    std::deque<outbound_frame> failed;
+    {
+        std::lock_guard<std::mutex> lg(outbound_mutex);
+        if(partial_frame) {
+            failed.push_back(std::move(*partial_frame));
+            partial_frame.reset();
+        }
+        for(auto& lane : outbound_lanes) {
+            std::move(lane.begin(), lane.end(), std::back_inserter(failed));
+            lane.clear();
+        }
+        written_bytes = 0;
+        write_armed = false;
+        queued_bytes.store(0);
+        queued_replies.store(0);
+    }
+
+    for(auto& frame : failed) {
+        if(frame.written) {
+            frame.written(std::make_exception_ptr(
+                std::runtime_error("fail_outbound(): connection closed")));
+        }
+    }
+}
+
+std::size_t srfc_connection::remove_outbound(const std::function<bool(const outbound_frame&)>& match)
+{
+    std::vector<outbound_frame> removed;
+    {
+        std::lock_guard<std::mutex> lg(outbound_mutex);
+
+        for(std::size_t lane = 0; lane < lane_count; ++lane) {
+            auto& queue = outbound_lanes[lane];
+
+            // the frames taken by the gather-write in progress stay in place:
+            auto kept = queue.begin() + static_cast<std::ptrdiff_t>(std::min(writing[lane], queue.size()));
+            for(auto it = kept; it != queue.end(); ++it) {
+                if(match(*it)) {
+                    queued_bytes -= size_of(*it);
+                    if(it->reply) {
+                        queued_replies -= size_of(*it);
+                    }
+                    removed.push_back(std::move(*it));
+                }
+                else {
+                    if(kept != it) {
+                        *kept = std::move(*it);
+                    }
+                    ++kept;
+                }
+            }
+            queue.erase(kept, queue.end());
+        }
+    }
+
+    for(auto& frame : removed) {
+        if(frame.written) {
+            frame.written(std::make_exception_ptr(
+                std::runtime_error("remove_outbound(): request cancelled")));
+        }
+    }
+
+    if(!removed.empty()) {
+        resume_reading();
+    }
+    return removed.size();
+}
+
+std::size_t srfc_connection::size_of(const outbound_frame& frame) noexcept
+{
+    return frame.header_size + frame.payload_size + frame.trailer_size;
+}
+
+//
+// Memory budget:
+//
+
+bool srfc_connection::over_budget() const noexcept
+{
+    return handled_bytes.load() + queued_replies.load() >= memory_budget.load();
+}
+
+void srfc_connection::pause_reading()
+{
+    const auto token = io_token.load();
+    if(token == 0) {
+        return;
+    }
+
+    // resume_reading() on other threads enables reading only after it's disabled here:
+    srfc_reactor::shared().want_read(token, false);
+    reading_paused.store(true);
+
+    // the memory may have been released meanwhile:
+    resume_reading();
+}
+
+void srfc_connection::resume_reading()
+{
+    if(!reading_paused.load() || over_budget() || executor_full.load() || !reading_paused.exchange(false)) {
+        return;
+    }
+
+    const auto token = io_token.load();
+    if(token != 0) {
+        srfc_reactor::shared().want_read(token, true);
+    }
+}
+
+void srfc_connection::release_handled(std::size_t bytes)
+{
+    handled_bytes -= bytes;
+    resume_reading();
+}
+
+bool srfc_connection::charge_inflated(const srfc_message_view& message, std::size_t* pBytes)
+{
+    *pBytes = 0;
+    if(message.getPayloadCodec() == payload_codec::none) {
+        return true;
+    }
+
+    // payloads larger than the max frame size aren't decompressed at all (see inflate()):
+    std::size_t size = 0;
+    try {
+        size = std::min(decompressed_size(message.getPayloadData(), message.getPayloadSize()), max_frame_size.load());
+    }
+    catch(const std::runtime_error&) {
+        return true;    // truncated, so inflate() rejects it
+    }
+
+    if(handled_bytes.load() + queued_replies.load() + size > memory_budget.load()) {
+        return false;
+    }
+    handled_bytes += size;
+    *pBytes = size;
+    return true;
+}
+
+void srfc_connection::reject_inflated(const srfc_message_view& message)
+{
+    const auto rid = message.getRequestId();
+
+    // the request isn't handled:
+    if(message.getType() == frame_type::request) {
+        auto response = srfc_response(rid, status_codes::memory_budget_exceeded);
+        response.setPriority(message.getPriority());
+        try {
+            __send_response__(response);
+        }
+        catch(...) {}
+        return;
+    }
+
+    // the request waiting for the response (or the chunk) fails, and the peer stops sending the rest:
+    abort_pending(rid, status_codes::memory_budget_exceeded);
+}
+
+void srfc_connection::submit_task(std::function<void()> task)
+{
+    auto& executor = srfc_executor::shared();
+    {
+        // the deferred tasks go first:
+        std::lock_guard<std::mutex> lg(deferred_mutex);
+        if(deferred_tasks.empty() && executor.try_submit(std::move(task))) {
+            return;
+        }
+
+        deferred_tasks.push_back(std::move(task));
+        if(deferred_tasks.size() != 1) {
+            return;     // already waiting for space
+        }
+        executor_full.store(true);
+    }
+
+    // the callback keeps the connection alive (see reset()):
+    ++running_handlers;
+    executor.when_space([this]{ submit_deferred(); });
+    pause_reading();
+}
+
+void srfc_connection::submit_deferred()
+{
+    auto& executor = srfc_executor::shared();
+    bool full = false;
+    {
+        std::lock_guard<std::mutex> lg(deferred_mutex);
+        while(!deferred_tasks.empty() && executor.try_submit(std::move(deferred_tasks.front()))) {
+            deferred_tasks.pop_front();
+        }
+        full = !deferred_tasks.empty();
+        executor_full.store(full);
+    }
+
+    // full again. The next callback keeps the connection alive:
+    if(full) {
+        executor.when_space([this]{ submit_deferred(); });
+        return;
+    }
+
+    resume_reading();
+    finish_handler();
+}
+
+void srfc_connection::pending_call::finish(srfc_response response)
+{
+    // the chunks received after that are dropped:
+    if(stream) {
+        stream->abandoned.store(true);
+    }
+
+    if(completion) {
+        completion(std::move(response));
+    }
+    else {
+        promise.set_value(std::move(response));
+    }
+}
+
+std::future<srfc_response> srfc_connection::add_pending(id_t requestId)
+{
+    pending_call slot;
+    auto res = slot.promise.get_future();
+
+    insert_pending(requestId, std::move(slot));
+    return res;
+}
+
+void srfc_connection::add_pending(id_t requestId, completion_t completion)
+{
+    pending_call slot;
+    slot.completion = std::move(completion);
+
+    insert_pending(requestId, std::move(slot));
+}
+
+std::future<std::vector<srfc_response>> srfc_connection::add_batch_pending(const std::vector<srfc_request>& requests)
+{
+    struct state_t
+    {
+        std::vector<srfc_response> responses;
+        std::atomic<std::size_t> left;
+        std::promise<std::vector<srfc_response>> promise;
+    };
+
+    auto state = std::make_shared<state_t>();
+    auto res = state->promise.get_future();
+    if(requests.empty()) {
+        state->promise.set_value({});
+        return res;
+    }
+
+    state->responses.reserve(requests.size());
+    for(const auto& request : requests) {
+        state->responses.push_back(srfc_response(request.getRequestId(), status_codes::connection_error));
+    }
+    state->left.store(requests.size());
+
+    // each slot owns its own element; the last one (acq_rel) sees all of them:
+    for(std::size_t i = 0; i < requests.size(); ++i) {
+        try {
+            add_pending(requests[i].getRequestId(), [state, i](srfc_response response) {
+                state->responses[i] = std::move(response);
+                if(state->left.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    state->promise.set_value(std::move(state->responses));
+                }
+            });
+        }
+        catch(...) {
+            // e.g. the request id is already pending. The slots of the batch are removed:
+            for(std::size_t j = 0; j < i; ++j) {
+                drop_pending(requests[j].getRequestId());
+            }
+            throw;
+        }
+    }
+
+    return res;
+}
+
+void srfc_connection::insert_pending(id_t requestId, pending_call slot)
+{
+    {
+        std::lock_guard<std::mutex> lg(pending_mutex);
+
+        // the connection was closed after the caller checked it:
+        if(connected.load()) {
+            if(pending_requests.emplace(requestId, std::move(slot)).second == false) {
+                throw std::logic_error("insert_pending(id_t requestId, pending_call slot): request with id = " + 
+                                       std::to_string(requestId) + " is already pending");
+            }
+            return;
+        }
+    }
+    // completed outside of the lock: the completion may send another request
+    slot.finish(srfc_response(requestId, status_codes::connection_error));
+}
+
+bool srfc_connection::drop_pending(id_t requestId)
+{
+    pending_call slot;
+    {
+        std::lock_guard<std::mutex> lg(pending_mutex);
+
+        auto it = pending_requests.find(requestId);
+        if(it == pending_requests.end()) {
+            return false;
+        }
+
+        slot = std::move(it->second);
+        pending_requests.erase(it);
+    }
+
+    if(slot.timer != 0) {
+        srfc_timer_wheel::shared().cancel(slot.timer);
+    }
+    return true;
+}
+
+void srfc_connection::set_pending_deadline(id_t requestId, std::chrono::milliseconds timeout)
+{
+    auto& wheel = srfc_timer_wheel::shared();
+
+    // the timer completes the request with response_timeout, reclaims its slot and cancels it on the peer:
+    const auto timer = wheel.schedule(timeout, [this, requestId] {
+        pending_call slot;
+        {
+            std::lock_guard<std::mutex> lg(pending_mutex);
+
+            auto it = pending_requests.find(requestId);
+            if(it == pending_requests.end()) {
+                return;
+            }
+
+            slot = std::move(it->second);
+            pending_requests.erase(it);
+        }
+        withdraw_request(requestId);
+        slot.finish(srfc_response(requestId, status_codes::response_timeout));
+    });
+
+    std::lock_guard<std::mutex> lg(pending_mutex);
+
+    auto it = pending_requests.find(requestId);
+    if(it != pending_requests.end()) {
+        it->second.timer = timer;
+    }
+    // the request was completed (or the timer fired) before the timer was attached:
+    else {
+        wheel.cancel(timer);
+    }
+}
+
+bool srfc_connection::complete_pending(srfc_response response)
+{
+    pending_call slot;
+    {
+        std::lock_guard<std::mutex> lg(pending_mutex);
+
+        auto it = pending_requests.find(response.getRequestId());
+        if(it == pending_requests.end()) {
+            return false;
+        }
+
+        slot = std::move(it->second);
+        pending_requests.erase(it);
+    }
+
+    if(slot.timer != 0) {
+        srfc_timer_wheel::shared().cancel(slot.timer);
+        slot.timer = 0;
+    }
+
+    // a streamed response is completed after its chunks are handled:
+    if(slot.stream) {
+        const auto rid = response.getRequestId();
+        const auto stream = std::move(slot.stream);
+        {
+            std::lock_guard<std::mutex> lg(stream->mutex);
+            stream->slot.emplace(std::move(slot));
+            stream->response.emplace(std::move(response));
+        }
+        schedule_drain(rid, stream);
+        return true;
+    }
+
+    // wakes only the waiter of this request:
+    slot.finish(std::move(response));
+    return true;
+}
+
+void srfc_connection::fail_pending()
+{
+    std::unordered_map<id_t, pending_call> failed;
+    {
+        std::lock_guard<std::mutex> lg(pending_mutex);
+        failed.swap(pending_requests);
+    }
+
+    for(auto& slot : failed) {
+        if(slot.second.timer != 0) {
+            srfc_timer_wheel::shared().cancel(slot.second.timer);
+        }
+        slot.second.finish(srfc_response(slot.first, status_codes::connection_error));
+    }
+}
+
+void srfc_connection::withdraw_request(id_t requestId)
+{
+    // the request is still queued, so it's never sent:
+    const auto removed = remove_outbound([requestId](const outbound_frame& frame) {
+        return frame.type == frame_type::request && frame.request_id == requestId;
+    });
+    // peers without cancel frames still answer it (the response is dropped):
+    if(removed != 0 || connected.load() == false || !peer_accepts(srfc_feature::cancel)) {
+        return;
+    }
+
+    // the cancel frame bypasses the queued data:
+    __send_stream_frame__(frame_type::cancel, requestId, nullptr, 0, frame_priority::high);
+}
+
+//
+// Received requests:
+//
+
+void srfc_connection::register_request(srfc_message_view& request)
+{
+    request.cancelled = std::make_shared<std::atomic_bool>(false);
+
+    std::lock_guard<std::mutex> lg(received_mutex);
+    received_requests[request.getRequestId()] = request.cancelled;
+}
+
+bool srfc_connection::finish_request(id_t requestId, const std::shared_ptr<std::atomic_bool>& cancelled)
+{
+    std::lock_guard<std::mutex> lg(received_mutex);
+
+    // the entry of a cancelled request is already removed (and the id may be reused):
+    auto it = received_requests.find(requestId);
+    if(it != received_requests.end() && it->second == cancelled) {
+        received_requests.erase(it);
+    }
+    return !is_cancelled(cancelled);
+}
+
+void srfc_connection::cancel_requests()
+{
+    // nobody receives the responses of the running handlers anymore:
+    std::unordered_map<id_t, std::shared_ptr<std::atomic_bool>> cancelled;
+    {
+        std::lock_guard<std::mutex> lg(received_mutex);
+        cancelled.swap(received_requests);
+    }
+
+    for(auto& request : cancelled) {
+        request.second->store(true);
+    }
+}
+
+void srfc_connection::dispatch_received()
+{
+    while(received_data.size() != 0) {
+        // validate, classify and decode the message in a single pass.
+        // The view points into the receive buffer (no copy is made):
+        srfc_message_view view;
+        const auto status = parser.parse(received_data.block(), received_data.data(), received_data.size(), view);
+
+        // entire message is not received yet:
+        if(status == parse_status::incomplete) {
+            return;
+        }
+
+        // the stream is corrupted, so the following frames can't be trusted either.
+        // The oversized frame isn't buffered to be skipped:
+        if(status == parse_status::invalid_checksum || status == parse_status::frame_too_large) {
+            shutdown_from_io();
+            return;
+        }
+
+        // Invalid message:
+        if(status != parse_status::ok) {
+            // skip the ill-formed message if its size is known, drop all received data otherwise:
+            if(parser.frame_size() != 0 && parser.frame_size() <= received_data.size()) {
+                received_data.consume(parser.frame_size());
+            }
+            else {
+                received_data.clear();
+            }
+            parser.reset();
+            continue;
+        }
+
+        received_data.consume(view.getFrameSize());
+        parser.reset();
+
+        // the hello of the peer is answered in place:
+        if(view.getType() == frame_type::request && view.getMethod() == hello_method) {
+            handle_hello(view);
+            continue;
+        }
+
+        // the decompressed payload is charged to the budget before it's allocated:
+        std::size_t inflated = 0;
+        if(!charge_inflated(view, &inflated)) {
+            reject_inflated(view);
+            continue;
+        }
+
+        // other frames are small (chunks are at most stream_chunk_size), so they're decompressed in place.
+        // The corrupted ones are dropped:
+        if(view.getType() != frame_type::request && !inflate(view)) {
+            release_handled(inflated);
+            continue;
+        }
+
+        // requests are passed to the handlers on the shared executor (and can be cancelled from now on).
+        // Other frames only update the pending requests, the streams and the queues in place:
+        if(view.getType() == frame_type::request) {
+            resolve_method(view);
+            register_request(view);
+            const auto held = view.getFrameSize() + inflated;
+            handled_bytes += view.getFrameSize();
+            ++running_handlers;
+            submit_task([this, held, view = std::move(view)]() mutable {
+                try {
+                    // the payload is decompressed off the I/O thread:
+                    if(inflate(view)) {
+                        handle_request(view);
+                    }
+                    else if(finish_request(view.getRequestId(), view.cancelled)) {
+                        auto response = srfc_response(view.getRequestId(), status_codes::bad_request);
+                        response.setPriority(view.getPriority());
+                        send_response(response);
+                    }
+                }
+                catch(...) {}   // e.g. the connection was closed before the response was sent
+                release_handled(held);
+                finish_handler();
+            });
+        }
+        else if(view.getType() == frame_type::chunk) {
+            handle_chunk(view, inflated);
+            inflated = 0;
+        }
+        else if(view.getType() == frame_type::credit) {
+            handle_credit(view);
+        }
+        else if(view.getType() == frame_type::cancel) {
+            handle_cancel(view);
+        }
+        else if(view.getType() == frame_type::batch) {
+            dispatch_batch(view);
+        }
+        else {
+            handle_response(view);
+        }
+
+        // the decompressed payload of the other frames is handed over (or copied) by now:
+        if(view.getType() != frame_type::request && inflated != 0) {
+            release_handled(inflated);
+        }
+    }
+}
+
+void srfc_connection::dispatch_batch(const srfc_message_view& batch)
+{
+    // the batched messages are views into the same receive buffer:
+    std::vector<srfc_message_view> requests;
+    std::size_t inflatedRequests = 0;   // charged to the budget until the requests are handled
+    const char* ptr = batch.getPayloadData();
+    std::size_t left = batch.getPayloadSize();
+
+    while(left != 0) {
+        srfc_frame_parser nested;
+        srfc_message_view message;
+
+        // the rest of the batch is dropped from the first ill-formed message:
+        if(nested.parse(batch.buffer, ptr, left, message) != parse_status::ok || 
+           message.getType() == frame_type::batch) 
+        {
+            break;
+        }
+        ptr += message.getFrameSize();
+        left -= message.getFrameSize();
+
+        // responses complete their slots in place, requests are handled together.
+        // Batched payloads aren't compressed by srfc_connection, but the wire format allows it:
+        // the requests are decompressed by the executor task, the responses in place as single ones.
+        // Other frames aren't batched:
+        std::size_t inflated = 0;
+        if(!charge_inflated(message, &inflated)) {
+            reject_inflated(message);
+            continue;
+        }
+
+        if(message.getType() == frame_type::request) {
+            resolve_method(message);
+            register_request(message);
+            requests.push_back(std::move(message));
+            inflatedRequests += inflated;
+            continue;
+        }
+        if(message.getType() == frame_type::response && inflate(message)) {
+            handle_response(message);
+        }
+        release_handled(inflated);
+    }
+
+    if(requests.empty()) {
+        return;
+    }
+
+    const auto held = batch.getFrameSize() + inflatedRequests;
+    handled_bytes += batch.getFrameSize();
+    ++running_handlers;
+    submit_task([this, held, requests = std::move(requests), priority = batch.getPriority()]() mutable {
+        try {
+            handle_batch(requests, priority);
+        }
+        catch(...) {}   // e.g. the connection was closed before the responses were sent
+        release_handled(held);
+        finish_handler();
+    });
+}
+
+//
+// Handshake:
+//
+
+void srfc_connection::send_hello()
+{
+    // the methods are announced by id, so the peer can name them with the ids:
+    announced_window.store(receive_window.load());
+    auto caps = local_capabilities(max_frame_size.load(), announced_window.load());
+    const auto table = methods.snapshot();
+    caps.methods.reserve(table->size());
+    for(srfc_method_table::method_id_t id = 0; id < table->size(); ++id) {
+        caps.methods.push_back(table->find(id) != nullptr ? table->name_of(id) : std::string());
+    }
+
+    auto hello = make_hello(caps);
+
+    // the answer is completed on the I/O thread. Older peers answer status_codes::unknown_method:
+    add_pending(hello.getRequestId(), [this](srfc_response response) {
+        finish_handshake(response.getStatusCode());
+    });
+    try {
+        __send_request__(hello);
+    }
+    catch(...) {
+        drop_pending(hello.getRequestId());
+        throw;
+    }
+}
+
+void srfc_connection::handle_hello(const srfc_message_view& hello)
+{
+    // the peer sends its hello before answering ours, so the capabilities are applied before the handshake ends:
+    const auto caps = read_hello(hello);
+    peer_formats.store(caps.wire_formats);
+    peer_codecs.store(caps.codecs & supported_codecs());
+    peer_checksums.store(caps.checksums & supported_checksums());
+    peer_max_frame.store(caps.max_frame_size);
+    peer_window.store(caps.stream_window);
+    peer_features.store(caps.features);
+
+    std::shared_ptr<method_ids_t> ids;
+    if(!caps.methods.empty()) {
+        ids = std::make_shared<method_ids_t>();
+        for(std::uint32_t id = 0; id < caps.methods.size(); ++id) {
+            if(!caps.methods[id].empty()) {
+                ids->emplace(caps.methods[id], id);
+            }
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lg(handshake_mutex);
+        peer_caps = caps;
+        peer_methods = std::move(ids);
+    }
+
+    auto response = srfc_response(hello.getRequestId());
+    response.setPriority(frame_priority::high);
+    __send_response__(response, nullptr);
+}
+
+void srfc_connection::finish_handshake(status_t status)
+{
+    {
+        std::lock_guard<std::mutex> lg(handshake_mutex);
+
+        // the peer has answered without the hello of its own:
+        if(!peer_caps && status != status_codes::connection_error) {
+            peer_caps = legacy_capabilities();
+        }
+        handshaken = true;
+    }
+    handshake_cv.notify_all();
+}
+
+std::uint32_t srfc_connection::peer_method_id(const std::string& methodName) const
+{
+    std::shared_ptr<const method_ids_t> ids;
+    {
+        std::lock_guard<std::mutex> lg(handshake_mutex);
+        ids = peer_methods;
+    }
+    return find_method_id(ids.get(), methodName);
+}
+
+wire_format srfc_connection::send_format() const noexcept
+{
+    const auto fmt = wire_fmt.load();
+    return (peer_formats.load() >> static_cast<unsigned>(fmt)) & 1u ? fmt : wire_format::srfc_v1;
+}
+
+payload_codec srfc_connection::send_codec() const noexcept
+{
+    const auto codec = compression.load();
+    const auto codecs = peer_codecs.load();
+    if(codec == payload_codec::none || codecs == 0) {
+        return payload_codec::none;
+    }
+
+    // the built-in codec is the fallback:
+    if((codecs >> static_cast<unsigned>(codec)) & 1u) {
+        return codec;
+    }
+    if((codecs >> static_cast<unsigned>(payload_codec::lz77)) & 1u) {
+        return payload_codec::lz77;
+    }
+    return payload_codec::none;
+}
+
+bool srfc_connection::peer_accepts(srfc_feature feature) const noexcept
+{
+    return (peer_features.load() & static_cast<std::uint8_t>(feature)) != 0;
+}
+
+frame_checksum srfc_connection::send_checksum() const noexcept
+{
+    const auto ck = checksum.load();
+    return ck != frame_checksum::none && (peer_checksums.load() >> static_cast<unsigned>(ck)) & 1u ? 
+        ck : frame_checksum::none;
+}
+
+void srfc_connection::seal(outbound_frame& frame, frame_checksum checksum, std::optional<std::uint32_t> payloadCrc)
+{
+    if(checksum == frame_checksum::none) {
+        return;
+    }
+
+    // the header is serialized after the payload is checksummed, so their checksums are combined:
+    auto crc = crc32c(0, frame.header.get(), frame.header_size);
+    if(payloadCrc) {
+        crc = crc32c_combine(crc, *payloadCrc, frame.payload_size);
+    }
+    else {
+        crc = crc32c(crc, frame.payload.get(), frame.payload_size);
+    }
+
+    auto* ptr = frame.trailer.data();
+    store_le_and_shift(ptr, crc);
+    frame.trailer_size = checksum_trailer_size;
+}
+
+bool srfc_connection::inflate(srfc_message_view& message) const
+{
+    if(message.codec == payload_codec::none) {
+        return true;
+    }
+
+    try {
+        std::size_t size = 0;
+        auto data = decompress_payload(message.codec, message.payload_data, message.payload_size, &size,
+                                       max_frame_size.load());
+
+        // the decompressed block keeps the receive buffer alive, as the method and parameters point into it:
+        const auto raw = data.get();
+        message.buffer = srfc_message_view::buffer_t(raw, 
+            [data = std::move(data), received = std::move(message.buffer)](char*) {});
+        message.payload_data = raw;
+        message.payload_size = size;
+        message.codec = payload_codec::none;
+        return true;
+    }
+    catch(const std::runtime_error&) {
+        return false;
+    }
+    catch(const std::bad_alloc&) {
+        return false;
+    }
+}
+
+//
+// Streams:
+//
+
+void srfc_connection::schedule_drain(id_t requestId, std::shared_ptr<inbound_stream> stream)
+{
+    {
+        std::lock_guard<std::mutex> lg(stream->mutex);
+        if(stream->draining) {
+            return;
+        }
+        stream->draining = true;
+    }
+
+    // the chunks collected by send_request() are appended on the I/O thread, so a handler waiting
+    // for the future on a worker doesn't wait for another worker (see srfc_executor):
+    if(!stream->on_chunk) {
+        try {
+            drain_stream(requestId, stream);
+        }
+        catch(...) {}
+        return;
+    }
+
+    ++running_handlers;
+    submit_task([this, requestId, stream = std::move(stream)] {
+        try {
+            drain_stream(requestId, stream);
+        }
+        catch(...) {}
+        finish_handler();
+    });
+}
+
+void srfc_connection::drain_stream(id_t requestId, const std::shared_ptr<inbound_stream>& stream)
+{
+    while(true) {
+        srfc_message_view chunk;
+        std::size_t held = 0;
+        std::optional<pending_call> slot;
+        std::optional<srfc_response> response;
+        {
+            std::lock_guard<std::mutex> lg(stream->mutex);
+
+            if(!stream->chunks.empty()) {
+                chunk = std::move(stream->chunks.front().first);
+                held = stream->chunks.front().second;
+                stream->chunks.pop_front();
+            }
+            // every chunk is handled. The response completes the slot:
+            else if(stream->slot) {
+                slot = std::move(stream->slot);
+                response = std::move(stream->response);
+                stream->slot.reset();
+                stream->response.reset();
+            }
+            else {
+                stream->draining = false;
+                return;
+            }
+        }
+
+        if(slot) {
+            if(stream->failed) {
+                response = srfc_response(requestId, status_codes::unhandled_exception);
+            }
+            else if(!stream->on_chunk && !stream->collected.empty()) {
+                // the payload takes the collected block over:
+                auto collected = std::make_shared<std::vector<char>>(std::move(stream->collected));
+                response->setPayload(payload_t(collected, collected->data()), collected->size());
+            }
+            slot->finish(std::move(*response));
+
+            std::lock_guard<std::mutex> lg(stream->mutex);
+            stream->draining = false;
+            return;
+        }
+
+        const auto size = chunk.getPayloadSize();
+        if(!stream->abandoned.load() && !stream->failed) {
+            try {
+                if(stream->on_chunk) {
+                    stream->on_chunk(chunk.getPayloadData(), size);
+                }
+                else {
+                    stream->collected.insert(stream->collected.end(), chunk.getPayloadData(), chunk.getPayloadData() + size);
+                }
+            }
+            catch(...) {
+                stream->failed = true;
+                abandon_stream(requestId, stream);
+            }
+        }
+        chunk = srfc_message_view();    // releases the receive buffer before the sender refills it
+        release_handled(held);
+
+        // the consumed bytes are returned to the sender:
+        {
+            std::lock_guard<std::mutex> lg(stream->mutex);
+            stream->credit += size;
+        }
+        grant_credit(requestId, size);
+    }
+}
+
+void srfc_connection::abandon_stream(id_t requestId, const std::shared_ptr<inbound_stream>& stream)
+{
+    // the response hasn't been received yet: complete the slot now and stop the sender
+    pending_call slot;
+    {
+        std::lock_guard<std::mutex> lg(pending_mutex);
+
+        auto it = pending_requests.find(requestId);
+        if(it == pending_requests.end() || it->second.stream != stream) {
+            return;
+        }
+
+        slot = std::move(it->second);
+        pending_requests.erase(it);
+    }
+
+    if(slot.timer != 0) {
+        srfc_timer_wheel::shared().cancel(slot.timer);
+    }
+    withdraw_request(requestId);
+    slot.finish(srfc_response(requestId, status_codes::unhandled_exception));
+}
+
+void srfc_connection::grant_credit(id_t requestId, std::size_t bytes)
+{
+    if(bytes == 0 || connected.load() == false) {
+        return;
+    }
+
+    // a chunk is never larger than the credit, so it fits into the 32-bit field of the credit frame:
+    constexpr std::size_t max_credit = 0xFFFFFFFF;
+    // credits are small and unblock the sender, so they bypass the queued data:
+    __send_stream_frame__(frame_type::credit, requestId, nullptr, std::min(bytes, max_credit), frame_priority::high);
+}
+
+void srfc_connection::start_stream(const srfc_message_view& request, status_t status, chunk_source_t source)
+{
+    const auto requestId = request.getRequestId();
+
+    // peers without stream frames get the whole payload in the response:
+    if(!peer_accepts(srfc_feature::streams)) {
+        std::vector<char> data;
+        while(!is_cancelled(request.cancelled)) {
+            const auto offset = data.size();
+            data.resize(offset + stream_chunk_size);
+            std::size_t read = 0;
+            try {
+                read = std::min(source(data.data() + offset, stream_chunk_size), stream_chunk_size);
+            }
+            catch(...) {
+                status = status_codes::unhandled_exception;
+            }
+            data.resize(offset + read);
+            if(read == 0) {
+                break;
+            }
+        }
+
+        srfc_response response(requestId, status);
+        response.setPriority(request.getPriority());
+        if(!data.empty()) {
+            payload_t payload(new char[data.size()], array_deleter<char>());
+            std::memcpy(payload.get(), data.data(), data.size());
+            response.setPayload(payload, data.size());
+        }
+        if(finish_request(requestId, request.cancelled)) {
+            send_response(response);
+        }
+        return;
+    }
+
+    auto stream = std::make_shared<outbound_stream>();
+    stream->source = std::move(source);
+    stream->status = status;
+    stream->priority = request.getPriority();
+    stream->credit = peer_window.load();
+    stream->cancelled = request.cancelled;
+    stream->pumping = true;
+    {
+        std::lock_guard<std::mutex> lg(stream_mutex);
+        if(outbound_streams.emplace(requestId, stream).second == false) {
+            throw std::logic_error("start_stream(const srfc_message_view& request, status_t status, chunk_source_t source): "
+                                   "request with id = " + std::to_string(requestId) + " is already streamed");
+        }
+    }
+
+    pump_stream(requestId, stream);
+}
+
+bool srfc_connection::stream_response(const srfc_response& response, std::function<void(std::exception_ptr)>& written)
+{
+    // the chunks of the payload take the credit path of the stream methods. The response follows them:
+    auto stream = std::make_shared<outbound_stream>();
+    stream->data = response.getPayload(&stream->data_size);
+    stream->response.emplace(response);
+    stream->response->setPayload(nullptr, 0);
+    stream->written = std::move(written);
+    stream->priority = response.getPriority();
+    stream->credit = peer_window.load();
+    stream->pumping = true;
+    {
+        std::lock_guard<std::mutex> lg(stream_mutex);
+
+        // the request is streamed already, so the response is sent in one frame:
+        if(outbound_streams.emplace(response.getRequestId(), stream).second == false) {
+            written = std::move(stream->written);
+            return false;
+        }
+    }
+
+    pump_stream(response.getRequestId(), stream);
+    return true;
+}
+
+void srfc_connection::pump_stream(id_t requestId, const std::shared_ptr<outbound_stream>& stream)
+{
+    // the source is called only by the pumping thread:
+    while(connected.load()) {
+        // the receiver has cancelled the request. handle_cancel() has removed the stream:
+        if(is_cancelled(stream->cancelled)) {
+            return;
+        }
+
+        std::size_t size;
+        {
+            std::lock_guard<std::mutex> lg(stream_mutex);
+
+            if(stream->closed) {
+                return;
+            }
+
+            // wait for the credit. handle_credit() starts pumping again:
+            if(stream->credit == 0) {
+                stream->pumping = false;
+                return;
+            }
+            size = std::min(stream->credit, stream_chunk_size);
+        }
+
+        payload_t chunk;
+        std::size_t read = 0;
+        std::optional<std::uint32_t> crc;
+        if(stream->data) {
+            // the chunks share the payload of the large response:
+            read = std::min(size, stream->data_size - stream->offset);
+            chunk = payload_t(stream->data, stream->data.get() + stream->offset);
+            stream->offset += read;
+        }
+        else {
+            chunk.reset(new char[size], array_deleter<char>());
+            try {
+                read = std::min(stream->source(chunk.get(), size), size);
+            }
+            catch(...) {
+                stream->status = status_codes::unhandled_exception;
+                read = 0;
+            }
+
+            // the chunk is checksummed while it's in the cache:
+            if(read != 0 && send_checksum() != frame_checksum::none) {
+                crc = crc32c(0, chunk.get(), read);
+            }
+        }
+
+        // end of the data. The response follows the last chunk:
+        if(read == 0) {
+            std::function<void(std::exception_ptr)> written;
+            {
+                std::lock_guard<std::mutex> lg(stream_mutex);
+                if(stream->closed) {
+                    return;
+                }
+                outbound_streams.erase(requestId);
+                written = std::move(stream->written);
+            }
+            if(stream->response) {
+                __send_response__(*stream->response, std::move(written));
+                return;
+            }
+            srfc_response response(requestId, stream->status);
+            response.setPriority(stream->priority);
+            if(finish_request(requestId, stream->cancelled)) {
+                send_response(response);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lg(stream_mutex);
+            stream->credit -= read;
+        }
+        __send_stream_frame__(frame_type::chunk, requestId, std::move(chunk), read, stream->priority, crc);
+    }
+}
+
+std::function<void(std::exception_ptr)> srfc_connection::close_stream(outbound_stream& stream)
+{
+    // the pumping thread stops. The large response won't be written, so its callback is returned to fail:
+    stream.closed = true;
+    return std::exchange(stream.written, nullptr);
+}
+
+void srfc_connection::fail_streams()
+{
+    // the sources are released; the receivers get connection_error from fail_pending()
+    std::unordered_map<id_t, std::shared_ptr<outbound_stream>> failed;
+    std::vector<std::function<void(std::exception_ptr)>> callbacks;
+    {
+        std::lock_guard<std::mutex> lg(stream_mutex);
+        failed.swap(outbound_streams);
+        for(auto& [rid, stream] : failed) {
+            if(auto written = close_stream(*stream)) {
+                callbacks.push_back(std::move(written));
+            }
+        }
+    }
+
+    for(auto& written : callbacks) {
+        written(std::make_exception_ptr(std::runtime_error("fail_streams(): connection closed")));
+    }
+}
+
+//
+// Awaiters:
+//
+
+srfc_connection::request_awaiter::request_awaiter(srfc_connection& connection, srfc_request request, 
+                                                  std::optional<std::chrono::milliseconds> timeout) :
+    connection(&connection), request(std::move(request)), timeout(timeout)
+{
+}
+
+void srfc_connection::request_awaiter::await_suspend(std::coroutine_handle<> awaiting)
+{
+    // The awaiter lives in the frame of the awaiting coroutine. The coroutine may be resumed 
+    // (and the awaiter destroyed) as soon as the slot is registered, so members are not used after that:
+    auto* c = connection;
+    const auto req = std::move(request);
+    const auto rid = req.getRequestId();
+    const auto tmo = timeout;
+
+    if(c->connected.load() == false) {
+        throw std::logic_error("await_suspend(std::coroutine_handle<> awaiting): not connected");
+    }
+
+    c->add_pending(rid, [this, c, awaiting](srfc_response res) {
+        response = std::move(res);
+        c->submit_task([awaiting]{awaiting.resume();});
+    });
+
+    try {
+        if(tmo) {
+            c->set_pending_deadline(rid, *tmo);
+        }
+        c->__send_request__(req);
+    }
+    catch(...) {
+        // resume with the exception, unless the slot is already completed:
+        if(c->drop_pending(rid)) {
+            throw;
+        }
+    }
+}
+
+srfc_connection::response_awaiter::response_awaiter(srfc_connection& connection, srfc_response response) :
+    connection(&connection), response(std::move(response))
+{
+}
+
+void srfc_connection::response_awaiter::await_suspend(std::coroutine_handle<> awaiting)
+{
+    if(connection->connected.load() == false) {
+        throw std::logic_error("await_suspend(std::coroutine_handle<> awaiting): not connected");
+    }
+
+    connection->__send_response__(response, [this, awaiting](std::exception_ptr e) {
+        error = e;
+        connection->submit_task([awaiting]{awaiting.resume();});
+    });
+}
+
+void srfc_connection::response_awaiter::await_resume()
+{
+    if(error) {
+        std::rethrow_exception(error);
     }
 }
 
-} // namespace net
\ No newline at end of file
+} // namespace net
@@ -0,0 +1,263 @@
+#include "includes/srfc_executor.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace net
+{
+
+// worker of the current thread (nullptr if the thread is not a worker):
+static thread_local const srfc_executor* current_executor = nullptr;
+static thread_local std::size_t current_index = 0;
+
+// settings of the shared executor:
+static std::mutex shared_mutex;
+static bool shared_created = false;
+static std::size_t shared_threads = 0;
+static std::size_t shared_capacity = 1024;
+
+static std::pair<std::size_t, std::size_t> take_shared_settings()
+{
+    std::lock_guard<std::mutex> lg(shared_mutex);
+    shared_created = true;
+    return std::make_pair(shared_threads, shared_capacity);
+}
+
+//
+// Constructors & dtor:
+//
+
+srfc_executor::srfc_executor(std::size_t threads, std::size_t queueCapacity) :
+    capacity(std::max<std::size_t>(queueCapacity, 1))
+{
+    if(threads == 0) {
+        threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 2);
+    }
+
+    queues.reserve(threads);
+    for(std::size_t i = 0; i < threads; ++i) {
+        queues.push_back(std::make_unique<worker_queue>());
+    }
+
+    workers.reserve(threads);
+    for(std::size_t i = 0; i < threads; ++i) {
+        workers.emplace_back(&srfc_executor::__worker__, this, i);
+    }
+}
+
+// queued tasks are finished before the workers exit
+srfc_executor::~srfc_executor()
+{
+    {
+        std::lock_guard<std::mutex> lg(idle_mutex);
+        terminate.store(true);
+    }
+    idle_cv.notify_all();
+    space_cv.notify_all();
+
+    for(auto& w : workers) {
+        w.join();
+    }
+}
+
+srfc_executor& srfc_executor::shared()
+{
+    static const auto settings = take_shared_settings();
+    static srfc_executor instance(settings.first, settings.second);
+    return instance;
+}
+
+void srfc_executor::configure_shared(std::size_t threads, std::size_t queueCapacity)
+{
+    std::lock_guard<std::mutex> lg(shared_mutex);
+    if(shared_created) {
+        throw std::logic_error("configure_shared(std::size_t threads, std::size_t queueCapacity): "
+                               "shared executor is already created");
+    }
+
+    shared_threads = threads;
+    shared_capacity = queueCapacity;
+}
+
+//
+// Submitting tasks:
+//
+
+void srfc_executor::submit(task_t task)
+{
+    if(push(task)) {
+        wake();
+        return;
+    }
+
+    // all queues are full. A worker can't wait for itself - run the task in place:
+    if(current_executor == this) {
+        try {
+            task();
+        }
+        catch(...) {}
+        return;
+    }
+
+    // wait until the workers take some tasks:
+    std::unique_lock<std::mutex> ul(idle_mutex);
+    ++blocked_producers;
+    space_cv.wait(ul, [this, &task] {
+        return terminate.load() || push(task);
+    });
+    --blocked_producers;
+    ul.unlock();
+
+    if(task) {
+        throw std::logic_error("submit(task_t task): executor is terminated");
+    }
+    idle_cv.notify_one();
+}
+
+bool srfc_executor::try_submit(task_t&& task)
+{
+    if(!push(task)) {
+        return false;
+    }
+
+    wake();
+    return true;
+}
+
+void srfc_executor::when_space(task_t callback)
+{
+    {
+        // the callback is registered before the check, so either the check sees the task taken
+        // by a worker, or the worker sees the callback:
+        std::lock_guard<std::mutex> lg(idle_mutex);
+        space_callbacks.push_back(std::move(callback));
+        ++space_waiters;
+        if(queued.load() >= capacity * queues.size() && !terminate.load()) {
+            return;
+        }
+
+        callback = std::move(space_callbacks.back());
+        space_callbacks.pop_back();
+        --space_waiters;
+    }
+
+    callback();
+}
+
+std::size_t srfc_executor::size() const noexcept
+{
+    return workers.size();
+}
+
+std::size_t srfc_executor::pending() const noexcept
+{
+    return queued.load();
+}
+
+// moves the task into the first queue with free space. Leaves the task untouched if all are full
+bool srfc_executor::push(task_t& task)
+{
+    // worker prefers its own queue:
+    const auto first = (current_executor == this) ? current_index
+                                                  : next_queue.fetch_add(1) % queues.size();
+
+    for(std::size_t i = 0; i < queues.size(); ++i) {
+        auto& q = *queues[(first + i) % queues.size()];
+
+        std::lock_guard<std::mutex> lg(q.mutex);
+        if(q.tasks.size() < capacity) {
+            q.tasks.push_back(std::move(task));
+            task = nullptr;
+            ++queued;
+            break;
+        }
+    }
+
+    return !task;
+}
+
+void srfc_executor::wake()
+{
+    // the lock orders the increment of queued with the idle check of the workers:
+    { std::lock_guard<std::mutex> lg(idle_mutex); }
+    idle_cv.notify_one();
+}
+
+bool srfc_executor::pop(std::size_t self, task_t& task)
+{
+    // own queue: the oldest task first
+    {
+        auto& q = *queues[self];
+        std::lock_guard<std::mutex> lg(q.mutex);
+        if(!q.tasks.empty()) {
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            --queued;
+            return true;
+        }
+    }
+
+    // steal from the other end of the other queues:
+    for(std::size_t i = 1; i < queues.size(); ++i) {
+        auto& q = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> lg(q.mutex);
+        if(!q.tasks.empty()) {
+            task = std::move(q.tasks.back());
+            q.tasks.pop_back();
+            --queued;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void srfc_executor::__worker__(std::size_t index)
+{
+    current_executor = this;
+    current_index = index;
+
+    task_t task;
+    while(true) {
+        if(pop(index, task)) {
+            // free space appeared:
+            if(blocked_producers.load() != 0) {
+                { std::lock_guard<std::mutex> lg(idle_mutex); }
+                space_cv.notify_all();
+            }
+            if(space_waiters.load() != 0) {
+                std::vector<task_t> callbacks;
+                {
+                    std::lock_guard<std::mutex> lg(idle_mutex);
+                    callbacks.swap(space_callbacks);
+                    space_waiters.store(0);
+                }
+                for(auto& callback : callbacks) {
+                    try {
+                        callback();
+                    }
+                    catch(...) {}
+                }
+            }
+
+            try {
+                task();
+            }
+            catch(...) {}
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> ul(idle_mutex);
+        idle_cv.wait(ul, [this] {
+            return queued.load() != 0 || terminate.load();
+        });
+
+        if(terminate.load() && queued.load() == 0) {
+            return;
+        }
+    }
+}
+
+} // namespace net
@@ -1,12 +1,15 @@
+#include "includes/srfc_request.hpp"
+#include "includes/srfc_message_view.hpp"
+#include "includes/srfc_checksum.hpp"
+
+#include <stdexcept>
 #include <algorithm>
 #include <cstring>
 #include <vector>
-#include <stdexcept>
-
-#include "includes/srfc_request.hpp"
 
 #include "includes/utilities/array_deleter.hpp"
 #include "includes/utilities/alg.hpp"
+#include "includes/utilities/byte_order.hpp"
 
 namespace net 
 {
@@ -44,6 +47,23 @@ srfc_request::srfc_request(serialized_t builtP, std::size_t reqSize)
     deserialize(builtP, reqSize);
 }
 
+srfc_request::srfc_request(const srfc_message_view& view) :
+    my_request_id(view.getRequestId()),
+    method_name(view.getMethod()),
+    priority(view.getPriority()),
+    codec(view.getPayloadCodec())
+{
+    dynamic_assert<std::logic_error>(
+        [&view]{ return view.getType() == frame_type::request;}, "Invalid type value");
+
+    parameters.reserve(view.getParams().size());
+    for(const auto& p : view.getParams()) {
+        parameters.emplace_back(std::string(p.first), std::string(p.second));
+    }
+
+    payload_ptr = view.getPayload(&payload_size);
+}
+
 srfc_request::srfc_request(srfc_request&& other) noexcept
 {
     *this = std::move(other);
@@ -63,6 +83,8 @@ srfc_request& srfc_request::operator=(const srfc_request& other)
     payload_ptr = other.payload_ptr;
 
     payload_size = other.payload_size;
+    priority = other.priority;
+    codec = other.codec;
 
     return *this;
 }
@@ -85,6 +107,12 @@ srfc_request& srfc_request::operator=(srfc_request&& other) noexcept
     payload_size = other.payload_size;
     other.payload_size = 0;
 
+    priority = other.priority;
+    other.priority = frame_priority::normal;
+
+    codec = other.codec;
+    other.codec = payload_codec::none;
+
     return *this;
 }
 
@@ -116,6 +144,16 @@ void srfc_request::setPayload(payload_t p, std::size_t psize)
     this->payload_size = psize;
 }
 
+void srfc_request::setPriority(frame_priority p) noexcept
+{
+    this->priority = p;
+}
+
+void srfc_request::setPayloadCodec(payload_codec c) noexcept
+{
+    this->codec = c;
+}
+
 //
 // Getters:
 //
@@ -147,12 +185,40 @@ srfc_request::getPayload(std::size_t* pSize) const noexcept
     return this->payload_ptr;
 }
 
-std::size_t srfc_request::getHeaderSize() const noexcept
+frame_priority srfc_request::getPriority() const noexcept
+{
+    return this->priority;
+}
+
+payload_codec srfc_request::getPayloadCodec() const noexcept
+{
+    return this->codec;
+}
+
+std::size_t srfc_request::getHeaderSize(wire_format fmt, frame_checksum checksum, std::uint32_t methodId) const noexcept
 {
     std::size_t sz = 0;
+    const auto byId = methodId != no_method_id;
+
+    if(fmt == wire_format::srfc_v2) {
+        /* add fixed-width header size: */
+        sz += srfc_v2_header::size;
+
+        /* add method size (the id is stored in the header): */
+        sz += byId ? 0 : method_name.size();
+
+        /* add params sizes: */
+        for(const auto& p : parameters) {
+            sz += srfc_v2_header::param_prefix_size;
+            sz += p.first.size();
+            sz += p.second.size();
+        }
+
+        return sz;
+    }
 
     /* add Preamble size*/
-    sz += 32;
+    sz += srfc_v1_preamble_size;
 
     /* add protocol version size: */
     sz += std::strlen(protocol_version);
@@ -168,12 +234,39 @@ std::size_t srfc_request::getHeaderSize() const noexcept
     sz += digits(my_request_id);
     sz += 1; // add trailing null
 
+    /* add optional checksum size: */
+    if(checksum != frame_checksum::none) {
+        sz += std::strlen("CK: ");
+        sz += 1; // single digit
+        sz += 1; // add trailing null
+    }
+
     sz += std::strlen("PS: ");
     sz += digits(payload_size);
     sz += 1; // add trailing null
 
-    /* add method size: */
-    sz += method_name.size();
+    /* add optional codec size: */
+    if(codec != payload_codec::none) {
+        sz += std::strlen("PC: ");
+        sz += 1; // single digit
+        sz += 1; // add trailing null
+    }
+
+    /* add optional priority size: */
+    if(priority != frame_priority::normal) {
+        sz += std::strlen("PRIO: ");
+        sz += 1; // single digit
+        sz += 1; // add trailing null
+    }
+
+    /* add method (or method id) size: */
+    if(byId) {
+        sz += std::strlen("MI: ");
+        sz += digits(methodId);
+    }
+    else {
+        sz += method_name.size();
+    }
     sz += 1; // add trailing null
 
     /* add params sizes: */
@@ -191,10 +284,11 @@ std::size_t srfc_request::getHeaderSize() const noexcept
 // Serialization & deserialization:
 //
 
-srfc_request::serialized_t srfc_request::serialize(std::size_t* pSize) const
+srfc_request::serialized_t srfc_request::serialize(std::size_t* pSize, wire_format fmt, frame_checksum checksum) const
 {
-    const auto head_size = getHeaderSize();
-    const auto full_size = head_size + payload_size;
+    const auto head_size = getHeaderSize(fmt, checksum);
+    const auto trailer_size = checksum != frame_checksum::none ? checksum_trailer_size : 0;
+    const auto full_size = head_size + payload_size + trailer_size;
 
     // Set pSize value:
     *pSize = full_size;
@@ -203,12 +297,69 @@ srfc_request::serialized_t srfc_request::serialize(std::size_t* pSize) const
     serialized_t pntr(new char[full_size], array_deleter<char>());
     auto tmpptr = pntr.get();   // raw pointer to write data. Should NOT be deleted.
 
+    // Set header:
+    if(fmt == wire_format::srfc_v2) {
+        writeV2Header(tmpptr, checksum, no_method_id);
+    }
+    else {
+        writeV1Header(tmpptr, full_size, checksum, no_method_id);
+    }
+
+    // Set payload. The checksum is computed as the payload is copied, and the trailer follows it:
+    if(checksum != frame_checksum::none) {
+        auto crc = crc32c(0, pntr.get(), head_size);
+        crc = copy_crc32c(crc, tmpptr, payload_ptr.get(), payload_size);
+        tmpptr += payload_size;
+        store_le_and_shift(tmpptr, crc);
+    }
+    else {
+        copy_and_shift(tmpptr, payload_ptr.get(), payload_size);
+    }
+
+    return pntr;
+}
+
+srfc_request::serialized_t 
+srfc_request::serializeHeader(std::size_t* pSize, wire_format fmt, frame_checksum checksum, std::uint32_t methodId) const
+{
+    const auto head_size = getHeaderSize(fmt, checksum, methodId);
+    const auto trailer_size = checksum != frame_checksum::none ? checksum_trailer_size : 0;
+    const auto full_size = head_size + payload_size + trailer_size;
+
+    // Set pSize value:
+    *pSize = head_size;
+
+    // allocate memeory for serialized header only. Payload is sent separately:
+    serialized_t pntr(new char[head_size], array_deleter<char>());
+    auto tmpptr = pntr.get();   // raw pointer to write data. Should NOT be deleted.
+
+    // Set header:
+    if(fmt == wire_format::srfc_v2) {
+        writeV2Header(tmpptr, checksum, methodId);
+    }
+    else {
+        writeV1Header(tmpptr, full_size, checksum, methodId);
+    }
+
+    return pntr;
+}
+
+void srfc_request::deserialize(serialized_t s, const std::size_t sSize)
+{
+    // validate, classify and decode the message in a single pass.
+    // Throws std::logic_error if the message is ill-formed:
+    *this = srfc_request(srfc_message_view(s, s.get(), sSize));
+}
+
+void srfc_request::writeV1Header(char*& tmpptr, std::size_t full_size, frame_checksum checksum, 
+                                 std::uint32_t methodId) const
+{
     // buffer for string for storing serialized integers:
     std::string tmpbuf;
 
     // Set preamble:
-    tmpbuf = std::string(32 - digits(full_size), '0') +  std::to_string(full_size);
-    copy_and_shift(tmpptr, tmpbuf.c_str(), 32);
+    tmpbuf = std::string(srfc_v1_preamble_size - digits(full_size), '0') +  std::to_string(full_size);
+    copy_and_shift(tmpptr, tmpbuf.c_str(), srfc_v1_preamble_size);
 
     // Set protocol version:
     copy_and_shift(tmpptr, protocol_version, std::strlen(protocol_version));
@@ -225,14 +376,42 @@ srfc_request::serialized_t srfc_request::serialize(std::size_t* pSize) const
     copy_and_shift(tmpptr, tmpbuf.c_str(), tmpbuf.size());
     *(tmpptr++) = static_cast<char>(0); // add trailing null
 
+    // Set checksum (omitted if the frame has no checksum trailer):
+    if(checksum != frame_checksum::none) {
+        copy_and_shift(tmpptr, "CK: ", std::strlen("CK: "));
+        *(tmpptr++) = static_cast<char>('0' + static_cast<int>(checksum));
+        *(tmpptr++) = static_cast<char>(0); // add trailing null
+    }
+
     // Set PS:
     tmpbuf = std::to_string(payload_size);
     copy_and_shift(tmpptr, "PS: ", std::strlen("PS: "));
     copy_and_shift(tmpptr, tmpbuf.c_str(), tmpbuf.size());
     *(tmpptr++) = static_cast<char>(0); // add trailing null
 
-    // Set Method:
-    copy_and_shift(tmpptr, method_name.c_str(), method_name.size());
+    // Set codec (omitted if the payload isn't compressed):
+    if(codec != payload_codec::none) {
+        copy_and_shift(tmpptr, "PC: ", std::strlen("PC: "));
+        *(tmpptr++) = static_cast<char>('0' + static_cast<int>(codec));
+        *(tmpptr++) = static_cast<char>(0); // add trailing null
+    }
+
+    // Set priority (omitted if normal, as older peers don't expect it):
+    if(priority != frame_priority::normal) {
+        copy_and_shift(tmpptr, "PRIO: ", std::strlen("PRIO: "));
+        *(tmpptr++) = static_cast<char>('0' + static_cast<int>(priority));
+        *(tmpptr++) = static_cast<char>(0); // add trailing null
+    }
+
+    // Set Method (or the method id announced by the receiver):
+    if(methodId != no_method_id) {
+        tmpbuf = std::to_string(methodId);
+        copy_and_shift(tmpptr, "MI: ", std::strlen("MI: "));
+        copy_and_shift(tmpptr, tmpbuf.c_str(), tmpbuf.size());
+    }
+    else {
+        copy_and_shift(tmpptr, method_name.c_str(), method_name.size());
+    }
     *(tmpptr++) = static_cast<char>(0); // add trailing null
 
     // Set parameters:
@@ -242,84 +421,42 @@ srfc_request::serialized_t srfc_request::serialize(std::size_t* pSize) const
         copy_and_shift(tmpptr, p.second.c_str(), p.second.size());
         *(tmpptr++) = static_cast<char>(0); // add trailing null
     }
-
-    // Set payload:
-    copy_and_shift(tmpptr, payload_ptr.get(), payload_size);
-
-    return pntr;
 }
 
-void srfc_request::deserialize(serialized_t s, const std::size_t sSize)
+void srfc_request::writeV2Header(char*& tmpptr, frame_checksum checksum, std::uint32_t methodId) const
 {
-    const auto* const rbound = s.get() +  sSize;
-
-    // raw pointer to copy data. Should NOT be deleted:
-    auto* ptr = s.get();  
-
-    /*-----------------------------------------------------*/
-    /*                 Get Preamble:                       */
-    /*-----------------------------------------------------*/
-    dynamic_assert<std::out_of_range>(
-        [&sSize]{ return sSize >= 32;}, "Serialized response size can't be less than 32");
-
-    std::vector<char> preamble(ptr, ptr + 32);
-    std::size_t preamble_value = std::stoul(std::string(preamble.begin(), preamble.end()));
-
-    dynamic_assert<std::logic_error>(preamble_value, sSize, "Serialized size and preamble value differs");
-
-    ptr += 32;
-
-    /*-----------------------------------------------------*/
-    /*            Get Protocol version:                    */
-    /*-----------------------------------------------------*/
-    auto protocolVersion = sstrcpy_and_shift(ptr, rbound);
-    dynamic_assert<std::logic_error>(protocolVersion, this->protocol_version, "Invalid protocol version");
-
-    /*-----------------------------------------------------*/
-    /*                    Get Type:                        */
-    /*-----------------------------------------------------*/
-    auto typeP = separate_param_val(sstrcpy_and_shift(ptr, rbound));
-    dynamic_assert<std::logic_error>(typeP.first, "TYPE", "Invalid header structure");
-    dynamic_assert<std::logic_error>(typeP.second, this->type, "Invalid type value");
-    
-    /*-----------------------------------------------------*/
-    /*                  Get Request ID:                     */
-    /*-----------------------------------------------------*/
-    auto requestIdP = separate_param_val(sstrcpy_and_shift(ptr, rbound));
-    dynamic_assert<std::logic_error>(requestIdP.first, "RI", "Invalid header structure");
-
-    this->my_request_id = std::stoul(requestIdP.second);
+    // the method id replaces the method name:
+    const auto byId = methodId != no_method_id;
+    const auto method_size = byId ? 0 : method_name.size();
+
+    // Set fixed-width header:
+    srfc_v2_header hdr;
+    hdr.type = static_cast<std::uint8_t>(frame_type::request);
+    hdr.request_id = my_request_id;
+    hdr.flags = static_cast<std::uint16_t>(static_cast<unsigned>(priority) | 
+                                           static_cast<unsigned>(codec) << codec_flags_shift |
+                                           static_cast<unsigned>(checksum) << checksum_flags_shift |
+                                           (byId ? method_id_flag : 0u));
+    hdr.status = byId ? methodId : 0;
+    hdr.method_length = static_cast<std::uint16_t>(method_size);
+    hdr.param_count = static_cast<std::uint16_t>(parameters.size());
+    hdr.params_length = static_cast<std::uint32_t>(
+        getHeaderSize(wire_format::srfc_v2) - srfc_v2_header::size - method_name.size());
+    hdr.payload_length = payload_size;
+
+    hdr.encode(tmpptr);
+    tmpptr += srfc_v2_header::size;
 
-    /*-----------------------------------------------------*/
-    /*               Get Payload Size:                     */
-    /*-----------------------------------------------------*/
-    auto payloadSize = separate_param_val(sstrcpy_and_shift(ptr, rbound));
-    dynamic_assert<std::logic_error>(payloadSize.first, "PS", "Invalid header structure");
-
-    this->payload_size = std::stoul(payloadSize.second);
-
-    /*-----------------------------------------------------*/
-    /*                  Get Method:                        */
-    /*-----------------------------------------------------*/
-    this->method_name = sstrcpy_and_shift(ptr, rbound);
+    // Set Method:
+    copy_and_shift(tmpptr, method_name.c_str(), method_size);
 
-    /*-----------------------------------------------------*/
-    /*                  Get Parameters:                    */
-    /*-----------------------------------------------------*/
-    while (ptr < rbound - payload_size) {
-        auto param = separate_param_val(sstrcpy_and_shift(ptr, rbound));
-        this->parameters.emplace_back(std::move(param));
+    // Set parameters:
+    for(const auto& p : parameters) {
+        store_le_and_shift(tmpptr, static_cast<std::uint16_t>(p.first.size()));
+        store_le_and_shift(tmpptr, static_cast<std::uint32_t>(p.second.size()));
+        copy_and_shift(tmpptr, p.first.c_str(), p.first.size());
+        copy_and_shift(tmpptr, p.second.c_str(), p.second.size());
     }
-
-    /*-----------------------------------------------------*/
-    /*                  Get Payload:                    */
-    /*-----------------------------------------------------*/
-    auto payload_pointer = s.get() + sSize - payload_size;
-
-    payload_t tmp(new char[payload_size], array_deleter<char>());
-    std::memcpy(tmp.get(), payload_pointer, payload_size);
-
-    this->payload_ptr = std::move(tmp);
 }
 
 std::string srfc_request::to_string() const 
@@ -337,6 +474,16 @@ std::string srfc_request::to_string() const
     // Add PS:
     res +=  std::string("PS: ") + std::to_string(payload_size) + "\n";
 
+    // Add codec:
+    if(codec != payload_codec::none) {
+        res += std::string("PC: ") + std::to_string(static_cast<int>(codec)) + "\n";
+    }
+
+    // Add priority:
+    if(priority != frame_priority::normal) {
+        res += std::string("PRIO: ") + std::to_string(static_cast<int>(priority)) + "\n";
+    }
+
     // Add Method:
     res += method_name + "\n";
 
@@ -390,6 +537,8 @@ void srfc_request::reset()
     parameters.clear();
     payload_ptr.reset();
     payload_size = 0;
+    priority = frame_priority::normal;
+    codec = payload_codec::none;
 }
 
 // Not yet implemeted
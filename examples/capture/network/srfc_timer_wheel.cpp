@@ -0,0 +1,168 @@
+#include "includes/srfc_timer_wheel.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace net
+{
+
+//
+// Constructors & dtor:
+//
+
+srfc_timer_wheel::srfc_timer_wheel(std::chrono::milliseconds tick, std::size_t slots) :
+    tick_duration(std::max<clock_t::duration>(tick, std::chrono::milliseconds(1))),
+    start(clock_t::now()),
+    wheel(std::max<std::size_t>(slots, 1))
+{
+}
+
+srfc_timer_wheel::~srfc_timer_wheel()
+{
+    if(worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lg(wheel_mutex);
+            terminate.store(true);
+        }
+        wheel_cv.notify_one();
+        worker.join();
+    }
+}
+
+srfc_timer_wheel& srfc_timer_wheel::shared()
+{
+    static srfc_timer_wheel instance;
+    return instance;
+}
+
+//
+// Timers:
+//
+
+srfc_timer_wheel::timer_id
+srfc_timer_wheel::schedule(std::chrono::milliseconds delay, callback_t callback)
+{
+    if(!callback) {
+        throw std::invalid_argument("schedule(std::chrono::milliseconds delay, callback_t callback): empty callback");
+    }
+
+    std::unique_lock<std::mutex> ul(wheel_mutex);
+
+    // round up to the next tick, but never to the already processed one:
+    const auto due = std::max(tick_of(clock_t::now() + delay + tick_duration - clock_t::duration(1)),
+                              processed_tick + 1);
+    const auto slot = static_cast<std::size_t>(due % wheel.size());
+    const auto id = next_id++;
+
+    wheel[slot].push_back({id, due, std::move(callback)});
+    index.emplace(id, std::make_pair(slot, std::prev(wheel[slot].end())));
+
+    // worker is started with the first timer:
+    if(worker.joinable() == false) {
+        worker = std::thread(&srfc_timer_wheel::__worker__, this);
+    }
+
+    // worker sleeps until the next tick or forever if the wheel was empty:
+    const bool wasEmpty = index.size() == 1;
+    ul.unlock();
+    if(wasEmpty) {
+        wheel_cv.notify_one();
+    }
+
+    return id;
+}
+
+bool srfc_timer_wheel::cancel(timer_id id)
+{
+    {
+        std::lock_guard<std::mutex> lg(wheel_mutex);
+
+        auto it = index.find(id);
+        if(it != index.end()) {
+            wheel[it->second.first].erase(it->second.second);
+            index.erase(it);
+            return true;
+        }
+    }
+
+    // the timer may be firing right now. Wait for its callback to finish
+    // (unless cancel() is called from a callback):
+    if(std::this_thread::get_id() != worker.get_id()) {
+        std::lock_guard<std::mutex> lg(fire_mutex);
+    }
+
+    return false;
+}
+
+std::size_t srfc_timer_wheel::size() const
+{
+    std::lock_guard<std::mutex> lg(wheel_mutex);
+    return index.size();
+}
+
+std::uint64_t srfc_timer_wheel::tick_of(clock_t::time_point tp) const
+{
+    return static_cast<std::uint64_t>((tp - start) / tick_duration);
+}
+
+void srfc_timer_wheel::__worker__()
+{
+    std::vector<callback_t> expired;
+
+    std::unique_lock<std::mutex> ul(wheel_mutex);
+    while(true) {
+        // sleep forever while the wheel is empty, until the next tick otherwise:
+        if(index.empty()) {
+            wheel_cv.wait(ul, [this]{ return !index.empty() || terminate.load(); });
+        }
+        else {
+            wheel_cv.wait_until(ul, start + tick_duration * (processed_tick + 1));
+        }
+
+        if(terminate.load()) {
+            return;
+        }
+
+        const auto now_tick = tick_of(clock_t::now());
+        if(now_tick <= processed_tick) {
+            continue;
+        }
+
+        // visit the slots of the elapsed ticks (each slot at most once):
+        const auto first = std::max(processed_tick + 1,
+                                    now_tick >= wheel.size() ? now_tick - wheel.size() + 1 : 0);
+        for(auto t = first; t <= now_tick; ++t) {
+            auto& slot = wheel[static_cast<std::size_t>(t % wheel.size())];
+            for(auto it = slot.begin(); it != slot.end(); ) {
+                if(it->due_tick <= now_tick) {
+                    expired.push_back(std::move(it->callback));
+                    index.erase(it->id);
+                    it = slot.erase(it);
+                }
+                else {
+                    ++it;
+                }
+            }
+        }
+        processed_tick = now_tick;
+
+        if(expired.empty()) {
+            continue;
+        }
+
+        // run callbacks without holding the wheel. cancel() waits for them on fire_mutex:
+        std::unique_lock<std::mutex> fl(fire_mutex);
+        ul.unlock();
+        for(auto& callback : expired) {
+            try {
+                callback();
+            }
+            catch(...) {}
+        }
+        expired.clear();
+        fl.unlock();
+        ul.lock();
+    }
+}
+
+} // namespace net
@@ -2,31 +2,37 @@
 #if defined(unix) || defined(__unix__) || defined(__unix)
 
 #include "../includes/srfc_connection.hpp"
+#include "../includes/utilities/array_deleter.hpp"
 
 #include <arpa/inet.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <unistd.h>
-#include <thread>
+#include <errno.h>
 
 #include <stdexcept>
 
-#include "../includes/utilities/array_deleter.hpp"
-
 namespace net
 {
 
-std::vector<char> srfc_connection::__receive__() 
+std::ptrdiff_t srfc_connection::__read_some__(char* buf, std::size_t len) 
 {
-    constexpr std::size_t bufSize = 1024;
-    char buf[bufSize] = {0};
-
-    std::size_t bytes_received = ::read(this->socket_fd, buf, bufSize);
-    if(bytes_received < 0) {
-        throw std::runtime_error("Read error"); // add errror code
+    while(true) {
+        const auto bytes_received = ::read(this->socket_fd, buf, len);
+        if(bytes_received >= 0) {
+            // if bytes_received == 0 -> connection closed.
+            return bytes_received;
+        }
+
+        if(errno == EAGAIN || errno == EWOULDBLOCK) {
+            return -1;
+        }
+        if(errno != EINTR) {
+            throw std::runtime_error("__read_some__(char* buf, std::size_t len): Read error"); // add errror code
+        }
     }
-    // if bytes_received == 0 -> connection closed.
-
-    return std::vector<char>(buf, buf + bytes_received);
 }
 
 void srfc_connection::__connect__(unsigned int port, std::string address)
@@ -56,10 +62,49 @@ void srfc_connection::__connect__(unsigned int port, std::string address)
     this->connected.store(true);
 }
 
-void srfc_connection::__send__(const void *buf, std::size_t len)
+void srfc_connection::__set_nonblocking__()
 {
-    if(send(this->socket_fd, buf, len, 0) < 0) {
-        throw std::runtime_error("__send__(const void *buf, std::size_t len): The send() function failed:");  
+    // sockets accepted by srfc_listener are already non-blocking:
+    const auto flags = ::fcntl(this->socket_fd, F_GETFL, 0);
+    if(flags < 0 || (!(flags & O_NONBLOCK) && ::fcntl(this->socket_fd, F_SETFL, flags | O_NONBLOCK) < 0)) {
+        throw std::runtime_error("__set_nonblocking__(): The fcntl() function failed:");
+    }
+}
+
+std::ptrdiff_t srfc_connection::__write_some__(const const_buffer* bufs, std::size_t count)
+{
+    // the caller passes the rest of the list on the next call:
+    iovec iov[IOV_MAX];
+    std::size_t iovcnt = 0;
+    for(std::size_t i = 0; i < count && iovcnt < IOV_MAX; ++i) {
+        if(bufs[i].size != 0) {
+            iov[iovcnt++] = {const_cast<char*>(bufs[i].data), bufs[i].size};
+        }
+    }
+
+#ifdef MSG_NOSIGNAL
+    constexpr int flags = MSG_NOSIGNAL;
+#else
+    constexpr int flags = 0;
+#endif
+
+    struct msghdr msg = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+
+    while(true) {
+        const auto sent = ::sendmsg(this->socket_fd, &msg, flags);
+        if(sent >= 0) {
+            return sent;
+        }
+
+        // the socket is non-blocking and its send buffer is full:
+        if(errno == EAGAIN || errno == EWOULDBLOCK) {
+            return -1;
+        }
+        if(errno != EINTR) {
+            throw std::runtime_error("__write_some__(const const_buffer* bufs, std::size_t count): The sendmsg() function failed:");  
+        }
     }
 }  
 
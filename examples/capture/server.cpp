@@ -2,10 +2,13 @@
 #include <algorithm>
 #include <vector>
 #include <string>
+#include <fstream>
 #include <chrono>
+#include <thread>
 
 #include <sstream>
 #include <iomanip>
+#include <stdexcept>
 
 #include "network/includes/srfc_listener.hpp"
 
@@ -86,7 +89,10 @@ static void on_connection_callback(srfc_connection con)
     // Hence, it should be used only for debugging and demonstrating purposes.
     //
     // To use all capabilities, use the implemented srfc functionality.
-    run_interactive_console(std::move(con));
+    //
+    // The callback is called on the library's executor and should return quickly,
+    // so the console is run in a separate thread.
+    std::thread(run_interactive_console, std::move(con)).detach();
 }
 
 static status_t PRINT_callback(
@@ -144,6 +150,42 @@ static void cout_responce(const srfc_response& response)
     std::cout << std::endl;
 }
 
+static void receive_file(srfc_connection& con, const srfc_request& rq)
+{
+    std::cout << "Enter output path: " << std::flush;
+    std::string path;
+    std::getline(std::cin, path);
+
+    std::ofstream ofs(path, std::ios::binary);
+    if(!ofs.is_open()) {
+        std::cout << "Error while saving to file: cannot open " << path << std::endl;
+        return;
+    }
+
+    std::cout << "Sending request..." << std::endl;
+    if(!con.is_connected()){
+        return;
+    } 
+
+    // The file is streamed: chunks are written as they arrive, so it's never held in memory.
+    // A failed write cancels the request, so the client stops reading the file
+    std::size_t received = 0;
+    auto res = con.send_streaming_request(rq, [&ofs, &received](const char* data, std::size_t size) {
+        if(!ofs.write(data, size)) {
+            throw std::runtime_error("Cannot write the file");
+        }
+        received += size;
+    });
+
+    std::cout << "Receiving file..." << std::endl;
+    auto resp = res.get();
+    ofs.close();
+
+    std::cout << std::endl;
+    cout_responce(resp);
+    std::cout << received << " bytes saved to " << path << std::endl;
+}
+
 static srfc_request make_requst_from_console() 
 {
     srfc_request rq;
@@ -258,6 +300,15 @@ static void run_interactive_console(srfc_connection con)
             continue;
         }
 
+        // Control calls overtake the file transfers on the connection:
+        rq.setPriority(rq.getMethod() == "GETFILE_SCAP" ? frame_priority::bulk : frame_priority::high);
+
+        // Files are received directly to disk:
+        if(rq.getMethod() == "GETFILE_SCAP") {
+            receive_file(con, rq);
+            continue;
+        }
+
         std::cout << "Sending request..." << std::endl;
 
         if(!con.is_connected()){
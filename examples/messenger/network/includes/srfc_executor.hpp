@@ -0,0 +1,95 @@
+#ifndef SRFC_EXECUTOR_HPP
+#define SRFC_EXECUTOR_HPP
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+
+namespace net
+{
+
+// Bounded work-stealing thread pool.
+// Every worker owns a task queue of limited capacity. Workers take their own tasks in FIFO order,
+// so a busy worker doesn't starve the oldest tasks of its queue, and steal from the other end
+// of the other queues when their own queue is empty (the owner and the thief rarely contend for a task).
+// Tasks submitted from a worker go to its own queue; tasks submitted from other threads are spread
+// over the queues round-robin.
+//
+// Tasks shouldn't block on each other: a task waiting for a task queued behind it waits forever once
+// every worker does the same. srfc_connection completes the futures of send_request() on its I/O thread
+// for that reason, but the onChunk handlers of send_streaming_request() and the completion callbacks run
+// on the workers, so the handlers mustn't wait for them (co_await the calls instead, see srfc_task.hpp).
+//
+// When all queues are full, submit() blocks the caller, except when it's called from a worker:
+// the task is run in place. The I/O threads mustn't block (the workers may wait for the responses
+// they read), so they use try_submit() and when_space(): the connection keeps the task and stops
+// reading the socket until the handlers catch up.
+class srfc_executor
+{
+public:
+    using task_t = std::function<void()>;
+
+    // Make non-copyable & non-movable:
+    srfc_executor(const srfc_executor& other) = delete;
+    srfc_executor& operator=(const srfc_executor& other) = delete;
+
+    // Parameterized constructor & dtor:
+    // threads == 0 selects the number of hardware threads (at least 2)
+    explicit srfc_executor(std::size_t threads = 0, std::size_t queueCapacity = 1024);
+    ~srfc_executor();
+
+    // The executor shared by all connections and listeners.
+    // configure_shared() throws std::logic_error if the shared executor is already created
+    static srfc_executor& shared();
+    static void           configure_shared(std::size_t threads, std::size_t queueCapacity);
+
+    // Submitting tasks. Exceptions thrown by the tasks are ignored:
+    void    submit(task_t task);
+    bool    try_submit(task_t&& task);  // returns false (and leaves the task) if all queues are full
+
+    // Calls the callback once a worker takes a task, so try_submit() may succeed again.
+    // It's called in place if the queues have free space already
+    void    when_space(task_t callback);
+
+    std::size_t size() const noexcept;      // number of workers
+    std::size_t pending() const noexcept;   // number of queued tasks
+
+private:
+    struct worker_queue
+    {
+        std::mutex mutex;
+        std::deque<task_t> tasks;
+    };
+
+    bool    push(task_t& task);
+    void    wake();
+    bool    pop(std::size_t self, task_t& task);
+    void    __worker__(std::size_t index);
+
+    // Fields:
+    const std::size_t capacity;     // of each queue
+    std::vector<std::unique_ptr<worker_queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::atomic<std::size_t> queued{0};
+    std::atomic<std::size_t> next_queue{0};
+    std::atomic<std::size_t> blocked_producers{0};
+    std::atomic<std::size_t> space_waiters{0};     // size of space_callbacks
+    std::atomic_bool terminate{false};
+
+    std::mutex idle_mutex;
+    std::condition_variable idle_cv;    // workers wait for tasks
+    std::condition_variable space_cv;   // producers wait for free space
+    std::vector<task_t> space_callbacks;    // of when_space(). Guarded by idle_mutex
+}; // class srfc_executor
+
+} // namespace net
+
+#endif
@@ -2,12 +2,14 @@
 #define SRFC_LISTENER_HPP
 
 #include <string>
+#include <vector>
 #include <functional>
 
-#include <thread>
-#include <mutex>
 #include <atomic>
-#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <deque>
+#include <utility>
 
 #include "srfc_connection.hpp"
 
@@ -18,6 +20,9 @@ class srfc_listener
 {
     using socket_t = srfc_connection::socket_t;
     using callback_t = srfc_connection::callback_t;
+    using view_callback_t = srfc_connection::view_callback_t;
+    using task_callback_t = srfc_connection::task_callback_t;
+    using stream_callback_t = srfc_connection::stream_callback_t;
     using connection_callback_t = std::function<void(srfc_connection)>;
     
 public:
@@ -36,16 +41,64 @@ public:
     srfc_listener(unsigned int port, std::string address = "", bool deferred = false);
     ~srfc_listener();
 
-    // 
+    // The callback receives each accepted connection as a DEFERRED object.
+    // It's called on the shared srfc_executor and should return quickly;
+    // long-running code should be moved to a separate thread.
     void    on_connection(connection_callback_t callback);
 
     // manipulating methods:
-    void        add_method(std::string methodName, callback_t methodCallback);
-    bool        remove_method(std::string methodName);
-    callback_t  get_method(std::string methodName) const;
-    bool        has_method(std::string methodName) const;
+    // The accepted connections share the methods of the listener, so the changes apply to the running
+    // connections too (see srfc_method_registry). A connection whose own methods are changed stops sharing them
+    void                add_method(std::string methodName, callback_t methodCallback);
+    void                add_method(std::string methodName, view_callback_t methodCallback);
+    void                add_method(std::string methodName, task_callback_t methodCallback);
+    void                add_method(std::string methodName, stream_callback_t methodCallback);
+    bool                remove_method(std::string methodName);
+    callback_t          get_method(std::string methodName) const;
+    view_callback_t     get_view_method(std::string methodName) const;
+    task_callback_t     get_task_method(std::string methodName) const;
+    stream_callback_t   get_stream_method(std::string methodName) const;
+    bool                has_method(std::string methodName) const;
+
+    // typed methods (see srfc_connection::add_method<R(Args...)>()):
+    template<typename Sig, typename Method>
+    void                add_method(std::string methodName, Method method);
+
+    // wire format of the outgoing messages of the accepted connections:
+    void        set_wire_format(wire_format fmt) noexcept;
+    wire_format get_wire_format() const noexcept;
+
+    // payload compression of the accepted connections (see srfc_connection::set_compression()):
+    void            set_compression(payload_codec codec) noexcept;
+    payload_codec   get_compression() const noexcept;
+
+    // frame checksum of the accepted connections (see srfc_connection::set_checksum()):
+    void            set_checksum(frame_checksum checksum) noexcept;
+    frame_checksum  get_checksum() const noexcept;
+
+    // limits announced in the handshake of the accepted connections (see srfc_connection::set_max_frame_size()):
+    void        set_max_frame_size(std::size_t bytes) noexcept;
+    std::size_t get_max_frame_size() const noexcept;
+    void        set_stream_window(std::size_t bytes) noexcept;
+    std::size_t get_stream_window() const noexcept;
+
+    // memory budget of each accepted connection (see srfc_connection::set_memory_budget()):
+    void        set_memory_budget(std::size_t bytes) noexcept;
+    std::size_t get_memory_budget() const noexcept;
+
+    // Sharded mode: listen(port, ...) opens one SO_REUSEPORT socket per shard on the same port,
+    // each served by its own reactor loop. The kernel spreads incoming connections between them,
+    // and the accepted connections stay on the loop of their shard.
+    // count == 0 selects one shard per reactor loop. Takes effect on the next listen(port, ...).
+    // A single shard is used for port 0, for listen(socket_t) and where SO_REUSEPORT
+    // doesn't balance connections (all systems except Linux).
+    // Unless pinLoops is false, listening on more than one shard pins the loops of the shared reactor
+    // to the cores (see srfc_reactor::pin_threads()), so a shard and its connections stay on one core
+    void        set_shards(std::size_t count, bool pinLoops = true) noexcept;
+    std::size_t get_shards() const noexcept;      // number of the listening sockets
 
     // manipulating connection:
+    // The listening socket is served by the shared srfc_reactor. No threads are owned by the listener.
     void    listen(unsigned int port, std::string address, bool deferred = false);
     void    listen(socket_t bindedSockFd, bool deferred = false);
     void    invoke_deferred();
@@ -54,35 +107,68 @@ public:
     void    reset();
 
 protected:
-    void    __listener_thread__();                         // listner_thread function 
-    void    connection_handler(socket_t clientfd);
+    void    on_acceptable(std::size_t shard);               // reactor handler
+    void    on_accepted(std::size_t shard, socket_t clientfd);  // reactor handler (if the reactor completes the I/O)
+    void    connection_handler(socket_t clientfd, std::size_t loop);
 
 private:
-    void        __bind__(unsigned int port, std::string address);   // platform-dependent implementataion
-    socket_t    __accept__();                                       // platform-dependent implementataion
-    void        __shutdown__();                                     // platform-dependent implementataion
-    void        __close__();                                        // platform-dependent implementataion
+    void        start_accepting();
+
+    // The accepted sockets are passed to the executor without blocking the I/O thread.
+    // When it's full, the shard stops accepting until submit_deferred() passes them on
+    // (pass_accepted() returns false if the socket is deferred):
+    bool        pass_accepted(std::size_t shard, socket_t clientfd);
+    void        defer_accepted(socket_t clientfd, std::size_t loop, srfc_reactor::token_t token);
+    void        submit_deferred();
+    void        wait_deferred();
+
+    // __accept__ returns -1 if no connection is pending
+    socket_t    __bind__(unsigned int port, std::string address);   // platform-dependent implementataion
+    void        __set_nonblocking__(socket_t fd);                   // platform-dependent implementataion
+    socket_t    __accept__(socket_t fd);                            // platform-dependent implementataion
+    void        __shutdown__(socket_t fd);                          // platform-dependent implementataion
+    void        __close__(socket_t fd);                             // platform-dependent implementataion
+    static bool __balances_reuseport__();                           // platform-dependent implementataion
 
 private:
-    socket_t socket_fd = 0;
+    struct shard_t
+    {
+        socket_t socket_fd = 0;
+        srfc_reactor::token_t io_token = 0;             // registration in the reactor (0 if not registered)
+        std::size_t loop = srfc_reactor::any_loop;      // loop of the socket and of its connections
+    };
+
+    std::vector<shard_t> shards;
+    std::size_t shard_count = 1;
+    bool pin_loops = true;
     
     connection_callback_t connection_callback = [](const auto c){return;}; // do nothing
-    std::unordered_map<std::string, callback_t> callback_map;
+    std::shared_ptr<srfc_method_registry> methods = std::make_shared<srfc_method_registry>();  // shared with the connections
+    std::atomic<wire_format> wire_fmt{wire_format::srfc_v1};
+    std::atomic<payload_codec> compression{payload_codec::none};
+    std::atomic<frame_checksum> checksum{frame_checksum::none};
+    std::atomic<std::size_t> max_frame_size{default_max_frame_size};
+    std::atomic<std::size_t> stream_window{srfc_connection::stream_window};
+    std::atomic<std::size_t> memory_budget{srfc_connection::default_memory_budget};
     
-    std::mutex listener_cv_mutex;
-    std::mutex idleable_cv_mutex;
-
-    std::condition_variable listener_cv;
-    std::condition_variable idleable_cv;
-
     std::atomic_bool binded {false};
     std::atomic_bool listening {false};
-    std::atomic_bool idleable {true};
-    std::atomic_bool terminate_listener {false};    // only setted in the constructor
 
-    std::thread listener_thread;
+    // accepted sockets waiting for the executor, and the shards not accepting meanwhile (under deferred_mutex):
+    std::deque<std::pair<socket_t, std::size_t>> deferred_accepts;
+    std::vector<srfc_reactor::token_t> paused_shards;
+    std::mutex deferred_mutex;
+    std::atomic<std::size_t> space_waits{0};    // when_space() callbacks. reset() waits for them
+
+    static constexpr std::size_t max_accept_batch = 64; // connections accepted per readiness event
 };
 
+template<typename Sig, typename Method>
+void srfc_listener::add_method(std::string methodName, Method method)
+{
+    add_method(std::move(methodName), view_callback_t(marshal_detail::make_method<Sig>(std::move(method))));
+}
+
 } // namespace net 
 
 #endif
\ No newline at end of file
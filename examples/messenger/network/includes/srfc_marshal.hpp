@@ -0,0 +1,288 @@
+#ifndef SRFC_MARSHAL_HPP
+#define SRFC_MARSHAL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "srfc_response.hpp"
+#include "srfc_message_view.hpp"
+#include "utilities/array_deleter.hpp"
+#include "utilities/byte_order.hpp"
+
+namespace net
+{
+
+// Typed methods (see srfc_connection::add_method<R(Args...)>() and srfc_connection::call<R(Args...)>()):
+// the arguments are written back to back into the request payload, and the result into the response payload:
+//  - bool, integers and enums: little-endian, of their size;
+//  - std::string, std::string_view and byte sequences (std::vector and std::span<const T> of char,
+//    unsigned char or std::byte): | size (u32, little-endian) | bytes |;
+//  - other trivially-copyable types (floating-point numbers, structs): their object representation,
+//    so both peers should agree on the layout.
+// The codec of a signature is generated at compile time: no names, no text conversions.
+// string_view and span arguments view the receive buffer, so the method gets them without a copy
+// (they're valid until it returns). A method can't return them.
+
+// Thrown (in the future of srfc_connection::call()) if the method returns another status than status_codes::ok
+class srfc_call_error : public std::runtime_error
+{
+public:
+    using status_t = status_codes::status_t;
+
+    srfc_call_error(status_t status, const std::string& what) : std::runtime_error(what), status_code(status) {}
+
+    status_t getStatusCode() const noexcept { return status_code; }
+
+private:
+    status_t status_code;
+}; // class srfc_call_error
+
+namespace marshal_detail
+{
+    using length_t = std::uint32_t;
+
+    template<typename T>
+    constexpr bool is_byte = std::is_same_v<T, char> || std::is_same_v<T, unsigned char> || std::is_same_v<T, std::byte>;
+
+    // Types written with the size:
+    template<typename T>
+    struct sequence : std::false_type {};
+
+    template<>
+    struct sequence<std::string> : std::true_type {};
+
+    template<>
+    struct sequence<std::string_view> : std::true_type {};
+
+    template<typename B, typename A>
+    struct sequence<std::vector<B, A>> : std::bool_constant<is_byte<B>> {};
+
+    template<typename B>
+    struct sequence<std::span<const B>> : std::bool_constant<is_byte<B>> {};
+
+    // Sequences viewing the receive buffer:
+    template<typename T>
+    struct view : std::false_type {};
+
+    template<>
+    struct view<std::string_view> : std::true_type {};
+
+    template<typename B>
+    struct view<std::span<const B>> : std::true_type {};
+
+    template<typename T>
+    constexpr bool is_marshalable = sequence<T>::value ||
+        (std::is_trivially_copyable_v<T> && !std::is_pointer_v<T> && !std::is_member_pointer_v<T>);
+
+    template<typename Sig>
+    struct signature;
+
+    template<typename R, typename... Args>
+    struct signature<R(Args...)>
+    {
+        using result_t = R;
+        using args_t = std::tuple<std::decay_t<Args>...>;
+
+        static_assert((is_marshalable<std::decay_t<Args>> && ...),
+                      "signature<R(Args...)>: The argument type can't be marshaled");
+        static_assert(std::is_void_v<R> || (is_marshalable<R> && !view<R>::value),
+                      "signature<R(Args...)>: The result type can't be marshaled");
+    };
+
+    template<typename T>
+    std::size_t size_of(const T& value) noexcept
+    {
+        if constexpr(sequence<T>::value) {
+            return sizeof(length_t) + value.size();
+        }
+        else {
+            return sizeof(T);
+        }
+    }
+
+    template<typename T>
+    void write(char*& ptr, const T& value)
+    {
+        if constexpr(sequence<T>::value) {
+            store_le_and_shift<length_t>(ptr, static_cast<length_t>(value.size()));
+            if(!value.empty()) {
+                std::memcpy(ptr, value.data(), value.size());
+                ptr += value.size();
+            }
+        }
+        else if constexpr(std::is_enum_v<T>) {
+            write(ptr, static_cast<std::underlying_type_t<T>>(value));
+        }
+        else if constexpr(std::is_same_v<T, bool>) {
+            *(ptr++) = value ? 1 : 0;
+        }
+        else if constexpr(std::is_integral_v<T>) {
+            store_le_and_shift<std::make_unsigned_t<T>>(ptr, static_cast<std::make_unsigned_t<T>>(value));
+        }
+        else {
+            std::memcpy(ptr, &value, sizeof(T));
+            ptr += sizeof(T);
+        }
+    }
+
+    // Returns false if the value is truncated:
+    template<typename T>
+    bool read(const char*& ptr, const char* end, T& value)
+    {
+        if constexpr(sequence<T>::value) {
+            if(static_cast<std::size_t>(end - ptr) < sizeof(length_t)) {
+                return false;
+            }
+            const std::size_t size = load_le_and_shift<length_t>(ptr);
+            if(static_cast<std::size_t>(end - ptr) < size) {
+                return false;
+            }
+
+            using byte_t = std::remove_const_t<typename T::value_type>;
+            const auto* data = reinterpret_cast<const byte_t*>(ptr);
+            if constexpr(view<T>::value) {
+                value = T(data, size);
+            }
+            else {
+                value.assign(data, data + size);
+            }
+            ptr += size;
+            return true;
+        }
+        else {
+            if(static_cast<std::size_t>(end - ptr) < sizeof(T)) {
+                return false;
+            }
+
+            if constexpr(std::is_enum_v<T>) {
+                std::underlying_type_t<T> v;
+                read(ptr, end, v);
+                value = static_cast<T>(v);
+            }
+            else if constexpr(std::is_same_v<T, bool>) {
+                value = *(ptr++) != 0;
+            }
+            else if constexpr(std::is_integral_v<T>) {
+                value = static_cast<T>(load_le_and_shift<std::make_unsigned_t<T>>(ptr));
+            }
+            else {
+                std::memcpy(&value, ptr, sizeof(T));
+                ptr += sizeof(T);
+            }
+            return true;
+        }
+    }
+
+    // Writes the values into a new payload.
+    // Throws std::length_error if a sequence is longer than its size field
+    template<typename... T>
+    std::shared_ptr<char> pack(std::size_t* pSize, const T&... values)
+    {
+        [[maybe_unused]] const auto too_long = [](const auto& value) {
+            if constexpr(sequence<std::decay_t<decltype(value)>>::value) {
+                return value.size() > std::numeric_limits<length_t>::max();
+            }
+            else {
+                return false;
+            }
+        };
+        if((too_long(values) || ...)) {
+            throw std::length_error("pack(std::size_t* pSize, const T&... values): The sequence is too long");
+        }
+
+        const std::size_t size = (std::size_t(0) + ... + size_of(values));
+        *pSize = size;
+        if(size == 0) {
+            return nullptr;
+        }
+
+        std::shared_ptr<char> res(new char[size], array_deleter<char>());
+        [[maybe_unused]] auto* ptr = res.get();
+        (write(ptr, values), ...);
+        return res;
+    }
+
+    // Converts the arguments to the types of the signature (without a copy if they match):
+    template<typename Tuple, std::size_t... I, typename... Args>
+    std::shared_ptr<char> pack_as(std::size_t* pSize, std::index_sequence<I...>, const Args&... args)
+    {
+        return pack<std::tuple_element_t<I, Tuple>...>(pSize, args...);
+    }
+
+    // Reads the values of the tuple. Returns false if the data is truncated or has extra bytes:
+    template<typename Tuple, std::size_t... I>
+    bool unpack(const char* ptr, const char* end, Tuple& values, std::index_sequence<I...>)
+    {
+        return (read(ptr, end, std::get<I>(values)) && ...) && ptr == end;
+    }
+
+    template<typename Tuple>
+    bool unpack(const char* data, std::size_t size, Tuple& values)
+    {
+        return unpack(data, data + size, values, std::make_index_sequence<std::tuple_size_v<Tuple>>());
+    }
+
+    // View method calling the typed one. Requests whose payload doesn't match get status_codes::bad_request:
+    template<typename Sig, typename Method>
+    auto make_method(Method method)
+    {
+        using sig = signature<Sig>;
+        using result_t = typename sig::result_t;
+
+        return [method = std::move(method)](const srfc_message_view& request, std::shared_ptr<char>* pld,
+                                            std::size_t* pldSize) -> status_codes::status_t
+        {
+            typename sig::args_t args;
+            if(!unpack(request.getPayloadData(), request.getPayloadSize(), args)) {
+                return status_codes::bad_request;
+            }
+
+            if constexpr(std::is_void_v<result_t>) {
+                std::apply(method, std::move(args));
+            }
+            else {
+                const result_t res = std::apply(method, std::move(args));
+                *pld = pack<result_t>(pldSize, res);
+            }
+            return status_codes::ok;
+        };
+    }
+
+    // Result of the typed call.
+    // Throws srfc_call_error if the method has failed, std::runtime_error if the result is ill-formed
+    template<typename R>
+    R take_result(const srfc_response& response)
+    {
+        if(response.getStatusCode() != status_codes::ok) {
+            throw srfc_call_error(response.getStatusCode(),
+                "call(std::string methodName, const Args&... args): The method has returned status " +
+                std::to_string(response.getStatusCode()));
+        }
+
+        if constexpr(!std::is_void_v<R>) {
+            std::size_t size = 0;
+            const auto pld = response.getPayload(&size);
+
+            std::tuple<R> res;
+            if(!unpack(pld.get(), size, res)) {
+                throw std::runtime_error("call(std::string methodName, const Args&... args): The result is ill-formed");
+            }
+            return std::move(std::get<0>(res));
+        }
+    }
+} // namespace marshal_detail
+
+} // namespace net
+
+#endif
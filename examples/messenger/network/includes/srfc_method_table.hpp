@@ -0,0 +1,93 @@
+#ifndef SRFC_METHOD_TABLE_HPP
+#define SRFC_METHOD_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "srfc_frame.hpp"
+#include "srfc_request.hpp"
+#include "srfc_response.hpp"
+#include "srfc_message_view.hpp"
+#include "srfc_task.hpp"
+
+namespace net
+{
+
+// Kind of the registered method (see srfc_connection::add_method()):
+enum class method_kind : std::uint8_t
+{
+    none = 0,       // removed
+    callback,
+    view,
+    task,
+    stream
+};
+
+// Dense table of the methods served by a connection (or by the connections of a listener).
+// Every name gets the next id when it's first added and keeps it when the method is replaced or removed,
+// so the ids announced to the peer in the handshake stay valid: the requests naming the method by id
+// are dispatched by indexing the table, and the ones naming it by name are looked up in the name index.
+// The methods are immutable and refcounted, so copying the table doesn't copy the callbacks
+// (see srfc_method_registry), and a method outlives the table while its requests are handled.
+class srfc_method_table
+{
+public:
+    using params_t = srfc_request::params_t;
+    using payload_t = srfc_request::payload_t;
+    using status_t = srfc_response::status_t;
+    using callback_t = std::function<status_t(const params_t&, payload_t, payload_t*, std::size_t*)>;
+    using view_callback_t = std::function<status_t(const srfc_message_view&, payload_t*, std::size_t*)>;
+    using task_callback_t = std::function<srfc_task<srfc_response>(srfc_message_view)>;
+    using chunk_source_t = std::function<std::size_t(char*, std::size_t)>;
+    using stream_callback_t = std::function<status_t(const srfc_message_view&, chunk_source_t*)>;
+    using method_id_t = std::uint32_t;
+
+    // Registered method. Only the callback of its kind is set:
+    struct method
+    {
+        std::string name;
+        method_kind kind = method_kind::none;
+        callback_t callback;
+        view_callback_t view_callback;
+        task_callback_t task_callback;
+        stream_callback_t stream_callback;
+    };
+
+    // Registering (replaces the method of the same name):
+    method_id_t add(std::string name, callback_t callback);
+    method_id_t add(std::string name, view_callback_t callback);
+    method_id_t add(std::string name, task_callback_t callback);
+    method_id_t add(std::string name, stream_callback_t callback);
+    bool        remove(const std::string& name);
+    void        clear() noexcept;   // forgets the ids too
+
+    // Lookup. Returns nullptr if the method isn't registered (or was removed):
+    const method*   find(method_id_t id) const noexcept;
+    const method*   find(const std::string& name) const;
+    std::shared_ptr<const method>   entry(method_id_t id) const noexcept;
+    std::shared_ptr<const method>   entry(const std::string& name) const;
+    method_id_t     id_of(const std::string& name) const;   // no_method_id if the name has no id
+
+    // Throws std::out_of_range if no method of the kind is registered under the name:
+    const method&   at(const std::string& name, method_kind kind) const;
+
+    // Number of the ids given (the removed methods included). The names of the ids are announced to the peer:
+    std::size_t         size() const noexcept;
+    const std::string&  name_of(method_id_t id) const;      // empty if the id wasn't given
+
+private:
+    method_id_t set(method m);
+
+    std::vector<std::shared_ptr<const method>> methods;     // indexed by id. Removed methods are of method_kind::none
+    std::unordered_map<std::string, method_id_t> ids;
+}; // class srfc_method_table
+
+} // namespace net
+
+#endif
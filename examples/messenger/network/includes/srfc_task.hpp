@@ -0,0 +1,151 @@
+#ifndef SRFC_TASK_HPP
+#define SRFC_TASK_HPP
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace net
+{
+
+template<typename T = void>
+class srfc_task;
+
+namespace task_detail
+{
+    // Result storage of the coroutine (return_value and return_void can't coexist in one promise):
+    template<typename T>
+    struct result
+    {
+        std::optional<T> value;
+
+        void return_value(T v) { value.emplace(std::move(v)); }
+        T    take() { return std::move(*value); }
+    };
+
+    template<>
+    struct result<void>
+    {
+        void return_void() noexcept {}
+        void take() noexcept {}
+    };
+} // namespace task_detail
+
+// Lazily started coroutine returning T.
+// The task starts when it is awaited (or detached) and, when it finishes, resumes its awaiter
+// on the thread that finished it. SRFC calls awaited inside of the task resume it on the shared srfc_executor,
+// so no thread is blocked while a call is in flight.
+//
+// Usage:
+//      srfc_task<std::size_t> count_files(srfc_connection& c) {
+//          auto list = co_await c.async_send_request(srfc_request("LIST_SCAP"));
+//          ...
+//          co_return n;
+//      }
+//      count_files(c).detach();    // or co_await count_files(c) from another task
+template<typename T>
+class srfc_task
+{
+public:
+    struct promise_type : task_detail::result<T>
+    {
+        std::coroutine_handle<> continuation;   // the awaiting coroutine
+        std::exception_ptr error;
+        bool detached = false;                  // the frame destroys itself when done
+
+        struct final_awaiter
+        {
+            bool await_ready() const noexcept { return false; }
+            void await_resume() const noexcept {}
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept
+            {
+                auto& p = h.promise();
+                if(p.continuation) {
+                    return p.continuation;      // symmetric transfer to the awaiter
+                }
+                if(p.detached) {
+                    h.destroy();
+                }
+                return std::noop_coroutine();
+            }
+        };
+
+        srfc_task get_return_object() noexcept
+        {
+            return srfc_task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        final_awaiter       final_suspend() const noexcept { return {}; }
+        void                unhandled_exception() noexcept { error = std::current_exception(); }
+    };
+
+    using handle_t = std::coroutine_handle<promise_type>;
+
+    // Make non-copyable:
+    srfc_task(const srfc_task& other) = delete;
+    srfc_task& operator=(const srfc_task& other) = delete;
+
+    // Move operations:
+    srfc_task(srfc_task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    srfc_task& operator=(srfc_task&& other) noexcept
+    {
+        if(this != &other) {
+            destroy();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    srfc_task() = default;
+    ~srfc_task() { destroy(); }
+
+    // Awaiting starts the task. The result (or the exception) of the task is returned by co_await:
+    bool await_ready() const noexcept { return !handle || handle.done(); }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+
+    T await_resume()
+    {
+        if(handle.promise().error) {
+            std::rethrow_exception(handle.promise().error);
+        }
+        return handle.promise().take();
+    }
+
+    // Starts the task without waiting for it. The frame is destroyed when the task finishes;
+    // its result and exception are discarded
+    void detach()
+    {
+        auto h = std::exchange(handle, nullptr);
+        if(h) {
+            h.promise().detached = true;
+            h.resume();
+        }
+    }
+
+    bool valid() const noexcept { return static_cast<bool>(handle); }
+
+private:
+    explicit srfc_task(handle_t h) noexcept : handle(h) {}
+
+    void destroy() noexcept
+    {
+        if(handle) {
+            handle.destroy();
+            handle = nullptr;
+        }
+    }
+
+    handle_t handle;
+}; // class srfc_task
+
+} // namespace net
+
+#endif
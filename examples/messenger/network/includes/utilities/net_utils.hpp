@@ -4,6 +4,9 @@
 #include <stdexcept>
 #include <algorithm>
 
+#include "../srfc_frame.hpp"
+#include "../srfc_frame_parser.hpp"
+#include "../srfc_message_view.hpp"
 #include "../srfc_request.hpp"
 #include "../srfc_response.hpp"
 
@@ -15,141 +18,55 @@ namespace net {
 
 using payload_t = srfc_connection::payload_t;
 
+// Validates the message in a single pass. Never throws
 inline bool is_valid_message(const srfc_request::serialized_t& message, std::size_t mSize) noexcept
 {
     try{
-        // raw pointer to copy data. Should NOT be deleted:
-        auto* ptr = message.get();  
-        const auto* const rbound = ptr +  mSize;
-
-        /*-----------------------------------------------------*/
-        /*               Check Preamble:                       */
-        /*-----------------------------------------------------*/
-        if(mSize < 32) {
-            return false;
-        }
-
-        // Throws std::invalid_argument if no conversion could be performed
-        const std::size_t preamble_value = std::stoul(std::string(ptr, ptr + 32)); 
-        if(preamble_value !=  mSize) {
-            // Serialized size and preamble value differs
-            return false;
-        }
-        ptr += 32;
-
-        /*-----------------------------------------------------*/
-        /*           Check Protocol version:                   */
-        /*-----------------------------------------------------*/
-        // throws std::out_of_range if invalid string
-        const auto protocolVersion = sstrcpy_and_shift(ptr, rbound);
-        if(protocolVersion != "SRFCv1") {
-            // Protocols don't match
-            return false;
-        }
-
-        /*-----------------------------------------------------*/
-        /*                  Check Type:                        */
-        /*-----------------------------------------------------*/
-        // throws std::invalid_argument, std::out_of_range if invalid string
-        const auto typeP = separate_param_val(sstrcpy_and_shift(ptr, rbound));
-        if(typeP.first != "TYPE") {
-            // Invalid header structure
-            return false;
-        }
-        if(typeP.second != "REQ" && typeP.second != "RES") {
-            // Invalid type
-            return false;    
-        }
-        
-        /*-----------------------------------------------------*/
-        /*                Check Request ID:                    */
-        /*-----------------------------------------------------*/
-        // throws std::invalid_argument, std::out_of_range if invalid string
-        const auto requestIdP = separate_param_val(sstrcpy_and_shift(ptr, rbound));
-        if(requestIdP.first != "RI") {
-            // Invalid header structure
-            return false;    
-        }
-        // Throws std::invalid_argument if no conversion could be performed
-        std::stoul(requestIdP.second);
-
-        /*-----------------------------------------------------*/
-        /*              Check Payload Size:                    */
-        /*-----------------------------------------------------*/
-        // throws std::invalid_argument, std::out_of_range if invalid string
-        const auto payloadSize = separate_param_val(sstrcpy_and_shift(ptr, rbound));
-        if(payloadSize.first != "PS") {
-            // Invalid header structure
-            return false;    
-        }
-        // Throws std::invalid_argument if no conversion could be performed
-        const auto payload_size = std::stoul(payloadSize.second);
-
-        /*-----------------------------------------------------*/
-        /*                 Check Method: (for requests)        */
-        /*-----------------------------------------------------*/
-        if(typeP.second == "REQ") {
-            // throws std std::out_of_range if invalid string
-            sstrcpy_and_shift(ptr, rbound);
-        }
-
-        /*-----------------------------------------------------*/
-        /*          Check Parameters: (for requests)           */
-        /*-----------------------------------------------------*/
-        if(typeP.second == "REQ") {
-            while (ptr < rbound - payload_size) {
-                // throws std::invalid_argument, std::out_of_range if invalid string
-                separate_param_val(sstrcpy_and_shift(ptr, rbound));
-            }
-        }
-
-        /*-----------------------------------------------------*/
-        /*      Check Status Code: (for responses)             */
-        /*-----------------------------------------------------*/
-        if(typeP.second == "RES") {
-            // throws std::invalid_argument, std::out_of_range if invalid string
-            const auto stCode = separate_param_val(sstrcpy_and_shift(ptr, rbound));
-            if(stCode.first != "STATUS") {
-                // Invalid header structure
-                return false;   
-            }
-            // Throws std::invalid_argument if no conversion could be performed
-            std::stoul(stCode.second);
-        }
+        srfc_frame_parser parser;
+        srfc_message_view view;
+        return parser.parse(message, message.get(), mSize, view) == parse_status::ok && 
+               parser.frame_size() == mSize;
     }
     catch(...) {
+        // std::bad_alloc
         return false;
     }
-    return true;
 }
 
 // d should point to a block of memory of size at least <preamble size> (32)
 // Throws std::invalid_argument if no conversion could be performed
 inline std::size_t get_size_from_preamble(const char* d) {
-    std::size_t message_size = std::stoul(std::string(d, d + 32));
-    return message_size;
+    srfc_frame_parser parser;
+    if(detect_wire_format(d) != wire_format::srfc_v1 || 
+       parser.parse_prefix(d, srfc_v1_preamble_size) != parse_status::ok) 
+    {
+        throw std::invalid_argument("Invalid SRFCv1 preamble");
+    }
+    return parser.frame_size();
+}
+
+// d should point to a block of memory of size at least frame_prefix_size(detect_wire_format(d))
+// Throws std::invalid_argument if no conversion could be performed
+inline std::size_t get_frame_size(const char* d) {
+    srfc_frame_parser parser;
+    const auto status = parser.parse_prefix(d, frame_prefix_size(detect_wire_format(d)));
+    if(status != parse_status::ok) {
+        throw std::invalid_argument(to_string(status));
+    }
+    return parser.frame_size();
 }
 
+// Throws std::logic_error if the message is ill-formed
 inline std::string extract_type(srfc_request::serialized_t message, std::size_t size)
 {
-    // raw pointer to read data. Should NOT be deleted
-    auto ptr = message.get();
-    auto rbound = ptr + size;
-
-    // omit Preamble:
-    dynamic_assert<std::logic_error>(
-        [&size]{return size >= 32;}, "Message size is less than the preamble size (32)");
-
-    ptr += 32; 
-
-    // omit Protocol version:
-    auto protocolVersion = ::sstrcpy_and_shift(ptr, rbound); // throws if out of bound
-
-    // Get Type:
-    auto type = separate_param_val(sstrcpy_and_shift(ptr, nullptr)); // throws if out of bound
-    dynamic_assert<std::logic_error>(type.first, "TYPE", "Invalid message structure");
+    srfc_frame_parser parser;
+    srfc_message_view view;
+    const auto status = parser.parse(message, message.get(), size, view);
+    if(status != parse_status::ok) {
+        throw std::logic_error(to_string(status));
+    }
 
-    return type.second;
+    return view.getType() == frame_type::request ? "REQ" : "RES";
 }
 
 inline std::string get_param(const srfc_connection::params_t& par, const std::string& parName) {
@@ -0,0 +1,364 @@
+#include "includes/srfc_codec.hpp"
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#if defined(SRFC_WITH_LZ4)
+#include <lz4.h>
+#endif
+
+#if defined(SRFC_WITH_ZSTD)
+#include <zstd.h>
+#endif
+
+#include "includes/utilities/array_deleter.hpp"
+#include "includes/utilities/byte_order.hpp"
+
+namespace net
+{
+
+namespace
+{
+
+constexpr std::size_t size_prefix = sizeof(std::uint64_t);  // uncompressed size before the codec data
+constexpr std::size_t sample_size = 4096;                   // probe of the incompressible payloads
+
+//
+// Built-in lz77 codec (LZ4 block layout):
+//  sequence: | token | literal length ext | literals | offset (u16, LE) | match length ext |
+// The token holds the literal length (high nibble) and the match length - 4 (low nibble);
+// 15 is continued by the bytes of the extension until a byte other than 255.
+// The last sequence has no match. Matches don't cover the last 5 bytes of the block.
+//
+
+constexpr std::size_t hash_log = 14;
+constexpr std::size_t min_match = 4;
+constexpr std::size_t last_literals = 5;
+constexpr std::size_t max_offset = 65535;
+
+inline std::uint32_t read32(const unsigned char* p)
+{
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline bool equal8(const unsigned char* a, const unsigned char* b)
+{
+    std::uint64_t x, y;
+    std::memcpy(&x, a, sizeof(x));
+    std::memcpy(&y, b, sizeof(y));
+    return x == y;
+}
+
+inline bool write_length(unsigned char*& op, unsigned char* oend, std::size_t len)
+{
+    for(; len >= 255; len -= 255) {
+        if(op == oend) {
+            return false;
+        }
+        *(op++) = 255;
+    }
+    if(op == oend) {
+        return false;
+    }
+    *(op++) = static_cast<unsigned char>(len);
+    return true;
+}
+
+// Returns the size of the compressed block or 0 if it doesn't fit into capacity
+std::size_t lz77_compress(const char* data, std::size_t size, char* out, std::size_t capacity)
+{
+    const auto* src = reinterpret_cast<const unsigned char*>(data);
+    const auto* ip = src;
+    const auto* anchor = src;
+    const auto* iend = src + size;
+    const auto* match_limit = iend - (size < last_literals ? size : last_literals);
+    const auto* search_end = size > 12 ? iend - 12 : src;
+
+    auto* op = reinterpret_cast<unsigned char*>(out);
+    auto* oend = op + capacity;
+
+    std::vector<std::uint32_t> table(std::size_t(1) << hash_log, 0);   // position + 1 (0 is empty)
+
+    const auto emit = [&](const unsigned char* literals, std::size_t lit_len, std::size_t offset, std::size_t match_len) {
+        if(op == oend) {
+            return false;
+        }
+        auto* token = op++;
+        *token = static_cast<unsigned char>((lit_len < 15 ? lit_len : 15) << 4);
+        if(lit_len >= 15 && !write_length(op, oend, lit_len - 15)) {
+            return false;
+        }
+        if(static_cast<std::size_t>(oend - op) < lit_len) {
+            return false;
+        }
+        std::memcpy(op, literals, lit_len);
+        op += lit_len;
+
+        if(match_len == 0) {
+            return true;    // the last sequence
+        }
+        if(oend - op < 2) {
+            return false;
+        }
+        *(op++) = static_cast<unsigned char>(offset & 0xFF);
+        *(op++) = static_cast<unsigned char>(offset >> 8);
+
+        match_len -= min_match;
+        *token |= static_cast<unsigned char>(match_len < 15 ? match_len : 15);
+        return match_len < 15 || write_length(op, oend, match_len - 15);
+    };
+
+    while(ip < search_end) {
+        const auto seq = read32(ip);
+        const auto h = (seq * 2654435761u) >> (32 - hash_log);
+        const auto ref = table[h];
+        table[h] = static_cast<std::uint32_t>(ip - src + 1);
+
+        if(ref == 0 || static_cast<std::size_t>(ip - src) - (ref - 1) > max_offset || read32(src + ref - 1) != seq) {
+            ip += 1 + ((ip - anchor) >> 6);     // skip faster over the incompressible data
+            continue;
+        }
+
+        const auto* match = src + ref - 1;
+        std::size_t len = min_match;
+        while(ip + len + 8 <= match_limit && equal8(ip + len, match + len)) {
+            len += 8;
+        }
+        while(ip + len < match_limit && ip[len] == match[len]) {
+            ++len;
+        }
+
+        if(!emit(anchor, ip - anchor, ip - match, len)) {
+            return 0;
+        }
+        ip += len;
+        anchor = ip;
+    }
+
+    if(!emit(anchor, iend - anchor, 0, 0)) {
+        return 0;
+    }
+
+    return op - reinterpret_cast<unsigned char*>(out);
+}
+
+inline std::size_t read_length(const unsigned char*& ip, const unsigned char* iend, std::size_t len)
+{
+    unsigned char b;
+    do {
+        if(ip == iend) {
+            throw std::runtime_error("decompress_payload(): The lz77 block is truncated");
+        }
+        b = *(ip++);
+        len += b;
+    } while(b == 255);
+
+    return len;
+}
+
+void lz77_decompress(const char* data, std::size_t size, char* out, std::size_t out_size)
+{
+    const auto* ip = reinterpret_cast<const unsigned char*>(data);
+    const auto* iend = ip + size;
+    auto* dst = reinterpret_cast<unsigned char*>(out);
+    auto* op = dst;
+    auto* oend = dst + out_size;
+
+    while(ip < iend) {
+        const auto token = *(ip++);
+
+        std::size_t lit_len = token >> 4;
+        if(lit_len == 15) {
+            lit_len = read_length(ip, iend, lit_len);
+        }
+        if(lit_len > static_cast<std::size_t>(iend - ip) || lit_len > static_cast<std::size_t>(oend - op)) {
+            throw std::runtime_error("decompress_payload(): The lz77 literals are out of bounds");
+        }
+        std::memcpy(op, ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+
+        if(ip == iend) {
+            break;          // the last sequence
+        }
+
+        if(iend - ip < 2) {
+            throw std::runtime_error("decompress_payload(): The lz77 block is truncated");
+        }
+        const std::size_t offset = ip[0] | (std::size_t(ip[1]) << 8);
+        ip += 2;
+        if(offset == 0 || offset > static_cast<std::size_t>(op - dst)) {
+            throw std::runtime_error("decompress_payload(): The lz77 offset is out of bounds");
+        }
+
+        std::size_t match_len = token & 15;
+        if(match_len == 15) {
+            match_len = read_length(ip, iend, match_len);
+        }
+        match_len += min_match;
+        if(match_len > static_cast<std::size_t>(oend - op)) {
+            throw std::runtime_error("decompress_payload(): The lz77 match is out of bounds");
+        }
+
+        const auto* match = op - offset;
+        if(offset >= match_len) {
+            std::memcpy(op, match, match_len);
+            op += match_len;
+        } else {
+            // overlapping match repeats the last offset bytes:
+            for(std::size_t i = 0; i < match_len; ++i) {
+                *(op++) = *(match++);
+            }
+        }
+    }
+
+    if(op != oend) {
+        throw std::runtime_error("decompress_payload(): The decompressed size doesn't match");
+    }
+}
+
+// Returns the size of the compressed data or 0 if it doesn't fit into capacity
+std::size_t compress_block(payload_codec codec, const char* data, std::size_t size, char* out, std::size_t capacity)
+{
+    switch(codec) {
+    case payload_codec::lz77:
+        return lz77_compress(data, size, out, capacity);
+#if defined(SRFC_WITH_LZ4)
+    case payload_codec::lz4:
+        if(size > LZ4_MAX_INPUT_SIZE || capacity > static_cast<std::size_t>(std::numeric_limits<int>::max())) {
+            return 0;
+        }
+        return static_cast<std::size_t>(
+            LZ4_compress_default(data, out, static_cast<int>(size), static_cast<int>(capacity)));
+#endif
+#if defined(SRFC_WITH_ZSTD)
+    case payload_codec::zstd: {
+        const auto res = ZSTD_compress(out, capacity, data, size, 1);
+        return ZSTD_isError(res) ? 0 : res;
+    }
+#endif
+    default:
+        return 0;
+    }
+}
+
+} // namespace
+
+std::uint8_t supported_codecs() noexcept
+{
+    std::uint8_t mask = 1u << static_cast<unsigned>(payload_codec::lz77);
+#if defined(SRFC_WITH_LZ4)
+    mask |= 1u << static_cast<unsigned>(payload_codec::lz4);
+#endif
+#if defined(SRFC_WITH_ZSTD)
+    mask |= 1u << static_cast<unsigned>(payload_codec::zstd);
+#endif
+    return mask;
+}
+
+bool is_supported(payload_codec codec) noexcept
+{
+    return codec != payload_codec::none && (supported_codecs() >> static_cast<unsigned>(codec)) & 1u;
+}
+
+std::shared_ptr<char> compress_payload(payload_codec codec, const char* data, std::size_t size, std::size_t* pSize)
+{
+    if(!is_supported(codec) || size < min_compressed_payload ||
+        size > std::numeric_limits<std::uint32_t>::max()) {
+        return nullptr;
+    }
+
+    // a sample that doesn't shrink by 1/8 means already compressed (or random) data:
+    if(size > 2 * sample_size) {
+        std::unique_ptr<char[]> probe(new char[sample_size]);
+        const auto res = lz77_compress(data, sample_size, probe.get(), sample_size);
+        if(res == 0 || res * 8 > sample_size * 7) {
+            return nullptr;
+        }
+    }
+
+    // the compressed payload should save at least 1/16 of the size:
+    const auto capacity = size - size / 16;
+    std::shared_ptr<char> res(new char[size_prefix + capacity], array_deleter<char>());
+
+    const auto compressed = compress_block(codec, data, size, res.get() + size_prefix, capacity);
+    if(compressed == 0 || size > compressed * max_compression_ratio) {
+        return nullptr;
+    }
+
+    auto* p = res.get();
+    store_le_and_shift<std::uint64_t>(p, size);
+
+    *pSize = size_prefix + compressed;
+    return res;
+}
+
+std::size_t decompressed_size(const char* data, std::size_t size)
+{
+    if(size <= size_prefix) {
+        throw std::runtime_error("decompressed_size(): The compressed payload is truncated");
+    }
+
+    const auto original = load_le_and_shift<std::uint64_t>(data);
+    if(original > std::numeric_limits<std::size_t>::max()) {
+        return std::numeric_limits<std::size_t>::max();
+    }
+    return static_cast<std::size_t>(original);
+}
+
+std::shared_ptr<char> decompress_payload(payload_codec codec, const char* data, std::size_t size, std::size_t* pSize,
+                                         std::size_t maxSize)
+{
+    if(!is_supported(codec)) {
+        throw std::runtime_error("decompress_payload(): The payload codec isn't supported");
+    }
+    if(size <= size_prefix) {
+        throw std::runtime_error("decompress_payload(): The compressed payload is truncated");
+    }
+
+    const auto* p = data;
+    const auto original = load_le_and_shift<std::uint64_t>(p);
+    const auto compressed = size - size_prefix;
+    if(original == 0 || original / max_compression_ratio > compressed || original > maxSize) {
+        throw std::runtime_error("decompress_payload(): The uncompressed size is out of bounds");
+    }
+
+    const auto out_size = static_cast<std::size_t>(original);
+    std::shared_ptr<char> res(new char[out_size], array_deleter<char>());
+
+    switch(codec) {
+    case payload_codec::lz77:
+        lz77_decompress(p, compressed, res.get(), out_size);
+        break;
+#if defined(SRFC_WITH_LZ4)
+    case payload_codec::lz4:
+        if(compressed > static_cast<std::size_t>(std::numeric_limits<int>::max()) ||
+            out_size > static_cast<std::size_t>(std::numeric_limits<int>::max()) ||
+            LZ4_decompress_safe(p, res.get(), static_cast<int>(compressed), static_cast<int>(out_size)) !=
+                static_cast<int>(out_size)) {
+            throw std::runtime_error("decompress_payload(): The lz4 payload is corrupted");
+        }
+        break;
+#endif
+#if defined(SRFC_WITH_ZSTD)
+    case payload_codec::zstd: {
+        const auto n = ZSTD_decompress(res.get(), out_size, p, compressed);
+        if(ZSTD_isError(n) || n != out_size) {
+            throw std::runtime_error("decompress_payload(): The zstd payload is corrupted");
+        }
+        break;
+    }
+#endif
+    default:
+        throw std::runtime_error("decompress_payload(): The payload codec isn't supported");
+    }
+
+    *pSize = out_size;
+    return res;
+}
+
+} // namespace net
@@ -0,0 +1,149 @@
+#include "includes/srfc_frame.hpp"
+
+#include <cstring>
+#include <string>
+
+#include "includes/utilities/alg.hpp"
+#include "includes/utilities/array_deleter.hpp"
+#include "includes/utilities/byte_order.hpp"
+
+namespace net
+{
+
+//
+// Static members initialization:
+//
+
+constexpr std::uint32_t srfc_v2_header::magic_value;
+constexpr std::uint8_t srfc_v2_header::version_value;
+constexpr std::size_t srfc_v2_header::size;
+constexpr std::size_t srfc_v2_header::param_prefix_size;
+
+//
+// Serialization & deserialization:
+//
+
+void srfc_v2_header::encode(char* out) const noexcept
+{
+    store_le_and_shift(out, magic);
+    store_le_and_shift(out, version);
+    store_le_and_shift(out, type);
+    store_le_and_shift(out, flags);
+    store_le_and_shift(out, request_id);
+    store_le_and_shift(out, status);
+    store_le_and_shift(out, method_length);
+    store_le_and_shift(out, param_count);
+    store_le_and_shift(out, params_length);
+    store_le_and_shift(out, payload_length);
+}
+
+bool srfc_v2_header::decode(const char* in) noexcept
+{
+    magic = load_le_and_shift<std::uint32_t>(in);
+    version = load_le_and_shift<std::uint8_t>(in);
+    type = load_le_and_shift<std::uint8_t>(in);
+    flags = load_le_and_shift<std::uint16_t>(in);
+    request_id = load_le_and_shift<std::uint64_t>(in);
+    status = load_le_and_shift<std::uint32_t>(in);
+    method_length = load_le_and_shift<std::uint16_t>(in);
+    param_count = load_le_and_shift<std::uint16_t>(in);
+    params_length = load_le_and_shift<std::uint32_t>(in);
+    payload_length = load_le_and_shift<std::uint64_t>(in);
+
+    return magic == magic_value && version == version_value;
+}
+
+std::size_t srfc_v2_header::frame_size() const noexcept
+{
+    const std::size_t trailer = checksum() != frame_checksum::none ? checksum_trailer_size : 0;
+    return size + method_length + params_length + payload_length + trailer;
+}
+
+frame_checksum srfc_v2_header::checksum() const noexcept
+{
+    return static_cast<frame_checksum>((flags & checksum_flags_mask) >> checksum_flags_shift);
+}
+
+//
+// Other:
+//
+
+wire_format detect_wire_format(const char* d) noexcept
+{
+    // SRFCv1 preamble consists of decimal digits only,
+    // whereas SRFCv2 header begins with the 'S' character of the magic value.
+    return *d == 'S' ? wire_format::srfc_v2 : wire_format::srfc_v1;
+}
+
+std::size_t frame_prefix_size(wire_format fmt) noexcept
+{
+    return fmt == wire_format::srfc_v2 ? srfc_v2_header::size : srfc_v1_preamble_size;
+}
+
+std::shared_ptr<char> serialize_stream_header(frame_type type, std::uint64_t requestId, std::size_t payloadSize,
+                                              std::uint32_t credit, wire_format fmt, std::size_t* pSize,
+                                              payload_codec codec, frame_checksum checksum)
+{
+    /*-----------------------------------------------------*/
+    /*                SRFCv2 header:                       */
+    /*-----------------------------------------------------*/
+    if(fmt == wire_format::srfc_v2) {
+        srfc_v2_header hdr;
+        hdr.type = static_cast<std::uint8_t>(type);
+        hdr.request_id = requestId;
+        hdr.status = type == frame_type::credit ? credit : 0;
+        hdr.flags = static_cast<std::uint16_t>(static_cast<unsigned>(codec) << codec_flags_shift |
+                                               static_cast<unsigned>(checksum) << checksum_flags_shift);
+        hdr.payload_length = payloadSize;
+
+        std::shared_ptr<char> res(new char[srfc_v2_header::size], array_deleter<char>());
+        hdr.encode(res.get());
+
+        *pSize = srfc_v2_header::size;
+        return res;
+    }
+
+    /*-----------------------------------------------------*/
+    /*                SRFCv1 lines:                        */
+    /*-----------------------------------------------------*/
+    std::string lines("SRFCv1");
+    lines.push_back('\0');
+    switch(type) {
+        case frame_type::credit:    lines += "TYPE: CRD"; break;
+        case frame_type::cancel:    lines += "TYPE: CNL"; break;
+        case frame_type::batch:     lines += "TYPE: BAT"; break;
+        default:                    lines += "TYPE: CHK"; break;
+    }
+    lines.push_back('\0');
+    lines += "RI: " + std::to_string(requestId);
+    lines.push_back('\0');
+    if(checksum != frame_checksum::none) {
+        lines += "CK: " + std::to_string(static_cast<int>(checksum));
+        lines.push_back('\0');
+    }
+    lines += "PS: " + std::to_string(payloadSize);
+    lines.push_back('\0');
+    if(codec != payload_codec::none) {
+        lines += "PC: " + std::to_string(static_cast<int>(codec));
+        lines.push_back('\0');
+    }
+    if(type == frame_type::credit) {
+        lines += "CREDIT: " + std::to_string(credit);
+        lines.push_back('\0');
+    }
+
+    const auto head_size = srfc_v1_preamble_size + lines.size();
+    const auto full_size = head_size + payloadSize + (checksum != frame_checksum::none ? checksum_trailer_size : 0);
+
+    std::shared_ptr<char> res(new char[head_size], array_deleter<char>());
+    auto tmpptr = res.get();
+
+    const auto preamble = std::string(srfc_v1_preamble_size - digits(full_size), '0') + std::to_string(full_size);
+    copy_and_shift(tmpptr, preamble.c_str(), srfc_v1_preamble_size);
+    copy_and_shift(tmpptr, lines.data(), lines.size());
+
+    *pSize = head_size;
+    return res;
+}
+
+} // namespace net
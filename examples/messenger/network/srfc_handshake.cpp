@@ -0,0 +1,151 @@
+#include "includes/srfc_handshake.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+
+#include "includes/srfc_checksum.hpp"
+#include "includes/srfc_codec.hpp"
+#include "includes/srfc_connection.hpp"
+#include "includes/utilities/alg.hpp"
+#include "includes/utilities/array_deleter.hpp"
+
+namespace net
+{
+
+// Parameters of the hello:
+static constexpr const char* formats_param = "FORMATS";
+static constexpr const char* codecs_param = "CODECS";
+static constexpr const char* checksums_param = "CHECKSUMS";
+static constexpr const char* max_frame_param = "MAX_FRAME";
+static constexpr const char* window_param = "WINDOW";
+static constexpr const char* features_param = "FEATURES";
+static constexpr const char* methods_param = "METHODS";
+
+static constexpr std::uint8_t format_bit(wire_format fmt) noexcept
+{
+    return static_cast<std::uint8_t>(1u << static_cast<unsigned>(fmt));
+}
+
+// Returns the numeric parameter of the hello, or def if it's missing or ill-formed:
+template<typename num_t>
+static num_t read_param(const srfc_message_view& hello, std::string_view name, num_t def) noexcept
+{
+    const auto& params = hello.getParams();
+    const auto it = std::find_if(params.cbegin(), params.cend(), [&name](const auto& p) { return p.first == name; });
+    if(it == params.cend()) {
+        return def;
+    }
+
+    num_t res = def;
+    const auto& value = it->second;
+    if(std::from_chars(value.data(), value.data() + value.size(), res).ec != std::errc()) {
+        return def;
+    }
+    return res;
+}
+
+srfc_capabilities local_capabilities(std::size_t maxFrameSize, std::size_t streamWindow) noexcept
+{
+    srfc_capabilities caps;
+    caps.wire_formats = format_bit(wire_format::srfc_v1) | format_bit(wire_format::srfc_v2);
+    caps.codecs = supported_codecs();
+    caps.checksums = supported_checksums();
+    caps.max_frame_size = std::max(maxFrameSize, min_max_frame_size);
+    caps.stream_window = streamWindow;
+    caps.features = static_cast<std::uint8_t>(srfc_feature::streams) | static_cast<std::uint8_t>(srfc_feature::priority) |
+                    static_cast<std::uint8_t>(srfc_feature::cancel) | static_cast<std::uint8_t>(srfc_feature::batch);
+    return caps;
+}
+
+srfc_capabilities legacy_capabilities() noexcept
+{
+    srfc_capabilities caps;
+    caps.wire_formats = format_bit(wire_format::srfc_v1);
+    caps.max_frame_size = std::numeric_limits<std::size_t>::max();
+    caps.stream_window = srfc_connection::stream_window;
+    return caps;
+}
+
+bool accepts(const srfc_capabilities& caps, wire_format fmt) noexcept
+{
+    return (caps.wire_formats & format_bit(fmt)) != 0;
+}
+
+bool accepts(const srfc_capabilities& caps, srfc_feature feature) noexcept
+{
+    return (caps.features & static_cast<std::uint8_t>(feature)) != 0;
+}
+
+srfc_request make_hello(const srfc_capabilities& caps)
+{
+    auto hello = srfc_request(hello_method);
+    hello.addParam(formats_param, std::to_string(caps.wire_formats));
+    hello.addParam(codecs_param, std::to_string(caps.codecs));
+    hello.addParam(checksums_param, std::to_string(caps.checksums));
+    hello.addParam(max_frame_param, std::to_string(caps.max_frame_size));
+    hello.addParam(window_param, std::to_string(caps.stream_window));
+    hello.addParam(features_param, std::to_string(caps.features));
+    hello.setPriority(frame_priority::high);
+
+    std::size_t size = 0;
+    for(const auto& name : caps.methods) {
+        size += name.size() + 1;
+    }
+    if(caps.methods.empty() || size > max_hello_methods_size) {
+        return hello;
+    }
+
+    std::shared_ptr<char> names(new char[size], array_deleter<char>());
+    auto tmpptr = names.get();
+    for(const auto& name : caps.methods) {
+        copy_and_shift(tmpptr, name.c_str(), name.size() + 1);     // with the trailing null
+    }
+    hello.addParam(methods_param, std::to_string(caps.methods.size()));
+    hello.setPayload(names, size);
+    return hello;
+}
+
+srfc_capabilities read_hello(const srfc_message_view& hello) noexcept
+{
+    const auto legacy = legacy_capabilities();
+
+    srfc_capabilities caps;
+    caps.wire_formats = read_param(hello, formats_param, legacy.wire_formats) | format_bit(wire_format::srfc_v1);
+    caps.codecs = read_param(hello, codecs_param, legacy.codecs);
+    caps.checksums = read_param(hello, checksums_param, legacy.checksums);
+    caps.max_frame_size = std::max(read_param(hello, max_frame_param, legacy.max_frame_size), min_max_frame_size);
+    caps.stream_window = std::max<std::size_t>(read_param(hello, window_param, legacy.stream_window), 1);
+    caps.features = read_param(hello, features_param, legacy.features);
+
+    // the ids are only used if all names are read:
+    const auto count = read_param<std::size_t>(hello, methods_param, 0);
+    const auto* ptr = hello.getPayloadData();
+    const auto* const rbound = ptr + hello.getPayloadSize();
+    if(count == 0 || count > hello.getPayloadSize()) {
+        return caps;
+    }
+    try {
+        caps.methods.reserve(count);
+        while(ptr < rbound && caps.methods.size() < count) {
+            const auto* end = static_cast<const char*>(std::memchr(ptr, '\0', rbound - ptr));
+            if(end == nullptr) {
+                break;
+            }
+            caps.methods.emplace_back(ptr, end);
+            ptr = end + 1;
+        }
+    }
+    catch(...) {
+        caps.methods.clear();
+    }
+    if(caps.methods.size() != count || ptr != rbound) {
+        caps.methods.clear();
+    }
+    return caps;
+}
+
+} // namespace net
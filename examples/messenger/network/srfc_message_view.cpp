@@ -0,0 +1,138 @@
+#include "includes/srfc_message_view.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "includes/srfc_frame_parser.hpp"
+
+namespace net
+{
+
+//
+// srfc_cancellation_token:
+//
+
+srfc_cancellation_token::srfc_cancellation_token(std::shared_ptr<const std::atomic_bool> flag) noexcept
+    : flag(std::move(flag))
+{
+}
+
+bool srfc_cancellation_token::is_cancelled() const noexcept
+{
+    return flag && flag->load();
+}
+
+//
+// Constructors:
+//
+
+srfc_message_view::srfc_message_view(buffer_t buf, const char* s, std::size_t sSize)
+{
+    srfc_frame_parser parser;
+    const auto status = parser.parse(buf, s, sSize, *this);
+
+    if(status == parse_status::incomplete || (status == parse_status::ok && parser.frame_size() != sSize)) {
+        throw std::logic_error("Serialized size and preamble value differs");
+    }
+    if(status != parse_status::ok) {
+        throw std::logic_error(to_string(status));
+    }
+}
+
+//
+// Getters:
+//
+
+wire_format srfc_message_view::getWireFormat() const noexcept
+{
+    return format;
+}
+
+frame_type srfc_message_view::getType() const noexcept
+{
+    return type;
+}
+
+srfc_message_view::id_t
+srfc_message_view::getRequestId() const noexcept
+{
+    return request_id;
+}
+
+srfc_message_view::status_t
+srfc_message_view::getStatusCode() const noexcept
+{
+    return status_code;
+}
+
+frame_priority srfc_message_view::getPriority() const noexcept
+{
+    return priority;
+}
+
+payload_codec srfc_message_view::getPayloadCodec() const noexcept
+{
+    return codec;
+}
+
+std::string_view srfc_message_view::getMethod() const noexcept
+{
+    return method_name;
+}
+
+std::uint32_t srfc_message_view::getMethodId() const noexcept
+{
+    return method_id;
+}
+
+const srfc_message_view::params_t&
+srfc_message_view::getParams() const noexcept
+{
+    return parameters;
+}
+
+const char* srfc_message_view::getPayloadData() const noexcept
+{
+    return payload_data;
+}
+
+std::size_t srfc_message_view::getPayloadSize() const noexcept
+{
+    return payload_size;
+}
+
+std::size_t srfc_message_view::getFrameSize() const noexcept
+{
+    return frame_size;
+}
+
+std::string_view srfc_message_view::getParam(std::string_view paramName) const
+{
+    auto it = std::find_if(parameters.cbegin(), parameters.cend(),
+        [&paramName](const auto& p){return p.first == paramName;});
+
+    if(it == parameters.cend()) {
+        throw std::out_of_range("Param " + std::string(paramName) + " not found.");
+    }
+
+    return it->second;
+}
+
+srfc_message_view::payload_t
+srfc_message_view::getPayload(std::size_t* pSize) const noexcept
+{
+    if(pSize != nullptr) {
+        *pSize = payload_size;
+    }
+
+    // aliasing constructor: shares the ownership of the whole receive buffer
+    return payload_t(buffer, const_cast<char*>(payload_data));
+}
+
+srfc_cancellation_token srfc_message_view::getCancellationToken() const noexcept
+{
+    return srfc_cancellation_token(cancelled);
+}
+
+} // namespace net
@@ -0,0 +1,333 @@
+#include "includes/srfc_reactor.hpp"
+#include "includes/srfc_frame.hpp"
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+#include <stdexcept>
+
+namespace net
+{
+
+// the index of the loop is kept in the low bits of the token:
+static constexpr unsigned loop_bits = 8;
+static constexpr std::size_t max_loops = std::size_t(1) << loop_bits;
+
+// settings of the shared reactor:
+static std::mutex shared_mutex;
+static bool shared_created = false;
+static std::size_t shared_threads = 0;
+static bool shared_io_uring = true;
+static bool shared_pin_threads = false;
+
+static std::tuple<std::size_t, bool, bool> take_shared_settings()
+{
+    std::lock_guard<std::mutex> lg(shared_mutex);
+    shared_created = true;
+    return std::make_tuple(shared_threads, shared_io_uring, shared_pin_threads);
+}
+
+//
+// Constructors & dtor:
+//
+
+srfc_reactor::srfc_reactor(std::size_t threads, bool useIoUring, bool pinThreads) :
+    use_io_uring(useIoUring)
+{
+    if(threads == 0) {
+        threads = std::max<std::size_t>(std::thread::hardware_concurrency() / 2, 1);
+    }
+    threads = std::min(threads, max_loops);
+
+    loops.reserve(threads);
+    for(std::size_t i = 0; i < threads; ++i) {
+        loops.push_back(std::make_unique<loop_t>());
+        __open__(*loops.back());
+    }
+
+    for(auto& loop : loops) {
+        loop->thread = std::thread(&srfc_reactor::__run__, this, std::ref(*loop));
+    }
+    if(pinThreads) {
+        pin_threads();
+    }
+}
+
+srfc_reactor::~srfc_reactor()
+{
+    terminate.store(true);
+
+    for(auto& loop : loops) {
+        __wake__(*loop);
+        loop->thread.join();
+        __close__(*loop);
+    }
+}
+
+srfc_reactor& srfc_reactor::shared()
+{
+    static const auto settings = take_shared_settings();
+    static srfc_reactor instance(std::get<0>(settings), std::get<1>(settings), std::get<2>(settings));
+    return instance;
+}
+
+void srfc_reactor::configure_shared(std::size_t threads, bool useIoUring, bool pinThreads)
+{
+    std::lock_guard<std::mutex> lg(shared_mutex);
+    if(shared_created) {
+        throw std::logic_error("configure_shared(std::size_t threads, bool useIoUring, bool pinThreads): "
+                               "shared reactor is already created");
+    }
+
+    shared_threads = threads;
+    shared_io_uring = useIoUring;
+    shared_pin_threads = pinThreads;
+}
+
+//
+// Registration:
+//
+
+srfc_reactor::token_t
+srfc_reactor::add(socket_t fd, handler_t handler, std::size_t loop)
+{
+    if(!handler) {
+        throw std::invalid_argument("add(socket_t fd, handler_t handler, std::size_t loop): empty handler");
+    }
+
+    auto e = std::make_shared<entry>();
+    e->fd = fd;
+    e->handler = std::move(handler);
+    return register_entry(std::move(e), loop);
+}
+
+srfc_reactor::token_t
+srfc_reactor::add_stream(socket_t fd, handler_t handler, receive_handler_t onReceive, send_handler_t onSent, std::size_t loop)
+{
+    if(!completes_io()) {
+        throw std::logic_error("add_stream(...): the backend doesn't complete the I/O");
+    }
+    if(!handler || !onReceive || !onSent) {
+        throw std::invalid_argument("add_stream(...): empty handler");
+    }
+
+    auto e = std::make_shared<entry>();
+    e->fd = fd;
+    e->handler = std::move(handler);
+    e->on_receive = std::move(onReceive);
+    e->on_sent = std::move(onSent);
+    return register_entry(std::move(e), loop);
+}
+
+srfc_reactor::token_t
+srfc_reactor::add_acceptor(socket_t fd, accept_handler_t onAccept, std::size_t loop)
+{
+    if(!completes_io()) {
+        throw std::logic_error("add_acceptor(...): the backend doesn't complete the I/O");
+    }
+    if(!onAccept) {
+        throw std::invalid_argument("add_acceptor(...): empty handler");
+    }
+
+    auto e = std::make_shared<entry>();
+    e->fd = fd;
+    e->handler = [](std::uint32_t) {};
+    e->on_accept = std::move(onAccept);
+    return register_entry(std::move(e), loop);
+}
+
+srfc_reactor::token_t
+srfc_reactor::register_entry(std::shared_ptr<entry> e, std::size_t loop)
+{
+    // least loaded loop:
+    if(loop == any_loop) {
+        loop = std::min_element(loops.cbegin(), loops.cend(), [](const auto& a, const auto& b) {
+            return a->load.load() < b->load.load();
+        }) - loops.cbegin();
+    }
+    if(loop >= loops.size()) {
+        throw std::out_of_range("register_entry(std::shared_ptr<entry> e, std::size_t loop): invalid loop index");
+    }
+
+    auto& l = *loops[loop];
+    e->token = (next_token.fetch_add(1) << loop_bits) | loop;
+
+    std::lock_guard<std::mutex> lg(l.mutex);
+    __watch__(l, *e, true);
+    l.entries.emplace(e->token, e);
+    ++l.load;
+
+    return e->token;
+}
+
+bool srfc_reactor::send(token_t token, const const_buffer* bufs, std::size_t count, std::shared_ptr<const void> keepAlive)
+{
+    auto& l = *loops[loop_of(token)];
+
+    std::lock_guard<std::mutex> lg(l.mutex);
+    auto it = l.entries.find(token);
+    if(it == l.entries.end()) {
+        return false;
+    }
+    if(!it->second->on_sent) {
+        throw std::logic_error("send(...): the socket is not added with add_stream()");
+    }
+    if(it->second->write_polled) {
+        throw std::logic_error("send(...): a send is already in flight");
+    }
+
+    __send__(l, *it->second, bufs, count, std::move(keepAlive));
+    return true;
+}
+
+void srfc_reactor::want_write(token_t token, bool enable)
+{
+    auto& l = *loops[loop_of(token)];
+
+    std::lock_guard<std::mutex> lg(l.mutex);
+    auto it = l.entries.find(token);
+    if(it == l.entries.end() || it->second->write == enable) {
+        return;
+    }
+
+    it->second->write = enable;
+    __watch__(l, *it->second, false);
+}
+
+void srfc_reactor::want_read(token_t token, bool enable)
+{
+    auto& l = *loops[loop_of(token)];
+
+    std::lock_guard<std::mutex> lg(l.mutex);
+    auto it = l.entries.find(token);
+    if(it == l.entries.end() || it->second->read == enable) {
+        return;
+    }
+
+    it->second->read = enable;
+    __watch__(l, *it->second, false);
+}
+
+void srfc_reactor::remove(token_t token)
+{
+    const auto loop = loop_of(token);
+    auto& l = *loops[loop];
+    {
+        std::lock_guard<std::mutex> lg(l.mutex);
+        auto it = l.entries.find(token);
+        if(it == l.entries.end()) {
+            return;
+        }
+
+        __unwatch__(l, it->second);
+        l.entries.erase(it);
+        --l.load;
+    }
+
+    // the handler may be running right now. Wait for the loop to finish the dispatch:
+    if(!in_loop(loop)) {
+        std::lock_guard<std::mutex> lg(l.dispatch_mutex);
+    }
+}
+
+std::size_t srfc_reactor::size() const noexcept
+{
+    return loops.size();
+}
+
+std::size_t srfc_reactor::loop_of(token_t token) const noexcept
+{
+    return static_cast<std::size_t>(token & (max_loops - 1));
+}
+
+bool srfc_reactor::in_loop(std::size_t loop) const
+{
+    return loops.at(loop)->thread.get_id() == std::this_thread::get_id();
+}
+
+bool srfc_reactor::uses_io_uring() const noexcept
+{
+    return !loops.empty() && loops.front()->ring != nullptr;
+}
+
+bool srfc_reactor::completes_io() const noexcept
+{
+    // only the io_uring backend completes the I/O:
+    return uses_io_uring();
+}
+
+void srfc_reactor::pin_threads()
+{
+    if(pinned.exchange(true)) {
+        return;
+    }
+
+    const auto cores = std::max(std::thread::hardware_concurrency(), 1u);
+    for(std::size_t i = 0; i < loops.size(); ++i) {
+        __pin__(*loops[i], i % cores);
+    }
+}
+
+bool srfc_reactor::pins_threads() const noexcept
+{
+    return pinned.load();
+}
+
+//
+// Loop:
+//
+
+void srfc_reactor::__run__(loop_t& loop)
+{
+    std::vector<ready_t> ready;
+
+    while(!terminate.load()) {
+        ready.clear();
+        try {
+            __poll__(loop, ready);
+        }
+        catch(...) {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> dl(loop.dispatch_mutex);
+        for(const auto& r : ready) {
+            // the socket may be removed by a previous handler:
+            std::shared_ptr<entry> e;
+            {
+                std::lock_guard<std::mutex> lg(loop.mutex);
+                auto it = loop.entries.find(r.token);
+                if(it != loop.entries.end()) {
+                    e = it->second;
+                }
+            }
+
+            try {
+                if(e != nullptr) {
+                    switch(r.kind) {
+                    case completion::none:
+                        e->handler(r.events);
+                        break;
+                    case completion::received:
+                        e->on_receive(r.data, r.result > 0 ? static_cast<std::size_t>(r.result) : 0);
+                        break;
+                    case completion::sent:
+                        e->on_sent(static_cast<std::ptrdiff_t>(r.result));
+                        break;
+                    case completion::accepted:
+                        e->on_accept(static_cast<socket_t>(r.result));
+                        break;
+                    }
+                }
+            }
+            catch(...) {}
+
+            // give back the receive buffer (or close the socket accepted for a removed listener):
+            if(r.kind != completion::none) {
+                __finish__(loop, r, e != nullptr);
+            }
+        }
+    }
+}
+
+} // namespace net
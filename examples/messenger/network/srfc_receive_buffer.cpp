@@ -0,0 +1,190 @@
+#include "includes/srfc_receive_buffer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <new>
+
+#include "includes/utilities/array_deleter.hpp"
+
+namespace net
+{
+
+//
+// Static members initialization:
+//
+
+constexpr std::size_t srfc_receive_buffer::min_read_size;
+constexpr std::size_t srfc_receive_buffer::max_read_size;
+constexpr std::size_t srfc_receive_buffer::max_ring_capacity;
+
+//
+// Constructors:
+//
+
+srfc_receive_buffer::srfc_receive_buffer(std::size_t initialCapacity) :
+    buffer(new char[initialCapacity], array_deleter<char>()),
+    capacity(initialCapacity),
+    initial_capacity(initialCapacity)
+{
+}
+
+//
+// Writing:
+//
+
+char* srfc_receive_buffer::prepare(std::size_t minFree)
+{
+    const auto unread = wpos - rpos;
+    const auto needed = unread + minFree;
+
+    // the block grown for a large message is left as soon as the unread bytes fit into the ring:
+    const auto ring = ring_capacity();
+    const bool oversized = capacity > ring && needed <= ring;
+
+    // enough free space at the end of the block:
+    if(capacity - wpos >= minFree && !oversized) {
+        return buffer.get() + wpos;
+    }
+
+    // the block is not shared with any view and can hold the unread bytes + minFree:
+    // move unread bytes to the beginning of the block
+    if(exclusive() && capacity >= needed && !oversized) {
+        std::memmove(buffer.get(), buffer.get() + rpos, unread);
+    }
+    // otherwise move unread bytes into a new block. It's not larger than the ring unless they need it:
+    else {
+        const auto newCapacity = std::max(std::min(capacity, ring), needed);
+        block_t tmp(new char[newCapacity], array_deleter<char>());
+        std::memcpy(tmp.get(), buffer.get() + rpos, unread);
+
+        buffer = std::move(tmp);
+        capacity = newCapacity;
+    }
+
+    rpos = 0;
+    wpos = unread;
+
+    return buffer.get() + wpos;
+}
+
+std::size_t srfc_receive_buffer::writable() const noexcept
+{
+    return capacity - wpos;
+}
+
+void srfc_receive_buffer::commit(std::size_t n) noexcept
+{
+    wpos += n;
+}
+
+//
+// Adaptive read size:
+//
+
+std::size_t srfc_receive_buffer::read_size() const noexcept
+{
+    return rsize;
+}
+
+void srfc_receive_buffer::adapt(std::size_t offered, std::size_t received) noexcept
+{
+    // the read filled all offered space - more data is probably pending:
+    if(received >= offered && rsize < max_read_size) {
+        rsize *= 2;
+    }
+    // the read returned much less than requested:
+    else if(received < offered / 4 && rsize > min_read_size) {
+        rsize /= 2;
+    }
+}
+
+std::size_t srfc_receive_buffer::ring_capacity() const noexcept
+{
+    return std::max(initial_capacity, max_ring_capacity);
+}
+
+void srfc_receive_buffer::shrink() noexcept
+{
+    // keeps the large block if the memory isn't available:
+    const auto newCapacity = std::max(initial_capacity, rsize);
+    auto* block = new(std::nothrow) char[newCapacity];
+    if(block == nullptr) {
+        return;
+    }
+
+    try {
+        buffer = block_t(block, array_deleter<char>());
+        capacity = newCapacity;
+        rpos = 0;
+        wpos = 0;
+    }
+    catch(...) {
+        delete[] block;
+    }
+}
+
+bool srfc_receive_buffer::exclusive() const noexcept
+{
+    if(buffer.use_count() != 1) {
+        return false;
+    }
+
+    // use_count() is a relaxed load. Synchronize with the release of the last view, 
+    // so its reads of the block happen before the block is overwritten:
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+}
+
+//
+// Reading:
+//
+
+const char* srfc_receive_buffer::data() const noexcept
+{
+    return buffer.get() + rpos;
+}
+
+std::size_t srfc_receive_buffer::size() const noexcept
+{
+    return wpos - rpos;
+}
+
+srfc_receive_buffer::block_t
+srfc_receive_buffer::block() const noexcept
+{
+    return buffer;
+}
+
+void srfc_receive_buffer::consume(std::size_t n) noexcept
+{
+    rpos += n;
+
+    if(rpos != wpos) {
+        return;
+    }
+
+    // the buffer is empty. Reuse the block from the beginning if it's not shared:
+    if(exclusive()) {
+        rpos = 0;
+        wpos = 0;
+    }
+
+    // the block grown for a large message is replaced. The views of the message keep it until they're released:
+    if(capacity > ring_capacity()) {
+        shrink();
+    }
+}
+
+void srfc_receive_buffer::clear() noexcept
+{
+    rpos = wpos;
+    consume(0);
+}
+
+std::size_t srfc_receive_buffer::get_capacity() const noexcept
+{
+    return capacity;
+}
+
+} // namespace net
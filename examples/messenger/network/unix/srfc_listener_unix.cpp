@@ -6,7 +6,8 @@
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <unistd.h>
-#include <thread>
+#include <fcntl.h>
+#include <errno.h>
 
 #include <stdexcept>
 
@@ -16,10 +17,9 @@
 namespace net
 {
 
-void srfc_listener::__bind__(unsigned int port, std::string interface)
+srfc_listener::socket_t srfc_listener::__bind__(unsigned int port, std::string interface)
 {
-    // sets socket_t socket_fd
-    // sets std::atomic_bool binded;
+    // SO_REUSEPORT lets every shard bind its own socket to the same port
 
     constexpr std::size_t backlog = 64;
 
@@ -33,8 +33,9 @@ void srfc_listener::__bind__(unsigned int port, std::string interface)
     }
   
     // Forcefully attaching socket to the port
-    if (::setsockopt(server_fd, SOL_SOCKET, 
-        SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt))) {
+    if (::setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) ||
+        ::setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt))) {
+        ::close(server_fd);
         throw std::runtime_error("__bind__(unsigned int port, std::string address): The setsockopt() function failed:");  
     }
 
@@ -47,46 +48,78 @@ void srfc_listener::__bind__(unsigned int port, std::string interface)
   
     // Forcefully attaching socket to the port
     if (::bind(server_fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        ::close(server_fd);
         throw std::runtime_error("__bind__(unsigned int port, std::string address): The bind() function failed:");  
     }
 
     if (::listen(server_fd, backlog) < 0) {
+        ::close(server_fd);
         throw std::runtime_error("__bind__(unsigned int port, std::string address): The listen() function failed:");  
     }
 
-    this->socket_fd = server_fd;
-    this->binded.store(true);
+    return server_fd;
 }
 
-srfc_listener::socket_t srfc_listener::__accept__()
+void srfc_listener::__set_nonblocking__(socket_t fd)
+{
+    const auto flags = ::fcntl(fd, F_GETFL, 0);
+    if(flags < 0 || ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        throw std::runtime_error("__set_nonblocking__(): The fcntl() function failed:");
+    }
+}
+
+srfc_listener::socket_t srfc_listener::__accept__(socket_t fd)
 {
     int new_socket = 0;
     struct sockaddr_in address = {0};
     int addrlen = sizeof(address);
 
-    if((new_socket = 
-        ::accept(this->socket_fd, (struct sockaddr*)&address, (socklen_t*)&addrlen)) < 0) 
+#if defined(__linux__)
+    // the accepted socket is created non-blocking, which saves the fcntl() calls of srfc_connection:
+    while((new_socket = 
+        ::accept4(fd, (struct sockaddr*)&address, (socklen_t*)&addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC)) < 0) 
+#else
+    while((new_socket = 
+        ::accept(fd, (struct sockaddr*)&address, (socklen_t*)&addrlen)) < 0) 
+#endif
     {
-        throw std::runtime_error("__accept__(): The accept() function failed:");  
+        // no pending connections on the non-blocking socket:
+        if(errno == EAGAIN || errno == EWOULDBLOCK) {
+            return -1;
+        }
+        // the connection was reset while waiting in the backlog:
+        if(errno != EINTR && errno != ECONNABORTED) {
+            throw std::runtime_error("__accept__(): The accept() function failed:");  
+        }
     }
 
     return new_socket;
 }
 
-void srfc_listener::__shutdown__()
+void srfc_listener::__shutdown__(socket_t fd)
 {
-    if(::shutdown(this->socket_fd, SHUT_RDWR) < 0) {
+    if(::shutdown(fd, SHUT_RDWR) < 0) {
         throw std::runtime_error("__shutdown__(): The shutdown() function failed:");
     }
 }
 
-void srfc_listener::__close__()
+void srfc_listener::__close__(socket_t fd)
 {
-    if(::close(this->socket_fd) < 0) {
+    if(::close(fd) < 0) {
         throw std::runtime_error("__close__(): The close() function failed:"); 
     }
 }
 
+bool srfc_listener::__balances_reuseport__()
+{
+    // elsewhere the last bound socket receives all connections:
+#if defined(__linux__)
+    return true;
+#else
+    return false;
+#endif
+}
+
 } // namespace net
 
 #endif
\ No newline at end of file
@@ -0,0 +1,889 @@
+// Compile only for UNIX-like systems:
+#if defined(unix) || defined(__unix__) || defined(__unix)
+
+#include "../includes/srfc_reactor.hpp"
+
+#include <unistd.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include <poll.h>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+// the multishot receives come with the headers of 6.0:
+#if defined(IORING_RECV_MULTISHOT)
+#define SRFC_HAS_IO_URING
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <limits.h>
+#endif
+#endif
+#endif
+#endif
+
+#include "../includes/srfc_frame.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+namespace net
+{
+
+#if defined(__linux__)
+
+// the token of the wake-up eventfd and of the io_uring requests without a handler (socket tokens are never 0):
+static constexpr srfc_reactor::token_t wake_token = 0;
+
+/*-----------------------------------------------------*/
+/*                io_uring backend:                    */
+/*-----------------------------------------------------*/
+
+// The streams and the listening sockets: multishot RECV (into the provided buffers of the loop) and ACCEPT,
+// SENDMSG of the gather lists, ASYNC_CANCEL when the reads are paused or the socket is removed.
+// The sockets added with add(): POLL_ADD / POLL_REMOVE. The wake-ups: NOP.
+
+#if defined(SRFC_HAS_IO_URING)
+
+// the requests of a socket are tagged with the high bits of its token:
+static constexpr std::uint64_t write_poll = std::uint64_t(1) << 63;
+static constexpr std::uint64_t recv_op    = std::uint64_t(1) << 62;
+static constexpr std::uint64_t send_op    = std::uint64_t(1) << 61;
+static constexpr std::uint64_t accept_op  = std::uint64_t(1) << 60;
+static constexpr std::uint64_t op_bits = write_poll | recv_op | send_op | accept_op;
+
+// the provided receive buffers of a loop (a power of 2 of them, 4MB of address space, touched on demand):
+static constexpr unsigned recv_buffer_count = 256;
+static constexpr std::size_t recv_buffer_size = 16 * 1024;
+static constexpr std::uint16_t recv_group = 0;
+
+// the request of the send in flight (see entry::send_state):
+struct io_send
+{
+    struct msghdr msg = {};
+    std::vector<struct iovec> iov;
+    std::shared_ptr<const void> keep_alive;
+};
+
+struct srfc_reactor::io_ring
+{
+    int fd = -1;
+
+    // submission queue:
+    void* sq_ptr = MAP_FAILED;
+    std::size_t sq_size = 0;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_flags;
+    unsigned* sq_array;
+    unsigned sq_entries;
+    struct io_uring_sqe* sqes = static_cast<struct io_uring_sqe*>(MAP_FAILED);
+    std::size_t sqes_size = 0;
+
+    // completion queue:
+    void* cq_ptr = MAP_FAILED;
+    std::size_t cq_size = 0;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+
+    // provided receive buffers. Only the loop thread gives them back:
+    struct io_uring_buf_ring* buf_ring = static_cast<struct io_uring_buf_ring*>(MAP_FAILED);
+    char* buffers = static_cast<char*>(MAP_FAILED);
+    std::uint16_t buf_tail = 0;
+    bool multishot_recv = true;             // cleared on the kernels without the multishot receives (before 6.0)
+    bool multishot_accept = true;
+
+    // the polls are one-shot. The fired ones are re-armed on the next iteration (after the handlers ran),
+    // which keeps the readiness level-triggered. So are the finished receives and accepts:
+    std::vector<std::uint64_t> fired;
+    std::vector<token_t> writable;          // streams to report writable on the next iteration
+    std::unordered_map<token_t, std::shared_ptr<entry>> retired;   // removed, waiting for their last completions
+
+    static io_ring* create(unsigned entries);   // nullptr if io_uring (or a feature it needs) is not available
+    void            release();                  // unmaps the rings and deletes this
+
+    // Called with loop.mutex held:
+    unsigned        unsubmitted() const;
+    void            submit();                   // submits the queued requests without waiting
+    void            push(const struct io_uring_sqe& request);
+    void            push(std::uint8_t opcode, int fd, std::uint32_t pollEvents, std::uint64_t addr, std::uint64_t userData);
+    void            poll(int fd, std::uint64_t userData);
+    void            receive(int fd, token_t token);
+    void            accept(int fd, token_t token);
+    void            cancel(std::uint64_t userData);
+
+    // Called by the loop thread:
+    void            recycle(std::uint16_t buffer);  // gives the buffer back to the kernel
+};
+
+static int ring_enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+static int ring_register(int fd, unsigned opcode, void* arg, unsigned count)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+void srfc_reactor::io_ring::release()
+{
+    // the requests in flight are cancelled when the ring is closed:
+    if(fd >= 0) {
+        ::close(fd);
+    }
+    if(buffers != MAP_FAILED) {
+        ::munmap(buffers, recv_buffer_count * recv_buffer_size);
+    }
+    if(buf_ring != MAP_FAILED) {
+        ::munmap(buf_ring, recv_buffer_count * sizeof(struct io_uring_buf));
+    }
+    if(sqes != MAP_FAILED) {
+        ::munmap(sqes, sqes_size);
+    }
+    if(cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) {
+        ::munmap(cq_ptr, cq_size);
+    }
+    if(sq_ptr != MAP_FAILED) {
+        ::munmap(sq_ptr, sq_size);
+    }
+    delete this;
+}
+
+// io_uring may be unavailable: old kernel, disabled by sysctl or seccomp
+srfc_reactor::io_ring* srfc_reactor::io_ring::create(unsigned entries)
+{
+    struct io_uring_params params = {};
+    const int fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if(fd < 0) {
+        return nullptr;
+    }
+
+    auto* ring = new srfc_reactor::io_ring;
+    ring->fd = fd;
+    ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    // single mmap of both rings (5.4) and no dropped completions (5.5) are required:
+    constexpr unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP;
+    if((params.features & required) != required) {
+        ring->release();
+        return nullptr;
+    }
+
+    ring->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sq_size = ring->cq_size = std::max(ring->sq_size, ring->cq_size);
+
+    ring->sq_ptr = ::mmap(nullptr, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if(ring->sq_ptr == MAP_FAILED) {
+        ring->release();
+        return nullptr;
+    }
+    ring->cq_ptr = ring->sq_ptr;
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = static_cast<struct io_uring_sqe*>(
+        ::mmap(nullptr, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+    if(ring->sqes == MAP_FAILED) {
+        ring->release();
+        return nullptr;
+    }
+
+    auto* sq = static_cast<char*>(ring->sq_ptr);
+    ring->sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    ring->sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    ring->sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    ring->sq_flags = reinterpret_cast<unsigned*>(sq + params.sq_off.flags);
+    ring->sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    ring->sq_entries = params.sq_entries;
+
+    auto* cq = static_cast<char*>(ring->cq_ptr);
+    ring->cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    ring->cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    ring->cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    ring->cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    // the opcodes of the completions (5.6):
+    constexpr unsigned probed = 64;
+    std::vector<char> probe(sizeof(struct io_uring_probe) + probed * sizeof(struct io_uring_probe_op), 0);
+    auto* pProbe = reinterpret_cast<struct io_uring_probe*>(probe.data());
+    if(ring_register(fd, IORING_REGISTER_PROBE, pProbe, probed) < 0) {
+        ring->release();
+        return nullptr;
+    }
+    for(const unsigned op : {IORING_OP_POLL_ADD, IORING_OP_POLL_REMOVE, IORING_OP_SENDMSG, IORING_OP_RECV,
+                             IORING_OP_ACCEPT, IORING_OP_ASYNC_CANCEL}) {
+        if(op > pProbe->last_op || (pProbe->ops[op].flags & IO_URING_OP_SUPPORTED) == 0) {
+            ring->release();
+            return nullptr;
+        }
+    }
+
+    // the ring of the provided receive buffers (5.19):
+    ring->buf_ring = static_cast<struct io_uring_buf_ring*>(::mmap(nullptr, recv_buffer_count * sizeof(struct io_uring_buf),
+        PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    ring->buffers = static_cast<char*>(::mmap(nullptr, recv_buffer_count * recv_buffer_size,
+        PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0));
+    if(ring->buf_ring == MAP_FAILED || ring->buffers == MAP_FAILED) {
+        ring->release();
+        return nullptr;
+    }
+
+    struct io_uring_buf_reg reg = {};
+    reg.ring_addr = reinterpret_cast<std::uint64_t>(ring->buf_ring);
+    reg.ring_entries = recv_buffer_count;
+    reg.bgid = recv_group;
+    if(ring_register(fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        ring->release();
+        return nullptr;
+    }
+    for(unsigned i = 0; i < recv_buffer_count; ++i) {
+        ring->recycle(static_cast<std::uint16_t>(i));
+    }
+
+    return ring;
+}
+
+unsigned srfc_reactor::io_ring::unsubmitted() const
+{
+    return *sq_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+}
+
+void srfc_reactor::io_ring::submit()
+{
+    const auto count = unsubmitted();
+    if(count != 0) {
+        while(ring_enter(fd, count, 0, 0) < 0 && errno == EINTR);
+    }
+}
+
+void srfc_reactor::io_ring::push(const struct io_uring_sqe& request)
+{
+    // the queue is full. Let the kernel consume it:
+    if(unsubmitted() == sq_entries) {
+        submit();
+        if(unsubmitted() == sq_entries) {
+            throw std::runtime_error("push(...): The io_uring submission queue is full");
+        }
+    }
+
+    const unsigned tail = *sq_tail;
+    const unsigned index = tail & *sq_mask;
+
+    sqes[index] = request;
+    sq_array[index] = index;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+void srfc_reactor::io_ring::push(std::uint8_t opcode, int fd, std::uint32_t pollEvents, std::uint64_t addr, std::uint64_t userData)
+{
+    struct io_uring_sqe sqe = {};
+    sqe.opcode = opcode;
+    sqe.fd = fd;
+    sqe.addr = addr;
+    sqe.poll32_events = pollEvents;
+    sqe.user_data = userData;
+    push(sqe);
+}
+
+void srfc_reactor::io_ring::poll(int fd, std::uint64_t userData)
+{
+    const std::uint32_t events = (userData & write_poll) ? POLLOUT : (POLLIN | POLLRDHUP);
+    push(IORING_OP_POLL_ADD, fd, events, 0, userData);
+}
+
+void srfc_reactor::io_ring::receive(int fd, token_t token)
+{
+    // the kernel picks the buffer when the data comes (len 0: the whole buffer):
+    struct io_uring_sqe sqe = {};
+    sqe.opcode = IORING_OP_RECV;
+    sqe.fd = fd;
+    sqe.flags = IOSQE_BUFFER_SELECT;
+    sqe.buf_group = recv_group;
+    sqe.ioprio = multishot_recv ? IORING_RECV_MULTISHOT : 0;
+    sqe.user_data = token | recv_op;
+    push(sqe);
+}
+
+void srfc_reactor::io_ring::accept(int fd, token_t token)
+{
+    struct io_uring_sqe sqe = {};
+    sqe.opcode = IORING_OP_ACCEPT;
+    sqe.fd = fd;
+    sqe.accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe.ioprio = multishot_accept ? IORING_ACCEPT_MULTISHOT : 0;
+    sqe.user_data = token | accept_op;
+    push(sqe);
+}
+
+void srfc_reactor::io_ring::cancel(std::uint64_t userData)
+{
+    // the cancelled request completes with -ECANCELED (or normally, if it's too late):
+    push(IORING_OP_ASYNC_CANCEL, -1, 0, userData, wake_token);
+}
+
+void srfc_reactor::io_ring::recycle(std::uint16_t buffer)
+{
+    // the ring is an array of io_uring_buf (its tail overlays the first one). Not through buf_ring->bufs:
+    // in C++ the empty struct in front of that flexible array takes a byte, which moves the array
+    auto& buf = reinterpret_cast<struct io_uring_buf*>(buf_ring)[buf_tail & (recv_buffer_count - 1)];
+    buf.addr = reinterpret_cast<std::uint64_t>(buffers + buffer * recv_buffer_size);
+    buf.len = static_cast<std::uint32_t>(recv_buffer_size);
+    buf.bid = buffer;
+    __atomic_store_n(&buf_ring->tail, ++buf_tail, __ATOMIC_RELEASE);
+}
+
+#endif
+
+/*-----------------------------------------------------*/
+/*                 epoll backend:                      */
+/*-----------------------------------------------------*/
+
+void srfc_reactor::__open__(loop_t& loop)
+{
+#if defined(SRFC_HAS_IO_URING)
+    if(use_io_uring) {
+        loop.ring = io_ring::create(4096);
+        if(loop.ring != nullptr) {
+            return;
+        }
+    }
+#endif
+
+    loop.poller = ::epoll_create1(EPOLL_CLOEXEC);
+    if(loop.poller < 0) {
+        throw std::runtime_error("__open__(loop_t& loop): The epoll_create1() function failed:");
+    }
+
+    loop.wake_read = loop.wake_write = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(loop.wake_read < 0) {
+        ::close(loop.poller);
+        throw std::runtime_error("__open__(loop_t& loop): The eventfd() function failed:");
+    }
+
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u64 = wake_token;
+    if(::epoll_ctl(loop.poller, EPOLL_CTL_ADD, loop.wake_read, &ev) < 0) {
+        ::close(loop.wake_read);
+        ::close(loop.poller);
+        throw std::runtime_error("__open__(loop_t& loop): The epoll_ctl() function failed:");
+    }
+}
+
+void srfc_reactor::__close__(loop_t& loop)
+{
+#if defined(SRFC_HAS_IO_URING)
+    if(loop.ring != nullptr) {
+        loop.ring->release();
+        loop.ring = nullptr;
+        return;
+    }
+#endif
+
+    ::close(loop.wake_read);
+    ::close(loop.poller);
+}
+
+void srfc_reactor::__wake__(loop_t& loop)
+{
+#if defined(SRFC_HAS_IO_URING)
+    if(loop.ring != nullptr) {
+        std::lock_guard<std::mutex> lg(loop.mutex);
+        loop.ring->push(IORING_OP_NOP, -1, 0, 0, wake_token);
+        loop.ring->submit();
+        return;
+    }
+#endif
+
+    const std::uint64_t one = 1;
+    while(::write(loop.wake_write, &one, sizeof(one)) < 0 && errno == EINTR);
+}
+
+void srfc_reactor::__poll__(loop_t& loop, std::vector<ready_t>& ready)
+{
+#if defined(SRFC_HAS_IO_URING)
+    if(loop.ring != nullptr) {
+        auto* ring = loop.ring;
+        unsigned toSubmit;
+        bool pending;
+        {
+            // re-arm the polls fired in the previous iteration (and the finished receives and accepts):
+            std::lock_guard<std::mutex> lg(loop.mutex);
+            for(const auto userData : ring->fired) {
+                auto it = loop.entries.find(userData & ~op_bits);
+                if(it == loop.entries.end()) {
+                    continue;
+                }
+
+                // the requests dropped by want_read(false) / want_write(false) aren't re-armed:
+                auto& e = *it->second;
+                if(userData & (recv_op | accept_op)) {
+                    if(e.read && !e.read_polled) {
+                        (userData & recv_op) ? ring->receive(e.fd, e.token) : ring->accept(e.fd, e.token);
+                        e.read_polled = true;
+                        e.cancelling = false;
+                    }
+                    continue;
+                }
+
+                auto& polled = (userData & write_poll) ? e.write_polled : e.read_polled;
+                polled = (userData & write_poll) ? e.write : e.read;
+                if(!polled) {
+                    continue;
+                }
+                ring->poll(e.fd, userData);
+            }
+            ring->fired.clear();
+            toSubmit = ring->unsubmitted();
+            pending = !ring->writable.empty();
+        }
+
+        // submit the re-armed requests and the ones made by the handlers, and wait (unless the writable
+        // streams are waiting to be reported):
+        if(ring_enter(ring->fd, toSubmit, pending ? 0 : 1, IORING_ENTER_GETEVENTS) < 0 && errno != EBUSY) {
+            if(errno == EINTR) {
+                return;
+            }
+            throw std::runtime_error("__poll__(loop_t& loop, std::vector<ready_t>& ready): The io_uring_enter() function failed:");
+        }
+
+        std::lock_guard<std::mutex> lg(loop.mutex);
+        unsigned head = *ring->cq_head;
+        const unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        for(; head != tail; ++head) {
+            const auto& cqe = ring->cqes[head & *ring->cq_mask];
+            if(cqe.user_data == wake_token) {
+                continue;
+            }
+
+            // the removed sockets are retired until their last request completes:
+            const auto token = cqe.user_data & ~op_bits;
+            auto it = loop.entries.find(token);
+            const bool alive = it != loop.entries.end();
+            if(!alive) {
+                it = ring->retired.find(token);
+                if(it == ring->retired.end()) {
+                    continue;
+                }
+            }
+            auto& e = *it->second;
+            const bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+
+            if(cqe.user_data & recv_op) {
+                const bool hasBuffer = (cqe.flags & IORING_CQE_F_BUFFER) != 0;
+                const auto buffer = static_cast<std::uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                if(!more) {
+                    e.read_polled = false;
+                }
+
+                // no multishot receives (re-armed single-shot), out of buffers (re-armed once they're given back),
+                // cancelled by want_read(false). The end of the stream and the errors aren't received again:
+                if(cqe.res == -EINVAL && ring->multishot_recv) {
+                    ring->multishot_recv = false;
+                }
+                const bool retry = cqe.res > 0 || cqe.res == -ENOBUFS || cqe.res == -ECANCELED || cqe.res == -EINVAL;
+                if(!more && retry) {
+                    ring->fired.push_back(cqe.user_data);
+                }
+
+                if(!alive || cqe.res == -ENOBUFS || cqe.res == -ECANCELED || cqe.res == -EINVAL) {
+                    if(hasBuffer) {
+                        ring->recycle(buffer);
+                    }
+                }
+                else {
+                    ready.push_back({token, 0, completion::received, cqe.res,
+                                     hasBuffer ? ring->buffers + buffer * recv_buffer_size : nullptr, buffer});
+                }
+            }
+            else if(cqe.user_data & accept_op) {
+                if(!more) {
+                    e.read_polled = false;
+                    ring->fired.push_back(cqe.user_data);
+                }
+                if(cqe.res == -EINVAL && ring->multishot_accept) {
+                    ring->multishot_accept = false;
+                }
+
+                // e.g. out of file descriptors: retried with the re-armed accept
+                if(cqe.res >= 0) {
+                    if(alive) {
+                        ready.push_back({token, 0, completion::accepted, cqe.res});
+                    }
+                    else {
+                        ::close(cqe.res);
+                    }
+                }
+            }
+            else if(cqe.user_data & send_op) {
+                // the buffers are not read anymore:
+                e.write_polled = false;
+                e.send_state.reset();
+                if(alive) {
+                    ready.push_back({token, 0, completion::sent, cqe.res});
+                    if(e.write) {
+                        ring->writable.push_back(token);
+                    }
+                }
+            }
+            else {
+                ring->fired.push_back(cqe.user_data);
+                if(!alive) {
+                    continue;
+                }
+
+                std::uint32_t res = io_events::closed | io_events::readable;   // the poll failed
+                if(cqe.res == -ECANCELED) {
+                    continue;
+                }
+                if(cqe.res >= 0) {
+                    res = 0;
+                    if(cqe.res & (POLLIN | POLLRDHUP)) {
+                        res |= io_events::readable;
+                    }
+                    if(cqe.res & POLLOUT) {
+                        res |= io_events::writable;
+                    }
+                    if(cqe.res & (POLLERR | POLLHUP)) {
+                        res |= io_events::closed | io_events::readable;
+                    }
+                }
+
+                // the poll fired after want_read(false) / want_write(false). Only the hang-ups are reported:
+                const bool wanted = (cqe.user_data & write_poll) ? e.write : e.read;
+                if(!wanted && (res & io_events::closed) == 0) {
+                    continue;
+                }
+                ready.push_back({token, res});
+            }
+
+            if(!alive && !e.read_polled && !e.write_polled) {
+                ring->retired.erase(it);
+            }
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+        // the streams may send (after the completions of their previous sends):
+        std::sort(ring->writable.begin(), ring->writable.end());
+        ring->writable.erase(std::unique(ring->writable.begin(), ring->writable.end()), ring->writable.end());
+        for(const auto token : ring->writable) {
+            auto it = loop.entries.find(token);
+            if(it != loop.entries.end() && it->second->write && !it->second->write_polled) {
+                ready.push_back({token, io_events::writable});
+            }
+        }
+        ring->writable.clear();
+        return;
+    }
+#endif
+
+    constexpr int max_events = 256;
+    struct epoll_event events[max_events];
+
+    const auto n = ::epoll_wait(loop.poller, events, max_events, -1);
+    if(n < 0) {
+        if(errno == EINTR) {
+            return;
+        }
+        throw std::runtime_error("__poll__(loop_t& loop, std::vector<ready_t>& ready): The epoll_wait() function failed:");
+    }
+
+    for(int i = 0; i < n; ++i) {
+        if(events[i].data.u64 == wake_token) {
+            std::uint64_t value;
+            while(::read(loop.wake_read, &value, sizeof(value)) < 0 && errno == EINTR);
+            continue;
+        }
+
+        std::uint32_t res = 0;
+        if(events[i].events & (EPOLLIN | EPOLLRDHUP)) {
+            res |= io_events::readable;
+        }
+        if(events[i].events & EPOLLOUT) {
+            res |= io_events::writable;
+        }
+        if(events[i].events & (EPOLLERR | EPOLLHUP)) {
+            res |= io_events::closed | io_events::readable;
+        }
+        ready.push_back({events[i].data.u64, res});
+    }
+}
+
+void srfc_reactor::__watch__(loop_t& loop, entry& e, bool added)
+{
+#if defined(SRFC_HAS_IO_URING)
+    if(loop.ring != nullptr) {
+        const bool inLoop = loop.thread.get_id() == std::this_thread::get_id();
+
+        if(e.on_receive || e.on_accept) {
+            // the receive / accept keeps completing until it's cancelled:
+            if(e.read && !e.read_polled) {
+                e.on_receive ? loop.ring->receive(e.fd, e.token) : loop.ring->accept(e.fd, e.token);
+                e.read_polled = true;
+                e.cancelling = false;
+            }
+            else if(!e.read && e.read_polled && !e.cancelling) {
+                loop.ring->cancel(e.token | (e.on_receive ? recv_op : accept_op));
+                e.cancelling = true;
+            }
+
+            // the writability of a stream is reported by the loop (once the send in flight completes):
+            if(e.write && !e.write_polled) {
+                loop.ring->writable.push_back(e.token);
+                if(!inLoop) {
+                    loop.ring->push(IORING_OP_NOP, -1, 0, 0, wake_token);
+                }
+            }
+        }
+        else {
+            // the polls are dropped when they fire after want_read(false) / want_write(false):
+            if(e.read && !e.read_polled) {
+                loop.ring->poll(e.fd, e.token);
+                e.read_polled = true;
+            }
+            if(e.write && !e.write_polled) {
+                loop.ring->poll(e.fd, e.token | write_poll);
+                e.write_polled = true;
+            }
+        }
+
+        // the loop thread submits its changes with the next wait:
+        if(!inLoop) {
+            loop.ring->submit();
+        }
+        return;
+    }
+#endif
+
+    struct epoll_event ev = {};
+    ev.events = (e.read ? static_cast<std::uint32_t>(EPOLLIN | EPOLLRDHUP) : std::uint32_t(0)) |
+                (e.write ? static_cast<std::uint32_t>(EPOLLOUT) : std::uint32_t(0));
+    ev.data.u64 = e.token;
+
+    if(::epoll_ctl(loop.poller, added ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, e.fd, &ev) < 0) {
+        throw std::runtime_error("__watch__(loop_t& loop, entry& e, bool added): The epoll_ctl() function failed:");
+    }
+}
+
+void srfc_reactor::__unwatch__(loop_t& loop, const std::shared_ptr<entry>& e)
+{
+#if defined(SRFC_HAS_IO_URING)
+    if(loop.ring != nullptr) {
+        // the pending requests hold a reference to the socket. Cancel them, so it can be closed:
+        if(e->on_receive || e->on_accept) {
+            if(e->read_polled && !e->cancelling) {
+                loop.ring->cancel(e->token | (e->on_receive ? recv_op : accept_op));
+                e->cancelling = true;
+            }
+            if(e->write_polled) {
+                loop.ring->cancel(e->token | send_op);
+            }
+
+            // the buffers of the send and the accepted sockets are released by the last completions:
+            if(e->read_polled || e->write_polled) {
+                loop.ring->retired.emplace(e->token, e);
+            }
+        }
+        else {
+            if(e->read_polled) {
+                loop.ring->push(IORING_OP_POLL_REMOVE, -1, 0, e->token, wake_token);
+            }
+            if(e->write_polled) {
+                loop.ring->push(IORING_OP_POLL_REMOVE, -1, 0, e->token | write_poll, wake_token);
+            }
+        }
+
+        if(loop.thread.get_id() != std::this_thread::get_id()) {
+            loop.ring->submit();
+        }
+        return;
+    }
+#endif
+
+    // fails only if the socket is already closed (and so removed from the epoll set):
+    ::epoll_ctl(loop.poller, EPOLL_CTL_DEL, e->fd, nullptr);
+}
+
+void srfc_reactor::__send__(loop_t& loop, entry& e, const const_buffer* bufs, std::size_t count,
+                            std::shared_ptr<const void> keepAlive)
+{
+#if defined(SRFC_HAS_IO_URING)
+    if(loop.ring != nullptr) {
+        // the gather list stays with the entry until the send completes. Longer lists are sent partially:
+        auto state = std::make_shared<io_send>();
+        state->iov.resize(std::min<std::size_t>(count, IOV_MAX));
+        for(std::size_t i = 0; i < state->iov.size(); ++i) {
+            state->iov[i].iov_base = const_cast<char*>(bufs[i].data);
+            state->iov[i].iov_len = bufs[i].size;
+        }
+        state->msg.msg_iov = state->iov.data();
+        state->msg.msg_iovlen = state->iov.size();
+        state->keep_alive = std::move(keepAlive);
+
+        struct io_uring_sqe sqe = {};
+        sqe.opcode = IORING_OP_SENDMSG;
+        sqe.fd = e.fd;
+        sqe.addr = reinterpret_cast<std::uint64_t>(&state->msg);
+        sqe.len = 1;
+        sqe.msg_flags = MSG_NOSIGNAL;
+        sqe.user_data = e.token | send_op;
+        loop.ring->push(sqe);
+
+        e.send_state = std::move(state);
+        e.write_polled = true;
+        if(loop.thread.get_id() != std::this_thread::get_id()) {
+            loop.ring->submit();
+        }
+        return;
+    }
+#endif
+
+    throw std::logic_error("__send__(...): the backend doesn't complete the I/O");
+}
+
+void srfc_reactor::__finish__(loop_t& loop, const ready_t& r, bool delivered)
+{
+#if defined(SRFC_HAS_IO_URING)
+    if(loop.ring != nullptr && r.kind == completion::received && r.data != nullptr) {
+        loop.ring->recycle(r.buffer);
+    }
+#endif
+    if(r.kind == completion::accepted && !delivered) {
+        ::close(static_cast<int>(r.result));
+    }
+}
+
+#else
+
+/*-----------------------------------------------------*/
+/*                 poll() backend:                     */
+/*-----------------------------------------------------*/
+
+void srfc_reactor::__open__(loop_t& loop)
+{
+    // self-pipe to interrupt poll() on interest changes:
+    int fds[2];
+    if(::pipe(fds) < 0) {
+        throw std::runtime_error("__open__(loop_t& loop): The pipe() function failed:");
+    }
+
+    for(const auto fd : fds) {
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+
+    loop.wake_read = fds[0];
+    loop.wake_write = fds[1];
+}
+
+void srfc_reactor::__close__(loop_t& loop)
+{
+    ::close(loop.wake_read);
+    ::close(loop.wake_write);
+}
+
+void srfc_reactor::__wake__(loop_t& loop)
+{
+    const char one = 1;
+    while(::write(loop.wake_write, &one, sizeof(one)) < 0 && errno == EINTR);
+}
+
+void srfc_reactor::__poll__(loop_t& loop, std::vector<ready_t>& ready)
+{
+    // the poll set is rebuilt on each call:
+    std::vector<struct pollfd> fds;
+    std::vector<token_t> tokens;
+    {
+        std::lock_guard<std::mutex> lg(loop.mutex);
+        fds.reserve(loop.entries.size() + 1);
+        tokens.reserve(loop.entries.size());
+
+        fds.push_back({loop.wake_read, POLLIN, 0});
+        for(const auto& p : loop.entries) {
+            const auto events = (p.second->read ? POLLIN : 0) | (p.second->write ? POLLOUT : 0);
+            fds.push_back({p.second->fd, static_cast<short>(events), 0});
+            tokens.push_back(p.first);
+        }
+    }
+
+    if(::poll(fds.data(), fds.size(), -1) < 0) {
+        if(errno == EINTR) {
+            return;
+        }
+        throw std::runtime_error("__poll__(loop_t& loop, std::vector<ready_t>& ready): The poll() function failed:");
+    }
+
+    if(fds[0].revents != 0) {
+        char buf[64];
+        while(::read(loop.wake_read, buf, sizeof(buf)) > 0);
+    }
+
+    for(std::size_t i = 1; i < fds.size(); ++i) {
+        std::uint32_t res = 0;
+        if(fds[i].revents & POLLIN) {
+            res |= io_events::readable;
+        }
+        if(fds[i].revents & POLLOUT) {
+            res |= io_events::writable;
+        }
+        if(fds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+            res |= io_events::closed | io_events::readable;
+        }
+        if(res != 0) {
+            ready.push_back({tokens[i - 1], res});
+        }
+    }
+}
+
+void srfc_reactor::__watch__(loop_t& loop, entry& e, bool added)
+{
+    // the loop rebuilds the poll set:
+    __wake__(loop);
+}
+
+void srfc_reactor::__unwatch__(loop_t& loop, const std::shared_ptr<entry>& e)
+{
+    __wake__(loop);
+}
+
+void srfc_reactor::__send__(loop_t& loop, entry& e, const const_buffer* bufs, std::size_t count,
+                            std::shared_ptr<const void> keepAlive)
+{
+    throw std::logic_error("__send__(...): the backend doesn't complete the I/O");
+}
+
+void srfc_reactor::__finish__(loop_t& loop, const ready_t& r, bool delivered)
+{
+    // the poll() backend completes nothing
+}
+
+#endif
+
+void srfc_reactor::__pin__(loop_t& loop, std::size_t core)
+{
+    // best effort: the loop keeps running unpinned if the core is not available
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    ::pthread_setaffinity_np(loop.thread.native_handle(), sizeof(set), &set);
+#endif
+}
+
+} // namespace net
+
+#endif
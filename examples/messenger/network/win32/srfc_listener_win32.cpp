@@ -21,10 +21,8 @@
 namespace net
 {
 
-void srfc_listener::__bind__(unsigned int port, std::string interf)
+srfc_listener::socket_t srfc_listener::__bind__(unsigned int port, std::string interf)
 {
-    // sets socket_t socket_fd
-    // sets std::atomic_bool binded;
 
     WSADATA wsaData;
 
@@ -47,6 +45,7 @@ void srfc_listener::__bind__(unsigned int port, std::string interf)
     if (::setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR | SO_BROADCAST, 
         reinterpret_cast<char*>(&opt), sizeof(opt)) == SOCKET_ERROR) 
     {
+        ::closesocket(server_fd);
         throw std::runtime_error("__bind__(unsigned int port, std::string address): The setsockopt() function failed:");  
     }
 
@@ -58,45 +57,70 @@ void srfc_listener::__bind__(unsigned int port, std::string interf)
 
     // Forcefully attaching socket to the port
     if (::bind(server_fd, (struct sockaddr*)&address, sizeof(address)) == SOCKET_ERROR) {
+        ::closesocket(server_fd);
         throw std::runtime_error("__bind__(unsigned int port, std::string address): The bind() function failed:");  
     }
 
     if (::listen(server_fd, backlog) == SOCKET_ERROR) {
+        ::closesocket(server_fd);
         throw std::runtime_error("__bind__(unsigned int port, std::string address): The listen() function failed:");  
     }
 
-    this->socket_fd = server_fd;
-    this->binded.store(true);
+    return server_fd;
 }
 
-srfc_listener::socket_t srfc_listener::__accept__()
+void srfc_listener::__set_nonblocking__(socket_t fd)
+{
+    u_long mode = 1;
+    if(::ioctlsocket(fd, FIONBIO, &mode) == SOCKET_ERROR) {
+        throw std::runtime_error("__set_nonblocking__(): The ioctlsocket() function failed:");
+    }
+}
+
+srfc_listener::socket_t srfc_listener::__accept__(socket_t fd)
 {
     int new_socket = 0;
     struct sockaddr_in address = {0};
     int addrlen = sizeof(address);
 
-    if((new_socket = 
-        ::accept(this->socket_fd, (struct sockaddr*)&address, (socklen_t*)&addrlen)) == INVALID_SOCKET) 
+    while((new_socket = 
+        ::accept(fd, (struct sockaddr*)&address, (socklen_t*)&addrlen)) == INVALID_SOCKET) 
     {
-        throw std::runtime_error("__accept__(): The accept() function failed:");  
+        const auto error = ::WSAGetLastError();
+
+        // no pending connections on the non-blocking socket:
+        if(error == WSAEWOULDBLOCK) {
+            return -1;
+        }
+        // the connection was reset while waiting in the backlog:
+        if(error != WSAECONNRESET) {
+            throw std::runtime_error("__accept__(): The accept() function failed:");  
+        }
     }
 
+    // accepted sockets inherit the non-blocking mode of the listening socket (set again by srfc_connection)
     return new_socket;
 }
 
-void srfc_listener::__shutdown__()
+void srfc_listener::__shutdown__(socket_t fd)
 {
-    if(::shutdown(this->socket_fd, SD_BOTH) == SOCKET_ERROR) {
+    if(::shutdown(fd, SD_BOTH) == SOCKET_ERROR) {
         throw std::runtime_error("__shutdown__(): The shutdown() function failed:");
     }
 }
 
-void srfc_listener::__close__()
+void srfc_listener::__close__(socket_t fd)
 {
-    if(::closesocket(this->socket_fd) == SOCKET_ERROR ) {
+    if(::closesocket(fd) == SOCKET_ERROR ) {
         throw std::runtime_error("__close__(): The closesocket() function failed:"); 
     }
 }
+
+bool srfc_listener::__balances_reuseport__()
+{
+    // SO_REUSEADDR doesn't spread connections between the sockets bound to one port:
+    return false;
+}
 } // namespace net
 
 #endif
\ No newline at end of file
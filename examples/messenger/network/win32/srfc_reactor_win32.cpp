@@ -0,0 +1,147 @@
+// Compile only for Windows-like systems:
+#if defined(_WIN32) || defined(_WIN64) || defined(__CYGWIN__)
+
+#undef UNICODE
+#define WIN32_LEAN_AND_MEAN
+
+
+#include <winsock2.h>
+#include <windows.h>
+#include <ws2tcpip.h>
+
+// Need to link with Ws2_32.lib
+#pragma comment (lib, "Ws2_32.lib")
+
+#include <vector>
+#include <stdexcept>
+
+#include "../includes/srfc_reactor.hpp"
+
+namespace net
+{
+
+/*-----------------------------------------------------*/
+/*                 WSAPoll backend:                    */
+/*-----------------------------------------------------*/
+
+void srfc_reactor::__open__(loop_t& loop)
+{
+    WSADATA wsaData;
+    if (::WSAStartup(MAKEWORD(2,2), &wsaData) != 0) {
+        throw std::runtime_error("__open__(loop_t& loop): WSAStartup error");
+    }
+
+    // WSAPoll can't wait on pipes or events. A loopback UDP socket connected to itself
+    // is used to interrupt it on interest changes:
+    auto sock = static_cast<socket_t>(::socket(AF_INET, SOCK_DGRAM, 0));
+    if (sock == static_cast<socket_t>(INVALID_SOCKET)) {
+        throw std::runtime_error("__open__(loop_t& loop): The socket() function failed:");
+    }
+
+    struct sockaddr_in addr = {};
+    int addrlen = sizeof(addr);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = ::htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+
+    u_long mode = 1;
+    if (::bind(sock, (struct sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR ||
+        ::getsockname(sock, (struct sockaddr*)&addr, &addrlen) == SOCKET_ERROR ||
+        ::connect(sock, (struct sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR ||
+        ::ioctlsocket(sock, FIONBIO, &mode) == SOCKET_ERROR)
+    {
+        ::closesocket(sock);
+        throw std::runtime_error("__open__(loop_t& loop): wake-up socket creation failed");
+    }
+
+    loop.wake_read = loop.wake_write = sock;
+}
+
+void srfc_reactor::__close__(loop_t& loop)
+{
+    ::closesocket(loop.wake_read);
+}
+
+void srfc_reactor::__wake__(loop_t& loop)
+{
+    const char one = 1;
+    ::send(loop.wake_write, &one, sizeof(one), 0);
+}
+
+void srfc_reactor::__poll__(loop_t& loop, std::vector<ready_t>& ready)
+{
+    // the poll set is rebuilt on each call:
+    std::vector<WSAPOLLFD> fds;
+    std::vector<token_t> tokens;
+    {
+        std::lock_guard<std::mutex> lg(loop.mutex);
+        fds.reserve(loop.entries.size() + 1);
+        tokens.reserve(loop.entries.size());
+
+        fds.push_back({static_cast<SOCKET>(loop.wake_read), POLLRDNORM, 0});
+        for(const auto& p : loop.entries) {
+            const SHORT events = (p.second->read ? POLLRDNORM : 0) | (p.second->write ? POLLWRNORM : 0);
+            fds.push_back({static_cast<SOCKET>(p.second->fd), events, 0});
+            tokens.push_back(p.first);
+        }
+    }
+
+    if(::WSAPoll(fds.data(), static_cast<ULONG>(fds.size()), -1) == SOCKET_ERROR) {
+        throw std::runtime_error("__poll__(loop_t& loop, std::vector<ready_t>& ready): The WSAPoll() function failed:");
+    }
+
+    if(fds[0].revents != 0) {
+        char buf[64];
+        while(::recv(loop.wake_read, buf, sizeof(buf), 0) > 0);
+    }
+
+    for(std::size_t i = 1; i < fds.size(); ++i) {
+        std::uint32_t res = 0;
+        if(fds[i].revents & POLLRDNORM) {
+            res |= io_events::readable;
+        }
+        if(fds[i].revents & POLLWRNORM) {
+            res |= io_events::writable;
+        }
+        if(fds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+            res |= io_events::closed | io_events::readable;
+        }
+        if(res != 0) {
+            ready.push_back({tokens[i - 1], res});
+        }
+    }
+}
+
+void srfc_reactor::__watch__(loop_t& loop, entry& e, bool added)
+{
+    // the loop rebuilds the poll set:
+    __wake__(loop);
+}
+
+void srfc_reactor::__unwatch__(loop_t& loop, const std::shared_ptr<entry>& e)
+{
+    __wake__(loop);
+}
+
+void srfc_reactor::__send__(loop_t& loop, entry& e, const const_buffer* bufs, std::size_t count,
+                            std::shared_ptr<const void> keepAlive)
+{
+    throw std::logic_error("__send__(...): the backend doesn't complete the I/O");
+}
+
+void srfc_reactor::__finish__(loop_t& loop, const ready_t& r, bool delivered)
+{
+    // the WSAPoll backend completes nothing
+}
+
+void srfc_reactor::__pin__(loop_t& loop, std::size_t core)
+{
+    // best effort. The mask covers the first 64 cores (the processor group of the process):
+    if(core < 64) {
+        ::SetThreadAffinityMask(loop.thread.native_handle(), DWORD_PTR(1) << core);
+    }
+}
+
+} // namespace net
+
+#endif
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <string>
+#include <thread>
 
 #include "network/includes/srfc_listener.hpp"
 #include "network/includes/utilities/net_utils.hpp"
@@ -37,7 +38,7 @@ srfc_connection::status_t print_rpc (
     return status_codes::ok;
 }
 
-void on_connection_callback(srfc_connection client) {
+void run_console(srfc_connection client) {
     client.invoke_deferred();
     while (true) {
         // get user input
@@ -53,6 +54,11 @@ void on_connection_callback(srfc_connection client) {
     }
 }
 
+void on_connection_callback(srfc_connection client) {
+    // the callback should return quickly. Run the console in a separate thread:
+    std::thread(run_console, std::move(client)).detach();
+}
+
 int main() 
 {
     // create client 
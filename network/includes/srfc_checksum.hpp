@@ -0,0 +1,33 @@
+#ifndef SRFC_CHECKSUM_HPP
+#define SRFC_CHECKSUM_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "srfc_frame.hpp"
+
+namespace net
+{
+
+// Frame checksums (see frame_checksum).
+// CRC32C (Castagnoli) is computed with the SSE4.2 crc32 instruction where the CPU has it
+// and with the slicing-by-8 tables otherwise. Both give the same values.
+
+// Bit mask of the supported checksums: bit n is set if frame_checksum n is supported
+std::uint8_t    supported_checksums() noexcept;
+
+// Extends crc, the checksum of the preceding data (0 for the first block), with the block.
+// Checksums are computed block by block as the data is produced or received, so no extra pass is needed
+std::uint32_t   crc32c(std::uint32_t crc, const char* data, std::size_t size) noexcept;
+
+// Checksum of two blocks back to back, from their checksums (size2 is the size of the second block).
+// The payload is checksummed as it's produced, and combined with the header serialized after it
+std::uint32_t   crc32c_combine(std::uint32_t crc1, std::uint32_t crc2, std::size_t size2) noexcept;
+
+// Copies the block and extends crc with it. The data is checksummed piece by piece right after
+// it's copied, while it's still in the cache
+std::uint32_t   copy_crc32c(std::uint32_t crc, char* dst, const char* src, std::size_t size) noexcept;
+
+} // namespace net
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef SRFC_CODEC_HPP
+#define SRFC_CODEC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+#include "srfc_frame.hpp"
+
+namespace net
+{
+
+// Payload compression (see payload_codec). A compressed payload is:
+//  | uncompressed size (u64, little-endian) | compressed data |
+// The built-in lz77 codec uses the LZ4 block layout (literal runs and back-references of up to 64 KB)
+// and favours speed over ratio. LZ4 and zstd are compiled in with -DSRFC_WITH_LZ4 / -DSRFC_WITH_ZSTD
+// (and linked with -llz4 / -lzstd).
+
+// Payloads smaller than that aren't compressed:
+constexpr std::size_t min_compressed_payload = 512;
+
+// Larger ratios are rejected, so a small message can't make the receiver allocate an arbitrary amount of memory:
+constexpr std::size_t max_compression_ratio = 1024;
+
+// Bit mask of the compiled-in codecs: bit n is set if payload_codec n is supported
+std::uint8_t    supported_codecs() noexcept;
+bool            is_supported(payload_codec codec) noexcept;
+
+// Compresses the payload into a new block. Returns nullptr if the payload should be sent as is:
+// the codec isn't compiled in, the payload is smaller than min_compressed_payload or doesn't shrink
+// (already compressed data is detected on a sample, so it costs little)
+std::shared_ptr<char> compress_payload(payload_codec codec, const char* data, std::size_t size, std::size_t* pSize);
+
+// Restores the payload compressed by compress_payload().
+// Throws std::runtime_error if the payload is corrupted, would be larger than maxSize or the codec isn't compiled in
+// (the size is checked before the block is allocated)
+std::shared_ptr<char> decompress_payload(payload_codec codec, const char* data, std::size_t size, std::size_t* pSize,
+                                         std::size_t maxSize = std::numeric_limits<std::size_t>::max());
+
+// Size of the payload restored by decompress_payload(), read from the prefix without decompressing it.
+// Throws std::runtime_error if the payload is truncated
+std::size_t decompressed_size(const char* data, std::size_t size);
+
+} // namespace net
+
+#endif
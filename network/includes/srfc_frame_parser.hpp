@@ -0,0 +1,91 @@
+#ifndef SRFC_FRAME_PARSER_HPP
+#define SRFC_FRAME_PARSER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+#include "srfc_frame.hpp"
+#include "srfc_message_view.hpp"
+
+namespace net
+{
+
+// Result of the frame parsing:
+enum class parse_status : std::uint8_t
+{
+    ok = 0,
+    incomplete,         // more bytes are needed
+    invalid_preamble,   // SRFCv1 preamble is not a number
+    invalid_version,    // unknown protocol version or SRFCv2 magic
+    invalid_type,       // unknown message type
+    invalid_structure,  // wrong header lines order, names or sizes
+    invalid_number,     // numeric field is not a number
+    out_of_bounds,      // field crosses the frame boundary
+    invalid_checksum,   // the checksum trailer doesn't match the frame
+    frame_too_large     // the frame exceeds the max frame size. It can't be skipped
+};
+
+const char* to_string(parse_status status) noexcept;
+
+// Incremental single-pass SRFC frame parser.
+// Validates, classifies and decodes a frame (SRFCv1 or SRFCv2) in one walk over its bytes.
+// Ill-formed frames are reported with parse_status codes; no exceptions are used.
+//
+// Usage: call parse() each time more bytes are available. Once the preamble/header is
+// received, the frame size is cached, so the prefix is not parsed again on the next calls.
+// The checksum of a checksummed frame is extended with the bytes received since the previous call,
+// while they're still in the cache, and checked against the trailer once the frame is complete.
+// Call reset() after the frame is consumed.
+class srfc_frame_parser
+{
+public:
+    using buffer_t = srfc_message_view::buffer_t;
+
+    // data should point to the beginning of the frame inside of the refcounted block.
+    // Returns:
+    //  - parse_status::ok if the entire frame is available and valid. view is set;
+    //  - parse_status::incomplete if more bytes are needed (see needed());
+    //  - error status otherwise. If frame_size() != 0 the ill-formed frame can be skipped.
+    parse_status parse(const buffer_t& block, const char* data, std::size_t available, srfc_message_view& view);
+
+    // Parses the preamble (SRFCv1) or header (SRFCv2) only:
+    parse_status parse_prefix(const char* data, std::size_t available) noexcept;
+
+    // Size of the current frame. 0 if the prefix is not yet parsed
+    std::size_t frame_size() const noexcept;
+
+    // Amount of bytes needed to make progress (prefix or the entire frame)
+    std::size_t needed() const noexcept;
+
+    wire_format format() const noexcept;
+    void        reset() noexcept;
+
+    // Frames larger than that are rejected as soon as their preamble/header is parsed,
+    // before their bytes are buffered. Unlimited by default. reset() keeps the limit
+    void        set_max_frame_size(std::size_t bytes) noexcept;
+    std::size_t get_max_frame_size() const noexcept;
+
+private:
+    parse_status parse_v1(srfc_message_view& view) const;
+    parse_status parse_v2(srfc_message_view& view) const;
+
+    // Finds out whether the frame has the checksum trailer (SRFCv1 frames tell it in the header lines).
+    // Returns false if more bytes are needed
+    bool         detect_checksum(const char* data, std::size_t available) noexcept;
+
+    wire_format fmt = wire_format::srfc_v1;
+    std::size_t size = 0;
+    std::size_t max_size = std::numeric_limits<std::size_t>::max();
+    srfc_v2_header header;  // valid for SRFCv2 frames once the prefix is parsed
+
+    bool checksum_known = false;
+    frame_checksum checksum = frame_checksum::none;
+    std::uint32_t crc = 0;
+    std::size_t checked = 0;    // bytes of the frame covered by crc
+}; // class srfc_frame_parser
+
+} // namespace net
+
+#endif
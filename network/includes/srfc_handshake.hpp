@@ -0,0 +1,66 @@
+#ifndef SRFC_HANDSHAKE_HPP
+#define SRFC_HANDSHAKE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "srfc_frame.hpp"
+#include "srfc_request.hpp"
+#include "srfc_message_view.hpp"
+
+namespace net
+{
+
+// Handshake (see srfc_connection): on connection both sides send the hello request announcing what they support,
+// and the peer answers it. The hello is always sent in SRFCv1 with high priority, so every peer understands it;
+// older peers answer it with status_codes::unknown_method and are treated as legacy_capabilities().
+// Each capability is a parameter of the hello. Unknown parameters are ignored, and the missing ones get
+// the legacy values, so new capabilities are added without a flag day.
+// The names of the methods are the payload of the hello: '\0'-separated, in the order of their ids.
+constexpr const char* hello_method = "__SRFC_HELLO__";
+
+// Frames and header lines added to SRFCv1 after the peers that don't handshake.
+// Bit flags of srfc_capabilities::features; they're sent only to the peers announcing them:
+enum class srfc_feature : std::uint8_t
+{
+    streams = 0x1,      // chunk and credit frames (responses streamed in chunks)
+    priority = 0x2,     // "PRIO: <n>" line of the SRFCv1 requests
+    cancel = 0x4,       // cancel frames
+    batch = 0x8         // batch frames
+};
+
+constexpr std::size_t default_max_frame_size = 64 * 1024 * 1024;   // 64MB
+constexpr std::size_t min_max_frame_size = 128 * 1024;              // a chunk and its header always fit
+
+struct srfc_capabilities
+{
+    std::uint8_t wire_formats = 0;      // bit n is set if wire_format n is accepted
+    std::uint8_t codecs = 0;            // bit n is set if payload_codec n is accepted
+    std::uint8_t checksums = 0;         // bit mask of the accepted frame checksums
+    std::size_t max_frame_size = 0;     // largest frame accepted (at least min_max_frame_size)
+    std::size_t stream_window = 0;      // bytes of a streamed response the sender may have in flight
+    std::uint8_t features = 0;          // bit mask of the accepted srfc_feature
+    std::vector<std::string> methods;   // method names by id (empty for the ids of removed methods)
+};
+
+// The method names aren't announced if they take more than that (the hello must fit into min_max_frame_size):
+constexpr std::size_t max_hello_methods_size = 64 * 1024;
+
+// Capabilities of this build with the given limits:
+srfc_capabilities   local_capabilities(std::size_t maxFrameSize, std::size_t streamWindow) noexcept;
+
+// Capabilities of the peers which don't handshake (SRFCv1 only, no codecs, no features, no limits):
+srfc_capabilities   legacy_capabilities() noexcept;
+
+bool    accepts(const srfc_capabilities& caps, wire_format fmt) noexcept;
+bool    accepts(const srfc_capabilities& caps, srfc_feature feature) noexcept;
+
+// Hello request carrying the capabilities, and the capabilities read from the hello of the peer:
+srfc_request        make_hello(const srfc_capabilities& caps);
+srfc_capabilities   read_hello(const srfc_message_view& hello) noexcept;
+
+} // namespace net
+
+#endif
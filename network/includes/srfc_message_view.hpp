@@ -0,0 +1,101 @@
+#ifndef SRFC_MESSAGE_VIEW_HPP
+#define SRFC_MESSAGE_VIEW_HPP
+
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <memory>
+#include <atomic>
+
+#include "srfc_frame.hpp"
+#include "srfc_request.hpp"
+#include "srfc_response.hpp"
+
+namespace net
+{
+
+class srfc_frame_parser;
+class srfc_connection;
+
+// Tells the method handler that its request was cancelled by the peer (or that the connection is closed),
+// so the response isn't needed anymore. Default-constructed tokens are never cancelled
+class srfc_cancellation_token
+{
+public:
+    srfc_cancellation_token() = default;
+    explicit srfc_cancellation_token(std::shared_ptr<const std::atomic_bool> flag) noexcept;
+
+    bool is_cancelled() const noexcept;
+
+private:
+    std::shared_ptr<const std::atomic_bool> flag;
+}; // class srfc_cancellation_token
+
+// Read-only view of a received SRFC message (request or response).
+// The method, parameters and payload point into the refcounted receive buffer,
+// which is kept alive while any view (or payload obtained from it) exists.
+class srfc_message_view
+{
+public:
+    using id_t = srfc_request::id_t;
+    using status_t = status_codes::status_t;
+    using payload_t = srfc_request::payload_t;
+    using buffer_t = std::shared_ptr<char>;
+    using param_t = std::pair<std::string_view, std::string_view>;
+    using params_t = std::vector<param_t>;
+
+    // Default constructor & parameterized constructors:
+    // s should point to the message of size sSize inside of the buffer buf.
+    // Throws std::logic_error if the message is ill-formed (use srfc_frame_parser to avoid exceptions)
+    srfc_message_view() = default;
+    srfc_message_view(buffer_t buf, const char* s, std::size_t sSize);
+
+    // Getters:
+    wire_format         getWireFormat() const noexcept;
+    frame_type          getType() const noexcept;
+    id_t                getRequestId() const noexcept;
+    status_t            getStatusCode() const noexcept;
+    frame_priority      getPriority() const noexcept;
+    payload_codec       getPayloadCodec() const noexcept;   // none once srfc_connection has decompressed the payload
+    std::string_view    getMethod() const noexcept;
+    std::uint32_t       getMethodId() const noexcept;       // no_method_id if the request names the method
+    const params_t&     getParams() const noexcept;
+    const char*         getPayloadData() const noexcept;
+    std::size_t         getPayloadSize() const noexcept;
+    std::size_t         getFrameSize() const noexcept;
+
+    // Throws std::out_of_range if no parameter found
+    std::string_view    getParam(std::string_view paramName) const;
+
+    // Returns the payload sharing the ownership of the receive buffer (no copy is made)
+    payload_t           getPayload(std::size_t* pSize = nullptr) const noexcept;
+
+    // Cancellation of the received request. Set by srfc_connection for the requests passed to the methods
+    srfc_cancellation_token getCancellationToken() const noexcept;
+
+private:
+    friend class srfc_frame_parser;
+    friend class srfc_connection;
+
+    buffer_t buffer;
+    const char* frame = nullptr;
+    std::size_t frame_size = 0;
+
+    wire_format format = wire_format::srfc_v1;
+    frame_type type = frame_type::request;
+    id_t request_id = 0;
+    status_t status_code = 0;
+    frame_priority priority = frame_priority::normal;
+    payload_codec codec = payload_codec::none;
+    std::string_view method_name;
+    std::uint32_t method_id = no_method_id;
+    std::shared_ptr<const void> method;     // the method resolved by srfc_connection (srfc_method_table::method)
+    params_t parameters;
+    const char* payload_data = nullptr;
+    std::size_t payload_size = 0;
+    std::shared_ptr<std::atomic_bool> cancelled;
+}; // class srfc_message_view
+
+} // namespace net
+
+#endif
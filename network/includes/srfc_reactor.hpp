@@ -0,0 +1,189 @@
+#ifndef SRFC_REACTOR_HPP
+#define SRFC_REACTOR_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+
+#include <mutex>
+#include <thread>
+#include <atomic>
+
+namespace net
+{
+
+struct const_buffer;    // see srfc_frame.hpp
+
+// I/O readiness events passed to the handlers:
+namespace io_events
+{
+    constexpr std::uint32_t readable = 1;
+    constexpr std::uint32_t writable = 2;
+    constexpr std::uint32_t closed   = 4;   // hang-up or error. The next read/write reports it
+} // namespace io_events
+
+// Readiness reactor multiplexing the sockets of all connections and listeners
+// on a small fixed set of I/O threads (loops).
+// A socket is owned by one loop for its whole registration and its handler is always invoked
+// on that loop's thread, so the handler of one socket never runs concurrently with itself.
+// Readiness is level-triggered: a handler doesn't have to drain the socket.
+//
+// Platform-dependent backends: io_uring or epoll (Linux), poll() (other UNIX-like systems), WSAPoll (Windows).
+//
+// The io_uring backend completes the I/O itself (see completes_io()). The streams and the listening sockets
+// are registered with add_stream() / add_acceptor(): the kernel accepts and receives with multishot requests
+// (one request keeps producing completions), the received data lands in the buffers provided by the loop,
+// and send() submits the gather list. The sockets registered with add() are polled for readiness.
+// The requests, the interest changes and the wait take a single io_uring_enter() per iteration.
+// Kernels without the provided buffer rings (5.19) fall back to epoll, where the handlers do the I/O
+// (single-shot requests are used where the multishot ones are missing, 5.19 - 6.0).
+class srfc_reactor
+{
+public:
+    // For WinAPI: see srfc_connection::socket_t
+    using socket_t = int;
+    using token_t = std::uint64_t;
+    using handler_t = std::function<void(std::uint32_t events)>;
+
+    // Completions (see completes_io()):
+    // receive_handler_t gets the received bytes (valid until it returns). Size 0 tells the stream is closed or broken.
+    // send_handler_t gets the number of sent bytes (maybe fewer than queued), or a negative error code.
+    // accept_handler_t gets the accepted non-blocking socket, and owns it
+    using receive_handler_t = std::function<void(const char* data, std::size_t size)>;
+    using send_handler_t = std::function<void(std::ptrdiff_t sent)>;
+    using accept_handler_t = std::function<void(socket_t fd)>;
+
+    static constexpr std::size_t any_loop = static_cast<std::size_t>(-1);
+
+    // Make non-copyable & non-movable:
+    srfc_reactor(const srfc_reactor& other) = delete;
+    srfc_reactor& operator=(const srfc_reactor& other) = delete;
+
+    // Parameterized constructor & dtor:
+    // threads == 0 selects half of the hardware threads (at least 1).
+    // useIoUring == false forces epoll instead of io_uring on Linux (ignored on other systems).
+    // pinThreads binds the thread of the loop i to the core i (modulo the number of cores, see pin_threads())
+    explicit srfc_reactor(std::size_t threads = 0, bool useIoUring = true, bool pinThreads = false);
+    ~srfc_reactor();
+
+    // The reactor shared by all connections and listeners.
+    // configure_shared() throws std::logic_error if the shared reactor is already created.
+    // The sharded srfc_listener pins the threads of the shared reactor (see srfc_listener::set_shards())
+    static srfc_reactor& shared();
+    static void          configure_shared(std::size_t threads, bool useIoUring = true, bool pinThreads = false);
+
+    // Binds the thread of the loop i to the core i (modulo the number of cores), so the sockets of a loop
+    // stay in the caches of one core. Best effort; the threads keep running unpinned where it fails.
+    // Does nothing if the threads are already pinned
+    void        pin_threads();
+    bool        pins_threads() const noexcept;
+
+    // Registers the socket on the loop (or on the least loaded one) and returns its token (never 0).
+    // The handler is called on readability (and writability, if enabled with want_write()).
+    // want_read(token, false) stops watching readability (e.g. to push back on the peer) until it's enabled again;
+    // errors and hang-ups are still reported where the backend allows it
+    token_t     add(socket_t fd, handler_t handler, std::size_t loop = any_loop);
+    void        want_write(token_t token, bool enable);
+    void        want_read(token_t token, bool enable);
+
+    // Completion-based registrations (only if completes_io(), throw std::logic_error otherwise):
+    // add_stream() receives until want_read(token, false) and calls the handler with io_events::writable when
+    // a send may be submitted: once want_write(token, true) is set and no send is in flight, and after each
+    // send completes while the writes are still wanted. The hang-up comes as an empty receive.
+    // add_acceptor() accepts until want_read(token, false). The completions made before the requests
+    // are cancelled are still passed to the handlers.
+    // send() submits the gather list (at most one send in flight per socket). The buffers must stay valid
+    // until the send completes: keepAlive is held until then, even if the socket is removed meanwhile.
+    // Returns false if the socket is not registered
+    bool        completes_io() const noexcept;
+    token_t     add_stream(socket_t fd, handler_t handler, receive_handler_t onReceive, send_handler_t onSent,
+                           std::size_t loop = any_loop);
+    token_t     add_acceptor(socket_t fd, accept_handler_t onAccept, std::size_t loop = any_loop);
+    bool        send(token_t token, const const_buffer* bufs, std::size_t count, std::shared_ptr<const void> keepAlive);
+
+    // Unregisters the socket (it is not closed). When remove() returns, the handler is not running
+    // and won't be called again, unless remove() is called from a handler of the same loop.
+    // The requests in flight are cancelled
+    void        remove(token_t token);
+
+    std::size_t size() const noexcept;                  // number of loops
+    std::size_t loop_of(token_t token) const noexcept;
+    bool        in_loop(std::size_t loop) const;        // the caller is the loop thread
+    bool        uses_io_uring() const noexcept;         // the backend is io_uring
+
+private:
+    struct entry
+    {
+        socket_t fd;
+        token_t token;
+        handler_t handler;
+        receive_handler_t on_receive;       // empty unless added with add_stream()
+        send_handler_t on_sent;
+        accept_handler_t on_accept;         // empty unless added with add_acceptor()
+        bool read = true;
+        bool write = false;
+        bool read_polled = false;           // io_uring: a readability poll (or the receive / accept) is in flight
+        bool write_polled = false;          // io_uring: a writability poll (or the send) is in flight
+        bool cancelling = false;            // io_uring: the receive / accept in flight is being cancelled
+        std::shared_ptr<void> send_state;   // io_uring: the request of the send in flight and what it holds
+    };
+
+    enum class completion : std::uint8_t { none, received, sent, accepted };
+
+    struct ready_t
+    {
+        token_t token;
+        std::uint32_t events;               // readiness (completion::none)
+        completion kind = completion::none;
+        std::int64_t result = 0;            // received or sent bytes, accepted socket, or a negative error code
+        const char* data = nullptr;         // received bytes, in a buffer of the loop
+        std::uint16_t buffer = 0;           // the buffer to give back once the handler returns
+    };
+
+    struct io_ring;                         // io_uring instance (Linux only)
+
+    struct loop_t
+    {
+        // platform-dependent poller and wake-up handles:
+        socket_t poller = -1;
+        socket_t wake_read = -1;
+        socket_t wake_write = -1;
+        io_ring* ring = nullptr;            // nullptr if io_uring is not used
+
+        std::mutex mutex;                   // guards entries and interest changes
+        std::mutex dispatch_mutex;          // held while the handlers are running
+        std::unordered_map<token_t, std::shared_ptr<entry>> entries;
+        std::atomic<std::size_t> load{0};   // number of registered sockets
+
+        std::thread thread;
+    };
+
+    void        __run__(loop_t& loop);
+    token_t     register_entry(std::shared_ptr<entry> e, std::size_t loop);
+
+    // Platform-dependent methods:
+    void        __open__(loop_t& loop);                                 // platform-dependent implementation
+    void        __close__(loop_t& loop);                                // platform-dependent implementation
+    void        __wake__(loop_t& loop);                                 // platform-dependent implementation
+    void        __poll__(loop_t& loop, std::vector<ready_t>& ready);    // platform-dependent implementation
+    void        __watch__(loop_t& loop, entry& e, bool added);          // platform-dependent implementation
+    void        __unwatch__(loop_t& loop, const std::shared_ptr<entry>& e);     // platform-dependent implementation
+    void        __send__(loop_t& loop, entry& e, const const_buffer* bufs, std::size_t count,
+                         std::shared_ptr<const void> keepAlive);                // platform-dependent implementation
+    void        __finish__(loop_t& loop, const ready_t& r, bool delivered);    // platform-dependent implementation
+    void        __pin__(loop_t& loop, std::size_t core);                // platform-dependent implementation
+
+    // Fields:
+    std::vector<std::unique_ptr<loop_t>> loops;
+    std::atomic<token_t> next_token{1};
+    std::atomic_bool terminate{false};
+    std::atomic_bool pinned{false};
+    const bool use_io_uring;
+}; // class srfc_reactor
+
+} // namespace net
+
+#endif
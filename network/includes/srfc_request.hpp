@@ -7,9 +7,13 @@
 #include <atomic>
 #include <memory>
 
+#include "srfc_frame.hpp"
+
 namespace net
 {
 
+class srfc_message_view;
+
 class srfc_request 
 {
 public:
@@ -26,6 +30,7 @@ public:
     srfc_request();
     srfc_request(const std::string& methodName);
     srfc_request(serialized_t builtP, std::size_t reqSize);
+    explicit srfc_request(const srfc_message_view& view);  // shares the payload with the view
     
     // Move constructor & move assignment operator:
     srfc_request(srfc_request&& other) noexcept;
@@ -35,16 +40,31 @@ public:
     bool setMethod(const std::string& methodName);
     bool setParams(const params_t& params);
     void setPayload(payload_t p, std::size_t psize);
+    void setPriority(frame_priority p) noexcept;
+    void setPayloadCodec(payload_codec c) noexcept;     // the payload is compressed with the codec
 
     // Getters:
     const std::string& getMethod() const noexcept;
     const params_t& getParams() const noexcept;
     id_t getRequestId() const noexcept;
     payload_t getPayload(std::size_t* pSize = nullptr) const noexcept;
-    std::size_t getHeaderSize() const noexcept;
+    frame_priority getPriority() const noexcept;
+    payload_codec getPayloadCodec() const noexcept;
+    std::size_t getHeaderSize(wire_format fmt = wire_format::srfc_v1, 
+                              frame_checksum checksum = frame_checksum::none,
+                              std::uint32_t methodId = no_method_id) const noexcept;
 
     // Serialization & deserialization:
-    serialized_t serialize(std::size_t* pSize) const;
+    // deserialize() detects the wire format of the message automatically.
+    // The deserialized payload shares the ownership of s (no copy is made).
+    // With the checksum, serialize() appends the checksum trailer (computed as the payload is copied);
+    // serializeHeader() leaves the trailer to the caller, who sends it after the payload.
+    // With the method id (announced by the receiver), the id is written instead of the method name
+    serialized_t serialize(std::size_t* pSize, wire_format fmt = wire_format::srfc_v1,
+                           frame_checksum checksum = frame_checksum::none) const;
+    serialized_t serializeHeader(std::size_t* pSize, wire_format fmt = wire_format::srfc_v1,   // without payload
+                                 frame_checksum checksum = frame_checksum::none,
+                                 std::uint32_t methodId = no_method_id) const;
     void deserialize(serialized_t s, const std::size_t sSize);
     std::string to_string() const;
 
@@ -57,6 +77,9 @@ private:
     bool validMethod(const std::string& methodName);
     bool validParams(const params_t& params);
 
+    void writeV1Header(char*& ptr, std::size_t fullSize, frame_checksum checksum, std::uint32_t methodId) const;
+    void writeV2Header(char*& ptr, frame_checksum checksum, std::uint32_t methodId) const;
+
 protected:
     static constexpr const char* protocol_version = "SRFCv1"; 
     static constexpr const char* type = "REQ";
@@ -68,6 +91,8 @@ protected:
     params_t parameters;
     payload_t payload_ptr = nullptr;
     std::size_t payload_size = 0;
+    frame_priority priority = frame_priority::normal;
+    payload_codec codec = payload_codec::none;
 }; // class srfc_request 
 
 } // namespace net
@@ -4,9 +4,13 @@
 #include <memory>
 #include <string>
 
+#include "srfc_frame.hpp"
+
 namespace net
 {
 
+class srfc_message_view;
+
 class status_codes {
 public:
     using status_t = unsigned long;
@@ -25,6 +29,7 @@ public:
     static const status_t forbidden = 403;
     static const status_t unknown_method = 404;
     static const status_t conflict = 405;
+    static const status_t frame_too_large = 406;     // exceeds the max frame size of the peer
 
     // Method execution errors:
     static const status_t execution_error = 500;
@@ -32,6 +37,8 @@ public:
     static const status_t invalid_arguments = 502;
     static const status_t connection_error = 503;
     static const status_t response_timeout = 504;
+    static const status_t request_cancelled = 505;
+    static const status_t memory_budget_exceeded = 506;    // the message doesn't fit into the memory budget
 };
 
 class srfc_response 
@@ -45,26 +52,43 @@ public:
     // Constructors:
     srfc_response(id_t rid, status_t status = status_codes::ok);
     srfc_response(serialized_t builtP, std::size_t reqSize);
+    explicit srfc_response(const srfc_message_view& view); // shares the payload with the view
 
     // Setters:
     void setRequestId(id_t rid) noexcept;
     void setStatusCode(status_t code) noexcept;
     void setPayload(payload_t p, std::size_t psize);
+    void setPriority(frame_priority p) noexcept;
+    void setPayloadCodec(payload_codec c) noexcept;     // the payload is compressed with the codec
 
     // Getters:
     id_t getRequestId() const noexcept;
     payload_t getPayload(std::size_t* pSize = nullptr) const noexcept;
     status_t getStatusCode() const noexcept;
-    std::size_t getHeaderSize() const noexcept;
+    frame_priority getPriority() const noexcept;
+    payload_codec getPayloadCodec() const noexcept;
+    std::size_t getHeaderSize(wire_format fmt = wire_format::srfc_v1, 
+                              frame_checksum checksum = frame_checksum::none) const noexcept;
 
     // Serialization & deserialization:
-    serialized_t serialize(std::size_t* pSize) const;
+    // deserialize() detects the wire format of the message automatically.
+    // The deserialized payload shares the ownership of s (no copy is made).
+    // With the checksum, serialize() appends the checksum trailer (computed as the payload is copied);
+    // serializeHeader() leaves the trailer to the caller, who sends it after the payload
+    serialized_t serialize(std::size_t* pSize, wire_format fmt = wire_format::srfc_v1,
+                           frame_checksum checksum = frame_checksum::none) const;
+    serialized_t serializeHeader(std::size_t* pSize, wire_format fmt = wire_format::srfc_v1,   // without payload
+                                 frame_checksum checksum = frame_checksum::none) const;
     void deserialize(serialized_t s, const std::size_t sSize);
     std::string to_string() const;
 
     //
     void reset();
 
+private:
+    void writeV1Header(char*& ptr, std::size_t fullSize, frame_checksum checksum) const;
+    void writeV2Header(char*& ptr, frame_checksum checksum) const;
+
 protected:
     static constexpr const char* protocol_version = "SRFCv1"; 
     static constexpr const char* type = "RES";
@@ -73,6 +97,8 @@ protected:
     status_t status_code = 0;
     payload_t payload_ptr = nullptr;
     std::size_t payload_size = 0;
+    frame_priority priority = frame_priority::normal;
+    payload_codec codec = payload_codec::none;
 
 }; // class srfc_response 
 
@@ -1,3 +1,6 @@
+#ifndef FILESYSTEM_UTILS_HPP
+#define FILESYSTEM_UTILS_HPP
+
 #include <experimental/filesystem>
 #include <vector>
 #include <string>
@@ -62,4 +65,6 @@ inline void create_folder(std::string dirname)
         throw std::runtime_error("create_folder(std::string dirname): cant create folder " + dirname + ".");
     }
     
-}
\ No newline at end of file
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,574 @@
+#include "includes/srfc_frame_parser.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <string_view>
+
+#include "includes/srfc_checksum.hpp"
+#include "includes/utilities/byte_order.hpp"
+
+namespace net
+{
+
+// parses the non-empty decimal number without sign and whitespaces
+// returns false if str is not a number or the value is out of range
+static bool parse_decimal(std::string_view str, std::uint64_t* value) noexcept
+{
+    constexpr auto max = std::numeric_limits<std::uint64_t>::max();
+
+    if(str.empty()) {
+        return false;
+    }
+
+    std::uint64_t res = 0;
+    for(const char c : str) {
+        if(c < '0' || c > '9') {
+            return false;
+        }
+
+        const std::uint64_t digit = c - '0';
+        if(res > (max - digit) / 10) {
+            return false;
+        }
+        res = res * 10 + digit;
+    }
+
+    *value = res;
+    return true;
+}
+
+// sets line to chars from p to the first null and moves p to the beginning of the next substring
+// returns false if no null found before rbound
+static bool next_line(const char*& p, const char* const rbound, std::string_view* line) noexcept
+{
+    const auto* endp = static_cast<const char*>(std::memchr(p, 0, rbound - p));
+    if(endp == nullptr) {
+        return false;
+    }
+
+    *line = std::string_view(p, endp - p);
+    p = endp + 1; // set to the begining of the next substring
+
+    return true;
+}
+
+// separates paramName and paramVal of the "<name>: <value>" line
+// returns false if line is ill-formed
+static bool separate_line(std::string_view str, srfc_message_view::param_t* param) noexcept
+{
+    constexpr std::string_view sep = ": ";
+    const auto pos = str.find_first_of(sep);
+
+    if(pos != std::string_view::npos && pos + sep.size() < str.length() && pos > 0) {
+        *param = std::make_pair(str.substr(0, pos), str.substr(pos + sep.size()));
+        return true;
+    }
+
+    return false;
+}
+
+// reads the "<name>: <number>" line and checks the name
+static parse_status read_number_line(const char*& p, const char* const rbound,
+                                     std::string_view name, std::uint64_t* value) noexcept
+{
+    std::string_view line;
+    srfc_message_view::param_t param;
+
+    if(!next_line(p, rbound, &line)) {
+        return parse_status::out_of_bounds;
+    }
+    if(!separate_line(line, &param) || param.first != name) {
+        return parse_status::invalid_structure;
+    }
+    if(!parse_decimal(param.second, value)) {
+        return parse_status::invalid_number;
+    }
+
+    return parse_status::ok;
+}
+
+//
+// Parsing:
+//
+
+parse_status srfc_frame_parser::parse(const buffer_t& block, const char* data, std::size_t available,
+                                      srfc_message_view& view)
+{
+    // parse the preamble (SRFCv1) or header (SRFCv2) once:
+    if(size == 0) {
+        const auto status = parse_prefix(data, available);
+        if(status != parse_status::ok) {
+            return status;
+        }
+    }
+
+    // checksum the bytes received since the previous call (all but the trailer):
+    if(!checksum_known && !detect_checksum(data, available)) {
+        return parse_status::incomplete;
+    }
+    if(checksum != frame_checksum::none && size < frame_prefix_size(fmt) + checksum_trailer_size) {
+        return parse_status::invalid_structure;
+    }
+    if(checksum != frame_checksum::none) {
+        const auto end = std::min(available, size - checksum_trailer_size);
+        if(end > checked) {
+            crc = crc32c(crc, data + checked, end - checked);
+            checked = end;
+        }
+    }
+
+    if(available < size) {
+        return parse_status::incomplete;
+    }
+
+    if(checksum != frame_checksum::none) {
+        const auto* trailer = data + size - checksum_trailer_size;
+        if(load_le_and_shift<std::uint32_t>(trailer) != crc) {
+            return parse_status::invalid_checksum;
+        }
+    }
+
+    srfc_message_view tmp;
+    tmp.buffer = block;
+    tmp.frame = data;
+    tmp.frame_size = size;
+    tmp.format = fmt;
+
+    const auto status = (fmt == wire_format::srfc_v2) ? parse_v2(tmp) : parse_v1(tmp);
+    if(status == parse_status::ok) {
+        view = std::move(tmp);
+    }
+
+    return status;
+}
+
+parse_status srfc_frame_parser::parse_prefix(const char* data, std::size_t available) noexcept
+{
+    if(available < 1) {
+        return parse_status::incomplete;
+    }
+
+    fmt = detect_wire_format(data);
+    if(available < frame_prefix_size(fmt)) {
+        return parse_status::incomplete;
+    }
+
+    /*-----------------------------------------------------*/
+    /*                SRFCv2 header:                       */
+    /*-----------------------------------------------------*/
+    if(fmt == wire_format::srfc_v2) {
+        if(!header.decode(data)) {
+            return parse_status::invalid_version;
+        }
+
+        // the frame size (with the checksum trailer) should fit into std::size_t:
+        constexpr auto max = std::numeric_limits<std::size_t>::max();
+        const std::uint64_t head_size = srfc_v2_header::size + header.method_length + header.params_length;
+        const std::uint64_t trailer = header.checksum() != frame_checksum::none ? checksum_trailer_size : 0;
+        if(header.payload_length > max - head_size - trailer) {
+            return parse_status::invalid_structure;
+        }
+
+        if(header.frame_size() > max_size) {
+            return parse_status::frame_too_large;
+        }
+
+        size = header.frame_size();
+        return parse_status::ok;
+    }
+
+    /*-----------------------------------------------------*/
+    /*                SRFCv1 preamble:                     */
+    /*-----------------------------------------------------*/
+    std::uint64_t value = 0;
+    if(!parse_decimal(std::string_view(data, srfc_v1_preamble_size), &value) ||
+       value <= srfc_v1_preamble_size || value > std::numeric_limits<std::size_t>::max())
+    {
+        return parse_status::invalid_preamble;
+    }
+    if(value > max_size) {
+        return parse_status::frame_too_large;
+    }
+
+    size = static_cast<std::size_t>(value);
+    return parse_status::ok;
+}
+
+bool srfc_frame_parser::detect_checksum(const char* data, std::size_t available) noexcept
+{
+    if(fmt == wire_format::srfc_v2) {
+        checksum = header.checksum();
+    }
+    else {
+        // the optional "CK: <n>" line follows the version, type and request id lines.
+        // Ill-formed lines are reported by parse_v1():
+        const auto complete = available >= size;
+        const auto* const rbound = data + std::min(available, size);
+        const auto* ptr = data + srfc_v1_preamble_size;
+
+        std::string_view line;
+        for(int i = 0; i < 3; ++i) {
+            if(!next_line(ptr, rbound, &line)) {
+                return complete;
+            }
+        }
+        if(!next_line(ptr, rbound, &line)) {
+            return complete;
+        }
+
+        constexpr std::string_view checksum_name = "CK: ";
+        std::uint64_t value = 0;
+        if(line.substr(0, checksum_name.size()) == checksum_name && 
+           parse_decimal(line.substr(checksum_name.size()), &value) &&
+           value == static_cast<std::uint64_t>(frame_checksum::crc32c)) 
+        {
+            checksum = frame_checksum::crc32c;
+        }
+    }
+
+    // unknown checksums are rejected by parse_v1() and parse_v2():
+    if(checksum != frame_checksum::none && checksum != frame_checksum::crc32c) {
+        checksum = frame_checksum::none;
+    }
+
+    checksum_known = true;
+    return true;
+}
+
+parse_status srfc_frame_parser::parse_v1(srfc_message_view& view) const
+{
+    const auto trailer = checksum != frame_checksum::none ? checksum_trailer_size : 0;
+    const auto* const rbound = view.frame + view.frame_size - trailer;
+    const auto* ptr = view.frame + srfc_v1_preamble_size;
+
+    std::string_view line;
+    srfc_message_view::param_t param;
+    std::uint64_t value = 0;
+    parse_status status;
+
+    /*-----------------------------------------------------*/
+    /*            Protocol version:                        */
+    /*-----------------------------------------------------*/
+    if(!next_line(ptr, rbound, &line)) {
+        return parse_status::out_of_bounds;
+    }
+    if(line != "SRFCv1") {
+        return parse_status::invalid_version;
+    }
+
+    /*-----------------------------------------------------*/
+    /*                    Type:                            */
+    /*-----------------------------------------------------*/
+    if(!next_line(ptr, rbound, &line)) {
+        return parse_status::out_of_bounds;
+    }
+    if(!separate_line(line, &param) || param.first != "TYPE") {
+        return parse_status::invalid_structure;
+    }
+
+    if(param.second == "REQ") {
+        view.type = frame_type::request;
+    }
+    else if(param.second == "RES") {
+        view.type = frame_type::response;
+    }
+    else if(param.second == "CHK") {
+        view.type = frame_type::chunk;
+    }
+    else if(param.second == "CRD") {
+        view.type = frame_type::credit;
+    }
+    else if(param.second == "CNL") {
+        view.type = frame_type::cancel;
+    }
+    else if(param.second == "BAT") {
+        view.type = frame_type::batch;
+    }
+    else {
+        return parse_status::invalid_type;
+    }
+
+    /*-----------------------------------------------------*/
+    /*                  Request ID:                        */
+    /*-----------------------------------------------------*/
+    if((status = read_number_line(ptr, rbound, "RI", &value)) != parse_status::ok) {
+        return status;
+    }
+    view.request_id = static_cast<srfc_message_view::id_t>(value);
+
+    /*-----------------------------------------------------*/
+    /*             Checksum (optional):                    */
+    /*-----------------------------------------------------*/
+    // detect_checksum() has read the line, so only its presence is checked here:
+    if(checksum != frame_checksum::none) {
+        if((status = read_number_line(ptr, rbound, "CK", &value)) != parse_status::ok) {
+            return status;
+        }
+    }
+
+    /*-----------------------------------------------------*/
+    /*               Payload Size:                         */
+    /*-----------------------------------------------------*/
+    if((status = read_number_line(ptr, rbound, "PS", &value)) != parse_status::ok) {
+        return status;
+    }
+    if(value > static_cast<std::uint64_t>(rbound - ptr)) {
+        return parse_status::out_of_bounds;
+    }
+    view.payload_size = static_cast<std::size_t>(value);
+
+    const auto* const payload_pointer = rbound - view.payload_size;
+
+    /*-----------------------------------------------------*/
+    /*             Payload codec (optional):               */
+    /*-----------------------------------------------------*/
+    constexpr std::string_view codec_name = "PC: ";
+    const auto* const codec_begin = ptr;
+    if(next_line(ptr, payload_pointer, &line) && line.substr(0, codec_name.size()) == codec_name) {
+        if(!parse_decimal(line.substr(codec_name.size()), &value) || 
+           value > static_cast<std::uint64_t>(payload_codec::zstd)) 
+        {
+            return parse_status::invalid_number;
+        }
+        view.codec = static_cast<payload_codec>(value);
+    }
+    else {
+        ptr = codec_begin;      // it's the next line
+    }
+
+    if(view.type == frame_type::request) {
+        /*-----------------------------------------------------*/
+        /*             Priority (optional):                    */
+        /*-----------------------------------------------------*/
+        constexpr std::string_view prio_name = "PRIO: ";
+        const auto* const line_begin = ptr;
+        if(next_line(ptr, payload_pointer, &line) && line.substr(0, prio_name.size()) == prio_name) {
+            if(!parse_decimal(line.substr(prio_name.size()), &value) || 
+               value > static_cast<std::uint64_t>(frame_priority::bulk)) 
+            {
+                return parse_status::invalid_number;
+            }
+            view.priority = static_cast<frame_priority>(value);
+        }
+        else {
+            ptr = line_begin;   // it's the method line
+        }
+
+        /*-----------------------------------------------------*/
+        /*              Method (or method id):                 */
+        /*-----------------------------------------------------*/
+        if(!next_line(ptr, payload_pointer, &view.method_name)) {
+            return parse_status::out_of_bounds;
+        }
+
+        constexpr std::string_view id_name = "MI: ";
+        if(view.method_name.substr(0, id_name.size()) == id_name) {
+            if(!parse_decimal(view.method_name.substr(id_name.size()), &value) || value >= no_method_id) {
+                return parse_status::invalid_number;
+            }
+            view.method_id = static_cast<std::uint32_t>(value);
+            view.method_name = std::string_view();
+        }
+
+        /*-----------------------------------------------------*/
+        /*                  Parameters:                        */
+        /*-----------------------------------------------------*/
+        while (ptr < payload_pointer) {
+            if(!next_line(ptr, payload_pointer, &line)) {
+                return parse_status::out_of_bounds;
+            }
+            if(!separate_line(line, &param)) {
+                return parse_status::invalid_structure;
+            }
+            view.parameters.push_back(param);
+        }
+    }
+    else if(view.type == frame_type::response) {
+        /*-----------------------------------------------------*/
+        /*                Status Code:                         */
+        /*-----------------------------------------------------*/
+        if((status = read_number_line(ptr, payload_pointer, "STATUS", &value)) != parse_status::ok) {
+            return status;
+        }
+        view.status_code = static_cast<srfc_message_view::status_t>(value);
+    }
+    else if(view.type == frame_type::credit) {
+        /*-----------------------------------------------------*/
+        /*                  Credit:                            */
+        /*-----------------------------------------------------*/
+        if((status = read_number_line(ptr, payload_pointer, "CREDIT", &value)) != parse_status::ok) {
+            return status;
+        }
+        if(view.payload_size != 0 || value > std::numeric_limits<std::uint32_t>::max()) {
+            return parse_status::invalid_structure;
+        }
+        view.status_code = static_cast<srfc_message_view::status_t>(value);
+    }
+    else if(view.type == frame_type::cancel && view.payload_size != 0) {
+        return parse_status::invalid_structure;
+    }
+    // chunks, cancels and batches have no lines after the payload size
+
+    if(ptr != payload_pointer) {
+        return parse_status::invalid_structure;
+    }
+
+    /*-----------------------------------------------------*/
+    /*                  Payload:                           */
+    /*-----------------------------------------------------*/
+    view.payload_data = payload_pointer;
+    return parse_status::ok;
+}
+
+parse_status srfc_frame_parser::parse_v2(srfc_message_view& view) const
+{
+    // header is already decoded by parse_prefix():
+    const auto* ptr = view.frame + srfc_v2_header::size;
+
+    /*-----------------------------------------------------*/
+    /*                    Type:                            */
+    /*-----------------------------------------------------*/
+    if(header.type == static_cast<std::uint8_t>(frame_type::request)) {
+        view.type = frame_type::request;
+    }
+    else if(header.type >= static_cast<std::uint8_t>(frame_type::response) && 
+            header.type <= static_cast<std::uint8_t>(frame_type::batch)) 
+    {
+        view.type = static_cast<frame_type>(header.type);
+        if(header.method_length != 0 || header.param_count != 0 || header.params_length != 0) {
+            return parse_status::invalid_structure;
+        }
+        if((view.type == frame_type::credit || view.type == frame_type::cancel) && header.payload_length != 0) {
+            return parse_status::invalid_structure;
+        }
+    }
+    else {
+        return parse_status::invalid_type;
+    }
+
+    view.request_id = static_cast<srfc_message_view::id_t>(header.request_id);
+    view.status_code = header.status;
+
+    // the status field of the request carries the method id:
+    if(view.type == frame_type::request && (header.flags & method_id_flag)) {
+        if(header.method_length != 0 || header.status == no_method_id) {
+            return parse_status::invalid_structure;
+        }
+        view.method_id = header.status;
+        view.status_code = 0;
+    }
+
+    // unknown priority values are treated as normal:
+    const auto prio = header.flags & priority_flags_mask;
+    if(prio <= static_cast<std::uint16_t>(frame_priority::bulk)) {
+        view.priority = static_cast<frame_priority>(prio);
+    }
+    if(header.checksum() != checksum) {
+        return parse_status::invalid_structure;     // unknown checksum
+    }
+    view.codec = static_cast<payload_codec>((header.flags & codec_flags_mask) >> codec_flags_shift);
+    view.payload_size = static_cast<std::size_t>(header.payload_length);
+
+    /*-----------------------------------------------------*/
+    /*                  Method:                            */
+    /*-----------------------------------------------------*/
+    view.method_name = std::string_view(ptr, header.method_length);
+    ptr += header.method_length;
+
+    /*-----------------------------------------------------*/
+    /*                  Parameters:                        */
+    /*-----------------------------------------------------*/
+    const auto* const params_rbound = ptr + header.params_length;
+    view.parameters.reserve(header.param_count);
+    for(std::size_t i = 0; i < header.param_count; ++i) {
+        if(static_cast<std::size_t>(params_rbound - ptr) < srfc_v2_header::param_prefix_size) {
+            return parse_status::out_of_bounds;
+        }
+
+        const std::size_t name_size = load_le_and_shift<std::uint16_t>(ptr);
+        const std::size_t value_size = load_le_and_shift<std::uint32_t>(ptr);
+        if(static_cast<std::size_t>(params_rbound - ptr) < name_size + value_size) {
+            return parse_status::out_of_bounds;
+        }
+
+        view.parameters.emplace_back(
+            std::string_view(ptr, name_size),
+            std::string_view(ptr + name_size, value_size)
+        );
+        ptr += name_size + value_size;
+    }
+
+    if(ptr != params_rbound) {
+        return parse_status::invalid_structure;
+    }
+
+    /*-----------------------------------------------------*/
+    /*                  Payload:                           */
+    /*-----------------------------------------------------*/
+    view.payload_data = ptr;
+    return parse_status::ok;
+}
+
+//
+// Getters:
+//
+
+std::size_t srfc_frame_parser::frame_size() const noexcept
+{
+    return size;
+}
+
+std::size_t srfc_frame_parser::needed() const noexcept
+{
+    return size != 0 ? size : frame_prefix_size(fmt);
+}
+
+wire_format srfc_frame_parser::format() const noexcept
+{
+    return fmt;
+}
+
+void srfc_frame_parser::set_max_frame_size(std::size_t bytes) noexcept
+{
+    max_size = bytes;
+}
+
+std::size_t srfc_frame_parser::get_max_frame_size() const noexcept
+{
+    return max_size;
+}
+
+void srfc_frame_parser::reset() noexcept
+{
+    fmt = wire_format::srfc_v1;
+    size = 0;
+    checksum_known = false;
+    checksum = frame_checksum::none;
+    crc = 0;
+    checked = 0;
+}
+
+//
+// Other:
+//
+
+const char* to_string(parse_status status) noexcept
+{
+    switch(status) {
+        case parse_status::ok:                  return "Ok";
+        case parse_status::incomplete:          return "Incomplete message";
+        case parse_status::invalid_preamble:    return "Invalid preamble";
+        case parse_status::invalid_version:     return "Invalid protocol version";
+        case parse_status::invalid_type:        return "Invalid type value";
+        case parse_status::invalid_structure:   return "Invalid header structure";
+        case parse_status::invalid_number:      return "Invalid numeric value";
+        case parse_status::out_of_bounds:       return "Invalid serialized message: out of bounds error";
+        case parse_status::invalid_checksum:    return "Checksum mismatch";
+        case parse_status::frame_too_large:     return "The frame exceeds the max frame size";
+    }
+
+    return "Unknown parse status";
+}
+
+} // namespace net
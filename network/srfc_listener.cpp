@@ -1,5 +1,12 @@
 #include "includes/srfc_listener.hpp"
 
+#include <algorithm>
+#include <stdexcept>
+#include <exception>
+#include <utility>
+
+#include "includes/srfc_executor.hpp"
+
 namespace net 
 {
 
@@ -20,36 +27,55 @@ srfc_listener::srfc_listener(srfc_listener&& other)
 
 srfc_listener& srfc_listener::operator=(srfc_listener&& other)
 {
-    if(this->listener_thread.joinable() == true) {
-        throw std::logic_error("operator=(srfc_listener&& other): is not deferred");
+    wait_deferred();
+    other.wait_deferred();
+
+    for(const auto& shard : this->shards) {
+        if(shard.io_token != 0) {
+            throw std::logic_error("operator=(srfc_listener&& other): is not deferred");
+        }
     }
-    if(other.listener_thread.joinable() == true) {
-        throw std::logic_error("operator=(srfc_listener&& other): is not deferred");        
+    for(const auto& shard : other.shards) {
+        if(shard.io_token != 0) {
+            throw std::logic_error("operator=(srfc_listener&& other): is not deferred");        
+        }
     }
 
-    callback_map = std::move(other.callback_map);
-    other.callback_map.clear();
+    methods = std::exchange(other.methods, std::make_shared<srfc_method_registry>());
 
     connection_callback = std::move(other.connection_callback);
     other.connection_callback = [](const auto c){return;}; // do nothing
 
-    socket_fd = other.socket_fd;
-    other.socket_fd = 0;
+    shards = std::move(other.shards);
+    other.shards.clear();
+
+    shard_count = other.shard_count;
+    other.shard_count = 1;
+
+    wire_fmt.store(other.wire_fmt.load());
+    other.wire_fmt.store(wire_format::srfc_v1);
+
+    compression.store(other.compression.load());
+    other.compression.store(payload_codec::none);
+
+    checksum.store(other.checksum.load());
+    other.checksum.store(frame_checksum::none);
+
+    max_frame_size.store(other.max_frame_size.load());
+    other.max_frame_size.store(default_max_frame_size);
+
+    stream_window.store(other.stream_window.load());
+    other.stream_window.store(srfc_connection::stream_window);
+
+    memory_budget.store(other.memory_budget.load());
+    other.memory_budget.store(srfc_connection::default_memory_budget);
 
     listening.store(other.listening.load());
     other.listening.store(false);
 
-    terminate_listener.store(other.terminate_listener.load());
-    other.terminate_listener.store(false);
-
     binded.store(other.binded.load());
     other.binded.store(false);
 
-    idleable.store(other.idleable.load());
-    other.idleable.store(true);
-
-    listener_thread = std::move(other.listener_thread);
-
     return *this;
 }
 
@@ -60,26 +86,127 @@ void srfc_listener::on_connection(connection_callback_t callback)
 
 void srfc_listener::add_method(std::string methodName, callback_t methodCallback)
 {
-    callback_map[methodName] = methodCallback;
+    methods->add(std::move(methodName), std::move(methodCallback));
+}
+
+void srfc_listener::add_method(std::string methodName, view_callback_t methodCallback)
+{
+    methods->add(std::move(methodName), std::move(methodCallback));
+}
+
+void srfc_listener::add_method(std::string methodName, task_callback_t methodCallback)
+{
+    methods->add(std::move(methodName), std::move(methodCallback));
+}
+
+void srfc_listener::add_method(std::string methodName, stream_callback_t methodCallback)
+{
+    methods->add(std::move(methodName), std::move(methodCallback));
 }
 
 bool srfc_listener::remove_method(std::string methodName)
 {
-    // std::unordered_map::erase returns number of elements removed (0 or 1)
-    auto res = callback_map.erase(methodName);
-    return res == 1 ? true : false; 
+    return methods->remove(methodName);
 }
 
 srfc_listener::callback_t 
 srfc_listener::get_method(std::string methodName) const
 {
-    // If no such element exists, an exception of type std::out_of_range is thrown
-    return callback_map.at(methodName);
+    return methods->snapshot()->at(methodName, method_kind::callback).callback;
+}
+
+srfc_listener::view_callback_t 
+srfc_listener::get_view_method(std::string methodName) const
+{
+    return methods->snapshot()->at(methodName, method_kind::view).view_callback;
+}
+
+srfc_listener::task_callback_t 
+srfc_listener::get_task_method(std::string methodName) const
+{
+    return methods->snapshot()->at(methodName, method_kind::task).task_callback;
+}
+
+srfc_listener::stream_callback_t 
+srfc_listener::get_stream_method(std::string methodName) const
+{
+    return methods->snapshot()->at(methodName, method_kind::stream).stream_callback;
 }
 
 bool srfc_listener::has_method(std::string methodName) const
 {
-    return callback_map.find(methodName) != callback_map.end();
+    return methods->snapshot()->find(methodName) != nullptr;
+}
+
+void srfc_listener::set_wire_format(wire_format fmt) noexcept
+{
+    wire_fmt.store(fmt);
+}
+
+wire_format srfc_listener::get_wire_format() const noexcept
+{
+    return wire_fmt.load();
+}
+
+void srfc_listener::set_compression(payload_codec codec) noexcept
+{
+    compression.store(codec);
+}
+
+payload_codec srfc_listener::get_compression() const noexcept
+{
+    return compression.load();
+}
+
+void srfc_listener::set_checksum(frame_checksum checksum) noexcept
+{
+    this->checksum.store(checksum);
+}
+
+frame_checksum srfc_listener::get_checksum() const noexcept
+{
+    return checksum.load();
+}
+
+void srfc_listener::set_max_frame_size(std::size_t bytes) noexcept
+{
+    max_frame_size.store(std::max(bytes, min_max_frame_size));
+}
+
+std::size_t srfc_listener::get_max_frame_size() const noexcept
+{
+    return max_frame_size.load();
+}
+
+void srfc_listener::set_stream_window(std::size_t bytes) noexcept
+{
+    stream_window.store(std::max<std::size_t>(bytes, 1));
+}
+
+std::size_t srfc_listener::get_stream_window() const noexcept
+{
+    return stream_window.load();
+}
+
+void srfc_listener::set_memory_budget(std::size_t bytes) noexcept
+{
+    memory_budget.store(std::max(bytes, min_max_frame_size));
+}
+
+std::size_t srfc_listener::get_memory_budget() const noexcept
+{
+    return memory_budget.load();
+}
+
+void srfc_listener::set_shards(std::size_t count, bool pinLoops) noexcept
+{
+    shard_count = count;
+    pin_loops = pinLoops;
+}
+
+std::size_t srfc_listener::get_shards() const noexcept
+{
+    return shards.size();
 }
 
 void srfc_listener::listen(unsigned int port, std::string interface, bool deferred)
@@ -93,20 +220,43 @@ void srfc_listener::listen(unsigned int port, std::string interface, bool deferr
                                "Call shutdown() beforehand to change the listening address"); 
     }
 
-    __bind__(port, interface);    // sets socket_t socket_fd
-                                // sets std::atomic_bool binded;
+    auto& reactor = srfc_reactor::shared();
 
-    if(!deferred) {
-        listening.store(true);
+    std::size_t count = shard_count == 0 ? reactor.size() : shard_count;
+    if(port == 0 || !__balances_reuseport__()) {
+        count = 1;
+    }
 
-        // listner_thread has not been started yet:
-        if(listener_thread.joinable() == false) {
-            listener_thread = std::thread(&srfc_listener::__listener_thread__, this);
+    // one listening socket per shard. The shards are spread over the reactor loops:
+    try {
+        for(std::size_t i = 0; i < count; ++i) {
+            shard_t shard;
+            shard.socket_fd = __bind__(port, interface);
+            shards.push_back(shard);
+            __set_nonblocking__(shard.socket_fd);
+            shards.back().loop = count == 1 ? srfc_reactor::any_loop : i % reactor.size();
         }
-        // listener is idled:
-        else {
-            listener_cv.notify_one();
+    }
+    catch(...) {
+        for(const auto& shard : shards) {
+            try {
+                __close__(shard.socket_fd);
+            }
+            catch(...) {}
         }
+        shards.clear();
+        throw;
+    }
+    binded.store(true);
+
+    if(shards.size() > 1 && pin_loops) {
+        reactor.pin_threads();
+    }
+
+    if(!deferred) {
+        listening.store(true);
+
+        start_accepting();
     }
 }
 
@@ -121,20 +271,14 @@ void srfc_listener::listen(socket_t bindedSockFd, bool deferred)
                                "Call shutdown() beforehand to change the listening address"); 
     }
 
-    this->socket_fd = bindedSockFd;
+    __set_nonblocking__(bindedSockFd);
+    shards.assign(1, shard_t{bindedSockFd});
     binded.store(true);
 
     if(!deferred) {
         listening.store(true);
 
-        // listner_thread has not been started yet:
-        if(listener_thread.joinable() == false) {
-            listener_thread = std::thread(&srfc_listener::__listener_thread__, this);
-        }
-        // listener is idled:
-        else {
-            listener_cv.notify_one();
-        }
+        start_accepting();
     }
 }
 
@@ -151,14 +295,7 @@ void srfc_listener::invoke_deferred()
 
     listening.store(true);
 
-    // listner_thread has not been started yet:
-    if(listener_thread.joinable() == false) {
-        listener_thread = std::thread(&srfc_listener::__listener_thread__, this);
-    }
-    // listener is idled:
-    else {
-        listener_cv.notify_one();
-    }
+    start_accepting();
 }
 
 bool srfc_listener::is_listening() const
@@ -173,18 +310,36 @@ void srfc_listener::shutdown()
     }
 
     binded.store(false);
-
-    // awake the listener_thread and idle on the listener_cv:
     listening.store(false);
-    listener_cv.notify_one();
 
-    __shutdown__(); 
-    __close__();
+    // wait for the I/O threads to leave on_acceptable():
+    for(auto& shard : shards) {
+        if(shard.io_token != 0) {
+            srfc_reactor::shared().remove(shard.io_token);
+            shard.io_token = 0;
+        }
+    }
+
+    // close every socket. The first error is rethrown:
+    std::exception_ptr error;
+    for(const auto& shard : shards) {
+        try {
+            __shutdown__(shard.socket_fd); 
+        }
+        catch(...) {
+            error = error ? error : std::current_exception();
+        }
+        try {
+            __close__(shard.socket_fd);
+        }
+        catch(...) {
+            error = error ? error : std::current_exception();
+        }
+    }
+    shards.clear();
 
-    // wait for listener to idle on listener_cv
-    if(listener_thread.joinable()) {
-        std::unique_lock<std::mutex> ul(idleable_cv_mutex);
-        idleable_cv.wait(ul, [this]{return this->idleable.load();});
+    if(error) {
+        std::rethrow_exception(error);
     }
 }   
 
@@ -195,55 +350,166 @@ void srfc_listener::reset()
     if(binded.load() == true) {
         shutdown();
     }
-    callback_map.clear();
+    // the sockets accepted meanwhile are still passed to the connection callback:
+    wait_deferred();
+
+    // the accepted connections keep the methods (in the last table of the registry):
+    methods = std::make_shared<srfc_method_registry>();
     connection_callback = [](const auto&){return;}; // do nothing
 }
 
 srfc_listener::~srfc_listener()
 {
     reset();
+}
 
-    // Terminate the terminate_listener thread if it was started:
-    if(listener_thread.joinable()) {
-        terminate_listener.store(true);
-        listener_cv.notify_one();
-        listener_thread.join();
+void srfc_listener::start_accepting()
+{
+    for(std::size_t i = 0; i < shards.size(); ++i) {
+        if(shards[i].io_token != 0) {
+            continue;
+        }
+
+        // the reactor accepts on its own if it can:
+        auto& reactor = srfc_reactor::shared();
+        if(reactor.completes_io()) {
+            shards[i].io_token = reactor.add_acceptor(shards[i].socket_fd, [this, i](socket_t clientfd) {
+                on_accepted(i, clientfd);
+            }, shards[i].loop);
+            continue;
+        }
+
+        shards[i].io_token = reactor.add(shards[i].socket_fd, [this, i](std::uint32_t) {
+            on_acceptable(i);
+        }, shards[i].loop);
     }
 }
 
-void srfc_listener::__listener_thread__()
+void srfc_listener::on_acceptable(std::size_t shard)
 {
-    while (true) {
-        idleable.store(true);
-        idleable_cv.notify_all();
+    const auto fd = shards[shard].socket_fd;
+
+    // drain pending connections in a batch:
+    for(std::size_t i = 0; i < max_accept_batch && listening.load(); ++i) {
+        socket_t client_fd;
+        try {
+            client_fd = __accept__(fd);
+        }
+        catch(...) {
+            return;     // e.g. out of file descriptors: retry on the next readiness event
+        }
 
-        std::unique_lock<std::mutex> ul(listener_cv_mutex);
-        listener_cv.wait(ul, [this]{
-            return this->listening.load() || this->terminate_listener.load();
-        });
+        if(client_fd == -1) {
+            return;
+        }
 
-        if(terminate_listener.load() == true) {
+        if(!pass_accepted(shard, client_fd)) {
             return;
         }
+    }
+}
+
+void srfc_listener::on_accepted(std::size_t shard, socket_t clientfd)
+{
+    // accepted while the listener is shutting down:
+    if(!listening.load()) {
+        try {
+            __close__(clientfd);
+        }
+        catch(...) {}
+        return;
+    }
 
-        idleable.store(false);
+    // the accepts completed after the shard is paused are deferred as well:
+    pass_accepted(shard, clientfd);
+}
 
-        const auto client_fd = __accept__();
-        std::thread([this, client_fd]{this->connection_handler(client_fd);}).detach();
+bool srfc_listener::pass_accepted(std::size_t shard, socket_t clientfd)
+{
+    const auto loop = shards[shard].loop;
+
+    // the user callback may block, so it's not called on the I/O thread:
+    if(!srfc_executor::shared().try_submit([this, clientfd, loop]{this->connection_handler(clientfd, loop);})) {
+        defer_accepted(clientfd, loop, shards[shard].io_token);
+        return false;
     }
+    return true;
 }
 
-void srfc_listener::connection_handler(socket_t clientfd)
+void srfc_listener::defer_accepted(socket_t clientfd, std::size_t loop, srfc_reactor::token_t token)
 {
-    // create DEFFERED connection:
-    srfc_connection tmp(clientfd, true);
+    // the shard is resumed only after it's paused here:
+    srfc_reactor::shared().want_read(token, false);
+    {
+        std::lock_guard<std::mutex> lg(deferred_mutex);
+        deferred_accepts.emplace_back(clientfd, loop);
+        paused_shards.push_back(token);
+        if(deferred_accepts.size() != 1) {
+            return;     // already waiting for space
+        }
+    }
+
+    ++space_waits;
+    srfc_executor::shared().when_space([this]{ submit_deferred(); });
+}
+
+void srfc_listener::submit_deferred()
+{
+    auto& executor = srfc_executor::shared();
+    std::vector<srfc_reactor::token_t> resumed;
+    {
+        std::lock_guard<std::mutex> lg(deferred_mutex);
+        while(!deferred_accepts.empty()) {
+            const auto [client_fd, loop] = deferred_accepts.front();
+            if(!executor.try_submit([this, client_fd, loop]{this->connection_handler(client_fd, loop);})) {
+                break;
+            }
+            deferred_accepts.pop_front();
+        }
+        if(deferred_accepts.empty()) {
+            resumed.swap(paused_shards);
+        }
+    }
+
+    // full again:
+    if(resumed.empty()) {
+        executor.when_space([this]{ submit_deferred(); });
+        return;
+    }
+
+    // the tokens of the shut down shards are ignored by the reactor:
+    for(const auto token : resumed) {
+        srfc_reactor::shared().want_read(token, true);
+    }
+    if(space_waits.fetch_sub(1) == 1) {
+        space_waits.notify_all();
+    }
+}
 
-    // add methods:
-    for(const auto& p : callback_map) {
-        tmp.add_method(p.first, p.second);
+void srfc_listener::wait_deferred()
+{
+    for(auto n = space_waits.load(); n != 0; n = space_waits.load()) {
+        space_waits.wait(n);
     }
+}
+
+void srfc_listener::connection_handler(socket_t clientfd, std::size_t loop)
+{
+    // create DEFFERED connection:
+    srfc_connection tmp(clientfd, true);
+    tmp.set_wire_format(wire_fmt.load());
+    tmp.set_compression(compression.load());
+    tmp.set_checksum(checksum.load());
+    tmp.set_max_frame_size(max_frame_size.load());
+    tmp.set_stream_window(stream_window.load());
+    tmp.set_memory_budget(memory_budget.load());
+    tmp.io_loop = loop;     // stays on the shard that accepted it
+
+    // the connection dispatches to the methods of the listener (including the ones added or removed later),
+    // until its own methods are changed:
+    tmp.methods.follow(methods);
     // pass DEFFERED connection:
     connection_callback(std::move(tmp));
 }
 
-} // namespace net 
\ No newline at end of file
+} // namespace net
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include "includes/srfc_method_registry.hpp"
+
+#include <utility>
+
+namespace net
+{
+
+// Versions are unique across the registries, so a reader notices a registry that stops following another one:
+static std::uint64_t next_version() noexcept
+{
+    static std::atomic<std::uint64_t> last{0};
+    return ++last;
+}
+
+srfc_method_registry::srfc_method_registry()
+    : table(std::make_shared<const srfc_method_table>()), own_version(next_version())
+{}
+
+srfc_method_registry::srfc_method_registry(srfc_method_registry&& other) noexcept
+    : srfc_method_registry()
+{
+    *this = std::move(other);
+}
+
+srfc_method_registry& srfc_method_registry::operator=(srfc_method_registry&& other) noexcept
+{
+    if(this == &other) {
+        return *this;
+    }
+
+    table = std::exchange(other.table, std::make_shared<const srfc_method_table>());
+    parent = std::move(other.parent);
+    other.parent.reset();
+    followed.store(other.followed.exchange(nullptr));
+    own_version.store(next_version());
+    other.own_version.store(next_version());
+    return *this;
+}
+
+template<typename change_t>
+auto srfc_method_registry::update(change_t change)
+{
+    std::lock_guard<std::mutex> lg(mutex);
+
+    // the changes start from the last table of the followed registry:
+    auto* const p = followed.load();
+    auto copy = std::make_shared<srfc_method_table>(p != nullptr ? *p->snapshot() : *table);
+
+    auto res = change(*copy);
+    table = std::move(copy);
+    own_version.store(next_version());
+    followed.store(nullptr);
+    return res;
+}
+
+//
+// Writers:
+//
+
+srfc_method_registry::method_id_t srfc_method_registry::add(std::string name, srfc_method_table::callback_t callback)
+{
+    return update([&](srfc_method_table& t) { return t.add(std::move(name), std::move(callback)); });
+}
+
+srfc_method_registry::method_id_t srfc_method_registry::add(std::string name, srfc_method_table::view_callback_t callback)
+{
+    return update([&](srfc_method_table& t) { return t.add(std::move(name), std::move(callback)); });
+}
+
+srfc_method_registry::method_id_t srfc_method_registry::add(std::string name, srfc_method_table::task_callback_t callback)
+{
+    return update([&](srfc_method_table& t) { return t.add(std::move(name), std::move(callback)); });
+}
+
+srfc_method_registry::method_id_t srfc_method_registry::add(std::string name, srfc_method_table::stream_callback_t callback)
+{
+    return update([&](srfc_method_table& t) { return t.add(std::move(name), std::move(callback)); });
+}
+
+bool srfc_method_registry::remove(const std::string& name)
+{
+    // nothing is published if there is no such method:
+    if(snapshot()->find(name) == nullptr) {
+        return false;
+    }
+    return update([&](srfc_method_table& t) { return t.remove(name); });
+}
+
+void srfc_method_registry::clear()
+{
+    std::lock_guard<std::mutex> lg(mutex);
+
+    table = std::make_shared<const srfc_method_table>();
+    own_version.store(next_version());
+    followed.store(nullptr);
+}
+
+void srfc_method_registry::follow(std::shared_ptr<srfc_method_registry> registry)
+{
+    std::lock_guard<std::mutex> lg(mutex);
+
+    parent = std::move(registry);
+    followed.store(parent.get());
+}
+
+//
+// Readers:
+//
+
+srfc_method_registry::table_ptr srfc_method_registry::snapshot() const
+{
+    std::lock_guard<std::mutex> lg(mutex);
+
+    auto* const p = followed.load();
+    return p != nullptr ? p->snapshot() : table;
+}
+
+std::uint64_t srfc_method_registry::version() const noexcept
+{
+    // the table is published before its version (and the version before the registry stops following),
+    // so a reader can't keep the older table with the newer version:
+    auto* const p = followed.load();
+    return p != nullptr ? p->version() : own_version.load();
+}
+
+} // namespace net
@@ -0,0 +1,143 @@
+#include "includes/srfc_method_table.hpp"
+
+#include <stdexcept>
+
+namespace net
+{
+
+//
+// Registering:
+//
+
+srfc_method_table::method_id_t srfc_method_table::set(method m)
+{
+    const auto it = ids.find(m.name);
+    if(it != ids.end()) {
+        methods[it->second] = std::make_shared<const method>(std::move(m));
+        return it->second;
+    }
+
+    if(methods.size() >= no_method_id) {
+        throw std::length_error("set(method m): too many methods");
+    }
+
+    const auto id = static_cast<method_id_t>(methods.size());
+    ids.emplace(m.name, id);
+    methods.push_back(std::make_shared<const method>(std::move(m)));
+    return id;
+}
+
+srfc_method_table::method_id_t srfc_method_table::add(std::string name, callback_t callback)
+{
+    method m;
+    m.name = std::move(name);
+    m.kind = method_kind::callback;
+    m.callback = std::move(callback);
+    return set(std::move(m));
+}
+
+srfc_method_table::method_id_t srfc_method_table::add(std::string name, view_callback_t callback)
+{
+    method m;
+    m.name = std::move(name);
+    m.kind = method_kind::view;
+    m.view_callback = std::move(callback);
+    return set(std::move(m));
+}
+
+srfc_method_table::method_id_t srfc_method_table::add(std::string name, task_callback_t callback)
+{
+    method m;
+    m.name = std::move(name);
+    m.kind = method_kind::task;
+    m.task_callback = std::move(callback);
+    return set(std::move(m));
+}
+
+srfc_method_table::method_id_t srfc_method_table::add(std::string name, stream_callback_t callback)
+{
+    method m;
+    m.name = std::move(name);
+    m.kind = method_kind::stream;
+    m.stream_callback = std::move(callback);
+    return set(std::move(m));
+}
+
+bool srfc_method_table::remove(const std::string& name)
+{
+    if(find(name) == nullptr) {
+        return false;
+    }
+
+    // the id stays taken by the name:
+    method m;
+    m.name = name;
+    set(std::move(m));
+    return true;
+}
+
+void srfc_method_table::clear() noexcept
+{
+    methods.clear();
+    ids.clear();
+}
+
+//
+// Lookup:
+//
+
+const srfc_method_table::method* srfc_method_table::find(method_id_t id) const noexcept
+{
+    if(id >= methods.size() || methods[id]->kind == method_kind::none) {
+        return nullptr;
+    }
+    return methods[id].get();
+}
+
+const srfc_method_table::method* srfc_method_table::find(const std::string& name) const
+{
+    const auto it = ids.find(name);
+    return it != ids.end() ? find(it->second) : nullptr;
+}
+
+std::shared_ptr<const srfc_method_table::method> srfc_method_table::entry(method_id_t id) const noexcept
+{
+    if(find(id) == nullptr) {
+        return nullptr;
+    }
+    return methods[id];
+}
+
+std::shared_ptr<const srfc_method_table::method> srfc_method_table::entry(const std::string& name) const
+{
+    const auto it = ids.find(name);
+    return it != ids.end() ? entry(it->second) : nullptr;
+}
+
+srfc_method_table::method_id_t srfc_method_table::id_of(const std::string& name) const
+{
+    const auto it = ids.find(name);
+    return it != ids.end() ? it->second : no_method_id;
+}
+
+const srfc_method_table::method& srfc_method_table::at(const std::string& name, method_kind kind) const
+{
+    const auto* m = find(name);
+    if(m == nullptr || m->kind != kind) {
+        throw std::out_of_range("at(const std::string& name, method_kind kind): no method of the kind found");
+    }
+    return *m;
+}
+
+std::size_t srfc_method_table::size() const noexcept
+{
+    return methods.size();
+}
+
+const std::string& srfc_method_table::name_of(method_id_t id) const
+{
+    static const std::string unknown;
+    return id < methods.size() ? methods[id]->name : unknown;
+}
+
+} // namespace net
@@ -1,5 +1,7 @@
 
 #include "includes/srfc_response.hpp"
+#include "includes/srfc_message_view.hpp"
+#include "includes/srfc_checksum.hpp"
 
 #include <cstring>
 #include <stdexcept>
@@ -7,6 +9,7 @@
 
 #include "includes/utilities/alg.hpp"
 #include "includes/utilities/array_deleter.hpp"
+#include "includes/utilities/byte_order.hpp"
 
 namespace net
 {
@@ -29,6 +32,18 @@ srfc_response::srfc_response(serialized_t builtP, std::size_t reqSize)
     deserialize(builtP, reqSize);
 }
 
+srfc_response::srfc_response(const srfc_message_view& view) :
+    request_id(view.getRequestId()),
+    status_code(view.getStatusCode()),
+    priority(view.getPriority()),
+    codec(view.getPayloadCodec())
+{
+    dynamic_assert<std::logic_error>(
+        [&view]{ return view.getType() == frame_type::response;}, "Invalid type value");
+
+    payload_ptr = view.getPayload(&payload_size);
+}
+
 //
 // Setters:
 //
@@ -49,6 +64,16 @@ void srfc_response::setPayload(payload_t p, std::size_t psize)
     this->payload_size = psize;
 }
 
+void srfc_response::setPriority(frame_priority p) noexcept
+{
+    this->priority = p;
+}
+
+void srfc_response::setPayloadCodec(payload_codec c) noexcept
+{
+    this->codec = c;
+}
+
 //
 // Getters:
 //
@@ -75,11 +100,28 @@ srfc_response::getStatusCode() const noexcept
     return this->status_code;
 }
 
-std::size_t srfc_response::getHeaderSize() const noexcept
+frame_priority srfc_response::getPriority() const noexcept
+{
+    return this->priority;
+}
+
+payload_codec srfc_response::getPayloadCodec() const noexcept
+{
+    return this->codec;
+}
+
+std::size_t srfc_response::getHeaderSize(wire_format fmt, frame_checksum checksum) const noexcept
 {
     std::size_t sz = 0;
+
+    if(fmt == wire_format::srfc_v2) {
+        /* add fixed-width header size: */
+        sz += srfc_v2_header::size;
+        return sz;
+    }
+
     /* add Preamble size*/
-    sz += 32;
+    sz += srfc_v1_preamble_size;
 
     /* add protocol version size: */
     sz += std::strlen(protocol_version);
@@ -94,11 +136,25 @@ std::size_t srfc_response::getHeaderSize() const noexcept
     sz += std::strlen("RI: ");
     sz += digits(request_id);
     sz += 1; // add trailing null
+
+    /* add optional checksum size: */
+    if(checksum != frame_checksum::none) {
+        sz += std::strlen("CK: ");
+        sz += 1; // single digit
+        sz += 1; // add trailing null
+    }
     
     sz += std::strlen("PS: ");
     sz += digits(payload_size);
     sz += 1; // add trailing null
 
+    /* add optional codec size: */
+    if(codec != payload_codec::none) {
+        sz += std::strlen("PC: ");
+        sz += 1; // single digit
+        sz += 1; // add trailing null
+    }
+
     /* add status code size: */
     sz += std::strlen("STATUS: ");
     sz += digits(status_code);
@@ -112,10 +168,11 @@ std::size_t srfc_response::getHeaderSize() const noexcept
 //
 
 srfc_response::serialized_t 
-srfc_response::serialize(std::size_t* pSize) const 
+srfc_response::serialize(std::size_t* pSize, wire_format fmt, frame_checksum checksum) const
 {
-    const auto head_size = getHeaderSize();
-    const auto full_size = head_size + payload_size; 
+    const auto head_size = getHeaderSize(fmt, checksum);
+    const auto trailer_size = checksum != frame_checksum::none ? checksum_trailer_size : 0;
+    const auto full_size = head_size + payload_size + trailer_size; 
 
     // Set pSize value:
     *pSize = full_size;
@@ -124,12 +181,68 @@ srfc_response::serialize(std::size_t* pSize) const
     serialized_t pntr(new char[full_size], array_deleter<char>());
     auto tmpptr = pntr.get();   // raw pointer to write data. Should NOT be deleted.
 
+    // Set header:
+    if(fmt == wire_format::srfc_v2) {
+        writeV2Header(tmpptr, checksum);
+    }
+    else {
+        writeV1Header(tmpptr, full_size, checksum);
+    }
+
+    // Set payload. The checksum is computed as the payload is copied, and the trailer follows it:
+    if(checksum != frame_checksum::none) {
+        auto crc = crc32c(0, pntr.get(), head_size);
+        crc = copy_crc32c(crc, tmpptr, payload_ptr.get(), payload_size);
+        tmpptr += payload_size;
+        store_le_and_shift(tmpptr, crc);
+    }
+    else {
+        copy_and_shift(tmpptr, payload_ptr.get(), payload_size);
+    }
+
+    return pntr;   
+}
+
+srfc_response::serialized_t 
+srfc_response::serializeHeader(std::size_t* pSize, wire_format fmt, frame_checksum checksum) const
+{
+    const auto head_size = getHeaderSize(fmt, checksum);
+    const auto trailer_size = checksum != frame_checksum::none ? checksum_trailer_size : 0;
+    const auto full_size = head_size + payload_size + trailer_size;
+
+    // Set pSize value:
+    *pSize = head_size;
+
+    // allocate memeory for serialized header only. Payload is sent separately:
+    serialized_t pntr(new char[head_size], array_deleter<char>());
+    auto tmpptr = pntr.get();   // raw pointer to write data. Should NOT be deleted.
+
+    // Set header:
+    if(fmt == wire_format::srfc_v2) {
+        writeV2Header(tmpptr, checksum);
+    }
+    else {
+        writeV1Header(tmpptr, full_size, checksum);
+    }
+
+    return pntr;
+}
+
+void srfc_response::deserialize(serialized_t s, const std::size_t sSize)
+{
+    // validate, classify and decode the message in a single pass.
+    // Throws std::logic_error if the message is ill-formed:
+    *this = srfc_response(srfc_message_view(s, s.get(), sSize));
+}
+
+void srfc_response::writeV1Header(char*& tmpptr, std::size_t full_size, frame_checksum checksum) const
+{
     // buffer for string for storing serialized integers:
     std::string tmpbuf;
 
     // Set preamble:
-    tmpbuf = std::string(32 - digits(full_size), '0') +  std::to_string(full_size);
-    copy_and_shift(tmpptr, tmpbuf.c_str(), 32);
+    tmpbuf = std::string(srfc_v1_preamble_size - digits(full_size), '0') +  std::to_string(full_size);
+    copy_and_shift(tmpptr, tmpbuf.c_str(), srfc_v1_preamble_size);
 
     // Set protocol version:
     copy_and_shift(tmpptr, protocol_version, std::strlen(protocol_version));
@@ -146,89 +259,47 @@ srfc_response::serialize(std::size_t* pSize) const
     copy_and_shift(tmpptr, tmpbuf.c_str(), tmpbuf.size());
     *(tmpptr++) = static_cast<char>(0); // add trailing null
 
+    // Set checksum (omitted if the frame has no checksum trailer):
+    if(checksum != frame_checksum::none) {
+        copy_and_shift(tmpptr, "CK: ", std::strlen("CK: "));
+        *(tmpptr++) = static_cast<char>('0' + static_cast<int>(checksum));
+        *(tmpptr++) = static_cast<char>(0); // add trailing null
+    }
+
     // Set PS:
     tmpbuf = std::to_string(payload_size);
     copy_and_shift(tmpptr, "PS: ", std::strlen("PS: "));
     copy_and_shift(tmpptr, tmpbuf.c_str(), tmpbuf.size());
     *(tmpptr++) = static_cast<char>(0); // add trailing null
 
+    // Set codec (omitted if the payload isn't compressed):
+    if(codec != payload_codec::none) {
+        copy_and_shift(tmpptr, "PC: ", std::strlen("PC: "));
+        *(tmpptr++) = static_cast<char>('0' + static_cast<int>(codec));
+        *(tmpptr++) = static_cast<char>(0); // add trailing null
+    }
+
     // Set Status code:
     tmpbuf = std::to_string(status_code);
     copy_and_shift(tmpptr, "STATUS: ", std::strlen("STATUS: "));
     copy_and_shift(tmpptr, tmpbuf.c_str(), tmpbuf.size());
     *(tmpptr++) = static_cast<char>(0); // add trailing null
-
-    // Set payload:
-    copy_and_shift(tmpptr, payload_ptr.get(), payload_size);
-
-    return pntr;   
 }
 
-void srfc_response::deserialize(serialized_t s, const std::size_t sSize)
-{  
-    const auto* const rbound = s.get() +  sSize;
-
-    // raw pointer to copy data. Should NOT be deleted:
-    auto* ptr = s.get();  
-
-    /*-----------------------------------------------------*/
-    /*                 Get Preamble:                       */
-    /*-----------------------------------------------------*/
-    dynamic_assert<std::out_of_range>(
-        [&sSize]{ return sSize >= 32;}, "Serialized response size can't be less than 32");
-
-    std::vector<char> preamble(ptr, ptr + 32);
-    std::size_t preamble_value = std::stoul(std::string(preamble.begin(), preamble.end()));
-    dynamic_assert<std::logic_error>(preamble_value, sSize, "Serialized size and preamble value differs");
-
-    ptr += 32;
-
-    /*-----------------------------------------------------*/
-    /*            Get Protocol version:                    */
-    /*-----------------------------------------------------*/
-    auto protocolVersion = sstrcpy_and_shift(ptr, rbound);
-    dynamic_assert<std::logic_error>(protocolVersion, protocol_version, "Invalid protocol version");
-
-    /*-----------------------------------------------------*/
-    /*                    Get Type:                        */
-    /*-----------------------------------------------------*/
-    auto typeP = separate_param_val(sstrcpy_and_shift(ptr, rbound));
-    dynamic_assert<std::logic_error>(typeP.first, "TYPE", "Invalid header structure");
-    dynamic_assert<std::logic_error>(typeP.second, this->type, "Invalid type value");
-
-    /*-----------------------------------------------------*/
-    /*                  Get Request ID:                     */
-    /*-----------------------------------------------------*/
-    auto requestIdP = separate_param_val(sstrcpy_and_shift(ptr, rbound));
-    dynamic_assert<std::logic_error>(requestIdP.first, "RI", "Invalid header structure");
-
-    this->request_id = std::stoul(requestIdP.second);
-
-    /*-----------------------------------------------------*/
-    /*               Get Payload Size:                     */
-    /*-----------------------------------------------------*/
-    auto payloadSize = separate_param_val(sstrcpy_and_shift(ptr, rbound));
-    dynamic_assert<std::logic_error>(payloadSize.first, "PS", "Invalid header structure");
-
-    this->payload_size = std::stoul(payloadSize.second);
-
-    /*-----------------------------------------------------*/
-    /*                Get Status Code:                     */
-    /*-----------------------------------------------------*/
-    auto stCode = separate_param_val(sstrcpy_and_shift(ptr, rbound));
-    dynamic_assert<std::logic_error>(stCode.first, "STATUS", "Invalid header structure");
-
-    this->status_code = std::stoul(stCode.second);
-
-    /*-----------------------------------------------------*/
-    /*                  Get Payload:                       */
-    /*-----------------------------------------------------*/
-    auto payload_pointer = s.get() + sSize - payload_size;
-
-    payload_t tmp(new char[payload_size], array_deleter<char>());
-    std::memcpy(tmp.get(), payload_pointer, payload_size);
-
-    this->payload_ptr = std::move(tmp);
+void srfc_response::writeV2Header(char*& tmpptr, frame_checksum checksum) const
+{
+    // Set fixed-width header:
+    srfc_v2_header hdr;
+    hdr.type = static_cast<std::uint8_t>(frame_type::response);
+    hdr.request_id = request_id;
+    hdr.status = static_cast<std::uint32_t>(status_code);
+    hdr.flags = static_cast<std::uint16_t>(static_cast<unsigned>(priority) | 
+                                           static_cast<unsigned>(codec) << codec_flags_shift |
+                                           static_cast<unsigned>(checksum) << checksum_flags_shift);
+    hdr.payload_length = payload_size;
+
+    hdr.encode(tmpptr);
+    tmpptr += srfc_v2_header::size;
 }
 
 std::string srfc_response::to_string() const 
@@ -246,6 +317,11 @@ std::string srfc_response::to_string() const
     // Add PS:
     res +=  std::string("PS: ") + std::to_string(payload_size) + "\n";
 
+    // Add codec:
+    if(codec != payload_codec::none) {
+        res += std::string("PC: ") + std::to_string(static_cast<int>(codec)) + "\n";
+    }
+
     // Add Status code:
     res +=  std::string("STATUS: ") + std::to_string(status_code) + "\n";
 
@@ -264,6 +340,8 @@ void srfc_response::reset()
     status_code = status_codes::none;
     payload_ptr.reset();
     payload_size = 0;
+    priority = frame_priority::normal;
+    codec = payload_codec::none;
 }
 
 
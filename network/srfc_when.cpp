@@ -0,0 +1,112 @@
+#include "includes/srfc_when.hpp"
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+
+namespace net
+{
+
+namespace
+{
+    // Sends the call; the completion is invoked with connection_error if it can't be sent
+    void start_call(srfc_call& call, srfc_connection::completion_t completion)
+    {
+        const auto rid = call.request.getRequestId();
+        try {
+            if(call.connection == nullptr) {
+                throw std::logic_error("start_call(srfc_call& call, completion_t completion): no connection");
+            }
+            if(call.timeout) {
+                call.connection->send_request(call.request, *call.timeout, completion);
+            }
+            else {
+                call.connection->send_request(call.request, completion);
+            }
+        }
+        catch(...) {
+            completion(srfc_response(rid, status_codes::connection_error));
+        }
+    }
+} // namespace
+
+void when_all(std::vector<srfc_call> calls, std::function<void(std::vector<srfc_response>)> callback)
+{
+    if(calls.empty()) {
+        callback({});
+        return;
+    }
+
+    struct state_t
+    {
+        std::vector<srfc_response> responses;
+        std::atomic<std::size_t> left;
+        std::function<void(std::vector<srfc_response>)> callback;
+    };
+
+    auto state = std::make_shared<state_t>();
+    state->responses.reserve(calls.size());
+    for(const auto& call : calls) {
+        state->responses.push_back(srfc_response(call.request.getRequestId(), status_codes::connection_error));
+    }
+    state->left.store(calls.size());
+    state->callback = std::move(callback);
+
+    // each completion owns its own element; the last one (acq_rel) sees all of them:
+    for(std::size_t i = 0; i < calls.size(); ++i) {
+        start_call(calls[i], [state, i](srfc_response response) {
+            state->responses[i] = std::move(response);
+            if(state->left.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                state->callback(std::move(state->responses));
+            }
+        });
+    }
+}
+
+std::future<std::vector<srfc_response>> when_all(std::vector<srfc_call> calls)
+{
+    auto promise = std::make_shared<std::promise<std::vector<srfc_response>>>();
+    auto res = promise->get_future();
+
+    when_all(std::move(calls), [promise](std::vector<srfc_response> responses) {
+        promise->set_value(std::move(responses));
+    });
+    return res;
+}
+
+void when_any(std::vector<srfc_call> calls, std::function<void(std::size_t, srfc_response)> callback)
+{
+    if(calls.empty()) {
+        throw std::invalid_argument("when_any(std::vector<srfc_call> calls, callback): no calls");
+    }
+
+    struct state_t
+    {
+        std::atomic_bool done{false};
+        std::function<void(std::size_t, srfc_response)> callback;
+    };
+
+    auto state = std::make_shared<state_t>();
+    state->callback = std::move(callback);
+
+    for(std::size_t i = 0; i < calls.size(); ++i) {
+        start_call(calls[i], [state, i](srfc_response response) {
+            if(state->done.exchange(true) == false) {
+                state->callback(i, std::move(response));
+            }
+        });
+    }
+}
+
+std::future<std::pair<std::size_t, srfc_response>> when_any(std::vector<srfc_call> calls)
+{
+    auto promise = std::make_shared<std::promise<std::pair<std::size_t, srfc_response>>>();
+    auto res = promise->get_future();
+
+    when_any(std::move(calls), [promise](std::size_t index, srfc_response response) {
+        promise->set_value(std::make_pair(index, std::move(response)));
+    });
+    return res;
+}
+
+} // namespace net
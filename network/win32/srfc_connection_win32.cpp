@@ -14,22 +14,25 @@
 
 // #pragma comment (lib, "Mswsock.lib")
 
+#include <vector>
+
 #include "../includes/srfc_connection.hpp"
 
 namespace net
 {
 
-std::vector<char> srfc_connection::__receive__() 
+std::ptrdiff_t srfc_connection::__read_some__(char* buf, std::size_t len) 
 {
-    constexpr std::size_t bufSize = 1024;
-    char buf[bufSize] = {0};
+    const auto bytes_received = ::recv(this->socket_fd, buf, static_cast<int>(len), 0);
+    if(bytes_received != SOCKET_ERROR) {
+        // if bytes_received == 0 -> connection closed.
+        return bytes_received;
+    }
 
-    std::size_t bytes_received = ::recv(this->socket_fd, buf, bufSize, 0);
-    if(bytes_received < 0) {
-        throw std::runtime_error("__receive__(): recv function failed"); // add errror code
+    if(::WSAGetLastError() == WSAEWOULDBLOCK) {
+        return -1;
     }
-    // if bytes_received == 0 -> connection closed.
-    return std::vector<char>(buf, buf + bytes_received);
+    throw std::runtime_error("__read_some__(char* buf, std::size_t len): recv function failed"); // add errror code
 }
 
 void srfc_connection::__connect__(unsigned int port, std::string address)
@@ -67,13 +70,36 @@ void srfc_connection::__connect__(unsigned int port, std::string address)
     this->connected.store(true);
 }
 
-void srfc_connection::__send__(const void *buf, std::size_t len)
+void srfc_connection::__set_nonblocking__()
 {
-    if(::send(this->socket_fd, reinterpret_cast<const char*>(buf), len, 0) 
-        == SOCKET_ERROR) 
+    u_long mode = 1;
+    if(::ioctlsocket(this->socket_fd, FIONBIO, &mode) == SOCKET_ERROR) {
+        throw std::runtime_error("__set_nonblocking__(): The ioctlsocket() function failed:");
+    }
+}
+
+std::ptrdiff_t srfc_connection::__write_some__(const const_buffer* bufs, std::size_t count)
+{
+    std::vector<WSABUF> wsabufs;
+    wsabufs.reserve(count);
+    for(std::size_t i = 0; i < count; ++i) {
+        if(bufs[i].size != 0) {
+            wsabufs.push_back({static_cast<ULONG>(bufs[i].size), const_cast<char*>(bufs[i].data)});
+        }
+    }
+
+    DWORD sent = 0;
+    if(::WSASend(this->socket_fd, wsabufs.data(), static_cast<DWORD>(wsabufs.size()), 
+                 &sent, 0, nullptr, nullptr) == SOCKET_ERROR) 
     {
-        throw std::runtime_error("__send__(const void *buf, std::size_t len): The send() function failed:");  
+        // the socket is non-blocking and its send buffer is full:
+        if(::WSAGetLastError() == WSAEWOULDBLOCK) {
+            return -1;
+        }
+        throw std::runtime_error("__write_some__(const const_buffer* bufs, std::size_t count): The WSASend() function failed:");  
     }
+
+    return static_cast<std::ptrdiff_t>(sent);
 }  
 
 void srfc_connection::__shutdown__() 
@@ -0,0 +1,164 @@
+// Batches: the responses in the order of the requests (with the errors, and the responses sent on their own),
+// the batched requests handled on one task, and the requests sent one by one to the peers without batches.
+
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "srfc_loopback.hpp"
+
+#include "../network/includes/srfc_response.hpp"
+#include "../network/includes/srfc_task.hpp"
+
+using namespace net;
+using namespace srfc_test;
+
+using payload_t = srfc_connection::payload_t;
+
+static void add_echo(srfc_listener& listener)
+{
+    listener.add_method("ECHO", srfc_connection::view_callback_t(
+        [](const srfc_message_view& request, payload_t* pPayload, std::size_t* pSize) {
+            *pPayload = make_block(std::string(request.getPayloadData(), request.getPayloadSize()));
+            *pSize = request.getPayloadSize();
+            return status_codes::ok;
+        }));
+}
+
+static srfc_request echo(const std::string& payload)
+{
+    srfc_request request("ECHO");
+    request.setPayload(make_block(payload), payload.size());
+    return request;
+}
+
+static std::string payload_of(const srfc_response& response)
+{
+    std::size_t size = 0;
+    const auto payload = response.getPayload(&size);
+    return std::string(payload.get(), size);
+}
+
+static srfc_task<srfc_response> answer_later(srfc_message_view request)
+{
+    srfc_response response(request.getRequestId(), status_codes::no_content);
+    co_return response;
+}
+
+SRFC_TEST(batch_responses_in_order)
+{
+    loopback server;
+    add_echo(server.listener);
+    server.listener.add_method("TASK", srfc_connection::task_callback_t(answer_later));
+    server.start();
+    auto client = server.connect();
+
+    // the large response and the response of the coroutine are sent on their own:
+    const std::string large(3 * srfc_connection::stream_chunk_size, 'L');
+    std::vector<srfc_request> requests;
+    requests.push_back(echo("first"));
+    requests.push_back(srfc_request("MISSING"));
+    requests.push_back(echo(large));
+    requests.push_back(srfc_request("TASK"));
+    for(int i = 0; i < 20; ++i) {
+        requests.push_back(echo(std::to_string(i)));
+    }
+
+    auto batch = client->send_batch(requests);
+    CHECK(batch.wait_for(patience) == std::future_status::ready);
+    const auto responses = batch.get();
+    CHECK(responses.size() == requests.size());
+    if(responses.size() != requests.size()) {
+        return;
+    }
+    for(std::size_t i = 0; i < responses.size(); ++i) {
+        CHECK(responses[i].getRequestId() == requests[i].getRequestId());
+    }
+    CHECK(payload_of(responses[0]) == "first");
+    CHECK(responses[1].getStatusCode() == status_codes::unknown_method);
+    CHECK(payload_of(responses[2]) == large);
+    CHECK(responses[3].getStatusCode() == status_codes::no_content);
+    for(int i = 0; i < 20; ++i) {
+        CHECK(payload_of(responses[4 + static_cast<std::size_t>(i)]) == std::to_string(i));
+    }
+
+    auto empty = client->send_batch({});
+    CHECK(empty.wait_for(patience) == std::future_status::ready);
+    CHECK(empty.get().empty());
+}
+
+// The batch is dispatched as one unit: its methods run one after another on one thread
+SRFC_TEST(batch_one_task)
+{
+    loopback server;
+    std::mutex mutex;
+    std::vector<std::thread::id> threads;
+    int running = 0;
+    bool overlapped = false;
+    server.listener.add_method("WHERE", srfc_connection::view_callback_t(
+        [&](const srfc_message_view&, payload_t*, std::size_t*) {
+            {
+                std::lock_guard<std::mutex> lg(mutex);
+                threads.push_back(std::this_thread::get_id());
+                overlapped = overlapped || running != 0;
+                ++running;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            std::lock_guard<std::mutex> lg(mutex);
+            --running;
+            return status_codes::ok;
+        }));
+    server.start();
+    auto client = server.connect();
+
+    std::vector<srfc_request> requests;
+    for(int i = 0; i < 10; ++i) {
+        requests.push_back(srfc_request("WHERE"));
+    }
+    auto batch = client->send_batch(requests);
+    CHECK(batch.wait_for(patience) == std::future_status::ready);
+    CHECK(batch.get().size() == 10);
+
+    std::lock_guard<std::mutex> lg(mutex);
+    CHECK(threads.size() == 10 && !overlapped);
+    for(const auto& id : threads) {
+        CHECK(id == threads.front());
+    }
+}
+
+// The legacy peer gets the requests one by one, and its responses complete the batch
+SRFC_TEST(batch_legacy_peer)
+{
+    raw_peer peer;
+    srfc_connection connection(peer.port, std::string("127.0.0.1"));
+    peer.accept();
+    srfc_message_view hello;
+    CHECK(peer.read(hello));
+    peer.write(srfc_response(hello.getRequestId(), status_codes::unknown_method));
+    CHECK(connection.wait_handshake(patience));
+
+    std::vector<srfc_request> requests;
+    for(int i = 0; i < 5; ++i) {
+        requests.push_back(echo(std::to_string(i)));
+    }
+    auto batch = connection.send_batch(requests);
+
+    std::vector<srfc_message_view> received(requests.size());
+    for(auto& request : received) {
+        CHECK(peer.read(request));
+        CHECK(request.getType() == frame_type::request && request.getMethod() == "ECHO");
+    }
+    for(auto it = received.rbegin(); it != received.rend(); ++it) {
+        srfc_response response(it->getRequestId(), status_codes::ok);
+        response.setPayload(make_block(std::string(it->getPayloadData(), it->getPayloadSize())), it->getPayloadSize());
+        peer.write(response);
+    }
+
+    CHECK(batch.wait_for(patience) == std::future_status::ready);
+    const auto responses = batch.get();
+    CHECK(responses.size() == requests.size());
+    for(std::size_t i = 0; i < responses.size(); ++i) {
+        CHECK(payload_of(responses[i]) == std::to_string(i));
+    }
+}
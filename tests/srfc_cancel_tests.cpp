@@ -0,0 +1,147 @@
+// Cancellation: the completion of a cancelled request, the cancellation token of the running handler,
+// the handlers skipped before they start, and the chunk source of a cancelled stream.
+
+#include <atomic>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "srfc_loopback.hpp"
+
+#include "../network/includes/srfc_executor.hpp"
+
+using namespace net;
+using namespace srfc_test;
+
+using payload_t = srfc_connection::payload_t;
+
+SRFC_TEST(cancel_running_handler)
+{
+    loopback server;
+    std::promise<void> started;
+    std::promise<bool> observed;
+    server.listener.add_method("WAIT", srfc_connection::view_callback_t(
+        [&](const srfc_message_view& request, payload_t*, std::size_t*) {
+            const auto token = request.getCancellationToken();
+            started.set_value();
+            const auto deadline = std::chrono::steady_clock::now() + patience;
+            while(!token.is_cancelled() && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            observed.set_value(token.is_cancelled());
+            return status_codes::ok;
+        }));
+    server.listener.add_method("PING", srfc_connection::view_callback_t(
+        [](const srfc_message_view&, payload_t*, std::size_t*) { return status_codes::ok; }));
+    server.start();
+    auto client = server.connect();
+
+    const srfc_request request("WAIT");
+    auto future = client->send_request(request);
+    CHECK(started.get_future().wait_for(patience) == std::future_status::ready);
+
+    // the completion gets request_cancelled at once, and the handler sees the token raised:
+    CHECK(client->cancel(request.getRequestId()));
+    CHECK(future.wait_for(std::chrono::milliseconds(0)) == std::future_status::ready);
+    CHECK(future.get().getStatusCode() == status_codes::request_cancelled);
+    auto raised = observed.get_future();
+    CHECK(raised.wait_for(patience) == std::future_status::ready);
+    CHECK(raised.get());
+
+    CHECK(!client->cancel(request.getRequestId()));
+    auto ping = client->send_request(srfc_request("PING"));
+    CHECK(ping.wait_for(patience) == std::future_status::ready);
+    CHECK(ping.get().getStatusCode() == status_codes::ok);
+}
+
+// The request cancelled while its handler waits for a worker isn't handled at all:
+SRFC_TEST(cancel_queued_handler)
+{
+    loopback server;
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::atomic<int> blocked{0};
+    std::atomic<int> handled{0};
+    server.listener.add_method("BLOCK", srfc_connection::view_callback_t(
+        [&blocked, released](const srfc_message_view&, payload_t*, std::size_t*) {
+            ++blocked;
+            released.wait_for(patience);
+            return status_codes::ok;
+        }));
+    server.listener.add_method("COUNT", srfc_connection::view_callback_t(
+        [&handled](const srfc_message_view&, payload_t*, std::size_t*) {
+            ++handled;
+            return status_codes::ok;
+        }));
+    server.start();
+    auto client = server.connect();
+
+    // every worker is busy:
+    const auto workers = static_cast<int>(srfc_executor::shared().size());
+    std::vector<std::future<srfc_response>> blocking;
+    for(int i = 0; i < workers; ++i) {
+        blocking.push_back(client->send_request(srfc_request("BLOCK")));
+    }
+    CHECK(eventually([&blocked, workers] { return blocked.load() == workers; }));
+
+    const srfc_request queued("COUNT");
+    auto future = client->send_request(queued);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(client->cancel(queued.getRequestId()));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    release.set_value();
+
+    for(auto& f : blocking) {
+        CHECK(f.wait_for(patience) == std::future_status::ready);
+    }
+    auto counted = client->send_request(srfc_request("COUNT"));
+    CHECK(counted.wait_for(patience) == std::future_status::ready);
+    CHECK(handled.load() == 1);
+    CHECK(future.get().getStatusCode() == status_codes::request_cancelled);
+}
+
+// The receiver cancels the stream after the first chunk: the sender stops and releases the chunk source
+SRFC_TEST(cancel_stream)
+{
+    loopback server;
+    std::weak_ptr<std::size_t> source;
+    std::mutex mutex;
+    server.listener.add_method("ENDLESS", srfc_connection::stream_callback_t(
+        [&](const srfc_message_view&, srfc_connection::chunk_source_t* pSource) {
+            auto produced = std::make_shared<std::size_t>(0);
+            {
+                std::lock_guard<std::mutex> lg(mutex);
+                source = produced;
+            }
+            *pSource = [produced](char* buf, std::size_t len) {
+                std::memset(buf, 'x', len);
+                *produced += len;
+                return len;
+            };
+            return status_codes::ok;
+        }));
+    server.start();
+    auto client = server.connect();
+
+    const srfc_request request("ENDLESS");
+    std::promise<void> firstChunk;
+    std::atomic<int> chunks{0};
+    auto future = client->send_streaming_request(request, [&](const char*, std::size_t) {
+        if(++chunks == 1) {
+            firstChunk.set_value();
+        }
+    });
+    CHECK(firstChunk.get_future().wait_for(patience) == std::future_status::ready);
+    CHECK(client->cancel(request.getRequestId()));
+    CHECK(future.wait_for(patience) == std::future_status::ready);
+    CHECK(future.get().getStatusCode() == status_codes::request_cancelled);
+
+    CHECK(eventually([&] {
+        std::lock_guard<std::mutex> lg(mutex);
+        return source.expired();
+    }));
+    CHECK(client->is_connected());
+}
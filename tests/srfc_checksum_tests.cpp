@@ -0,0 +1,213 @@
+// CRC32C frame checksums: the checksum itself, checksummed round trips, corrupted frames
+// and the checksummed frames of the connections (streams and batches are checksummed as they're produced).
+
+#include <cstdint>
+#include <future>
+#include <limits>
+
+#include "srfc_loopback.hpp"
+
+#include "../network/includes/srfc_checksum.hpp"
+#include "../network/includes/srfc_frame.hpp"
+#include "../network/includes/srfc_response.hpp"
+
+using namespace net;
+using namespace srfc_test;
+
+SRFC_TEST(checksum_crc32c)
+{
+    const std::string check = "123456789";
+    CHECK(crc32c(0, check.data(), check.size()) == 0xE3069283);
+    CHECK(crc32c(0, nullptr, 0) == 0);
+
+    // 32 bytes of zeros and of ones (RFC 3720, B.4):
+    const std::string zeros(32, '\0');
+    const std::string ones(32, '\xFF');
+    CHECK(crc32c(0, zeros.data(), zeros.size()) == 0x8A9136AA);
+    CHECK(crc32c(0, ones.data(), ones.size()) == 0x62A8AB43);
+
+    // block by block, with every alignment:
+    std::string data;
+    for(int i = 0; i < 1000; ++i) {
+        data.push_back(static_cast<char>(i * 31 + 7));
+    }
+    const auto whole = crc32c(0, data.data(), data.size());
+    for(std::size_t split = 0; split <= 17; ++split) {
+        const auto first = crc32c(0, data.data(), split);
+        CHECK(crc32c(first, data.data() + split, data.size() - split) == whole);
+    }
+
+    std::string copy(data.size(), '\0');
+    CHECK(copy_crc32c(0, copy.data(), data.data(), data.size()) == whole);
+    CHECK(copy == data);
+}
+
+SRFC_TEST(checksum_combine)
+{
+    std::string data;
+    for(int i = 0; i < 100000; ++i) {
+        data.push_back(static_cast<char>(i * 17 + 3));
+    }
+    const auto whole = crc32c(0, data.data(), data.size());
+
+    // the checksum of the second block is combined with the checksum of the first:
+    for(const std::size_t split : {0, 1, 7, 8, 1000, 65536, 99999, 100000}) {
+        const auto first = crc32c(0, data.data(), split);
+        const auto second = crc32c(0, data.data() + split, data.size() - split);
+        CHECK(crc32c_combine(first, second, data.size() - split) == whole);
+    }
+}
+
+SRFC_TEST(checksum_round_trip)
+{
+    for(const auto fmt : {wire_format::srfc_v1, wire_format::srfc_v2}) {
+        const auto request = make_request("checksummed payload");
+
+        std::size_t size = 0;
+        const auto frame = request.serialize(&size, fmt, frame_checksum::crc32c);
+
+        srfc_message_view view;
+        CHECK(parse_frame(frame, size, view) == parse_status::ok);
+        CHECK(view.getFrameSize() == size);
+        CHECK(std::string(view.getPayloadData(), view.getPayloadSize()) == "checksummed payload");
+
+        srfc_response response(7, status_codes::ok);
+        response.setPayload(make_block("answer"), 6);
+        const auto answer = response.serialize(&size, fmt, frame_checksum::crc32c);
+        CHECK(parse_frame(answer, size, view) == parse_status::ok);
+        CHECK(view.getRequestId() == 7);
+    }
+}
+
+SRFC_TEST(checksum_truncated)
+{
+    for(const auto fmt : {wire_format::srfc_v1, wire_format::srfc_v2}) {
+        const auto request = make_request("truncated payload");
+
+        std::size_t size = 0;
+        const auto frame = request.serialize(&size, fmt, frame_checksum::crc32c);
+
+        srfc_frame_parser parser;
+        srfc_message_view view;
+        for(std::size_t available = 0; available < size; ++available) {
+            CHECK(parser.parse(frame, frame.get(), available, view) == parse_status::incomplete);
+        }
+        CHECK(parser.parse(frame, frame.get(), size, view) == parse_status::ok);
+    }
+}
+
+SRFC_TEST(checksum_corrupted)
+{
+    for(const auto fmt : {wire_format::srfc_v1, wire_format::srfc_v2}) {
+        const auto request = make_request("corrupted payload");
+
+        std::size_t size = 0;
+        const auto frame = request.serialize(&size, fmt, frame_checksum::crc32c);
+
+        // every flipped byte is reported, never read out of bounds:
+        for(std::size_t i = 0; i < size; ++i) {
+            std::shared_ptr<char> bad(new char[size], array_deleter<char>());
+            std::memcpy(bad.get(), frame.get(), size);
+            bad.get()[i] = static_cast<char>(bad.get()[i] ^ 0x01);
+
+            srfc_message_view view;
+            CHECK(parse_frame(bad, size, view) != parse_status::ok);
+        }
+    }
+}
+
+// The checksum trailer makes the frame size of the SRFCv2 header wrap around to 2, below any frame limit:
+SRFC_TEST(checksum_wrapping_header)
+{
+    constexpr auto max = std::numeric_limits<std::size_t>::max();
+
+    srfc_v2_header header;
+    header.type = static_cast<std::uint8_t>(frame_type::request);
+    header.flags = static_cast<std::uint16_t>(frame_checksum::crc32c) << checksum_flags_shift;
+    header.payload_length = max - srfc_v2_header::size - 1;
+
+    std::shared_ptr<char> block(new char[srfc_v2_header::size], array_deleter<char>());
+    header.encode(block.get());
+
+    srfc_frame_parser parser;
+    srfc_message_view view;
+    parser.set_max_frame_size(1024);
+    CHECK(parser.parse_prefix(block.get(), srfc_v2_header::size) == parse_status::invalid_structure);
+    parser.reset();
+    CHECK(parser.parse(block, block.get(), srfc_v2_header::size, view) == parse_status::invalid_structure);
+
+    header.payload_length = max - srfc_v2_header::size - checksum_trailer_size;
+    header.encode(block.get());
+    parser.reset();
+    CHECK(parser.parse(block, block.get(), srfc_v2_header::size, view) == parse_status::frame_too_large);
+}
+
+// Both sides verify the frames they receive: a wrong checksum would shut the connection down
+SRFC_TEST(checksum_connection)
+{
+    using payload_t = srfc_connection::payload_t;
+    constexpr std::size_t size = 500000;
+
+    loopback server;
+    server.listener.set_checksum(frame_checksum::crc32c);
+    server.listener.add_method("ECHO", srfc_connection::view_callback_t(
+        [](const srfc_message_view& request, payload_t* pPayload, std::size_t* pSize) {
+            *pPayload = make_block(std::string(request.getPayloadData(), request.getPayloadSize()));
+            *pSize = request.getPayloadSize();
+            return status_codes::ok;
+        }));
+    server.listener.add_method("DATA", srfc_connection::stream_callback_t(
+        [](const srfc_message_view&, srfc_connection::chunk_source_t* pSource) {
+            auto offset = std::make_shared<std::size_t>(0);
+            *pSource = [offset](char* buf, std::size_t len) {
+                const auto n = std::min(len, size - *offset);
+                for(std::size_t i = 0; i < n; ++i) {
+                    buf[i] = static_cast<char>(*offset + i);
+                }
+                *offset += n;
+                return n;
+            };
+            return status_codes::ok;
+        }));
+    server.start();
+
+    auto client = server.connect(true);
+    client->set_checksum(frame_checksum::crc32c);
+    client->invoke_deferred();
+    CHECK(client->wait_handshake(patience));
+
+    // the chunks filled by the source:
+    auto streamed = client->send_request(srfc_request("DATA"));
+    CHECK(streamed.wait_for(patience) == std::future_status::ready);
+    std::size_t payloadSize = 0;
+    const auto response = streamed.get();
+    const auto payload = response.getPayload(&payloadSize);
+    CHECK(response.getStatusCode() == status_codes::ok && payloadSize == size);
+    bool same = payloadSize == size;
+    for(std::size_t i = 0; same && i < size; ++i) {
+        same = payload.get()[i] == static_cast<char>(i);
+    }
+    CHECK(same);
+    CHECK(client->is_connected());
+    if(!client->is_connected()) {
+        return;
+    }
+
+    // the batches of requests and of responses:
+    std::vector<srfc_request> requests;
+    for(int i = 0; i < 10; ++i) {
+        requests.push_back(make_request("batched " + std::to_string(i)));
+        requests.back().setMethod("ECHO");
+    }
+    auto batch = client->send_batch(requests);
+    CHECK(batch.wait_for(patience) == std::future_status::ready);
+    const auto responses = batch.get();
+    CHECK(responses.size() == requests.size());
+    for(std::size_t i = 0; i < responses.size(); ++i) {
+        const auto echoed = responses[i].getPayload(&payloadSize);
+        CHECK(responses[i].getStatusCode() == status_codes::ok);
+        CHECK(std::string(echoed.get(), payloadSize) == "batched " + std::to_string(i));
+    }
+
+    CHECK(client->is_connected());
+}
@@ -0,0 +1,183 @@
+// Payload compression: lz77 round trips, incompressible and corrupted payloads, and the size limit of the receivers.
+
+#include <cstdint>
+#include <future>
+#include <stdexcept>
+
+#include "srfc_loopback.hpp"
+
+#include "../network/includes/srfc_codec.hpp"
+
+using namespace net;
+using namespace srfc_test;
+
+static bool decompress_throws(const std::string& data)
+{
+    try {
+        std::size_t size = 0;
+        decompress_payload(payload_codec::lz77, data.data(), data.size(), &size);
+    }
+    catch(const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+SRFC_TEST(codec_lz77)
+{
+    std::string text;
+    for(int i = 0; text.size() < 100000; ++i) {
+        text += "LIST_SCAP 21.07.2018_" + std::to_string(i % 97) + ".png\n";
+    }
+
+    std::size_t size = 0;
+    const auto compressed = compress_payload(payload_codec::lz77, text.data(), text.size(), &size);
+    CHECK(compressed != nullptr);
+    if(compressed == nullptr) {
+        return;
+    }
+    CHECK(size < text.size());
+
+    std::size_t restoredSize = 0;
+    const auto restored = decompress_payload(payload_codec::lz77, compressed.get(), size, &restoredSize);
+    CHECK(restoredSize == text.size());
+    CHECK(std::memcmp(restored.get(), text.data(), text.size()) == 0);
+
+    // long runs make overlapping matches:
+    const std::string run(70000, 'a');
+    const auto compressedRun = compress_payload(payload_codec::lz77, run.data(), run.size(), &size);
+    CHECK(compressedRun != nullptr);
+    if(compressedRun != nullptr) {
+        const auto restoredRun = decompress_payload(payload_codec::lz77, compressedRun.get(), size, &restoredSize);
+        CHECK(restoredSize == run.size() && std::string(restoredRun.get(), restoredSize) == run);
+    }
+}
+
+SRFC_TEST(codec_sent_as_is)
+{
+    std::string text(10000, 'x');
+    std::size_t size = 0;
+
+    // small and incompressible payloads are sent as is:
+    std::string noise;
+    std::uint32_t seed = 12345;
+    for(int i = 0; i < 100000; ++i) {
+        seed = seed * 1664525 + 1013904223;
+        noise.push_back(static_cast<char>(seed >> 24));
+    }
+    CHECK(compress_payload(payload_codec::lz77, noise.data(), noise.size(), &size) == nullptr);
+    CHECK(compress_payload(payload_codec::lz77, text.data(), min_compressed_payload - 1, &size) == nullptr);
+    CHECK(compress_payload(payload_codec::none, text.data(), text.size(), &size) == nullptr);
+    CHECK(is_supported(payload_codec::lz77) && !is_supported(payload_codec::none));
+}
+
+SRFC_TEST(codec_lz77_corrupted)
+{
+    std::string text;
+    for(int i = 0; text.size() < 10000; ++i) {
+        text += "GETFILE_SCAP " + std::to_string(i % 13) + "\n";
+    }
+
+    std::size_t size = 0;
+    const auto compressed = compress_payload(payload_codec::lz77, text.data(), text.size(), &size);
+    CHECK(compressed != nullptr);
+    if(compressed == nullptr) {
+        return;
+    }
+    const std::string good(compressed.get(), size);
+
+    // truncated at every point:
+    for(std::size_t cut = 0; cut < good.size(); ++cut) {
+        CHECK(decompress_throws(good.substr(0, cut)));
+    }
+
+    // uncompressed size doesn't match the data, or is too large for it:
+    auto wrongSize = good;
+    wrongSize[0] = static_cast<char>(wrongSize[0] + 1);
+    CHECK(decompress_throws(wrongSize));
+
+    auto hugeSize = good;
+    std::memset(hugeSize.data(), 0xFF, 8);
+    CHECK(decompress_throws(hugeSize));
+
+    // back-reference before the beginning of the output:
+    const std::string badOffset = std::string("\x20\0\0\0\0\0\0\0", 8) + std::string("\x00\x05\x00", 3);
+    CHECK(decompress_throws(badOffset));
+
+    // any corrupted byte is either rejected or restored into a block of the original size:
+    for(std::size_t i = 8; i < good.size(); ++i) {
+        auto bad = good;
+        bad[i] = static_cast<char>(bad[i] ^ 0x5A);
+        try {
+            std::size_t restoredSize = 0;
+            decompress_payload(payload_codec::lz77, bad.data(), bad.size(), &restoredSize);
+            CHECK(restoredSize == text.size());
+        }
+        catch(const std::runtime_error&) {
+        }
+    }
+}
+
+SRFC_TEST(codec_max_size)
+{
+    const std::string text(100000, 'a');
+    std::size_t size = 0;
+    const auto compressed = compress_payload(payload_codec::lz77, text.data(), text.size(), &size);
+    CHECK(compressed != nullptr);
+    if(compressed == nullptr) {
+        return;
+    }
+
+    // the declared size is checked before anything is allocated:
+    std::size_t restoredSize = 0;
+    CHECK(decompress_payload(payload_codec::lz77, compressed.get(), size, &restoredSize, text.size()) != nullptr);
+    bool thrown = false;
+    try {
+        decompress_payload(payload_codec::lz77, compressed.get(), size, &restoredSize, text.size() - 1);
+    }
+    catch(const std::runtime_error&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+// A small frame whose payload decompresses beyond the max frame size of the receiver is rejected,
+// and the connection goes on:
+SRFC_TEST(codec_inflated_over_max_frame)
+{
+    using payload_t = srfc_connection::payload_t;
+
+    raw_peer peer;
+    srfc_connection connection(peer.port, std::string("127.0.0.1"), true);
+    connection.set_max_frame_size(min_max_frame_size);
+    connection.add_method("PRINT", srfc_connection::view_callback_t(
+        [](const srfc_message_view&, payload_t*, std::size_t*) { return status_codes::ok; }));
+    connection.invoke_deferred();
+    peer.accept();
+
+    srfc_message_view view;
+    CHECK(peer.read(view));
+    peer.write(srfc_response(view.getRequestId(), status_codes::unknown_method));
+
+    const auto send_compressed = [&peer](std::size_t originalSize) {
+        const std::string text(originalSize, 'a');
+        std::size_t size = 0;
+        const auto compressed = compress_payload(payload_codec::lz77, text.data(), text.size(), &size);
+
+        srfc_request request("PRINT");
+        request.setPayload(compressed, size);
+        request.setPayloadCodec(payload_codec::lz77);
+        CHECK(size < min_max_frame_size);
+        peer.write(request, wire_format::srfc_v2);
+        return request.getRequestId();
+    };
+
+    const auto tooLarge = send_compressed(4 * min_max_frame_size);
+    CHECK(peer.read(view));
+    CHECK(view.getRequestId() == tooLarge && view.getStatusCode() == status_codes::bad_request);
+
+    const auto small = send_compressed(1000);
+    CHECK(peer.read(view));
+    CHECK(view.getRequestId() == small && view.getStatusCode() == status_codes::ok);
+    CHECK(connection.is_connected());
+}
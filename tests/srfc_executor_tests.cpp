@@ -0,0 +1,173 @@
+// Work-stealing executor: the order of the own queue, stealing, try_submit() and when_space() on full queues,
+// and the handlers waiting for the collected responses on the shared executor.
+
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <vector>
+
+#include "srfc_loopback.hpp"
+
+#include "../network/includes/srfc_executor.hpp"
+#include "../network/includes/srfc_frame.hpp"
+
+using namespace net;
+using namespace srfc_test;
+
+SRFC_TEST(executor_runs_all)
+{
+    std::atomic<int> done{0};
+    {
+        srfc_executor executor(4, 16);
+        CHECK(executor.size() == 4);
+        for(int i = 0; i < 1000; ++i) {
+            executor.submit([&done] { ++done; });
+        }
+    }   // the queued tasks are finished before the workers exit
+    CHECK(done.load() == 1000);
+}
+
+// The worker takes the tasks it has submitted in the order of submission:
+SRFC_TEST(executor_own_queue_fifo)
+{
+    srfc_executor executor(1, 16);
+
+    std::mutex mutex;
+    std::vector<int> order;
+    std::promise<void> done;
+    executor.submit([&] {
+        for(int i = 0; i < 5; ++i) {
+            executor.submit([&, i] {
+                std::lock_guard<std::mutex> lg(mutex);
+                order.push_back(i);
+            });
+        }
+        executor.submit([&done] { done.set_value(); });
+    });
+
+    CHECK(done.get_future().wait_for(patience) == std::future_status::ready);
+    CHECK((order == std::vector<int>{0, 1, 2, 3, 4}));
+}
+
+// The tasks queued by a busy worker are stolen by the idle one:
+SRFC_TEST(executor_steals)
+{
+    srfc_executor executor(2, 16);
+
+    std::promise<bool> stolen;
+    executor.submit([&] {
+        std::atomic<int> done{0};
+        for(int i = 0; i < 3; ++i) {
+            executor.submit([&done] { ++done; });
+        }
+        // this worker is busy until the other one has run its tasks:
+        stolen.set_value(eventually([&done] { return done.load() == 3; }));
+    });
+
+    auto future = stolen.get_future();
+    CHECK(future.wait_for(patience) == std::future_status::ready && future.get());
+}
+
+SRFC_TEST(executor_full)
+{
+    srfc_executor executor(1, 2);
+
+    std::promise<void> go;
+    auto goFuture = go.get_future().share();
+    std::promise<void> started;
+    executor.submit([&started, goFuture] {
+        started.set_value();
+        goFuture.wait();
+    });
+    started.get_future().wait();
+
+    // the queue takes its capacity, and then leaves the tasks to the caller:
+    std::atomic<int> done{0};
+    srfc_executor::task_t task = [&done] { ++done; };
+    CHECK(executor.try_submit([&done] { ++done; }));
+    CHECK(executor.try_submit([&done] { ++done; }));
+    CHECK(!executor.try_submit(std::move(task)));
+    CHECK(task != nullptr);
+    CHECK(executor.pending() == 2);
+
+    // when_space() calls back once a worker takes a task:
+    std::promise<void> space;
+    executor.when_space([&space] { space.set_value(); });
+    auto spaceFuture = space.get_future();
+    CHECK(spaceFuture.wait_for(std::chrono::milliseconds(50)) == std::future_status::timeout);
+
+    go.set_value();
+    CHECK(spaceFuture.wait_for(patience) == std::future_status::ready);
+    CHECK(executor.try_submit(std::move(task)));
+    CHECK(eventually([&done] { return done.load() == 3; }));
+
+    // with free space, it calls back in place:
+    bool called = false;
+    executor.when_space([&called] { called = true; });
+    CHECK(called);
+}
+
+// Every worker of the shared executor runs a handler waiting for the response of another peer,
+// streamed in chunks. The chunks are collected on the I/O thread, so none of them waits for a worker:
+SRFC_TEST(executor_handlers_wait_for_chunked_responses)
+{
+    using payload_t = srfc_connection::payload_t;
+    const auto workers = srfc_executor::shared().size();
+    const std::string data(2 * srfc_connection::stream_chunk_size, 'c');
+
+    // the other peer answers with the chunks of the data on its own thread:
+    raw_peer peer;
+    srfc_connection relay(peer.port, std::string("127.0.0.1"), true);
+    relay.invoke_deferred();
+    peer.accept();
+    std::thread answering([&peer, &data, workers] {
+        srfc_message_view request;
+        if(!peer.read(request)) {
+            return;
+        }
+        peer.write(srfc_response(request.getRequestId(), status_codes::unknown_method));
+
+        for(std::size_t i = 0; i < workers && peer.read(request);) {
+            // the credits granted for the chunks of the previous answers:
+            if(request.getType() != frame_type::request) {
+                continue;
+            }
+            ++i;
+            for(std::size_t offset = 0; offset < data.size(); offset += srfc_connection::stream_chunk_size) {
+                std::size_t headerSize = 0;
+                const auto header = serialize_stream_header(frame_type::chunk, request.getRequestId(),
+                                                            srfc_connection::stream_chunk_size, 0,
+                                                            wire_format::srfc_v1, &headerSize);
+                peer.write(header.get(), headerSize);
+                peer.write(data.data() + offset, srfc_connection::stream_chunk_size);
+            }
+            peer.write(srfc_response(request.getRequestId(), status_codes::ok));
+        }
+    });
+    CHECK(relay.wait_handshake(patience));
+
+    loopback server;
+    server.listener.add_method("RELAY", srfc_connection::view_callback_t(
+        [&relay, &data](const srfc_message_view&, payload_t*, std::size_t*) {
+            auto future = relay.send_request(srfc_request("DATA"));
+            if(future.wait_for(patience) != std::future_status::ready) {
+                return status_codes::response_timeout;
+            }
+            std::size_t size = 0;
+            future.get().getPayload(&size);
+            return size == data.size() ? status_codes::ok : status_codes::execution_error;
+        }));
+    server.start();
+    const auto client = server.connect();
+
+    std::vector<std::future<srfc_response>> futures;
+    for(std::size_t i = 0; i < workers; ++i) {
+        futures.push_back(client->send_request(srfc_request("RELAY")));
+    }
+    for(auto& future : futures) {
+        CHECK(future.wait_for(2 * patience) == std::future_status::ready);
+        CHECK(future.get().getStatusCode() == status_codes::ok);
+    }
+
+    answering.join();
+}
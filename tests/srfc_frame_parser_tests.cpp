@@ -0,0 +1,98 @@
+// Frame parser: incomplete, ill-formed and wrapping frames.
+
+#include <cstdint>
+#include <limits>
+
+#include "srfc_test.hpp"
+
+#include "../network/includes/srfc_frame.hpp"
+
+using namespace net;
+using namespace srfc_test;
+
+SRFC_TEST(parser_truncated)
+{
+    for(const auto fmt : {wire_format::srfc_v1, wire_format::srfc_v2}) {
+        const auto request = make_request("truncated payload");
+
+        std::size_t size = 0;
+        const auto frame = request.serialize(&size, fmt);
+
+        // one parser fed byte by byte, and a fresh parser for every prefix:
+        srfc_frame_parser parser;
+        srfc_message_view view;
+        for(std::size_t available = 0; available < size; ++available) {
+            CHECK(parser.parse(frame, frame.get(), available, view) == parse_status::incomplete);
+
+            srfc_frame_parser fresh;
+            CHECK(fresh.parse(frame, frame.get(), available, view) == parse_status::incomplete);
+        }
+        CHECK(parser.parse(frame, frame.get(), size, view) == parse_status::ok);
+        CHECK(parser.frame_size() == size);
+    }
+}
+
+SRFC_TEST(parser_ill_formed_prefix)
+{
+    srfc_message_view view;
+
+    const auto notNumber = make_block(std::string(31, '0') + "x");
+    CHECK(parse_frame(notNumber, srfc_v1_preamble_size, view) == parse_status::invalid_preamble);
+
+    const auto tooShort = make_block(std::string(30, '0') + "32");
+    CHECK(parse_frame(tooShort, srfc_v1_preamble_size, view) == parse_status::invalid_preamble);
+
+    const auto tooLong = make_block(std::string(32, '9'));
+    CHECK(parse_frame(tooLong, srfc_v1_preamble_size, view) != parse_status::ok);
+
+    srfc_v2_header header;
+    header.version = 3;
+    std::shared_ptr<char> block(new char[srfc_v2_header::size], array_deleter<char>());
+    header.encode(block.get());
+    CHECK(parse_frame(block, srfc_v2_header::size, view) == parse_status::invalid_version);
+}
+
+SRFC_TEST(parser_ill_formed_header)
+{
+    // the method and parameters don't fit into the frame:
+    srfc_v2_header header;
+    header.type = static_cast<std::uint8_t>(frame_type::request);
+    header.method_length = 10;
+    header.params_length = 0;
+    header.payload_length = 0;
+
+    std::shared_ptr<char> block(new char[srfc_v2_header::size + 10], array_deleter<char>());
+    std::memset(block.get(), 'A', srfc_v2_header::size + 10);
+    header.encode(block.get());
+
+    srfc_message_view view;
+    CHECK(parse_frame(block, srfc_v2_header::size + 10, view) == parse_status::ok);
+
+    header.type = 0x7F;
+    header.encode(block.get());
+    CHECK(parse_frame(block, srfc_v2_header::size + 10, view) == parse_status::invalid_type);
+}
+
+// SRFCv2 header whose sizes don't fit into std::size_t:
+SRFC_TEST(parser_wrapping_header)
+{
+    constexpr auto max = std::numeric_limits<std::size_t>::max();
+
+    srfc_v2_header header;
+    header.type = static_cast<std::uint8_t>(frame_type::request);
+    header.method_length = 5;
+    header.params_length = 100;
+    header.payload_length = max - srfc_v2_header::size - 100;
+
+    std::shared_ptr<char> block(new char[srfc_v2_header::size], array_deleter<char>());
+    header.encode(block.get());
+
+    srfc_frame_parser parser;
+    srfc_message_view view;
+    CHECK(parser.parse(block, block.get(), srfc_v2_header::size, view) == parse_status::invalid_structure);
+
+    header.payload_length = std::numeric_limits<std::uint64_t>::max();
+    header.encode(block.get());
+    parser.reset();
+    CHECK(parser.parse(block, block.get(), srfc_v2_header::size, view) == parse_status::invalid_structure);
+}
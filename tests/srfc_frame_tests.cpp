@@ -0,0 +1,107 @@
+// SRFCv1 and SRFCv2 serialization: serialize -> parse round trips of requests and responses.
+
+#include "srfc_test.hpp"
+
+#include "../network/includes/srfc_frame.hpp"
+#include "../network/includes/srfc_response.hpp"
+
+using namespace net;
+using namespace srfc_test;
+
+SRFC_TEST(frame_request_round_trip)
+{
+    for(const auto fmt : {wire_format::srfc_v1, wire_format::srfc_v2}) {
+        const auto request = make_request("payload");
+
+        std::size_t size = 0;
+        const auto frame = request.serialize(&size, fmt);
+        CHECK(frame != nullptr && size > 0);
+
+        srfc_message_view view;
+        CHECK(parse_frame(frame, size, view) == parse_status::ok);
+        CHECK(view.getWireFormat() == fmt);
+        CHECK(view.getType() == frame_type::request);
+        CHECK(view.getRequestId() == request.getRequestId());
+        CHECK(view.getMethod() == "PRINT");
+        CHECK(view.getParams().size() == 2);
+        CHECK(view.getParam("MESSAGE") == "hello");
+        CHECK(view.getParam("INTERVAL") == "5");
+        CHECK(std::string(view.getPayloadData(), view.getPayloadSize()) == "payload");
+        CHECK(view.getFrameSize() == size);
+
+        const srfc_request copy(frame, size);
+        std::size_t payloadSize = 0;
+        const auto payload = copy.getPayload(&payloadSize);
+        CHECK(copy.getMethod() == "PRINT");
+        CHECK(copy.getRequestId() == request.getRequestId());
+        CHECK(copy.getParams() == request.getParams());
+        CHECK(std::string(payload.get(), payloadSize) == "payload");
+    }
+}
+
+SRFC_TEST(frame_response_round_trip)
+{
+    for(const auto fmt : {wire_format::srfc_v1, wire_format::srfc_v2}) {
+        srfc_response response(42, status_codes::unknown_method);
+        response.setPayload(make_block("not here"), 8);
+        response.setPriority(frame_priority::bulk);
+
+        std::size_t size = 0;
+        const auto frame = response.serialize(&size, fmt);
+
+        srfc_message_view view;
+        CHECK(parse_frame(frame, size, view) == parse_status::ok);
+        CHECK(view.getType() == frame_type::response);
+        CHECK(view.getRequestId() == 42);
+        CHECK(view.getStatusCode() == status_codes::unknown_method);
+        CHECK(std::string(view.getPayloadData(), view.getPayloadSize()) == "not here");
+        if(fmt == wire_format::srfc_v2) {
+            CHECK(view.getPriority() == frame_priority::bulk);
+        }
+
+        const srfc_response copy(frame, size);
+        CHECK(copy.getRequestId() == 42 && copy.getStatusCode() == status_codes::unknown_method);
+    }
+}
+
+SRFC_TEST(frame_empty_round_trip)
+{
+    for(const auto fmt : {wire_format::srfc_v1, wire_format::srfc_v2}) {
+        const srfc_request request("PING");
+
+        std::size_t size = 0;
+        const auto frame = request.serialize(&size, fmt);
+
+        srfc_message_view view;
+        CHECK(parse_frame(frame, size, view) == parse_status::ok);
+        CHECK(view.getMethod() == "PING");
+        CHECK(view.getParams().empty());
+        CHECK(view.getPayloadSize() == 0);
+    }
+}
+
+SRFC_TEST(frame_v2_header_round_trip)
+{
+    srfc_v2_header header;
+    header.type = static_cast<std::uint8_t>(frame_type::response);
+    header.flags = static_cast<std::uint16_t>(frame_priority::high);
+    header.param_count = 1;
+    header.request_id = 0x0102030405060708ull;
+    header.status = 404;
+    header.method_length = 1;
+    header.params_length = 2;
+    header.payload_length = 3;
+
+    char block[srfc_v2_header::size];
+    header.encode(block);
+
+    srfc_v2_header decoded;
+    CHECK(decoded.decode(block));
+    CHECK(decoded.type == header.type && decoded.flags == header.flags && decoded.param_count == 1);
+    CHECK(decoded.request_id == header.request_id && decoded.status == header.status);
+    CHECK(decoded.method_length == 1 && decoded.params_length == 2 && decoded.payload_length == 3);
+    CHECK(decoded.frame_size() == srfc_v2_header::size + 6);
+
+    block[0] = 'X';
+    CHECK(!decoded.decode(block));
+}
@@ -0,0 +1,158 @@
+// Handshake: the hello round trip, the capabilities agreed by two connections, the legacy peers,
+// and the wire format, method ids and limits taken from the hello of the peer.
+
+#include <future>
+#include <string>
+#include <vector>
+
+#include "srfc_loopback.hpp"
+
+#include "../network/includes/srfc_handshake.hpp"
+#include "../network/includes/srfc_response.hpp"
+
+using namespace net;
+using namespace srfc_test;
+
+using payload_t = srfc_connection::payload_t;
+
+static srfc_capabilities hello_round_trip(const srfc_request& hello)
+{
+    std::size_t size = 0;
+    const auto frame = hello.serialize(&size, wire_format::srfc_v1);
+    srfc_message_view view;
+    CHECK(parse_frame(frame, size, view) == parse_status::ok);
+    return read_hello(view);
+}
+
+SRFC_TEST(handshake_hello)
+{
+    auto caps = local_capabilities(1024 * 1024, 4096);
+    caps.methods = {"LIST_SCAP", "", "GETFILE_SCAP"};
+    const auto read = hello_round_trip(make_hello(caps));
+    CHECK(read.wire_formats == caps.wire_formats && read.codecs == caps.codecs && read.checksums == caps.checksums);
+    CHECK(read.max_frame_size == 1024 * 1024 && read.stream_window == 4096);
+    CHECK(read.features == caps.features);
+    CHECK(read.methods == caps.methods);
+    CHECK(accepts(read, wire_format::srfc_v2) && accepts(read, srfc_feature::batch));
+
+    // the missing parameters get the legacy values, unknown ones are ignored, and the limits are clamped:
+    srfc_request partial(hello_method);
+    partial.addParam("FORMATS", std::to_string(caps.wire_formats));
+    partial.addParam("MAX_FRAME", "1");
+    partial.addParam("FROM_THE_FUTURE", "42");
+    const auto legacy = legacy_capabilities();
+    const auto clamped = hello_round_trip(partial);
+    CHECK(accepts(clamped, wire_format::srfc_v2));
+    CHECK(clamped.max_frame_size == min_max_frame_size);
+    CHECK(clamped.features == legacy.features && clamped.codecs == legacy.codecs);
+    CHECK(clamped.stream_window == legacy.stream_window && clamped.methods.empty());
+
+    // SRFCv1 is always accepted, and the names are dropped unless all of them are read:
+    srfc_request broken(hello_method);
+    broken.addParam("FORMATS", "0");
+    broken.addParam("METHODS", "3");
+    broken.setPayload(make_block(std::string("A\0B\0", 4)), 4);
+    const auto read2 = hello_round_trip(broken);
+    CHECK(accepts(read2, wire_format::srfc_v1) && read2.methods.empty());
+}
+
+SRFC_TEST(handshake_agreed)
+{
+    loopback server;
+    server.listener.set_max_frame_size(2 * min_max_frame_size);
+    server.listener.set_stream_window(100000);
+    server.listener.add_method("PING", srfc_connection::view_callback_t(
+        [](const srfc_message_view&, payload_t*, std::size_t*) { return status_codes::ok; }));
+    server.start();
+
+    auto client = server.connect(true);
+    client->set_max_frame_size(3 * min_max_frame_size);
+    client->invoke_deferred();
+    CHECK(client->wait_handshake(patience));
+
+    const auto peer = client->get_peer_capabilities();
+    CHECK(peer.has_value());
+    if(peer) {
+        CHECK(peer->max_frame_size == 2 * min_max_frame_size && peer->stream_window == 100000);
+        CHECK(accepts(*peer, wire_format::srfc_v2) && accepts(*peer, srfc_feature::cancel));
+        CHECK(peer->methods.size() == 1 && peer->methods.front() == "PING");
+    }
+
+    auto* accepted = server.accepted(0);
+    CHECK(accepted != nullptr);
+    if(accepted != nullptr) {
+        CHECK(accepted->wait_handshake(patience));
+        const auto other = accepted->get_peer_capabilities();
+        CHECK(other.has_value() && other->max_frame_size == 3 * min_max_frame_size);
+    }
+
+    auto ping = client->send_request(srfc_request("PING"));
+    CHECK(ping.wait_for(patience) == std::future_status::ready);
+    CHECK(ping.get().getStatusCode() == status_codes::ok);
+}
+
+// The peer answering the hello with unknown_method gets SRFCv1 frames without the new header lines
+SRFC_TEST(handshake_legacy_peer)
+{
+    raw_peer peer;
+    srfc_connection connection(peer.port, std::string("127.0.0.1"), true);
+    connection.set_wire_format(wire_format::srfc_v2);
+    connection.invoke_deferred();
+    peer.accept();
+
+    srfc_message_view hello;
+    CHECK(peer.read(hello));
+    CHECK(hello.getMethod() == hello_method && hello.getWireFormat() == wire_format::srfc_v1);
+    CHECK(!connection.get_peer_capabilities().has_value());
+    peer.write(srfc_response(hello.getRequestId(), status_codes::unknown_method));
+    CHECK(connection.wait_handshake(patience));
+
+    const auto caps = connection.get_peer_capabilities();
+    CHECK(caps.has_value() && !accepts(*caps, wire_format::srfc_v2) && caps->features == 0);
+
+    auto future = connection.send_request(make_request("legacy"));
+    srfc_message_view request;
+    CHECK(peer.read(request));
+    CHECK(request.getWireFormat() == wire_format::srfc_v1 && request.getMethod() == "PRINT");
+    peer.write(srfc_response(request.getRequestId(), status_codes::ok));
+    CHECK(future.wait_for(patience) == std::future_status::ready);
+}
+
+// The peer announcing its hello: the requests are sent in its formats and name its methods by id
+SRFC_TEST(handshake_peer_hello)
+{
+    raw_peer peer;
+    srfc_connection connection(peer.port, std::string("127.0.0.1"), true);
+    connection.set_wire_format(wire_format::srfc_v2);
+    connection.invoke_deferred();
+    peer.accept();
+
+    srfc_message_view hello;
+    CHECK(peer.read(hello));
+
+    auto caps = local_capabilities(min_max_frame_size, 65536);
+    caps.methods = {"STAT", "PRINT"};
+    const auto own = make_hello(caps);
+    peer.write(own);
+    srfc_message_view answer;
+    CHECK(peer.read(answer));
+    CHECK(answer.getType() == frame_type::response && answer.getRequestId() == own.getRequestId());
+    CHECK(answer.getStatusCode() == status_codes::ok);
+    peer.write(srfc_response(hello.getRequestId(), status_codes::ok));
+    CHECK(connection.wait_handshake(patience));
+
+    auto future = connection.send_request(make_request("by id"));
+    srfc_message_view request;
+    CHECK(peer.read(request));
+    CHECK(request.getWireFormat() == wire_format::srfc_v2);
+    CHECK(request.getMethodId() == 1 && request.getParam("MESSAGE") == "hello");
+    peer.write(srfc_response(request.getRequestId(), status_codes::ok), wire_format::srfc_v2);
+    CHECK(future.wait_for(patience) == std::future_status::ready);
+    CHECK(future.get().getStatusCode() == status_codes::ok);
+
+    // a frame beyond the announced max frame size isn't sent:
+    const std::string large(2 * min_max_frame_size, 'x');
+    auto rejected = connection.send_request(make_request(large));
+    CHECK(rejected.wait_for(patience) == std::future_status::ready);
+    CHECK(rejected.get().getStatusCode() == status_codes::frame_too_large);
+}
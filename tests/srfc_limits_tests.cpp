@@ -0,0 +1,117 @@
+// Limits of the receivers: the max frame size and the memory budget, with the decompressed payloads charged to it.
+
+#include <future>
+#include <string>
+
+#include "srfc_loopback.hpp"
+
+#include "../network/includes/srfc_codec.hpp"
+
+using namespace net;
+using namespace srfc_test;
+
+SRFC_TEST(limits_oversized_frame)
+{
+    for(const auto fmt : {wire_format::srfc_v1, wire_format::srfc_v2}) {
+        const auto request = make_request(std::string(1000, 'x'));
+
+        std::size_t size = 0;
+        const auto frame = request.serialize(&size, fmt);
+
+        // rejected as soon as the prefix is received:
+        srfc_frame_parser parser;
+        srfc_message_view view;
+        parser.set_max_frame_size(size - 1);
+        CHECK(parser.parse(frame, frame.get(), frame_prefix_size(fmt), view) == parse_status::frame_too_large);
+
+        parser.reset();
+        CHECK(parser.get_max_frame_size() == size - 1);
+        parser.set_max_frame_size(size);
+        CHECK(parser.parse(frame, frame.get(), size, view) == parse_status::ok);
+    }
+}
+
+// Payload of originalSize bytes compressed with lz77:
+static std::shared_ptr<char> compressed_payload(std::size_t originalSize, std::size_t* pSize)
+{
+    std::string text;
+    for(int i = 0; text.size() < originalSize; ++i) {
+        text += "LIST_SCAP 21.07.2018_" + std::to_string(i % 97) + ".png\n";
+    }
+    text.resize(originalSize);
+
+    auto res = compress_payload(payload_codec::lz77, text.data(), text.size(), pSize);
+    CHECK(res != nullptr);
+    return res;
+}
+
+// The connection serves the raw peer, which doesn't handshake:
+static void start_legacy(raw_peer& peer, srfc_connection& connection)
+{
+    using payload_t = srfc_connection::payload_t;
+
+    connection.set_memory_budget(min_max_frame_size);
+    connection.add_method("PRINT", srfc_connection::view_callback_t(
+        [](const srfc_message_view&, payload_t*, std::size_t*) { return status_codes::ok; }));
+    connection.invoke_deferred();
+    peer.accept();
+
+    srfc_message_view hello;
+    CHECK(peer.read(hello));
+    peer.write(srfc_response(hello.getRequestId(), status_codes::unknown_method));
+    CHECK(connection.wait_handshake(patience));
+}
+
+SRFC_TEST(limits_inflated_request_over_budget)
+{
+    raw_peer peer;
+    srfc_connection connection(peer.port, std::string("127.0.0.1"), true);
+    start_legacy(peer, connection);
+
+    // the request decompresses within the max frame size, but beyond the budget:
+    const auto send_compressed = [&peer](std::size_t originalSize) {
+        std::size_t size = 0;
+        const auto payload = compressed_payload(originalSize, &size);
+        srfc_request request("PRINT");
+        request.setPayload(payload, size);
+        request.setPayloadCodec(payload_codec::lz77);
+        peer.write(request, wire_format::srfc_v2);
+        return request.getRequestId();
+    };
+
+    srfc_message_view view;
+    const auto tooLarge = send_compressed(2 * min_max_frame_size);
+    CHECK(peer.read(view));
+    CHECK(view.getRequestId() == tooLarge && view.getStatusCode() == status_codes::memory_budget_exceeded);
+
+    const auto small = send_compressed(min_max_frame_size / 4);
+    CHECK(peer.read(view));
+    CHECK(view.getRequestId() == small && view.getStatusCode() == status_codes::ok);
+
+    // nothing stays charged:
+    CHECK(eventually([&connection] { return connection.get_memory_usage().inbound == 0; }));
+}
+
+SRFC_TEST(limits_inflated_response_over_budget)
+{
+    raw_peer peer;
+    srfc_connection connection(peer.port, std::string("127.0.0.1"), true);
+    start_legacy(peer, connection);
+
+    auto future = connection.send_request(srfc_request("GET"));
+    srfc_message_view request;
+    CHECK(peer.read(request));
+
+    std::size_t size = 0;
+    const auto payload = compressed_payload(2 * min_max_frame_size, &size);
+    srfc_response response(request.getRequestId(), status_codes::ok);
+    response.setPayload(payload, size);
+    response.setPayloadCodec(payload_codec::lz77);
+    peer.write(response, wire_format::srfc_v2);
+
+    // the request fails, and the connection goes on:
+    CHECK(future.wait_for(patience) == std::future_status::ready);
+    CHECK(future.get().getStatusCode() == status_codes::memory_budget_exceeded);
+    CHECK(connection.is_connected());
+    CHECK(eventually([&connection] { return connection.get_memory_usage().inbound == 0; }));
+}
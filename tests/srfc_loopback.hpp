@@ -0,0 +1,214 @@
+#ifndef SRFC_LOOPBACK_HPP
+#define SRFC_LOOPBACK_HPP
+
+// Peers on the loopback interface for the tests of the connections (POSIX sockets only):
+//  - loopback: a listener on a free port, keeping the connections it accepts;
+//  - raw_peer: a bare socket reading and writing frames, standing for a peer that predates the handshake.
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "srfc_test.hpp"
+
+#include "../network/includes/srfc_listener.hpp"
+
+namespace srfc_test
+{
+    constexpr std::chrono::milliseconds patience{5000};   // of the waits that should succeed
+
+    // Polls the condition until it holds (false if it doesn't in time):
+    template<typename Condition>
+    bool eventually(Condition condition)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + patience;
+        while(!condition()) {
+            if(std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    // Listening socket bound to a free port of the loopback interface:
+    inline int bind_loopback(unsigned* pPort, int backlog = 64)
+    {
+        const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if(fd < 0) {
+            throw std::runtime_error("bind_loopback(unsigned* pPort): The socket() function failed");
+        }
+
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+        socklen_t length = sizeof(address);
+        if(::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(fd, backlog) < 0 ||
+           ::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) < 0) {
+            ::close(fd);
+            throw std::runtime_error("bind_loopback(unsigned* pPort): The socket can't be bound");
+        }
+
+        *pPort = ntohs(address.sin_port);
+        return fd;
+    }
+
+    // Free port (for the listeners binding their sockets on their own):
+    inline unsigned free_port()
+    {
+        unsigned port = 0;
+        ::close(bind_loopback(&port));
+        return port;
+    }
+
+    class loopback
+    {
+    public:
+        net::srfc_listener listener;
+        unsigned port = 0;
+
+        loopback() = default;
+        loopback(const loopback& other) = delete;
+        loopback& operator=(const loopback& other) = delete;
+        ~loopback() { stop(); }
+
+        // Methods and settings are added to the listener beforehand:
+        void start()
+        {
+            listener.on_connection([this](net::srfc_connection c) {
+                auto connection = std::make_unique<net::srfc_connection>(std::move(c));
+                connection->invoke_deferred();
+
+                std::lock_guard<std::mutex> lg(mutex);
+                connections.push_back(std::move(connection));
+                accepted_cv.notify_all();
+            });
+            listener.listen(bind_loopback(&port));
+        }
+
+        // The connection is handshaken (unless deferred):
+        std::unique_ptr<net::srfc_connection> connect(bool deferred = false) const
+        {
+            auto connection = std::make_unique<net::srfc_connection>(port, std::string("127.0.0.1"), deferred);
+            if(!deferred) {
+                CHECK(connection->wait_handshake(patience));
+            }
+            return connection;
+        }
+
+        // The i-th accepted connection (nullptr if it isn't accepted in time):
+        net::srfc_connection* accepted(std::size_t i)
+        {
+            std::unique_lock<std::mutex> ul(mutex);
+            accepted_cv.wait_for(ul, patience, [this, i] { return connections.size() > i; });
+            return connections.size() > i ? connections[i].get() : nullptr;
+        }
+
+        void stop()
+        {
+            listener.reset();
+
+            std::vector<std::unique_ptr<net::srfc_connection>> closed;
+            {
+                std::lock_guard<std::mutex> lg(mutex);
+                closed.swap(connections);
+            }
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable accepted_cv;
+        std::vector<std::unique_ptr<net::srfc_connection>> connections;
+    };
+
+    // Peer reading and writing whole frames with blocking calls:
+    class raw_peer
+    {
+    public:
+        unsigned port = 0;
+
+        raw_peer() : listen_fd(bind_loopback(&port, 1)) {}
+        raw_peer(const raw_peer& other) = delete;
+        raw_peer& operator=(const raw_peer& other) = delete;
+        ~raw_peer()
+        {
+            if(fd >= 0) {
+                ::close(fd);
+            }
+            ::close(listen_fd);
+        }
+
+        void accept()
+        {
+            fd = ::accept(listen_fd, nullptr, nullptr);
+            timeval timeout = {5, 0};
+            ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        }
+
+        // The next frame, and its bytes. Returns false if the peer has closed or nothing came in time:
+        bool read(net::srfc_message_view& view, std::string* pRaw = nullptr)
+        {
+            net::srfc_frame_parser parser;
+            for(;;) {
+                auto block = make_block(received);
+                const auto status = parser.parse(block, block.get(), received.size(), view);
+                if(status == net::parse_status::ok) {
+                    if(pRaw != nullptr) {
+                        *pRaw = received.substr(0, view.getFrameSize());
+                    }
+                    received.erase(0, view.getFrameSize());
+                    return true;
+                }
+                if(status != net::parse_status::incomplete) {
+                    return false;
+                }
+                parser.reset();
+
+                char buffer[65536];
+                const auto n = ::recv(fd, buffer, sizeof(buffer), 0);
+                if(n <= 0) {
+                    return false;
+                }
+                received.append(buffer, static_cast<std::size_t>(n));
+            }
+        }
+
+        template<typename message_t>
+        void write(const message_t& message, net::wire_format fmt = net::wire_format::srfc_v1)
+        {
+            std::size_t size = 0;
+            const auto frame = message.serialize(&size, fmt);
+            write(frame.get(), size);
+        }
+
+        void write(const char* data, std::size_t size)
+        {
+            while(size != 0) {
+                const auto n = ::send(fd, data, size, MSG_NOSIGNAL);
+                if(n <= 0) {
+                    return;
+                }
+                data += n;
+                size -= static_cast<std::size_t>(n);
+            }
+        }
+
+    private:
+        int listen_fd;
+        int fd = -1;
+        std::string received;
+    };
+} // namespace srfc_test
+
+#endif
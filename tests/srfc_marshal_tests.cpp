@@ -0,0 +1,136 @@
+// Typed methods: the layout of the marshaled values, truncated and oversized payloads,
+// and add_method<R(Args...)>() / call<R(Args...)>() over a connection (results, void, errors).
+
+#include <cstdint>
+#include <future>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "srfc_loopback.hpp"
+
+#include "../network/includes/srfc_marshal.hpp"
+
+using namespace net;
+using namespace srfc_test;
+
+namespace
+{
+    enum class color : std::uint16_t { red = 1, blue = 0x0203 };
+
+    struct point
+    {
+        double x;
+        double y;
+    };
+}
+
+SRFC_TEST(marshal_layout)
+{
+    std::size_t size = 0;
+    const auto packed = marshal_detail::pack(&size, std::int32_t(-2), std::string("ab"), true, color::blue);
+    const std::string expected("\xFE\xFF\xFF\xFF" "\x02\0\0\0" "ab" "\x01" "\x03\x02", 13);
+    CHECK(size == expected.size() && std::string(packed.get(), size) == expected);
+
+    std::tuple<std::int32_t, std::string, bool, color> values;
+    CHECK(marshal_detail::unpack(packed.get(), size, values));
+    CHECK(std::get<0>(values) == -2 && std::get<1>(values) == "ab" && std::get<2>(values) && std::get<3>(values) == color::blue);
+
+    // truncated anywhere, or with extra bytes:
+    for(std::size_t cut = 0; cut < size; ++cut) {
+        CHECK(!marshal_detail::unpack(packed.get(), cut, values));
+    }
+    const auto longer = expected + "x";
+    CHECK(!marshal_detail::unpack(longer.data(), longer.size(), values));
+
+    // views point into the payload:
+    const auto bytes = marshal_detail::pack(&size, std::vector<unsigned char>{1, 2, 3}, point{1.5, -2.5});
+    std::tuple<std::string_view, point> viewed;
+    CHECK(marshal_detail::unpack(bytes.get(), size, viewed));
+    CHECK(std::get<0>(viewed).data() == bytes.get() + 4 && std::get<0>(viewed) == "\x01\x02\x03");
+    CHECK(std::get<1>(viewed).x == 1.5 && std::get<1>(viewed).y == -2.5);
+
+    // nothing to write:
+    CHECK(marshal_detail::pack(&size) == nullptr && size == 0);
+}
+
+SRFC_TEST(marshal_call)
+{
+    loopback server;
+    std::promise<bool> flag;
+    server.listener.add_method<std::int32_t(std::int32_t, std::int32_t)>("ADD", [](std::int32_t a, std::int32_t b) {
+        return a + b;
+    });
+    server.listener.add_method<std::string(std::string_view, std::uint8_t)>("REPEAT",
+        [](std::string_view text, std::uint8_t times) {
+            std::string res;
+            for(std::uint8_t i = 0; i < times; ++i) {
+                res += text;
+            }
+            return res;
+        });
+    server.listener.add_method<point(point, double)>("SCALE", [](point p, double k) { return point{p.x * k, p.y * k}; });
+    server.listener.add_method<void(bool)>("SET", [&flag](bool value) { flag.set_value(value); });
+    server.start();
+    auto client = server.connect();
+
+    auto sum = client->call<std::int32_t(std::int32_t, std::int32_t)>("ADD", 40, 2);
+    CHECK(sum.wait_for(patience) == std::future_status::ready && sum.get() == 42);
+
+    // the arguments are converted to the types of the signature:
+    auto repeated = client->call<std::string(std::string, std::uint8_t)>("REPEAT", "ab", 3);
+    CHECK(repeated.wait_for(patience) == std::future_status::ready && repeated.get() == "ababab");
+
+    auto scaled = client->call<point(point, double)>("SCALE", point{1, -2}, 2.0);
+    CHECK(scaled.wait_for(patience) == std::future_status::ready);
+    const auto p = scaled.get();
+    CHECK(p.x == 2 && p.y == -4);
+
+    auto set = client->call<void(bool)>("SET", true);
+    CHECK(set.wait_for(patience) == std::future_status::ready);
+    set.get();
+    CHECK(flag.get_future().get());
+}
+
+SRFC_TEST(marshal_call_errors)
+{
+    loopback server;
+    server.listener.add_method<std::int32_t(std::int32_t, std::int32_t)>("ADD", [](std::int32_t a, std::int32_t b) {
+        return a + b;
+    });
+    server.start();
+    auto client = server.connect();
+
+    const auto status_of = [](auto future) {
+        if(future.wait_for(patience) != std::future_status::ready) {
+            return status_codes::none;
+        }
+        try {
+            future.get();
+        }
+        catch(const srfc_call_error& e) {
+            return e.getStatusCode();
+        }
+        return status_codes::ok;
+    };
+
+    // the arguments don't match the signature of the method:
+    CHECK(status_of(client->call<std::int32_t(std::int32_t)>("ADD", 1)) == status_codes::bad_request);
+    CHECK(status_of(client->call<std::int32_t(std::int64_t, std::int32_t)>("ADD", 1, 2)) == status_codes::bad_request);
+    CHECK(status_of(client->call<void()>("MISSING")) == status_codes::unknown_method);
+
+    // the result doesn't match the expected type:
+    auto wrongResult = client->call<std::int64_t(std::int32_t, std::int32_t)>("ADD", 1, 2);
+    CHECK(wrongResult.wait_for(patience) == std::future_status::ready);
+    bool thrown = false;
+    try {
+        wrongResult.get();
+    }
+    catch(const srfc_call_error&) {
+    }
+    catch(const std::runtime_error&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
@@ -0,0 +1,92 @@
+// Method ids: the ids on the wire and the dispatch table.
+
+#include <stdexcept>
+
+#include "srfc_test.hpp"
+
+#include "../network/includes/srfc_frame.hpp"
+#include "../network/includes/srfc_method_table.hpp"
+
+using namespace net;
+using namespace srfc_test;
+
+SRFC_TEST(method_id_on_the_wire)
+{
+    for(const auto fmt : {wire_format::srfc_v1, wire_format::srfc_v2}) {
+        const auto request = make_request("");
+
+        std::size_t headerSize = 0;
+        const auto header = request.serializeHeader(&headerSize, fmt, frame_checksum::none, 7);
+        CHECK(headerSize == request.getHeaderSize(fmt, frame_checksum::none, 7));
+
+        srfc_message_view view;
+        CHECK(parse_frame(header, headerSize, view) == parse_status::ok);
+        CHECK(view.getMethodId() == 7);
+        CHECK(view.getMethod().empty());
+        CHECK(view.getParam("MESSAGE") == "hello");
+
+        // without the id the method is named:
+        const auto named = request.serializeHeader(&headerSize, fmt, frame_checksum::none, no_method_id);
+        CHECK(parse_frame(named, headerSize, view) == parse_status::ok);
+        CHECK(view.getMethodId() == no_method_id);
+        CHECK(view.getMethod() == "PRINT");
+    }
+}
+
+SRFC_TEST(method_table_ids)
+{
+    using table_t = srfc_method_table;
+    const table_t::view_callback_t ok = [](const srfc_message_view&, table_t::payload_t*, std::size_t*) {
+        return status_codes::ok;
+    };
+
+    table_t table;
+    const auto a = table.add("A", ok);
+    const auto b = table.add("B", ok);
+    CHECK(a == 0 && b == 1);
+    CHECK(table.size() == 2);
+    CHECK(table.id_of("B") == b && table.id_of("C") == no_method_id);
+    CHECK(table.name_of(a) == "A");
+
+    // by id and by name:
+    CHECK(table.find(b) != nullptr && table.find(b)->name == "B");
+    CHECK(table.find("A") == table.find(a));
+    CHECK(table.find(42) == nullptr && table.find("C") == nullptr);
+
+    // a replaced or removed method keeps its id, so the announced ids stay valid:
+    CHECK(table.add("A", ok) == a);
+    CHECK(table.remove("A"));
+    CHECK(!table.remove("A"));
+    CHECK(table.find(a) == nullptr && table.find("A") == nullptr);
+    CHECK(table.add("A", ok) == a);
+    CHECK(table.size() == 2);
+
+    bool thrown = false;
+    try {
+        table.at("B", method_kind::stream);
+    }
+    catch(const std::out_of_range&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    CHECK(table.at("B", method_kind::view).kind == method_kind::view);
+
+    table.clear();
+    CHECK(table.size() == 0 && table.find("B") == nullptr);
+}
+
+SRFC_TEST(method_table_outlives_copy)
+{
+    using table_t = srfc_method_table;
+    table_t table;
+    table.add("A", table_t::view_callback_t([](const srfc_message_view&, table_t::payload_t*, std::size_t*) {
+        return status_codes::ok;
+    }));
+
+    // the entries are shared by the copies, and outlive the table:
+    auto entry = table.entry("A");
+    table_t copy = table;
+    CHECK(copy.entry("A") == entry);
+    table.clear();
+    CHECK(entry->kind == method_kind::view && entry->name == "A");
+}
@@ -0,0 +1,90 @@
+// Priority lanes: the priority on the wire, high-priority calls overtaking a bulk transfer,
+// and the peers predating the priority.
+
+#include <chrono>
+#include <future>
+
+#include "srfc_loopback.hpp"
+
+using namespace net;
+using namespace srfc_test;
+
+SRFC_TEST(priority_on_the_wire)
+{
+    for(const auto fmt : {wire_format::srfc_v1, wire_format::srfc_v2}) {
+        auto request = make_request("");
+        request.setPriority(frame_priority::high);
+
+        std::size_t size = 0;
+        const auto frame = request.serialize(&size, fmt);
+
+        srfc_message_view view;
+        CHECK(parse_frame(frame, size, view) == parse_status::ok);
+        CHECK(view.getPriority() == frame_priority::high);
+        CHECK(view.getMethod() == "PRINT");
+    }
+}
+
+SRFC_TEST(priority_overtakes_bulk)
+{
+    constexpr std::size_t bulkSize = 32 * 1024 * 1024;
+    using payload_t = srfc_connection::payload_t;
+
+    loopback server;
+    server.listener.add_method("BULK", srfc_connection::view_callback_t(
+        [](const srfc_message_view&, payload_t* pPayload, std::size_t* pSize) {
+            *pPayload = payload_t(new char[bulkSize], array_deleter<char>());
+            std::memset(pPayload->get(), 'b', bulkSize);
+            *pSize = bulkSize;
+            return status_codes::ok;
+        }));
+    server.listener.add_method("PING", srfc_connection::view_callback_t(
+        [](const srfc_message_view&, payload_t*, std::size_t*) { return status_codes::ok; }));
+    server.start();
+    const auto client = server.connect();
+
+    srfc_request bulk("BULK");
+    bulk.setPriority(frame_priority::bulk);
+    srfc_request ping("PING");
+    ping.setPriority(frame_priority::high);
+
+    // the ping is answered while the bulk response is still being chunked:
+    auto bulkFuture = client->send_request(bulk);
+    auto pingFuture = client->send_request(ping);
+    CHECK(pingFuture.wait_for(patience) == std::future_status::ready);
+    CHECK(pingFuture.get().getStatusCode() == status_codes::ok);
+    CHECK(bulkFuture.wait_for(std::chrono::seconds(0)) != std::future_status::ready);
+
+    CHECK(bulkFuture.wait_for(patience) == std::future_status::ready);
+    std::size_t size = 0;
+    const auto response = bulkFuture.get();
+    const auto payload = response.getPayload(&size);
+    CHECK(response.getStatusCode() == status_codes::ok && size == bulkSize);
+    CHECK(size == bulkSize && payload.get()[0] == 'b' && payload.get()[size - 1] == 'b');
+}
+
+// A peer that doesn't handshake reads the "PRIO" line as the method name, so it gets the requests as normal:
+SRFC_TEST(priority_legacy_peer)
+{
+    raw_peer peer;
+    srfc_connection client(peer.port, std::string("127.0.0.1"));
+    peer.accept();
+
+    srfc_message_view view;
+    CHECK(peer.read(view));
+    peer.write(srfc_response(view.getRequestId(), status_codes::unknown_method));
+    CHECK(client.wait_handshake(patience));
+
+    auto request = make_request("urgent");
+    request.setPriority(frame_priority::high);
+    auto future = client.send_request(request);
+
+    std::string raw;
+    CHECK(peer.read(view, &raw));
+    CHECK(raw.find("PRIO") == std::string::npos);
+    CHECK(view.getMethod() == "PRINT" && view.getPriority() == frame_priority::normal);
+
+    peer.write(srfc_response(view.getRequestId(), status_codes::ok));
+    CHECK(future.wait_for(patience) == std::future_status::ready);
+    CHECK(future.get().getStatusCode() == status_codes::ok);
+}
@@ -0,0 +1,532 @@
+// Reactor: readability, writability and hang-ups of the registered sockets, want_read() / want_write(),
+// remove() and the loops the sockets are spread over (on epoll, and on io_uring where the kernel has it).
+// The completions of the io_uring backend: receives, sends and accepts, and the fallback to epoll.
+
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "srfc_loopback.hpp"
+
+#include "../network/includes/srfc_frame.hpp"
+#include "../network/includes/srfc_reactor.hpp"
+
+using namespace net;
+using namespace srfc_test;
+
+namespace
+{
+    // Connected pair of non-blocking sockets, closed at the end of the test:
+    struct socket_pair
+    {
+        int fds[2] = {-1, -1};
+
+        socket_pair()
+        {
+            CHECK(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == 0);
+        }
+        ~socket_pair()
+        {
+            close(0);
+            close(1);
+        }
+
+        void close(int i)
+        {
+            if(fds[i] >= 0) {
+                ::close(fds[i]);
+                fds[i] = -1;
+            }
+        }
+    };
+
+    // Events received by the handler:
+    struct recorder
+    {
+        std::mutex mutex;
+        std::vector<std::uint32_t> events;
+        std::atomic<int> calls{0};
+
+        srfc_reactor::handler_t handler()
+        {
+            return [this](std::uint32_t ev) {
+                std::lock_guard<std::mutex> lg(mutex);
+                events.push_back(ev);
+                ++calls;
+            };
+        }
+
+        bool seen(std::uint32_t ev)
+        {
+            std::lock_guard<std::mutex> lg(mutex);
+            for(const auto e : events) {
+                if((e & ev) != 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void clear()
+        {
+            std::lock_guard<std::mutex> lg(mutex);
+            events.clear();
+        }
+    };
+}
+
+template<typename Test>
+static void on_each_backend(Test test)
+{
+    srfc_reactor epoll(2, false);
+    CHECK(!epoll.uses_io_uring() && !epoll.completes_io());
+    test(epoll);
+
+    srfc_reactor ring(2, true);
+    if(ring.uses_io_uring()) {
+        CHECK(ring.completes_io());
+        test(ring);
+    }
+}
+
+// The completions need the io_uring backend (nullptr if the kernel doesn't have it):
+static std::unique_ptr<srfc_reactor> completing_reactor()
+{
+    auto reactor = std::make_unique<srfc_reactor>(1, true);
+    return reactor->completes_io() ? std::move(reactor) : nullptr;
+}
+
+SRFC_TEST(reactor_readable)
+{
+    on_each_backend([](srfc_reactor& reactor) {
+        socket_pair pair;
+        std::promise<bool> inLoop;
+        std::atomic<bool> first{true};
+        std::string received;
+        std::mutex mutex;
+        srfc_reactor::token_t token = 0;
+        token = reactor.add(pair.fds[0], [&](std::uint32_t ev) {
+            if((ev & io_events::readable) == 0) {
+                return;
+            }
+            char buffer[64];
+            const auto n = ::recv(pair.fds[0], buffer, sizeof(buffer), 0);
+            std::lock_guard<std::mutex> lg(mutex);
+            if(n > 0) {
+                received.append(buffer, static_cast<std::size_t>(n));
+            }
+            if(first.exchange(false)) {
+                inLoop.set_value(reactor.in_loop(reactor.loop_of(token)));
+            }
+        });
+        CHECK(token != 0);
+
+        CHECK(::send(pair.fds[1], "ping", 4, 0) == 4);
+        auto future = inLoop.get_future();
+        CHECK(future.wait_for(patience) == std::future_status::ready);
+        CHECK(future.get());
+        CHECK(eventually([&] {
+            std::lock_guard<std::mutex> lg(mutex);
+            return received == "ping";
+        }));
+        CHECK(!reactor.in_loop(reactor.loop_of(token)));
+
+        // level-triggered: the data left in the socket is reported again
+        CHECK(::send(pair.fds[1], "again", 5, 0) == 5);
+        CHECK(eventually([&] {
+            std::lock_guard<std::mutex> lg(mutex);
+            return received == "pingagain";
+        }));
+        reactor.remove(token);
+    });
+}
+
+SRFC_TEST(reactor_want_read_and_write)
+{
+    on_each_backend([](srfc_reactor& reactor) {
+        socket_pair pair;
+        recorder rec;
+        const auto token = reactor.add(pair.fds[0], rec.handler());
+
+        // writability is reported only when it's wanted:
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        CHECK(!rec.seen(io_events::writable));
+        reactor.want_write(token, true);
+        CHECK(eventually([&rec] { return rec.seen(io_events::writable); }));
+        reactor.want_write(token, false);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        rec.clear();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        CHECK(!rec.seen(io_events::writable));
+
+        // readability isn't reported while the reads are paused, and the data waits in the socket:
+        reactor.want_read(token, false);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        rec.clear();
+        CHECK(::send(pair.fds[1], "x", 1, 0) == 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        CHECK(!rec.seen(io_events::readable));
+        reactor.want_read(token, true);
+        CHECK(eventually([&rec] { return rec.seen(io_events::readable); }));
+        reactor.remove(token);
+    });
+}
+
+SRFC_TEST(reactor_closed)
+{
+    on_each_backend([](srfc_reactor& reactor) {
+        socket_pair pair;
+        std::atomic<bool> hungUp{false};
+        const auto token = reactor.add(pair.fds[0], [&](std::uint32_t ev) {
+            char buffer[16];
+            if(::recv(pair.fds[0], buffer, sizeof(buffer), 0) == 0 || (ev & io_events::closed) != 0) {
+                hungUp = true;
+            }
+        });
+
+        pair.close(1);
+        CHECK(eventually([&hungUp] { return hungUp.load(); }));
+        reactor.remove(token);
+    });
+}
+
+// When remove() returns, the handler doesn't run and isn't called again
+SRFC_TEST(reactor_remove)
+{
+    on_each_backend([](srfc_reactor& reactor) {
+        socket_pair pair;
+        std::atomic<bool> running{false};
+        std::atomic<bool> removed{false};
+        std::atomic<int> late{0};
+        const auto token = reactor.add(pair.fds[0], [&](std::uint32_t) {
+            running = true;
+            if(removed.load()) {
+                ++late;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            running = false;
+        });
+
+        // the handler is busy with the unread data when the socket is removed:
+        CHECK(::send(pair.fds[1], "x", 1, 0) == 1);
+        CHECK(eventually([&running] { return running.load(); }));
+        reactor.remove(token);
+        CHECK(!running.load());
+        removed = true;
+
+        CHECK(::send(pair.fds[1], "y", 1, 0) == 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        CHECK(late.load() == 0);
+
+        // the socket is still open and may be registered again:
+        std::atomic<bool> again{false};
+        const auto second = reactor.add(pair.fds[0], [&again](std::uint32_t) { again = true; });
+        CHECK(second != token);
+        CHECK(eventually([&again] { return again.load(); }));
+        reactor.remove(second);
+    });
+}
+
+// The sockets are spread over the loops, and a handler never runs concurrently with itself
+SRFC_TEST(reactor_loops)
+{
+    on_each_backend([](srfc_reactor& reactor) {
+        CHECK(reactor.size() == 2);
+
+        std::vector<std::unique_ptr<socket_pair>> pairs;
+        std::vector<srfc_reactor::token_t> tokens;
+        std::atomic<int> overlapped{0};
+        std::atomic<int> reads{0};
+        std::vector<std::unique_ptr<std::atomic<int>>> inside;
+        for(int i = 0; i < 4; ++i) {
+            pairs.push_back(std::make_unique<socket_pair>());
+            inside.push_back(std::make_unique<std::atomic<int>>(0));
+            const int fd = pairs.back()->fds[0];
+            auto* pInside = inside.back().get();
+            tokens.push_back(reactor.add(fd, [&, fd, pInside](std::uint32_t) {
+                if(pInside->fetch_add(1) != 0) {
+                    ++overlapped;
+                }
+                char buffer[64];
+                while(::recv(fd, buffer, sizeof(buffer), 0) > 0) {
+                    ++reads;
+                }
+                --*pInside;
+            }));
+        }
+        CHECK(reactor.loop_of(tokens[0]) != reactor.loop_of(tokens[1]));
+        CHECK(reactor.loop_of(tokens[2]) != reactor.loop_of(tokens[3]));
+
+        // the loop is chosen by the caller:
+        socket_pair pinned;
+        const auto onLoop1 = reactor.add(pinned.fds[0], [](std::uint32_t) {}, 1);
+        CHECK(reactor.loop_of(onLoop1) == 1);
+        reactor.remove(onLoop1);
+
+        for(int round = 0; round < 100; ++round) {
+            for(auto& pair : pairs) {
+                CHECK(::send(pair->fds[1], "z", 1, 0) == 1);
+            }
+        }
+        CHECK(eventually([&reads] { return reads.load() >= 4; }));
+        for(const auto token : tokens) {
+            reactor.remove(token);
+        }
+        CHECK(overlapped.load() == 0);
+    });
+}
+
+// Without io_uring the handlers do the I/O: the completion-based registrations are refused
+SRFC_TEST(reactor_completions_fallback)
+{
+    srfc_reactor reactor(1, false);
+    CHECK(!reactor.completes_io());
+
+    socket_pair pair;
+    bool thrown = false;
+    try {
+        reactor.add_stream(pair.fds[0], [](std::uint32_t) {}, [](const char*, std::size_t) {}, [](std::ptrdiff_t) {});
+    }
+    catch(const std::logic_error&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    thrown = false;
+    try {
+        reactor.add_acceptor(pair.fds[0], [](int) {});
+    }
+    catch(const std::logic_error&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+// The received bytes come in order through the buffers of the loop, also across paused reads,
+// and the hang-up comes as an empty receive
+SRFC_TEST(reactor_completions_receive)
+{
+    const auto reactor = completing_reactor();
+    if(reactor == nullptr) {
+        return;
+    }
+
+    socket_pair pair;
+    std::mutex mutex;
+    std::string received;
+    std::atomic<bool> closed{false};
+    const auto token = reactor->add_stream(pair.fds[0], [](std::uint32_t) {},
+        [&](const char* data, std::size_t size) {
+            if(size == 0) {
+                closed = true;
+                return;
+            }
+            std::lock_guard<std::mutex> lg(mutex);
+            received.append(data, size);
+        },
+        [](std::ptrdiff_t) {});
+    const auto size_of_received = [&] {
+        std::lock_guard<std::mutex> lg(mutex);
+        return received.size();
+    };
+
+    // more than all the buffers of the loop hold:
+    std::string data;
+    for(std::size_t i = 0; data.size() < 8 * 1024 * 1024; ++i) {
+        data += std::to_string(i) + ' ';
+    }
+    std::thread writer([&pair, &data] {
+        std::size_t offset = 0;
+        while(offset < data.size()) {
+            const auto n = ::send(pair.fds[1], data.data() + offset, std::min<std::size_t>(data.size() - offset, 100000), 0);
+            if(n > 0) {
+                offset += static_cast<std::size_t>(n);
+            }
+            else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    });
+
+    // paused in the middle: the data waits in the socket
+    CHECK(eventually([&] { return size_of_received() > 0; }));
+    reactor->want_read(token, false);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    const auto paused = size_of_received();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(size_of_received() == paused);
+    reactor->want_read(token, true);
+
+    writer.join();
+    CHECK(eventually([&] { return size_of_received() == data.size(); }));
+    {
+        std::lock_guard<std::mutex> lg(mutex);
+        CHECK(received == data);
+    }
+
+    pair.close(1);
+    CHECK(eventually([&closed] { return closed.load(); }));
+    reactor->remove(token);
+}
+
+// Writability is reported when the writes are wanted and after each completed send.
+// The buffers are held until the send completes
+SRFC_TEST(reactor_completions_send)
+{
+    const auto reactor = completing_reactor();
+    if(reactor == nullptr) {
+        return;
+    }
+
+    socket_pair pair;
+    recorder rec;
+    std::atomic<std::ptrdiff_t> sent{0};
+    std::atomic<int> sends{0};
+    const auto token = reactor->add_stream(pair.fds[0], rec.handler(), [](const char*, std::size_t) {},
+        [&](std::ptrdiff_t n) {
+            sent += n;
+            ++sends;
+        });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(!rec.seen(io_events::writable));
+    reactor->want_write(token, true);
+    CHECK(eventually([&rec] { return rec.seen(io_events::writable); }));
+
+    // a gather list of two parts:
+    auto held = std::make_shared<std::string>("hello, ");
+    std::weak_ptr<std::string> weak = held;
+    const std::string world = "world";
+    const const_buffer parts[] = {{held->data(), held->size()}, {world.data(), world.size()}};
+    rec.clear();
+    CHECK(reactor->send(token, parts, 2, std::move(held)));
+    CHECK(eventually([&sends] { return sends.load() >= 1; }));
+    CHECK(eventually([&weak] { return weak.expired(); }));
+    CHECK(eventually([&rec] { return rec.seen(io_events::writable); }));
+
+    std::string received(64, '\0');
+    std::size_t total = 0;
+    CHECK(eventually([&] {
+        const auto n = ::recv(pair.fds[1], received.data() + total, received.size() - total, 0);
+        total += n > 0 ? static_cast<std::size_t>(n) : 0;
+        return total >= 12;
+    }));
+    CHECK(received.substr(0, total).rfind("hello, world", 0) == 0);
+
+    // not reported anymore once the writes aren't wanted:
+    reactor->want_write(token, false);
+    CHECK(reactor->send(token, parts + 1, 1, nullptr));
+    CHECK(eventually([&sends] { return sends.load() >= 2; }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    rec.clear();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(!rec.seen(io_events::writable));
+
+    reactor->remove(token);
+    CHECK(!reactor->send(token, parts, 1, nullptr));
+}
+
+// One send in flight. A send blocked by the full socket is cancelled by remove(): its buffers are released
+// once it completes
+SRFC_TEST(reactor_completions_remove)
+{
+    const auto reactor = completing_reactor();
+    if(reactor == nullptr) {
+        return;
+    }
+
+    socket_pair pair;
+    std::atomic<int> sends{0};
+    const auto token = reactor->add_stream(pair.fds[0], [](std::uint32_t) {}, [](const char*, std::size_t) {},
+        [&sends](std::ptrdiff_t) { ++sends; });
+
+    // the socket buffers are full (nobody reads them):
+    const std::string filler(65536, 'f');
+    while(::send(pair.fds[0], filler.data(), filler.size(), MSG_DONTWAIT) > 0);
+    auto block = std::make_shared<std::string>(65536, 'x');
+    std::weak_ptr<std::string> weak = block;
+    const const_buffer part = {block->data(), block->size()};
+    CHECK(reactor->send(token, &part, 1, std::move(block)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(!weak.expired());
+
+    bool thrown = false;
+    try {
+        reactor->send(token, &part, 1, nullptr);
+    }
+    catch(const std::logic_error&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    reactor->remove(token);
+    CHECK(eventually([&weak] { return weak.expired(); }));
+    CHECK(sends.load() == 0);
+}
+
+// The accepted sockets are passed to the handler until the accepts are paused
+SRFC_TEST(reactor_completions_accept)
+{
+    const auto reactor = completing_reactor();
+    if(reactor == nullptr) {
+        return;
+    }
+
+    unsigned port = 0;
+    const int listening = bind_loopback(&port);
+    std::mutex mutex;
+    std::vector<int> accepted;
+    const auto token = reactor->add_acceptor(listening, [&](int fd) {
+        std::lock_guard<std::mutex> lg(mutex);
+        accepted.push_back(fd);
+    });
+    const auto accepted_count = [&] {
+        std::lock_guard<std::mutex> lg(mutex);
+        return accepted.size();
+    };
+
+    const auto connect_client = [port] {
+        const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(static_cast<std::uint16_t>(port));
+        CHECK(::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+        return fd;
+    };
+
+    std::vector<int> clients;
+    for(int i = 0; i < 3; ++i) {
+        clients.push_back(connect_client());
+    }
+    CHECK(eventually([&] { return accepted_count() == 3; }));
+
+    // paused: the connections wait in the backlog
+    reactor->want_read(token, false);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    clients.push_back(connect_client());
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(accepted_count() == 3);
+    reactor->want_read(token, true);
+    CHECK(eventually([&] { return accepted_count() == 4; }));
+
+    // the accepted sockets are non-blocking:
+    {
+        std::lock_guard<std::mutex> lg(mutex);
+        for(const auto fd : accepted) {
+            CHECK((::fcntl(fd, F_GETFL, 0) & O_NONBLOCK) != 0);
+            ::close(fd);
+        }
+    }
+    reactor->remove(token);
+    for(const auto fd : clients) {
+        ::close(fd);
+    }
+    ::close(listening);
+}
@@ -0,0 +1,115 @@
+// Receive ring: reading into the block, the views sharing it, the adaptive read size,
+// and the blocks grown for large messages given back once the messages are released.
+
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "srfc_test.hpp"
+
+#include "../network/includes/srfc_receive_buffer.hpp"
+
+using namespace net;
+using namespace srfc_test;
+
+static void write(srfc_receive_buffer& buffer, const std::string& data)
+{
+    std::memcpy(buffer.prepare(data.size()), data.data(), data.size());
+    buffer.commit(data.size());
+}
+
+SRFC_TEST(receive_buffer_ring)
+{
+    srfc_receive_buffer buffer(64);
+    write(buffer, "first");
+    write(buffer, "second");
+    CHECK(buffer.size() == 11 && std::string(buffer.data(), 11) == "firstsecond");
+
+    // the consumed block is reused from the beginning:
+    const auto* start = buffer.data();
+    buffer.consume(11);
+    CHECK(buffer.size() == 0);
+    write(buffer, "third");
+    CHECK(buffer.data() == start && buffer.get_capacity() == 64);
+
+    // the unread tail is moved to the beginning when the end is reached:
+    write(buffer, std::string(50, 'x'));
+    buffer.consume(50);
+    write(buffer, std::string(40, 'y'));
+    CHECK(buffer.data() == start && std::string(buffer.data(), 5) == "xxxxx" && buffer.size() == 45);
+}
+
+SRFC_TEST(receive_buffer_shared)
+{
+    srfc_receive_buffer buffer(64);
+    write(buffer, std::string(40, 'a'));
+
+    // the block viewed by a message is never overwritten:
+    const auto view = buffer.block();
+    buffer.consume(30);
+    write(buffer, std::string(40, 'b'));
+    CHECK(buffer.block() != view);
+    CHECK(std::string(view.get(), 40) == std::string(40, 'a'));
+    CHECK(std::string(buffer.data(), buffer.size()) == std::string(10, 'a') + std::string(40, 'b'));
+}
+
+SRFC_TEST(receive_buffer_read_size)
+{
+    srfc_receive_buffer buffer;
+    const auto initial = buffer.read_size();
+    buffer.adapt(initial, initial);
+    CHECK(buffer.read_size() == 2 * initial);
+    for(int i = 0; i < 20; ++i) {
+        buffer.adapt(buffer.read_size(), buffer.read_size());
+    }
+    CHECK(buffer.read_size() == srfc_receive_buffer::max_read_size);
+    buffer.adapt(buffer.read_size(), 1);
+    CHECK(buffer.read_size() == srfc_receive_buffer::max_read_size / 2);
+}
+
+// The block grown for a large message is replaced by a ring-sized one; the view of the message keeps the large one
+SRFC_TEST(receive_buffer_shrinks)
+{
+    constexpr std::size_t large = 4 * srfc_receive_buffer::max_ring_capacity;
+    const std::string message(large, 'L');
+
+    srfc_receive_buffer buffer;
+    write(buffer, message);
+    CHECK(buffer.get_capacity() >= large);
+
+    std::weak_ptr<char> released;
+    {
+        const auto view = buffer.block();
+        released = view;
+        buffer.consume(large);
+        CHECK(buffer.get_capacity() <= srfc_receive_buffer::max_ring_capacity);
+        CHECK(std::memcmp(view.get(), message.data(), large) == 0);
+    }
+    CHECK(released.expired());
+
+    // nothing views it:
+    write(buffer, message);
+    CHECK(buffer.get_capacity() >= large);
+    buffer.consume(large);
+    CHECK(buffer.get_capacity() <= srfc_receive_buffer::max_ring_capacity);
+}
+
+// The part of the next message read with the large one is moved into the ring
+SRFC_TEST(receive_buffer_shrinks_with_tail)
+{
+    constexpr std::size_t large = 4 * srfc_receive_buffer::max_ring_capacity;
+
+    srfc_receive_buffer buffer;
+    write(buffer, std::string(large, 'L') + "next");
+    std::weak_ptr<char> released = buffer.block();
+    {
+        const auto view = buffer.block();
+        buffer.consume(large);
+        CHECK(buffer.size() == 4);
+
+        write(buffer, " message");
+        CHECK(buffer.get_capacity() <= srfc_receive_buffer::max_ring_capacity);
+        CHECK(std::string(buffer.data(), buffer.size()) == "next message");
+    }
+    CHECK(released.expired());
+}
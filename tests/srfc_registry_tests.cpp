@@ -0,0 +1,143 @@
+// Method registry (read-copy-update): the snapshots outliving the changes, the registries following another one,
+// readers racing the writers, and the methods of the listener changed while its connections run.
+
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "srfc_loopback.hpp"
+
+#include "../network/includes/srfc_method_registry.hpp"
+
+using namespace net;
+using namespace srfc_test;
+
+using payload_t = srfc_method_table::payload_t;
+
+static srfc_method_table::view_callback_t answering(srfc_response::status_t status)
+{
+    return [status](const srfc_message_view&, payload_t*, std::size_t*) { return status; };
+}
+
+SRFC_TEST(registry_snapshot)
+{
+    srfc_method_registry registry;
+    const auto empty = registry.snapshot();
+    const auto v0 = registry.version();
+
+    const auto a = registry.add("A", answering(status_codes::ok));
+    const auto withA = registry.snapshot();
+    CHECK(registry.version() != v0);
+    CHECK(empty->find("A") == nullptr && withA->find(a) != nullptr);
+
+    // the published tables are never changed in place:
+    CHECK(registry.remove("A"));
+    CHECK(withA->find("A") != nullptr && registry.snapshot()->find("A") == nullptr);
+    CHECK(!registry.remove("A"));
+
+    // the ids are kept until clear():
+    CHECK(registry.add("A", answering(status_codes::ok)) == a);
+    registry.clear();
+    CHECK(registry.snapshot()->size() == 0);
+}
+
+SRFC_TEST(registry_follow)
+{
+    auto parent = std::make_shared<srfc_method_registry>();
+    parent->add("SHARED", answering(status_codes::ok));
+
+    srfc_method_registry child;
+    child.follow(parent);
+    CHECK(child.snapshot()->find("SHARED") != nullptr);
+
+    // the changes of the followed registry are seen at once:
+    const auto version = child.version();
+    parent->add("LATER", answering(status_codes::ok));
+    CHECK(child.version() != version);
+    CHECK(child.snapshot()->find("LATER") != nullptr);
+
+    // the changed child starts with a copy and stops following:
+    child.add("OWN", answering(status_codes::ok));
+    parent->add("UNSEEN", answering(status_codes::ok));
+    const auto own = child.snapshot();
+    CHECK(own->find("SHARED") != nullptr && own->find("LATER") != nullptr && own->find("OWN") != nullptr);
+    CHECK(own->find("UNSEEN") == nullptr && parent->snapshot()->find("OWN") == nullptr);
+}
+
+SRFC_TEST(registry_readers_and_writers)
+{
+    srfc_method_registry registry;
+    registry.add("STABLE", answering(status_codes::ok));
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> broken{0};
+    std::vector<std::thread> readers;
+    for(int i = 0; i < 4; ++i) {
+        readers.emplace_back([&] {
+            while(!stop.load()) {
+                const auto table = registry.snapshot();
+                const auto* stable = table->find("STABLE");
+                if(stable == nullptr || stable->name != "STABLE") {
+                    ++broken;
+                }
+                const auto* flip = table->find("FLIP");
+                if(flip != nullptr && flip->name != "FLIP") {
+                    ++broken;
+                }
+            }
+        });
+    }
+
+    for(int i = 0; i < 2000; ++i) {
+        registry.add("FLIP", answering(status_codes::ok));
+        registry.remove("FLIP");
+    }
+    stop = true;
+    for(auto& reader : readers) {
+        reader.join();
+    }
+    CHECK(broken.load() == 0);
+}
+
+// The methods added to (and removed from) the listener are seen by the connections it has accepted,
+// unless a connection has changed its own methods
+SRFC_TEST(registry_listener)
+{
+    loopback server;
+    server.listener.add_method("FIRST", answering(status_codes::ok));
+    server.start();
+    auto client = server.connect();
+    auto other = server.connect();
+
+    const auto status_of = [](srfc_connection& connection, const char* method) {
+        auto future = connection.send_request(srfc_request(method));
+        if(future.wait_for(patience) != std::future_status::ready) {
+            return status_codes::none;
+        }
+        return future.get().getStatusCode();
+    };
+
+    CHECK(status_of(*client, "SECOND") == status_codes::unknown_method);
+    server.listener.add_method("SECOND", answering(status_codes::no_content));
+    CHECK(status_of(*client, "SECOND") == status_codes::no_content);
+    CHECK(status_of(*other, "SECOND") == status_codes::no_content);
+
+    CHECK(server.listener.remove_method("FIRST"));
+    CHECK(status_of(*client, "FIRST") == status_codes::unknown_method);
+
+    // the accepted connection with its own method doesn't follow the listener anymore:
+    auto* accepted = server.accepted(1);
+    CHECK(accepted != nullptr);
+    if(accepted == nullptr) {
+        return;
+    }
+    accepted->add_method("OWN", answering(status_codes::ok));
+    server.listener.add_method("THIRD", answering(status_codes::ok));
+    const bool otherIsAccepted1 = status_of(*other, "OWN") == status_codes::ok;
+    auto& own = otherIsAccepted1 ? *other : *client;
+    auto& shared = otherIsAccepted1 ? *client : *other;
+    CHECK(status_of(own, "OWN") == status_codes::ok && status_of(own, "SECOND") == status_codes::no_content);
+    CHECK(status_of(own, "THIRD") == status_codes::unknown_method);
+    CHECK(status_of(shared, "THIRD") == status_codes::ok && status_of(shared, "OWN") == status_codes::unknown_method);
+}
@@ -0,0 +1,96 @@
+// Sharded listeners: the SO_REUSEPORT sockets of the shards serving the connections, and the loops pinned to the cores.
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "srfc_loopback.hpp"
+
+#include "../network/includes/srfc_reactor.hpp"
+
+using namespace net;
+using namespace srfc_test;
+
+// Number of the cores the loop thread of the reactor may run on:
+static int loop_cores(srfc_reactor& reactor, std::size_t loop)
+{
+    int fds[2];
+    CHECK(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == 0);
+
+    std::promise<int> cores;
+    std::atomic<bool> first{true};
+    const auto token = reactor.add(fds[0], [&](std::uint32_t) {
+        char byte;
+        while(::recv(fds[0], &byte, 1, 0) > 0);
+        if(first.exchange(false)) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            ::pthread_getaffinity_np(::pthread_self(), sizeof(set), &set);
+            cores.set_value(CPU_COUNT(&set));
+        }
+    }, loop);
+    CHECK(::send(fds[1], "x", 1, 0) == 1);
+
+    auto future = cores.get_future();
+    const auto res = future.wait_for(patience) == std::future_status::ready ? future.get() : 0;
+    reactor.remove(token);
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return res;
+}
+
+SRFC_TEST(shards_pin_threads)
+{
+    srfc_reactor reactor(2, false);
+    CHECK(!reactor.pins_threads());
+    reactor.pin_threads();
+    CHECK(reactor.pins_threads());
+    CHECK(loop_cores(reactor, 0) == 1 && loop_cores(reactor, 1) == 1);
+
+    srfc_reactor pinned(1, false, true);
+    CHECK(pinned.pins_threads() && loop_cores(pinned, 0) == 1);
+}
+
+// Every shard accepts connections on the same port, and the sharded listener pins the shared loops
+SRFC_TEST(shards_listen)
+{
+    using payload_t = srfc_connection::payload_t;
+
+    srfc_listener listener;
+    std::mutex mutex;
+    std::vector<std::unique_ptr<srfc_connection>> accepted;
+    listener.on_connection([&](srfc_connection c) {
+        auto connection = std::make_unique<srfc_connection>(std::move(c));
+        connection->invoke_deferred();
+        std::lock_guard<std::mutex> lg(mutex);
+        accepted.push_back(std::move(connection));
+    });
+    listener.add_method("PING", srfc_connection::view_callback_t(
+        [](const srfc_message_view&, payload_t*, std::size_t*) { return status_codes::ok; }));
+
+    listener.set_shards(2);
+    const auto port = free_port();
+    listener.listen(port, std::string("127.0.0.1"));
+    CHECK(listener.get_shards() == 2);
+    CHECK(srfc_reactor::shared().pins_threads());
+
+    std::vector<std::unique_ptr<srfc_connection>> clients;
+    for(int i = 0; i < 8; ++i) {
+        clients.push_back(std::make_unique<srfc_connection>(port, std::string("127.0.0.1")));
+        auto ping = clients.back()->send_request(srfc_request("PING"));
+        CHECK(ping.wait_for(patience) == std::future_status::ready);
+        CHECK(ping.get().getStatusCode() == status_codes::ok);
+    }
+
+    clients.clear();
+    listener.reset();
+    std::lock_guard<std::mutex> lg(mutex);
+    CHECK(accepted.size() == 8);
+}
@@ -0,0 +1,182 @@
+// Per-request completion slots: responses completing their own requests in any order, responses nobody waits for,
+// many requests in flight from many threads, and the pending requests of a closed connection.
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "srfc_loopback.hpp"
+
+#include "../network/includes/srfc_response.hpp"
+
+using namespace net;
+using namespace srfc_test;
+
+// Connection to the raw peer, which answers the hello as a legacy peer:
+static std::unique_ptr<srfc_connection> connect_legacy(raw_peer& peer)
+{
+    auto connection = std::make_unique<srfc_connection>(peer.port, std::string("127.0.0.1"));
+    peer.accept();
+
+    srfc_message_view hello;
+    CHECK(peer.read(hello));
+    peer.write(srfc_response(hello.getRequestId(), status_codes::unknown_method));
+    CHECK(connection->wait_handshake(patience));
+    return connection;
+}
+
+static srfc_response answer(const srfc_message_view& request, const std::string& payload)
+{
+    srfc_response response(request.getRequestId(), status_codes::ok);
+    response.setPayload(make_block(payload), payload.size());
+    return response;
+}
+
+SRFC_TEST(slots_out_of_order)
+{
+    raw_peer peer;
+    auto connection = connect_legacy(peer);
+
+    std::vector<std::future<srfc_response>> futures;
+    for(int i = 0; i < 3; ++i) {
+        futures.push_back(connection->send_request(make_request(std::to_string(i))));
+    }
+
+    std::vector<srfc_message_view> requests(3);
+    for(auto& request : requests) {
+        CHECK(peer.read(request));
+    }
+
+    // answered backwards, each response completes its own request only:
+    for(int i = 2; i >= 0; --i) {
+        const auto& request = requests[static_cast<std::size_t>(i)];
+        peer.write(answer(request, std::string(request.getPayloadData(), request.getPayloadSize())));
+        CHECK(futures[static_cast<std::size_t>(i)].wait_for(patience) == std::future_status::ready);
+        for(int j = 0; j < i; ++j) {
+            CHECK(futures[static_cast<std::size_t>(j)].wait_for(std::chrono::milliseconds(0)) == std::future_status::timeout);
+        }
+    }
+
+    for(int i = 0; i < 3; ++i) {
+        std::size_t size = 0;
+        const auto response = futures[static_cast<std::size_t>(i)].get();
+        const auto payload = response.getPayload(&size);
+        CHECK(response.getRequestId() == requests[static_cast<std::size_t>(i)].getRequestId());
+        CHECK(std::string(payload.get(), size) == std::to_string(i));
+    }
+}
+
+// The responses of unknown ids (and the second response of an id) are dropped, and the connection goes on:
+SRFC_TEST(slots_unsolicited_response)
+{
+    raw_peer peer;
+    auto connection = connect_legacy(peer);
+
+    auto future = connection->send_request(make_request("first"));
+    srfc_message_view request;
+    CHECK(peer.read(request));
+
+    auto unsolicited = answer(request, "unsolicited");
+    unsolicited.setRequestId(request.getRequestId() + 1000);
+    peer.write(unsolicited);
+    peer.write(answer(request, "answer"));
+    peer.write(answer(request, "duplicate"));
+
+    CHECK(future.wait_for(patience) == std::future_status::ready);
+    std::size_t size = 0;
+    const auto response = future.get();
+    const auto payload = response.getPayload(&size);
+    CHECK(std::string(payload.get(), size) == "answer");
+
+    auto next = connection->send_request(make_request("next"));
+    CHECK(peer.read(request));
+    peer.write(answer(request, "next"));
+    CHECK(next.wait_for(patience) == std::future_status::ready);
+    CHECK(next.get().getStatusCode() == status_codes::ok);
+    CHECK(connection->is_connected());
+}
+
+SRFC_TEST(slots_many_in_flight)
+{
+    using payload_t = srfc_connection::payload_t;
+    constexpr int threads = 8;
+    constexpr int requests = 200;
+
+    loopback server;
+    server.listener.add_method("ECHO", srfc_connection::view_callback_t(
+        [](const srfc_message_view& request, payload_t* pPayload, std::size_t* pSize) {
+            *pPayload = make_block(std::string(request.getPayloadData(), request.getPayloadSize()));
+            *pSize = request.getPayloadSize();
+            return status_codes::ok;
+        }));
+    server.start();
+    auto client = server.connect();
+
+    std::atomic<int> matched{0};
+    std::atomic<int> callbacks{0};
+    std::vector<std::thread> senders;
+    for(int t = 0; t < threads; ++t) {
+        senders.emplace_back([&, t] {
+            std::vector<std::pair<std::string, std::future<srfc_response>>> futures;
+            for(int i = 0; i < requests; ++i) {
+                auto payload = std::to_string(t) + ":" + std::to_string(i);
+                auto request = make_request(payload);
+                request.setMethod("ECHO");
+                if(i % 2 == 0) {
+                    futures.emplace_back(payload, client->send_request(request));
+                    continue;
+                }
+                client->send_request(request, [&, payload](srfc_response response) {
+                    std::size_t size = 0;
+                    const auto echoed = response.getPayload(&size);
+                    if(response.getStatusCode() == status_codes::ok && std::string(echoed.get(), size) == payload) {
+                        ++matched;
+                    }
+                    ++callbacks;
+                });
+            }
+
+            for(auto& [payload, future] : futures) {
+                if(future.wait_for(patience) != std::future_status::ready) {
+                    continue;
+                }
+                std::size_t size = 0;
+                const auto response = future.get();
+                const auto echoed = response.getPayload(&size);
+                if(response.getStatusCode() == status_codes::ok && std::string(echoed.get(), size) == payload) {
+                    ++matched;
+                }
+            }
+        });
+    }
+    for(auto& sender : senders) {
+        sender.join();
+    }
+
+    CHECK(eventually([&callbacks] { return callbacks.load() == threads * requests / 2; }));
+    CHECK(matched.load() == threads * requests);
+}
+
+// The requests pending when the peer closes are completed with connection_error:
+SRFC_TEST(slots_connection_closed)
+{
+    auto peer = std::make_unique<raw_peer>();
+    auto connection = connect_legacy(*peer);
+
+    auto future = connection->send_request(make_request("pending"));
+    std::promise<srfc_response> completed;
+    connection->send_request(make_request("pending"), [&completed](srfc_response response) {
+        completed.set_value(std::move(response));
+    });
+    srfc_message_view request;
+    CHECK(peer->read(request));
+    peer.reset();
+
+    CHECK(future.wait_for(patience) == std::future_status::ready);
+    CHECK(future.get().getStatusCode() == status_codes::connection_error);
+    auto callback = completed.get_future();
+    CHECK(callback.wait_for(patience) == std::future_status::ready);
+    CHECK(callback.get().getStatusCode() == status_codes::connection_error);
+}
@@ -0,0 +1,161 @@
+// Streamed responses: the chunks in order, the collected payload, the credit of the receiver
+// and the chunks beyond it.
+
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <string>
+
+#include "srfc_loopback.hpp"
+
+#include "../network/includes/srfc_frame.hpp"
+
+using namespace net;
+using namespace srfc_test;
+
+// Byte i of the streamed data:
+static char pattern(std::size_t i)
+{
+    return static_cast<char>('a' + i % 23);
+}
+
+// Streams size bytes of the pattern, counting the produced bytes:
+static srfc_connection::stream_callback_t pattern_stream(std::size_t size, std::atomic<std::size_t>* pProduced)
+{
+    return [size, pProduced](const srfc_message_view&, srfc_connection::chunk_source_t* pSource) {
+        auto offset = std::make_shared<std::size_t>(0);
+        *pSource = [size, pProduced, offset](char* buf, std::size_t len) {
+            const auto n = std::min(len, size - *offset);
+            for(std::size_t i = 0; i < n; ++i) {
+                buf[i] = pattern(*offset + i);
+            }
+            *offset += n;
+            *pProduced += n;
+            return n;
+        };
+        return status_codes::ok;
+    };
+}
+
+SRFC_TEST(stream_chunks_in_order)
+{
+    constexpr std::size_t size = 1000000;
+    std::atomic<std::size_t> produced{0};
+
+    loopback server;
+    server.listener.add_method("DATA", pattern_stream(size, &produced));
+    server.start();
+    const auto client = server.connect();
+
+    std::size_t received = 0;
+    std::size_t chunks = 0;
+    bool inOrder = true;
+    auto future = client->send_streaming_request(srfc_request("DATA"), [&](const char* data, std::size_t len) {
+        for(std::size_t i = 0; i < len; ++i) {
+            inOrder = inOrder && data[i] == pattern(received + i);
+        }
+        received += len;
+        ++chunks;
+    });
+
+    CHECK(future.wait_for(patience) == std::future_status::ready);
+    const auto response = future.get();
+    CHECK(response.getStatusCode() == status_codes::ok);
+    CHECK(received == size && inOrder);
+    CHECK(chunks >= size / srfc_connection::stream_chunk_size);
+    CHECK(eventually([&client] { return client->get_memory_usage().inbound == 0; }));
+}
+
+SRFC_TEST(stream_collected)
+{
+    constexpr std::size_t size = 300000;
+    std::atomic<std::size_t> produced{0};
+
+    loopback server;
+    server.listener.add_method("DATA", pattern_stream(size, &produced));
+    server.start();
+    const auto client = server.connect();
+
+    // send_request() gets the chunks as the payload of the response:
+    auto future = client->send_request(srfc_request("DATA"));
+    CHECK(future.wait_for(patience) == std::future_status::ready);
+    const auto response = future.get();
+
+    std::size_t payloadSize = 0;
+    const auto payload = response.getPayload(&payloadSize);
+    CHECK(response.getStatusCode() == status_codes::ok && payloadSize == size);
+    bool same = payloadSize == size;
+    for(std::size_t i = 0; same && i < size; ++i) {
+        same = payload.get()[i] == pattern(i);
+    }
+    CHECK(same);
+}
+
+// A slow receiver holds the sender at its window, and the queued chunks count in its budget:
+SRFC_TEST(stream_credit)
+{
+    constexpr std::size_t window = 2 * srfc_connection::stream_chunk_size;
+    constexpr std::size_t size = 8 * window;
+    std::atomic<std::size_t> produced{0};
+
+    loopback server;
+    server.listener.add_method("DATA", pattern_stream(size, &produced));
+    server.start();
+
+    auto client = server.connect(true);
+    client->set_stream_window(window);
+    client->invoke_deferred();
+    CHECK(client->wait_handshake(patience));
+
+    std::promise<void> go;
+    auto goFuture = go.get_future().share();
+    std::atomic<std::size_t> received{0};
+    auto future = client->send_streaming_request(srfc_request("DATA"), [&](const char*, std::size_t len) {
+        goFuture.wait();
+        received += len;
+    });
+
+    // the first chunk waits: the window is produced, and the rest of it is queued
+    CHECK(eventually([&] { return produced.load() == window; }));
+    CHECK(eventually([&] { return client->get_memory_usage().inbound >= window / 2; }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(produced.load() == window);
+
+    go.set_value();
+    CHECK(future.wait_for(patience) == std::future_status::ready);
+    CHECK(future.get().getStatusCode() == status_codes::ok);
+    CHECK(received.load() == size && produced.load() == size);
+    CHECK(eventually([&client] { return client->get_memory_usage().inbound == 0; }));
+}
+
+// A peer sending more than the granted credit fails the request, and the connection goes on:
+SRFC_TEST(stream_chunk_beyond_credit)
+{
+    constexpr std::size_t window = srfc_connection::stream_chunk_size;
+
+    raw_peer peer;
+    srfc_connection connection(peer.port, std::string("127.0.0.1"), true);
+    connection.set_stream_window(window);
+    connection.invoke_deferred();
+    peer.accept();
+
+    srfc_message_view view;
+    CHECK(peer.read(view));
+    peer.write(srfc_response(view.getRequestId(), status_codes::unknown_method));
+    CHECK(connection.wait_handshake(patience));
+
+    auto future = connection.send_streaming_request(srfc_request("DATA"), [](const char*, std::size_t) {});
+    CHECK(peer.read(view));
+
+    const std::string data(window + 1, 'x');
+    std::size_t headerSize = 0;
+    const auto header = serialize_stream_header(frame_type::chunk, view.getRequestId(), data.size(), 0,
+                                                wire_format::srfc_v1, &headerSize);
+    peer.write(header.get(), headerSize);
+    peer.write(data.data(), data.size());
+
+    CHECK(future.wait_for(patience) == std::future_status::ready);
+    CHECK(future.get().getStatusCode() == status_codes::memory_budget_exceeded);
+    CHECK(connection.is_connected());
+    CHECK(eventually([&connection] { return connection.get_memory_usage().inbound == 0; }));
+}
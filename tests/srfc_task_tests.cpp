@@ -0,0 +1,185 @@
+// Coroutines: tasks awaiting tasks, exceptions, the methods written as tasks and async_send_request()
+// (the calls awaited inside of the tasks block no thread, so more of them are in flight than there are workers).
+
+#include <future>
+#include <stdexcept>
+#include <vector>
+
+#include "srfc_loopback.hpp"
+
+#include "../network/includes/srfc_task.hpp"
+
+using namespace net;
+using namespace srfc_test;
+
+static srfc_task<int> add(int a, int b)
+{
+    co_return a + b;
+}
+
+static srfc_task<int> sum(int n)
+{
+    int total = 0;
+    for(int i = 1; i <= n; ++i) {
+        total += co_await add(i, 0);
+    }
+    co_return total;
+}
+
+static srfc_task<int> fail()
+{
+    throw std::runtime_error("failed");
+    co_return 0;
+}
+
+static srfc_task<> run(srfc_task<int> task, std::promise<int>* pResult)
+{
+    try {
+        pResult->set_value(co_await std::move(task));
+    }
+    catch(...) {
+        pResult->set_exception(std::current_exception());
+    }
+}
+
+SRFC_TEST(task_result)
+{
+    std::promise<int> result;
+    auto task = sum(100);
+    CHECK(task.valid());
+    run(std::move(task), &result).detach();
+    auto future = result.get_future();
+    CHECK(future.wait_for(std::chrono::milliseconds(0)) == std::future_status::ready);
+    CHECK(future.get() == 5050);
+
+    // the exception of the task is rethrown by co_await:
+    std::promise<int> failed;
+    run(fail(), &failed).detach();
+    bool thrown = false;
+    try {
+        failed.get_future().get();
+    }
+    catch(const std::runtime_error&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+// The task is started when it's awaited or detached:
+SRFC_TEST(task_lazy)
+{
+    bool started = false;
+    auto task = [](bool* pStarted) -> srfc_task<> {
+        *pStarted = true;
+        co_return;
+    }(&started);
+    CHECK(!started);
+    task.detach();
+    CHECK(started && !task.valid());
+}
+
+static srfc_task<srfc_response> relay(srfc_connection* backend, srfc_message_view request)
+{
+    srfc_request forwarded("ECHO");
+    forwarded.setPayload(make_block(std::string(request.getPayloadData(), request.getPayloadSize())),
+                         request.getPayloadSize());
+    const auto answer = co_await backend->async_send_request(std::move(forwarded), patience);
+
+    std::size_t size = 0;
+    const auto payload = answer.getPayload(&size);
+    srfc_response response(request.getRequestId(), answer.getStatusCode());
+    response.setPayload(payload, size);
+    co_return response;
+}
+
+// The front method relays the requests to the backend, which answers only when all of them are in flight:
+// blocking methods would hold both workers and relay 2 requests at most
+SRFC_TEST(task_method_relay)
+{
+    constexpr std::size_t calls = 16;
+
+    raw_peer backend;
+    srfc_connection toBackend(backend.port, std::string("127.0.0.1"));
+    backend.accept();
+    srfc_message_view hello;
+    CHECK(backend.read(hello));
+    backend.write(srfc_response(hello.getRequestId(), status_codes::unknown_method));
+    CHECK(toBackend.wait_handshake(patience));
+
+    loopback front;
+    srfc_connection* pBackend = &toBackend;
+    front.listener.add_method("RELAY", srfc_connection::task_callback_t(
+        [pBackend](srfc_message_view request) { return relay(pBackend, std::move(request)); }));
+    front.start();
+    auto client = front.connect();
+
+    std::vector<std::future<srfc_response>> relayed;
+    for(std::size_t i = 0; i < calls; ++i) {
+        auto request = make_request("relayed " + std::to_string(i));
+        request.setMethod("RELAY");
+        relayed.push_back(client->send_request(request));
+    }
+
+    std::vector<srfc_message_view> forwarded(calls);
+    for(auto& request : forwarded) {
+        CHECK(backend.read(request));
+    }
+    for(const auto& request : forwarded) {
+        srfc_response response(request.getRequestId(), status_codes::ok);
+        response.setPayload(make_block(std::string(request.getPayloadData(), request.getPayloadSize())),
+                            request.getPayloadSize());
+        backend.write(response);
+    }
+
+    for(std::size_t i = 0; i < calls; ++i) {
+        CHECK(relayed[i].wait_for(patience) == std::future_status::ready);
+        std::size_t size = 0;
+        const auto response = relayed[i].get();
+        const auto payload = response.getPayload(&size);
+        CHECK(response.getStatusCode() == status_codes::ok);
+        CHECK(std::string(payload.get(), size) == "relayed " + std::to_string(i));
+    }
+}
+
+static srfc_task<srfc_response> thrower(srfc_message_view)
+{
+    throw std::runtime_error("thrown by the task");
+    co_return srfc_response(0);
+}
+
+static srfc_task<> await_call(srfc_connection* connection, srfc_request request,
+                              std::chrono::milliseconds timeout, std::promise<srfc_response>* pResponse)
+{
+    pResponse->set_value(co_await connection->async_send_request(std::move(request), timeout));
+}
+
+// A throwing task method answers unhandled_exception, and an awaited call may time out:
+SRFC_TEST(task_errors)
+{
+    using payload_t = srfc_connection::payload_t;
+
+    loopback server;
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    server.listener.add_method("THROW", srfc_connection::task_callback_t(thrower));
+    server.listener.add_method("SLOW", srfc_connection::view_callback_t(
+        [released](const srfc_message_view&, payload_t*, std::size_t*) {
+            released.wait_for(patience);
+            return status_codes::ok;
+        }));
+    server.start();
+    auto client = server.connect();
+
+    std::promise<srfc_response> thrown;
+    await_call(client.get(), srfc_request("THROW"), patience, &thrown).detach();
+    auto future = thrown.get_future();
+    CHECK(future.wait_for(patience) == std::future_status::ready);
+    CHECK(future.get().getStatusCode() == status_codes::unhandled_exception);
+
+    std::promise<srfc_response> late;
+    await_call(client.get(), srfc_request("SLOW"), std::chrono::milliseconds(30), &late).detach();
+    future = late.get_future();
+    CHECK(future.wait_for(patience) == std::future_status::ready);
+    CHECK(future.get().getStatusCode() == status_codes::response_timeout);
+    release.set_value();
+}
@@ -0,0 +1,78 @@
+#ifndef SRFC_TEST_HPP
+#define SRFC_TEST_HPP
+
+// Minimal test harness: SRFC_TEST(name) registers a test of the file, CHECK(cond) counts the failed checks.
+// srfc_tests.cpp runs the registered tests (or the ones whose names contain its argument).
+
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../network/includes/srfc_frame_parser.hpp"
+#include "../network/includes/srfc_message_view.hpp"
+#include "../network/includes/srfc_request.hpp"
+#include "../network/includes/utilities/array_deleter.hpp"
+
+namespace srfc_test
+{
+    using test_t = void(*)();
+
+    inline std::vector<std::pair<const char*, test_t>>& tests()
+    {
+        static std::vector<std::pair<const char*, test_t>> registered;
+        return registered;
+    }
+
+    inline int& failed()
+    {
+        static int count = 0;
+        return count;
+    }
+
+    struct registrar
+    {
+        registrar(const char* name, test_t test) { tests().emplace_back(name, test); }
+    };
+
+    inline std::shared_ptr<char> make_block(const std::string& str)
+    {
+        std::shared_ptr<char> res(new char[str.size()], array_deleter<char>());
+        std::memcpy(res.get(), str.data(), str.size());
+        return res;
+    }
+
+    inline net::srfc_request make_request(const std::string& payload)
+    {
+        net::srfc_request request("PRINT");
+        request.addParam("MESSAGE", "hello");
+        request.addParam("INTERVAL", "5");
+        request.setPayload(make_block(payload), payload.size());
+        return request;
+    }
+
+    // Parses the complete frame:
+    inline net::parse_status parse_frame(const std::shared_ptr<char>& frame, std::size_t size, net::srfc_message_view& view)
+    {
+        net::srfc_frame_parser parser;
+        return parser.parse(frame, frame.get(), size, view);
+    }
+} // namespace srfc_test
+
+#define SRFC_TEST(name)                                                         \
+    static void name();                                                         \
+    static const srfc_test::registrar name##_registrar(#name, name);            \
+    static void name()
+
+#define CHECK(cond)                                                             \
+    do {                                                                        \
+        if(!(cond)) {                                                           \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": " #cond << std::endl; \
+            ++srfc_test::failed();                                              \
+        }                                                                       \
+    } while(false)
+
+#endif
@@ -0,0 +1,40 @@
+// Runs the tests registered by the srfc_*_tests.cpp files (or the ones whose names contain the argument).
+// Returns the number of failed checks.
+// With SRFC_TEST_EPOLL set, the shared reactor runs on epoll (the handlers read and write the sockets)
+// instead of completing the I/O on io_uring.
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "srfc_test.hpp"
+
+#include "../network/includes/srfc_reactor.hpp"
+
+int main(int argc, char** argv)
+{
+    const std::string filter = argc > 1 ? argv[1] : "";
+    if(std::getenv("SRFC_TEST_EPOLL") != nullptr) {
+        net::srfc_reactor::configure_shared(0, false);
+    }
+
+    for(const auto& [name, test] : srfc_test::tests()) {
+        if(std::string(name).find(filter) == std::string::npos) {
+            continue;
+        }
+
+        const auto before = srfc_test::failed();
+        test();
+        if(srfc_test::failed() != before) {
+            std::cerr << name << " failed" << std::endl;
+        }
+    }
+
+    if(srfc_test::failed() != 0) {
+        std::cerr << srfc_test::failed() << " check(s) failed" << std::endl;
+        return srfc_test::failed();
+    }
+
+    std::cout << "All tests passed" << std::endl;
+    return 0;
+}
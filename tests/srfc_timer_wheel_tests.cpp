@@ -0,0 +1,134 @@
+// Timer wheel and request deadlines: firing after the delay, in the order of the deadlines, timers beyond
+// one revolution, cancel(), and the requests completed with status_codes::response_timeout.
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <vector>
+
+#include "srfc_loopback.hpp"
+
+#include "../network/includes/srfc_timer_wheel.hpp"
+
+using namespace net;
+using namespace srfc_test;
+
+SRFC_TEST(timer_fires_after_delay)
+{
+    srfc_timer_wheel wheel(std::chrono::milliseconds(1), 64);
+
+    std::promise<srfc_timer_wheel::clock_t::time_point> fired;
+    const auto scheduled = srfc_timer_wheel::clock_t::now();
+    const auto id = wheel.schedule(std::chrono::milliseconds(30), [&fired] {
+        fired.set_value(srfc_timer_wheel::clock_t::now());
+    });
+    CHECK(id != 0);
+    CHECK(wheel.size() == 1);
+
+    auto future = fired.get_future();
+    CHECK(future.wait_for(patience) == std::future_status::ready);
+    CHECK(future.get() - scheduled >= std::chrono::milliseconds(30));
+    CHECK(eventually([&wheel] { return wheel.size() == 0; }));
+    CHECK(!wheel.cancel(id));
+}
+
+SRFC_TEST(timer_order)
+{
+    srfc_timer_wheel wheel(std::chrono::milliseconds(1), 16);
+
+    std::mutex mutex;
+    std::vector<int> order;
+    std::promise<void> done;
+    const int delays[] = {40, 10, 30, 20};
+    for(const int delay : delays) {
+        wheel.schedule(std::chrono::milliseconds(delay), [&, delay] {
+            std::lock_guard<std::mutex> lg(mutex);
+            order.push_back(delay);
+            if(order.size() == 4) {
+                done.set_value();
+            }
+        });
+    }
+
+    CHECK(done.get_future().wait_for(patience) == std::future_status::ready);
+    CHECK((order == std::vector<int>{10, 20, 30, 40}));
+}
+
+// 8 slots of 1ms: the timer waits in its slot for more than 6 revolutions
+SRFC_TEST(timer_beyond_revolution)
+{
+    srfc_timer_wheel wheel(std::chrono::milliseconds(1), 8);
+
+    std::atomic<int> fired{0};
+    const auto scheduled = srfc_timer_wheel::clock_t::now();
+    std::promise<srfc_timer_wheel::clock_t::time_point> late;
+    wheel.schedule(std::chrono::milliseconds(50), [&late] { late.set_value(srfc_timer_wheel::clock_t::now()); });
+    wheel.schedule(std::chrono::milliseconds(2), [&fired] { ++fired; });
+
+    auto future = late.get_future();
+    CHECK(future.wait_for(patience) == std::future_status::ready);
+    CHECK(future.get() - scheduled >= std::chrono::milliseconds(50));
+    CHECK(fired.load() == 1);
+}
+
+SRFC_TEST(timer_cancel)
+{
+    srfc_timer_wheel wheel(std::chrono::milliseconds(1), 64);
+
+    std::atomic<int> fired{0};
+    const auto cancelled = wheel.schedule(std::chrono::milliseconds(20), [&fired] { fired += 100; });
+    const auto kept = wheel.schedule(std::chrono::milliseconds(40), [&fired] { ++fired; });
+    CHECK(cancelled != kept);
+    CHECK(wheel.size() == 2);
+
+    CHECK(wheel.cancel(cancelled));
+    CHECK(!wheel.cancel(cancelled));
+    CHECK(wheel.size() == 1);
+
+    CHECK(eventually([&fired] { return fired.load() != 0; }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(fired.load() == 1);
+    CHECK(!wheel.cancel(kept));
+}
+
+// The request whose method doesn't answer in time is completed with response_timeout; the late response is dropped
+// and the connection goes on:
+SRFC_TEST(timer_request_deadline)
+{
+    using payload_t = srfc_connection::payload_t;
+
+    loopback server;
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    server.listener.add_method("SLOW", srfc_connection::view_callback_t(
+        [released](const srfc_message_view&, payload_t*, std::size_t*) {
+            released.wait_for(patience);
+            return status_codes::ok;
+        }));
+    server.listener.add_method("PING", srfc_connection::view_callback_t(
+        [](const srfc_message_view&, payload_t*, std::size_t*) { return status_codes::ok; }));
+    server.start();
+    auto client = server.connect();
+
+    const auto sent = std::chrono::steady_clock::now();
+    auto slow = client->send_request(srfc_request("SLOW"), std::chrono::milliseconds(50));
+    CHECK(slow.wait_for(patience) == std::future_status::ready);
+    CHECK(std::chrono::steady_clock::now() - sent >= std::chrono::milliseconds(50));
+    CHECK(slow.get().getStatusCode() == status_codes::response_timeout);
+
+    // the callback form, and a request answered in time:
+    std::promise<srfc_response> timedOut;
+    client->send_request(srfc_request("SLOW"), std::chrono::milliseconds(20), [&timedOut](srfc_response response) {
+        timedOut.set_value(std::move(response));
+    });
+    auto callback = timedOut.get_future();
+    CHECK(callback.wait_for(patience) == std::future_status::ready);
+    CHECK(callback.get().getStatusCode() == status_codes::response_timeout);
+
+    release.set_value();
+    auto ping = client->send_request(srfc_request("PING"), patience);
+    CHECK(ping.wait_for(patience) == std::future_status::ready);
+    CHECK(ping.get().getStatusCode() == status_codes::ok);
+    CHECK(client->is_connected());
+}
@@ -0,0 +1,153 @@
+// when_all() and when_any(): the responses in the order of the calls, the first completed call,
+// the calls that can't be sent or time out, and the calls over several connections.
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "srfc_loopback.hpp"
+
+#include "../network/includes/srfc_when.hpp"
+
+using namespace net;
+using namespace srfc_test;
+
+// The server answers DELAY after MS milliseconds with the payload of the request:
+static void add_delay(loopback& server)
+{
+    using payload_t = srfc_connection::payload_t;
+    server.listener.add_method("DELAY", srfc_connection::view_callback_t(
+        [](const srfc_message_view& request, payload_t* pPayload, std::size_t* pSize) {
+            fprintf(stderr, "T %lld start %s ms=%s tid=%zu\n", (long long)(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() % 100000), std::string(request.getPayloadData(), request.getPayloadSize()).c_str(), std::string(request.getParam("MS")).c_str(), std::hash<std::thread::id>()(std::this_thread::get_id()) % 1000);
+            std::this_thread::sleep_for(std::chrono::milliseconds(std::stoi(std::string(request.getParam("MS")))));
+            *pPayload = make_block(std::string(request.getPayloadData(), request.getPayloadSize()));
+            *pSize = request.getPayloadSize();
+            return status_codes::ok;
+        }));
+}
+
+static srfc_request delayed(int ms, const std::string& payload)
+{
+    srfc_request request("DELAY");
+    request.addParam("MS", std::to_string(ms));
+    request.setPayload(make_block(payload), payload.size());
+    return request;
+}
+
+static std::string payload_of(const srfc_response& response)
+{
+    std::size_t size = 0;
+    const auto payload = response.getPayload(&size);
+    return std::string(payload.get(), size);
+}
+
+SRFC_TEST(when_all_order)
+{
+    loopback server;
+    add_delay(server);
+    server.start();
+    auto client = server.connect();
+
+    std::vector<srfc_call> calls;
+    calls.push_back({client.get(), delayed(60, "slow")});
+    calls.push_back({client.get(), delayed(0, "fast")});
+    calls.push_back({nullptr, delayed(0, "unsent")});
+    // (the late handler still holds a worker of the shared executor after the test, keep it short)
+    calls.push_back({client.get(), delayed(100, "late"), std::chrono::milliseconds(20)});
+    calls.push_back({client.get(), delayed(20, "medium")});
+
+    auto all = when_all(std::move(calls));
+    CHECK(all.wait_for(patience) == std::future_status::ready);
+    const auto responses = all.get();
+    CHECK(responses.size() == 5);
+    if(responses.size() != 5) {
+        return;
+    }
+    CHECK(payload_of(responses[0]) == "slow" && payload_of(responses[1]) == "fast");
+    CHECK(responses[2].getStatusCode() == status_codes::connection_error);
+    CHECK(responses[3].getStatusCode() == status_codes::response_timeout);
+    CHECK(payload_of(responses[4]) == "medium");
+}
+
+SRFC_TEST(when_all_callback)
+{
+    loopback first;
+    loopback second;
+    add_delay(first);
+    add_delay(second);
+    first.start();
+    second.start();
+    auto a = first.connect();
+    auto b = second.connect();
+
+    std::vector<srfc_call> calls;
+    for(int i = 0; i < 10; ++i) {
+        calls.push_back({(i % 2 == 0 ? a : b).get(), delayed(i % 3, std::to_string(i))});
+    }
+
+    std::promise<std::vector<srfc_response>> completed;
+    when_all(std::move(calls), [&completed](std::vector<srfc_response> responses) {
+        completed.set_value(std::move(responses));
+    });
+    auto future = completed.get_future();
+    CHECK(future.wait_for(patience) == std::future_status::ready);
+    const auto responses = future.get();
+    CHECK(responses.size() == 10);
+    for(std::size_t i = 0; i < responses.size(); ++i) {
+        CHECK(payload_of(responses[i]) == std::to_string(i));
+    }
+
+    // no calls: the callback is called in place
+    bool called = false;
+    when_all({}, [&called](std::vector<srfc_response> responses) { called = responses.empty(); });
+    CHECK(called);
+}
+
+SRFC_TEST(when_any_first)
+{
+    fprintf(stderr, "T %lld any begins\n", (long long)(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() % 100000));
+    loopback server;
+    add_delay(server);
+    server.start();
+    auto client = server.connect();
+
+    std::vector<srfc_call> calls;
+    calls.push_back({client.get(), delayed(300, "slow")});
+    calls.push_back({client.get(), delayed(0, "fast")});
+    calls.push_back({client.get(), delayed(150, "medium")});
+
+    auto any = when_any(std::move(calls));
+    CHECK(any.wait_for(patience) == std::future_status::ready);
+    const auto [index, response] = any.get();
+    CHECK(index == 1);
+    CHECK(payload_of(response) == "fast");
+
+    // the callback is called once, for the first completion:
+    std::atomic<int> called{0};
+    std::promise<std::size_t> first;
+    std::vector<srfc_call> more;
+    more.push_back({nullptr, delayed(0, "unsent")});
+    more.push_back({client.get(), delayed(0, "sent")});
+    when_any(std::move(more), [&](std::size_t i, srfc_response) {
+        if(++called == 1) {
+            first.set_value(i);
+        }
+    });
+    auto future = first.get_future();
+    CHECK(future.wait_for(patience) == std::future_status::ready);
+    CHECK(future.get() == 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(called.load() == 1);
+
+    bool thrown = false;
+    try {
+        when_any({});
+    }
+    catch(const std::invalid_argument&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}